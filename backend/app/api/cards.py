@@ -17,42 +17,23 @@ router = APIRouter(prefix="/api/cards", tags=["RFID Cards"])
 limiter = Limiter(key_func=get_remote_address)
 
 
-def _sync_cards_to_esp32(db: Session):
-    """Helper function to sync all active cards to ESP32 via MQTT"""
+def _sync_cards_to_esp32(db: Session, card_uid: Optional[str] = None, full: bool = False):
+    """Record a card change (if any) and push pending whitelist changes to ESP32 via MQTT"""
     from app.services.mqtt_service import mqtt_service
+    from app.services import whitelist_sync_service
     
     try:
-        # Get all active cards
-        active_cards = db.query(RFIDCard).filter(RFIDCard.is_active == True).all()
+        whitelist_sync_service.ensure_baseline(db)
         
-        # Build cards array for ESP32.
-        # Keep payload minimal to avoid MQTT buffer truncation on device.
-        cards_data = [
-            {
-                "card_uid": card.card_uid,
-                "access_level": getattr(card.access_level, "value", card.access_level),
-                "is_active": bool(card.is_active),
-            }
-            for card in active_cards
-        ]
-
-        payload = {"cards": cards_data}
-
-        # Send sync command via MQTT
-        success = mqtt_service.send_command("sync_whitelist", payload)
+        if card_uid is not None:
+            card = db.query(RFIDCard).filter(RFIDCard.card_uid == card_uid).first()
+            whitelist_sync_service.record_card_change(db, card_uid, card)
+        
+        # Sends only what changed since the version the ESP32 last acked
+        success = mqtt_service.sync_whitelist(db, full=full)
         
-        if success:
-            try:
-                import json
-                approx_bytes = len(json.dumps({"command": "sync_whitelist", **payload}))
-            except Exception:
-                approx_bytes = None
-            logger.info(
-                f"✓ Synced {len(cards_data)} cards to ESP32"
-                + (f" (~{approx_bytes} bytes)" if approx_bytes is not None else "")
-            )
-        else:
-            logger.warning("⚠ Failed to send sync command to ESP32")
+        if not success:
+            logger.warning("⚠ Failed to send whitelist sync to ESP32")
         
         return success
     except Exception as e:
@@ -155,7 +136,7 @@ def create_card(
     db.refresh(db_card)
     
     # Auto-sync to ESP32
-    _sync_cards_to_esp32(db)
+    _sync_cards_to_esp32(db, card_uid=db_card.card_uid)
     
     return db_card
 
@@ -186,7 +167,7 @@ def update_card(
     db.refresh(card)
     
     # Auto-sync to ESP32
-    _sync_cards_to_esp32(db)
+    _sync_cards_to_esp32(db, card_uid=card.card_uid)
     
     return card
 
@@ -218,7 +199,7 @@ def delete_card(
     db.commit()
 
     # Auto-sync to ESP32 so removed card no longer exists in whitelist
-    _sync_cards_to_esp32(db)
+    _sync_cards_to_esp32(db, card_uid=card_uid)
 
     return {"message": "Card deleted successfully"}
 
@@ -255,9 +236,9 @@ def sync_cards_to_esp32(
     current_user: dict = Depends(get_current_user)
 ):
     """
-    Manually trigger synchronization of all cards to ESP32
+    Manually trigger synchronization of all cards to ESP32 (full snapshot)
     """
-    success = _sync_cards_to_esp32(db)
+    success = _sync_cards_to_esp32(db, full=True)
     
     if success:
         return {"message": "Cards synchronized to ESP32 successfully"}
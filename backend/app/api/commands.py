@@ -83,6 +83,33 @@ def refresh_status(current_user: dict = Depends(get_current_user)):
         )
 
 
+@router.post("/refresh-metrics")
+def refresh_metrics(current_user: dict = Depends(get_current_user)):
+    """
+    Request ESP32 to send its latency percentiles
+    """
+    success = mqtt_service.request_metrics()
+    
+    if success:
+        return {
+            "message": "Metrics refresh requested",
+            "status": "sent"
+        }
+    else:
+        raise HTTPException(
+            status_code=503,
+            detail="Failed to send command. MQTT connection might be down."
+        )
+
+
+@router.get("/metrics")
+def get_metrics(current_user: dict = Depends(get_current_user)):
+    """
+    Latest per-stage latency percentiles reported by the ESP32 (microseconds)
+    """
+    return mqtt_service.device_metrics
+
+
 @router.post("/scan-mode")
 def activate_scan_mode(
     command: dict,
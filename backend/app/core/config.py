@@ -41,6 +41,12 @@ class Settings(BaseSettings):
     DAILY_MAX_RATE: float = 50.0
     GRACE_PERIOD_MINUTES: int = 15
     
+    # Whitelist sync (sized so each message fits the ESP32's 512-byte MQTT buffer)
+    WHITELIST_CARDS_PER_CHUNK: int = 10  # Cards per whitelist_snapshot message
+    WHITELIST_OPS_PER_DELTA: int = 8  # Operations per whitelist_delta message
+    WHITELIST_SNAPSHOT_THRESHOLD: int = 40  # Send a snapshot instead when more changes are pending
+    WHITELIST_RESULT_TIMEOUT: float = 10.0  # Seconds to wait for a whitelist message's result before sending the next
+    
     # CORS
     ALLOWED_ORIGINS: str = "http://localhost:8000,http://127.0.0.1:8000,http://localhost:3000,http://127.0.0.1:3000"
     
@@ -109,3 +109,23 @@ class ParkingPricing(Base):
     daily_max_rate = Column(Float, nullable=False, default=50.0)
     grace_period_minutes = Column(Integer, nullable=False, default=15)
     updated_at = Column(DateTime, default=datetime.utcnow, onupdate=datetime.utcnow)
+
+
+class WhitelistChange(Base):
+    """Append-only log of whitelist changes; version is the ESP32 sync cursor"""
+    __tablename__ = "whitelist_changes"
+
+    version = Column(Integer, primary_key=True, autoincrement=True)
+    card_uid = Column(String, nullable=False, index=True)
+    op = Column(String, nullable=False)  # upsert, remove
+    access_level = Column(Integer, nullable=True)  # Firmware access level code (upsert only)
+    created_at = Column(DateTime, default=datetime.utcnow)
+
+
+class DeviceEventReceipt(Base):
+    """(boot, seq) of every processed ESP32 outbox event, for replay dedupe"""
+    __tablename__ = "device_event_receipts"
+
+    boot_id = Column(Integer, primary_key=True)
+    sequence = Column(Integer, primary_key=True)
+    received_at = Column(DateTime, default=datetime.utcnow)
@@ -0,0 +1,131 @@
+"""Decoder for the compact MessagePack and batched event formats.
+
+With ``MQTT_EVENT_ENCODING`` set to ``EVENT_ENCODING_MSGPACK`` the ESP32
+publishes entry/exit events as MessagePack maps with one-letter keys on the
+``parking/v2/events/*`` topics. Events that arrive together are sent as one
+``{"events": [...]}`` message on a batch topic, in either encoding. This
+module expands all of them back into single JSON-shaped events on the v1
+topics so the rest of the backend handles every format the same way.
+"""
+
+import json
+from typing import List, Optional, Tuple
+
+import msgpack
+
+# v2 topic -> (v1 topic, action, gate)
+COMPACT_TOPICS = {
+    "parking/v2/events/entry": ("parking/events/entry", "entry", "entrance"),
+    "parking/v2/events/exit": ("parking/events/exit", "exit", "exit"),
+}
+
+BATCH_TOPIC = "parking/events/batch"
+COMPACT_BATCH_TOPIC = "parking/v2/events/batch"
+
+# Batched compact events carry their kind ("k") instead of a topic
+COMPACT_KINDS = {
+    0: "parking/v2/events/entry",
+    1: "parking/v2/events/exit",
+}
+
+# JSON action -> v1 topic
+ACTION_TOPICS = {
+    "entry": "parking/events/entry",
+    "exit": "parking/events/exit",
+}
+
+# Status codes (index = code); mirrors EVENT_STATUS_CODES in MQTTHandler.cpp
+STATUS_CODES = (
+    "success",
+    "success_no_slot",
+    "denied_unauthorized",
+    "denied_full",
+)
+
+# Compact key -> JSON key
+FIELD_NAMES = {
+    "u": "card_uid",
+    "s": "slot_id",
+    "a": "available_slots",
+    "t": "timestamp",
+    "d": "duration",
+    "b": "boot",
+    "q": "seq",
+}
+
+
+ENCODED_TOPICS = (BATCH_TOPIC, COMPACT_BATCH_TOPIC, *COMPACT_TOPICS)
+
+
+def is_encoded_topic(topic: str) -> bool:
+    """True for topics whose payload is not a single JSON message."""
+    return topic in ENCODED_TOPICS
+
+
+def decode_events(topic: str, payload: bytes) -> List[Tuple[str, dict]]:
+    """Decode a compact or batched message into ``[(v1 topic, event), ...]``.
+
+    Raises ``ValueError`` if the payload does not match the topic's format.
+    """
+    if topic in COMPACT_TOPICS:
+        return [_expand_compact(topic, _unpack(payload))]
+
+    if topic == COMPACT_BATCH_TOPIC:
+        batch = _unpack(payload)
+        events = []
+        for packed in _batch_events(batch):
+            kind_topic = COMPACT_KINDS.get(packed.get("k"))
+            if kind_topic is None:
+                raise ValueError(f"unknown event kind {packed.get('k')!r}")
+            events.append(_expand_compact(kind_topic, packed))
+        return events
+
+    try:
+        batch = json.loads(payload)
+    except ValueError as e:
+        raise ValueError(f"invalid JSON batch: {e}") from e
+    events = []
+    for event in _batch_events(batch):
+        action_topic = ACTION_TOPICS.get(event.get("action"))
+        if action_topic is None:
+            raise ValueError(f"unknown event action {event.get('action')!r}")
+        events.append((action_topic, event))
+    return events
+
+
+def _unpack(payload: bytes):
+    try:
+        packed = msgpack.unpackb(payload, raw=False)
+    except Exception as e:
+        raise ValueError(f"invalid MessagePack payload: {e}") from e
+    if not isinstance(packed, dict):
+        raise ValueError("MessagePack message is not a map")
+    return packed
+
+
+def _batch_events(batch) -> list:
+    events = batch.get("events") if isinstance(batch, dict) else None
+    if not isinstance(events, list) or not all(isinstance(e, dict) for e in events):
+        raise ValueError("batch has no event list")
+    return events
+
+
+def _expand_compact(topic: str, packed: dict) -> Tuple[str, dict]:
+    legacy_topic, action, gate = COMPACT_TOPICS[topic]
+
+    data = {"action": action, "gate": gate}
+    for key, value in packed.items():
+        if key == "st":
+            data["status"] = _status_name(value)
+        elif key in FIELD_NAMES:
+            data[FIELD_NAMES[key]] = value
+
+    return legacy_topic, data
+
+
+def _status_name(value) -> Optional[str]:
+    if isinstance(value, int):
+        if 0 <= value < len(STATUS_CODES):
+            return STATUS_CODES[value]
+        return f"unknown_{value}"
+    return value
@@ -4,14 +4,19 @@ MQTT Client Service for communicating with ESP32 parking system
 import paho.mqtt.client as mqtt
 import json
 import logging
+import threading
+import time
 from typing import Callable, Optional
 from datetime import datetime
+from sqlalchemy.exc import IntegrityError
 from sqlalchemy.orm import Session
 from app.core.config import settings
 from app.core.database import SessionLocal
-from app.models.models import EntryExitLog, ParkingSlot, SystemEvent, EventSeverity
+from app.models.models import EntryExitLog, ParkingSlot, SystemEvent, EventSeverity, DeviceEventReceipt
 from app.services.parking_service import calculate_parking_fee
 from app.services.pricing_service import get_pricing
+from app.services import whitelist_sync_service
+from app.services import event_codec
 
 logger = logging.getLogger(__name__)
 
@@ -21,6 +26,15 @@ class MQTTService:
         self.client: Optional[mqtt.Client] = None
         self.connected = False
         self.message_callbacks = []
+        self.device_whitelist_version: Optional[int] = None  # Last version acked by ESP32
+        self.device_status: dict = {}  # Latest status, with partial updates merged in
+        self.device_metrics: dict = {}  # Latest latency percentiles (get_metrics)
+        self.next_command_id = 1  # Correlation id for the next command
+        self.pending_commands: dict = {}  # Command id -> name, until its result arrives
+        self.whitelist_lock = threading.Lock()  # Guards the whitelist message fields below
+        self.whitelist_outgoing: list = []  # (command, payload) waiting for the previous one to run
+        self.whitelist_in_flight = 0  # Id of the whitelist message the ESP32 has not run yet
+        self.whitelist_sent_at = 0.0  # time.monotonic() when it was published
         
     def on_connect(self, client, userdata, flags, rc):
         """Callback when connected to MQTT broker"""
@@ -32,10 +46,24 @@ class MQTTService:
             client.subscribe("parking/events/entry")
             client.subscribe("parking/events/exit")
             client.subscribe("parking/events/scan")
+            client.subscribe("parking/events/denied")
             client.subscribe("parking/system")
+            client.subscribe("parking/system/metrics")
+            client.subscribe("parking/whitelist/ack")
+            client.subscribe("parking/commands/ack")
+            client.subscribe("parking/commands/result")
+            for topic in event_codec.ENCODED_TOPICS:
+                client.subscribe(topic)
             
             logger.info("✓ Subscribed to parking topics")
             
+            # Ask the ESP32 which whitelist version it holds; its ack
+            # triggers whatever catch-up is needed
+            self.send_command("whitelist_version")
+            
+            # Status updates only carry changes; start from a full snapshot
+            self.request_status()
+            
             # Log system event
             db = SessionLocal()
             try:
@@ -59,6 +87,11 @@ class MQTTService:
         self.connected = False
         logger.warning(f"⚠ Disconnected from MQTT Broker, code: {rc}")
         
+        # The version query after reconnecting decides what to send again
+        with self.whitelist_lock:
+            self.whitelist_outgoing = []
+            self.whitelist_in_flight = 0
+        
         # Log system event
         db = SessionLocal()
         try:
@@ -77,39 +110,83 @@ class MQTTService:
     def on_message(self, client, userdata, msg):
         """Callback when message received from MQTT broker"""
         try:
-            topic = msg.topic
-            payload = msg.payload.decode()
-            logger.info(f"📨 MQTT Message on {topic}: {payload}")
-            
-            # Parse JSON payload
-            data = json.loads(payload)
-            
-            # Process based on topic
-            if topic == "parking/events/entry":
-                self.handle_entry_event(data)
-            elif topic == "parking/events/exit":
-                self.handle_exit_event(data)
-            elif topic == "parking/events/scan":
-                self.handle_scan_event(data)
-            elif topic == "parking/system":
-                self.handle_system_status(data)
+            if event_codec.is_encoded_topic(msg.topic):
+                # Compact or batched events: expand to single JSON-shaped events
+                messages = event_codec.decode_events(msg.topic, msg.payload)
+                logger.info(f"📨 MQTT Message on {msg.topic} ({len(msg.payload)} bytes): {len(messages)} events")
+            else:
+                payload = msg.payload.decode()
+                logger.info(f"📨 MQTT Message on {msg.topic}: {payload}")
+                
+                # Parse JSON payload
+                messages = [(msg.topic, json.loads(payload))]
             
-            # Notify all registered callbacks
-            for callback in self.message_callbacks:
-                try:
-                    callback(topic, data)
-                except Exception as callback_error:
-                    logger.error(f"Error in message callback: {callback_error}")
+            for topic, data in messages:
+                self.dispatch_message(topic, data)
                 
         except json.JSONDecodeError:
             logger.error(f"✗ Invalid JSON in MQTT message: {payload}")
+        except ValueError as e:
+            logger.error(f"✗ Invalid event on {msg.topic}: {e}")
         except Exception as e:
             logger.error(f"✗ Error processing MQTT message: {e}")
     
-    def handle_entry_event(self, data: dict):
-        """Handle vehicle entry event from ESP32"""
+    def dispatch_message(self, topic: str, data: dict):
+        """Process one decoded message and forward it to registered callbacks"""
+        processed = True
+        if topic == "parking/events/entry":
+            processed = self.handle_entry_event(data)
+        elif topic == "parking/events/exit":
+            processed = self.handle_exit_event(data)
+        elif topic == "parking/events/scan":
+            self.handle_scan_event(data)
+        elif topic == "parking/events/denied":
+            self.handle_denied_summary(data)
+        elif topic == "parking/system":
+            data = self.handle_system_status(data)
+        elif topic == "parking/system/metrics":
+            self.handle_metrics(data)
+        elif topic == "parking/whitelist/ack":
+            self.handle_whitelist_ack(data)
+        elif topic == "parking/commands/ack":
+            self.handle_command_ack(data)
+        elif topic == "parking/commands/result":
+            self.handle_command_result(data)
+        
+        # Replayed duplicates were already broadcast the first time
+        if not processed:
+            return
+        
+        # Notify all registered callbacks
+        for callback in self.message_callbacks:
+            try:
+                callback(topic, data)
+            except Exception as callback_error:
+                logger.error(f"Error in message callback: {callback_error}")
+    
+    def _claim_event(self, db: Session, data: dict) -> bool:
+        """Register an outbox event's (boot, seq); False if already processed"""
+        boot_id = data.get("boot")
+        sequence = data.get("seq")
+        if boot_id is None or sequence is None:
+            return True
+        
+        db.add(DeviceEventReceipt(boot_id=boot_id, sequence=sequence))
+        try:
+            db.flush()
+        except IntegrityError:
+            db.rollback()
+            logger.info(f"↺ Duplicate event boot={boot_id} seq={sequence} ignored")
+            return False
+        return True
+    
+    def handle_entry_event(self, data: dict) -> bool:
+        """Handle vehicle entry event from ESP32; False if it was a replayed duplicate"""
         db = SessionLocal()
         try:
+            if not self._claim_event(db, data):
+                return False
+            
             # Create entry log
             log = EntryExitLog(
                 card_uid=data.get("card_uid"),
@@ -137,11 +214,15 @@ class MQTTService:
             db.rollback()
         finally:
             db.close()
+        return True
     
-    def handle_exit_event(self, data: dict):
-        """Handle vehicle exit event from ESP32"""
+    def handle_exit_event(self, data: dict) -> bool:
+        """Handle vehicle exit event from ESP32; False if it was a replayed duplicate"""
         db = SessionLocal()
         try:
+            if not self._claim_event(db, data):
+                return False
+            
             # Calculate parking fee
             slot_id = data.get("slot_id")
             duration_minutes = 0
@@ -186,6 +267,7 @@ class MQTTService:
             db.rollback()
         finally:
             db.close()
+        return True
     
     def handle_scan_event(self, data: dict):
         """Handle card scan event from ESP32 scan mode"""
@@ -195,12 +277,107 @@ class MQTTService:
         # Event is automatically forwarded to WebSocket clients via message_callbacks
         # Frontend will handle duplicate detection and form population
     
-    def handle_system_status(self, data: dict):
-        """Handle system status update from ESP32"""
+    def handle_denied_summary(self, data: dict):
+        """Log repeated refusals the ESP32 folded into one message"""
+        # The first refusal of the window arrived as a normal entry/exit event
+        logger.warning(f"🚫 Card {data.get('card_uid')} refused {data.get('repeats')} more times "
+                       f"at {data.get('gate')} lane {data.get('lane')} within {data.get('window_s')} s")
+    
+    def handle_system_status(self, data: dict) -> dict:
+        """Handle system status update from ESP32; returns the merged status"""
+        # Partial updates carry only the fields that changed
+        if data.get("partial"):
+            merged = dict(self.device_status)
+            merged.update(data)
+            merged.pop("partial")
+        else:
+            merged = dict(data)
+        self.device_status = merged
+        data = merged
+        
         logger.info(f"📊 System Status: {data.get('occupied_slots')}/{data.get('total_slots')} occupied")
         
+        outbox = data.get("outbox") or {}
+        if outbox.get("pending"):
+            logger.warning(f"⚠ ESP32 outbox backlog: {outbox.get('pending')} events ({outbox.get('stored')} in flash)")
+        if outbox.get("dropped"):
+            logger.warning(f"⚠ ESP32 outbox dropped {outbox.get('dropped')} events since boot")
+        
         # You can add logic here to sync slot status if needed
         # This is useful if ESP32 restarts and we need to sync state
+        return data
+    
+    def handle_metrics(self, data: dict):
+        """Keep the latest per-stage latency percentiles (microseconds)"""
+        self.device_metrics = data
+        stages = data.get("stages") or {}
+        open_stage = stages.get("card_to_open") or {}
+        if open_stage:
+            logger.info(f"⏱ Card to barrier open: p50 {open_stage.get('p50')} us, "
+                        f"p99 {open_stage.get('p99')} us, max {open_stage.get('max')} us")
+    
+    def handle_command_ack(self, data: dict):
+        """Log whether the ESP32 accepted a command"""
+        command_id = data.get("id")
+        ack_status = data.get("status")
+        if ack_status == "accepted":
+            logger.info(f"📨 Command #{command_id} {data.get('command')} accepted")
+            return
+        # Refused commands never produce a result
+        command = self.pending_commands.pop(command_id, data.get("command"))
+        logger.warning(f"⚠ Command #{command_id} {command} refused: {ack_status}")
+        
+        # The rest of a refused snapshot is useless: the ESP32 abandons it
+        # and asks for a new one with a "resync" whitelist ack
+        with self.whitelist_lock:
+            if command_id == self.whitelist_in_flight:
+                self.whitelist_outgoing = []
+                self.whitelist_in_flight = 0
+    
+    def handle_command_result(self, data: dict):
+        """Log the outcome of a command the ESP32 ran"""
+        command_id = data.get("id")
+        self.pending_commands.pop(command_id, None)
+        with self.whitelist_lock:
+            if command_id == self.whitelist_in_flight:
+                self._send_next_whitelist_message()
+        result = data.get("status")
+        if result == "ok":
+            logger.info(f"✓ Command #{command_id} {data.get('command')} done")
+        else:
+            logger.warning(f"⚠ Command #{command_id} {data.get('command')} failed: {result}")
+    
+    def handle_whitelist_ack(self, data: dict):
+        """Track the whitelist version applied on the ESP32 and catch it up"""
+        version = data.get("version", 0)
+        ack_status = data.get("status")
+        self.device_whitelist_version = version
+        logger.info(f"📋 ESP32 whitelist at v{version} ({ack_status}, {data.get('cards')} cards)")
+        
+        if ack_status == "incomplete":
+            logger.warning(f"⚠ ESP32 could not store every card of whitelist v{version}")
+        
+        # "current" answers a version query or a reboot; "resync" means the
+        # device saw a gap or a broken snapshot
+        if ack_status not in ("current", "resync"):
+            return
+        
+        db = SessionLocal()
+        try:
+            if ack_status == "resync":
+                whitelist_sync_service.send_snapshot(db, self)
+            elif version < whitelist_sync_service.latest_version(db):
+                whitelist_sync_service.send_deltas(db, self, version)
+        except Exception as e:
+            logger.error(f"✗ Failed to sync whitelist after ack: {e}")
+        finally:
+            db.close()
+    
+    def sync_whitelist(self, db: Session, full: bool = False):
+        """Send the ESP32 the whitelist changes it has not acked yet"""
+        if full:
+            return whitelist_sync_service.send_snapshot(db, self)
+        return whitelist_sync_service.send_deltas(db, self, self.device_whitelist_version)
     
     def start(self):
         """Start MQTT client and connect to broker"""
@@ -288,11 +465,53 @@ class MQTTService:
             return False
     
     def send_command(self, command: str, data: dict = None):
-        """Send command to ESP32"""
-        message = {"command": command}
+        """Send command to ESP32; it is acked and answered with the same id"""
+        return self._publish_command(command, data) != 0
+    
+    def _publish_command(self, command: str, data: dict = None) -> int:
+        """Publish a command with a fresh id; returns the id, 0 if not sent"""
+        command_id = self.next_command_id
+        self.next_command_id = command_id % 0xFFFFFFFF + 1  # 0 means "no id" on the device
+        message = {"command": command, "id": command_id}
         if data:
             message.update(data)
-        return self.publish("parking/commands", message)
+        if not self.publish("parking/commands", message):
+            return 0
+        self.pending_commands[command_id] = command
+        return command_id
+    
+    def send_whitelist_messages(self, messages: list) -> bool:
+        """Send (command, payload) pairs one at a time, each after the last one ran.
+        
+        The ESP32 queues only COMMAND_QUEUE_LENGTH (4) commands for its gate
+        task, so a snapshot or a long delta sent back to back overflows it.
+        Each message goes out when the command result of the previous one
+        arrives, or after WHITELIST_RESULT_TIMEOUT if it never does.
+        Messages of an earlier call that are still waiting are replaced.
+        """
+        with self.whitelist_lock:
+            self.whitelist_outgoing = list(messages)
+            waiting = time.monotonic() - self.whitelist_sent_at < settings.WHITELIST_RESULT_TIMEOUT
+            if self.whitelist_in_flight and waiting:
+                return True
+            return self._send_next_whitelist_message()
+    
+    def _send_next_whitelist_message(self) -> bool:
+        """Publish the next waiting whitelist message (whitelist_lock held)"""
+        self.whitelist_in_flight = 0
+        if not self.whitelist_outgoing:
+            return True
+        
+        command, payload = self.whitelist_outgoing.pop(0)
+        command_id = self._publish_command(command, payload)
+        if not command_id:
+            logger.warning(f"⚠ {command} not sent, {len(self.whitelist_outgoing)} whitelist messages dropped")
+            self.whitelist_outgoing = []
+            return False
+        
+        self.whitelist_in_flight = command_id
+        self.whitelist_sent_at = time.monotonic()
+        return True
     
     def open_barrier(self, gate: str):
         """Send command to open specific barrier"""
@@ -306,6 +525,10 @@ class MQTTService:
         """Request status update from ESP32"""
         return self.send_command("get_status")
     
+    def request_metrics(self):
+        """Request latency metrics from ESP32"""
+        return self.send_command("get_metrics")
+    
     def register_callback(self, callback: Callable):
         """Register callback for MQTT messages"""
         self.message_callbacks.append(callback)
@@ -0,0 +1,156 @@
+"""Versioned whitelist synchronization with the ESP32.
+
+Every card change is appended to the ``whitelist_changes`` log; its version
+is a monotonically increasing sync cursor. The ESP32 acknowledges the
+version it has applied on ``parking/whitelist/ack`` and only the changes
+after that version are sent as ``whitelist_delta`` messages. When the device
+is unknown, far behind, or reports a gap, the full list is sent as a chunked
+``whitelist_snapshot`` instead.
+
+Messages go out one at a time through ``send_whitelist_messages()``: the
+ESP32 queues only four commands, so each chunk or delta waits for the
+command result of the previous one.
+"""
+
+import logging
+from typing import Optional
+
+from sqlalchemy import func
+from sqlalchemy.orm import Session
+
+from app.core.config import settings
+from app.models.models import AccessLevel, RFIDCard, WhitelistChange
+
+logger = logging.getLogger(__name__)
+
+# Firmware access level codes (ACCESS_LEVEL_* in Config.h)
+ACCESS_LEVEL_CODES = {
+    AccessLevel.REGULAR: 0,
+    AccessLevel.ADMIN: 1,
+    AccessLevel.TEMPORARY: 2,
+}
+
+
+def _access_level_code(card: RFIDCard) -> int:
+    return ACCESS_LEVEL_CODES.get(card.access_level, 0)
+
+
+def latest_version(db: Session) -> int:
+    return db.query(func.max(WhitelistChange.version)).scalar() or 0
+
+
+def ensure_baseline(db: Session) -> None:
+    """Seed the change log from existing cards the first time it is used."""
+    if db.query(WhitelistChange).first() is not None:
+        return
+
+    for card in db.query(RFIDCard).filter(RFIDCard.is_active == True).all():
+        db.add(WhitelistChange(
+            card_uid=card.card_uid,
+            op="upsert",
+            access_level=_access_level_code(card),
+        ))
+    db.commit()
+
+
+def record_card_change(db: Session, card_uid: str, card: Optional[RFIDCard]) -> int:
+    """Append the current state of a card to the change log.
+
+    Pass ``card=None`` for a deleted card. Inactive cards are removed from
+    the device, which only stores cards that may enter.
+    """
+    if card is None or not card.is_active:
+        change = WhitelistChange(card_uid=card_uid, op="remove")
+    else:
+        change = WhitelistChange(
+            card_uid=card_uid,
+            op="upsert",
+            access_level=_access_level_code(card),
+        )
+
+    db.add(change)
+    db.commit()
+    return change.version
+
+
+def send_snapshot(db: Session, mqtt_service) -> bool:
+    """Send every active card in chunks tagged with the latest version.
+
+    Returns whether the first chunk went out; the rest follow as the ESP32
+    runs each one.
+    """
+    version = latest_version(db)
+    cards = [
+        {"uid": card.card_uid, "lvl": _access_level_code(card)}
+        for card in db.query(RFIDCard).filter(RFIDCard.is_active == True).all()
+    ]
+
+    size = settings.WHITELIST_CARDS_PER_CHUNK
+    chunks = [cards[i:i + size] for i in range(0, len(cards), size)] or [[]]
+
+    messages = [
+        ("whitelist_snapshot", {
+            "version": version,
+            "chunk": index,
+            "total": len(chunks),
+            "count": len(cards),
+            "cards": chunk,
+        })
+        for index, chunk in enumerate(chunks)
+    ]
+    if not mqtt_service.send_whitelist_messages(messages):
+        logger.warning(f"⚠ Whitelist snapshot v{version} not sent")
+        return False
+
+    logger.info(f"✓ Sending whitelist snapshot v{version}: {len(cards)} cards in {len(chunks)} chunks")
+    return True
+
+
+def send_deltas(db: Session, mqtt_service, device_version: Optional[int]) -> bool:
+    """Bring the device from ``device_version`` to the latest version.
+
+    Falls back to a snapshot when the device version is unknown, is 0 (never
+    synced, factory defaults), or too many changes are pending.
+    """
+    if not device_version:
+        return send_snapshot(db, mqtt_service)
+
+    changes = db.query(WhitelistChange).filter(
+        WhitelistChange.version > device_version
+    ).order_by(WhitelistChange.version.asc()).all()
+
+    if not changes:
+        return True
+    if len(changes) > settings.WHITELIST_SNAPSHOT_THRESHOLD:
+        return send_snapshot(db, mqtt_service)
+
+    # Only the newest change per card matters
+    latest_per_card = {}
+    for change in changes:
+        latest_per_card.pop(change.card_uid, None)
+        latest_per_card[change.card_uid] = change
+    collapsed = list(latest_per_card.values())
+
+    messages = []
+    base = device_version
+    size = settings.WHITELIST_OPS_PER_DELTA
+    for i in range(0, len(collapsed), size):
+        batch = collapsed[i:i + size]
+        version = batch[-1].version
+
+        ops = []
+        for change in batch:
+            op = {"op": change.op, "uid": change.card_uid}
+            if change.op == "upsert":
+                op["lvl"] = change.access_level or 0
+            ops.append(op)
+
+        messages.append(("whitelist_delta", {"base": base, "version": version, "ops": ops}))
+        base = version
+
+    if not mqtt_service.send_whitelist_messages(messages):
+        logger.warning(f"⚠ Whitelist delta {device_version}->{base} not sent")
+        return False
+
+    logger.info(f"✓ Sending whitelist delta v{device_version}->v{base}: {len(collapsed)} changes")
+    return True
@@ -0,0 +1,432 @@
+/**
+ * @file BenchmarkRunner.cpp
+ * @brief Implementation of the on-device throughput test
+ */
+
+#include "BenchmarkRunner.h"
+
+static_assert(BENCHMARK_CARDS + BENCHMARK_UNKNOWN_CARDS <= 256,
+              "Synthetic card numbers must fit one UID byte");
+
+#define BENCHMARK_UID_PREFIX_0 0xBE
+#define BENCHMARK_UID_PREFIX_1 0x4C
+
+BenchmarkRunner::BenchmarkRunner(RFIDManager& rfid, SlotManager& slots,
+                                 GateController* gates, const LaneConfig* lanes,
+                                 uint8_t laneCount)
+  : _rfid(rfid),
+    _slots(slots),
+    _laneCount(laneCount > LANE_COUNT ? LANE_COUNT : laneCount),
+    _phase(RUN_IDLE),
+    _startMs(0),
+    _arrivalsEndMs(0),
+    _drainEndMs(0),
+    _arrivals(0),
+    _nextCard(0),
+    _exitHead(0),
+    _exitCount(0),
+    _lastTickUs(0),
+    _jitterTotalUs(0),
+    _deliveryTotalUs(0),
+    _tracking(false),
+    _lock(portMUX_INITIALIZER_UNLOCKED) {
+  for (uint8_t i = 0; i < _laneCount; i++) {
+    _lanes[i].gate = &gates[i];
+    _lanes[i].reader = i;
+    _lanes[i].entry = (lanes[i].direction == LANE_ENTRY);
+    _lanes[i].phase = LANE_EMPTY;
+  }
+  memset(_busy, 0, sizeof(_busy));
+  memset(_queuedAt, 0, sizeof(_queuedAt));
+  memset(&_results, 0, sizeof(_results));
+  _results.status = "idle";
+}
+
+bool BenchmarkRunner::start(unsigned long durationMs) {
+  if (_phase != RUN_IDLE) {
+    DEBUG_PRINTLN("⚠ Benchmark already running");
+    return false;
+  }
+
+  // Synthetic cars need every gate to themselves
+  for (uint8_t i = 0; i < _laneCount; i++) {
+    if (_lanes[i].gate->getState() != STATE_IDLE || _lanes[i].gate->isVehicleDetected()) {
+      reject("gate_busy");
+      return false;
+    }
+  }
+  if (_rfid.getCardCount() + BENCHMARK_CARDS > MAX_RFID_CARDS) {
+    reject("whitelist_full");
+    return false;
+  }
+
+  // Never committed: abortTransaction() in finish() restores the stored list
+  _rfid.beginTransaction();
+  for (uint8_t card = 0; card < BENCHMARK_CARDS; card++) {
+    CardUid uid = makeCard(card);
+    if (!_rfid.isAuthorized(uid)) {
+      _rfid.addCard(uid, "Benchmark", ACCESS_REGULAR);
+    }
+  }
+
+  uint64_t now = TimeSync::monotonicMillis();
+  _phase = RUN_ARRIVING;
+  _startMs = now;
+  _arrivalsEndMs = now + durationMs;
+  _drainEndMs = _arrivalsEndMs + BENCHMARK_DRAIN_TIMEOUT_MS;
+  _arrivals = 0;
+  _nextCard = 0;
+  _exitHead = 0;
+  _exitCount = 0;
+  _lastTickUs = 0;
+  _jitterTotalUs = 0;
+  memset(_busy, 0, sizeof(_busy));
+  for (uint8_t i = 0; i < _laneCount; i++) {
+    _lanes[i].phase = LANE_EMPTY;
+  }
+
+  portENTER_CRITICAL(&_lock);
+  memset(_queuedAt, 0, sizeof(_queuedAt));
+  memset(&_results, 0, sizeof(_results));
+  _results.status = "running";
+  _deliveryTotalUs = 0;
+  _tracking = true;
+  portEXIT_CRITICAL(&_lock);
+
+  // Stage histograms then describe this run only
+  LatencyTracer::reset();
+
+  DEBUG_PRINTF("▶ Benchmark started for %lu ms\n", durationMs);
+  return true;
+}
+
+void BenchmarkRunner::stop() {
+  if (_phase != RUN_IDLE) {
+    finish("stopped");
+  }
+}
+
+void BenchmarkRunner::reject(const char* status) {
+  if (_phase != RUN_IDLE) {
+    return;
+  }
+
+  DEBUG_PRINTF("✗ Benchmark not started: %s\n", status);
+  portENTER_CRITICAL(&_lock);
+  memset(&_results, 0, sizeof(_results));
+  _results.status = status;
+  portEXIT_CRITICAL(&_lock);
+}
+
+bool BenchmarkRunner::update() {
+  if (_phase == RUN_IDLE) {
+    return false;
+  }
+
+  recordTick();
+
+  uint64_t now = TimeSync::monotonicMillis();
+  if (_phase == RUN_ARRIVING && now >= _arrivalsEndMs) {
+    _phase = RUN_DRAINING;
+    DEBUG_PRINTLN("▶ Benchmark arrivals done, draining");
+  }
+
+  for (uint8_t i = 0; i < _laneCount; i++) {
+    driveLane(_lanes[i], now);
+  }
+
+  if (_phase == RUN_DRAINING) {
+    if (isDrained()) {
+      finish("completed");
+      return true;
+    }
+    if (now >= _drainEndMs) {
+      finish("incomplete");
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BenchmarkRunner::isRunning() const {
+  return _phase != RUN_IDLE;
+}
+
+void BenchmarkRunner::onEventQueued(PublishType type, const CardUid& uid) {
+  int card = cardNumber(uid);
+  if (card < 0) {
+    return;
+  }
+
+  uint64_t now = (uint64_t)esp_timer_get_time();
+  portENTER_CRITICAL(&_lock);
+  if (_tracking) {
+    _queuedAt[card][type == PUBLISH_EXIT ? 1 : 0] = now;
+    _results.eventsQueued++;
+  }
+  portEXIT_CRITICAL(&_lock);
+}
+
+void BenchmarkRunner::onEventPublished(const OutboxRecord& record) {
+  int card = cardNumber(record.cardUID);
+  if (card < 0) {
+    return;
+  }
+
+  uint64_t now = (uint64_t)esp_timer_get_time();
+  uint32_t elapsed = 0;
+  portENTER_CRITICAL(&_lock);
+  uint64_t& queuedAt = _queuedAt[card][record.type == PUBLISH_EXIT ? 1 : 0];
+  bool timed = _tracking && queuedAt != 0;
+  if (timed) {
+    uint64_t delta = now - queuedAt;
+    elapsed = (delta > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : (uint32_t)delta;
+    queuedAt = 0;
+    _results.timedEvents++;
+    _deliveryTotalUs += elapsed;
+    if (elapsed > _results.deliveryMaxUs) {
+      _results.deliveryMaxUs = elapsed;
+    }
+  }
+  if (_tracking) {
+    // A card queued again before its last event left keeps only the newer
+    // stamp; the older event still counts, untimed
+    _results.eventsPublished++;
+  }
+  portEXIT_CRITICAL(&_lock);
+
+  if (timed) {
+    LatencyTracer::record(TRACE_EVENT_DELIVERY, elapsed);
+  }
+}
+
+void BenchmarkRunner::getResults(BenchmarkResults& results) {
+  portENTER_CRITICAL(&_lock);
+  results = _results;
+  uint64_t deliveryTotal = _deliveryTotalUs;
+  portEXIT_CRITICAL(&_lock);
+
+  if (results.timedEvents > 0) {
+    results.deliveryAvgUs = (uint32_t)(deliveryTotal / results.timedEvents);
+  }
+  if (results.durationMs == 0 && _phase != RUN_IDLE) {
+    results.durationMs = (uint32_t)(TimeSync::monotonicMillis() - _startMs);
+  }
+}
+
+CardUid BenchmarkRunner::makeCard(uint8_t card) {
+  uint8_t bytes[4] = { BENCHMARK_UID_PREFIX_0, BENCHMARK_UID_PREFIX_1, 0x00, card };
+  CardUid uid;
+  uid.fromBytes(bytes, sizeof(bytes));
+  return uid;
+}
+
+int BenchmarkRunner::cardNumber(const CardUid& uid) {
+  if (uid.length != 4 || uid.bytes[0] != BENCHMARK_UID_PREFIX_0 ||
+      uid.bytes[1] != BENCHMARK_UID_PREFIX_1 || uid.bytes[2] != 0x00 ||
+      uid.bytes[3] >= BENCHMARK_CARDS + BENCHMARK_UNKNOWN_CARDS) {
+    return -1;
+  }
+  return uid.bytes[3];
+}
+
+bool BenchmarkRunner::nextCar(bool isEntrance, uint8_t& card) {
+  if (!isEntrance) {
+    if (_exitCount == 0) {
+      return false;
+    }
+    card = _exitQueue[_exitHead];
+    return true;
+  }
+
+  if (_phase != RUN_ARRIVING) {
+    return false;
+  }
+
+#if BENCHMARK_UNKNOWN_EVERY > 0
+  if (_arrivals % BENCHMARK_UNKNOWN_EVERY == BENCHMARK_UNKNOWN_EVERY - 1) {
+    card = BENCHMARK_CARDS + (_arrivals / BENCHMARK_UNKNOWN_EVERY) % BENCHMARK_UNKNOWN_CARDS;
+    return true;
+  }
+#endif
+
+  // Next known card whose car is neither inside nor at another entry
+  // lane; none when they all are
+  for (uint8_t i = 0; i < BENCHMARK_CARDS; i++) {
+    uint8_t candidate = (_nextCard + i) % BENCHMARK_CARDS;
+    if (!_busy[candidate]) {
+      card = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void BenchmarkRunner::driveLane(Lane& lane, uint64_t now) {
+  GateState state = lane.gate->getState();
+  bool isEntrance = lane.entry;
+
+  if (lane.phase != LANE_EMPTY && now - lane.phaseStart > BENCHMARK_STEP_TIMEOUT_MS) {
+    DEBUG_PRINTF("⚠ Benchmark car %u abandoned at lane %u\n", lane.card, lane.reader);
+    portENTER_CRITICAL(&_lock);
+    _results.abandoned++;
+    portEXIT_CRITICAL(&_lock);
+    _rfid.injectCard(lane.reader, CardUid());
+    lane.gate->simulateSensor(true, false);
+    lane.granted = false;
+    lane.phase = LANE_LEAVING;
+    lane.phaseStart = now;
+    return;
+  }
+
+  switch (lane.phase) {
+    case LANE_EMPTY: {
+      // Like a driver: only pull up once the barrier is down and the lane clear
+      uint8_t card;
+      if (state != STATE_IDLE || lane.gate->isVehicleDetected() ||
+          !nextCar(isEntrance, card)) {
+        break;
+      }
+      if (isEntrance) {
+        _arrivals++;
+        if (card < BENCHMARK_CARDS) {
+          _busy[card] = true;
+          _nextCard = (card + 1) % BENCHMARK_CARDS;
+        }
+      } else {
+        _exitHead = (_exitHead + 1) % BENCHMARK_CARDS;
+        _exitCount--;
+      }
+      lane.card = card;
+      lane.granted = false;
+      lane.gate->simulateSensor(true, true);
+      lane.phase = LANE_ARRIVING;
+      lane.phaseStart = now;
+      break;
+    }
+
+    case LANE_ARRIVING:
+      if (state == STATE_WAITING_CARD) {
+        _rfid.injectCard(lane.reader, makeCard(lane.card));
+        lane.phase = LANE_AT_READER;
+        lane.phaseStart = now;
+      }
+      break;
+
+    case LANE_AT_READER:
+      if (state == STATE_BARRIER_OPEN) {
+        lane.granted = true;
+      } else if (state == STATE_MESSAGE_HOLD) {
+        portENTER_CRITICAL(&_lock);
+        _results.denied++;
+        portEXIT_CRITICAL(&_lock);
+      } else {
+        break;
+      }
+      // Drive through, or back away from the refusal
+      lane.gate->simulateSensor(true, false);
+      lane.phase = LANE_LEAVING;
+      lane.phaseStart = now;
+      break;
+
+    case LANE_LEAVING:
+      if (lane.gate->isVehicleDetected()) {
+        break;
+      }
+      if (lane.granted && isEntrance) {
+        portENTER_CRITICAL(&_lock);
+        _results.carsIn++;
+        portEXIT_CRITICAL(&_lock);
+        if (lane.card < BENCHMARK_CARDS) {
+          _exitQueue[(_exitHead + _exitCount) % BENCHMARK_CARDS] = lane.card;
+          _exitCount++;
+        }
+      } else if (lane.granted) {
+        portENTER_CRITICAL(&_lock);
+        _results.carsOut++;
+        portEXIT_CRITICAL(&_lock);
+        _busy[lane.card] = false;
+      } else if (isEntrance && lane.card < BENCHMARK_CARDS) {
+        // Refused or abandoned: the car drove away
+        _busy[lane.card] = false;
+      } else if (!isEntrance) {
+        // Still parked; try again later
+        _exitQueue[(_exitHead + _exitCount) % BENCHMARK_CARDS] = lane.card;
+        _exitCount++;
+      }
+      lane.phase = LANE_EMPTY;
+      break;
+  }
+}
+
+void BenchmarkRunner::recordTick() {
+  uint64_t now = (uint64_t)esp_timer_get_time();
+  if (_lastTickUs != 0) {
+    int64_t interval = (int64_t)(now - _lastTickUs);
+    int64_t deviation = interval - (int64_t)GATE_TASK_PERIOD_MS * 1000;
+    uint32_t jitter = (uint32_t)(deviation < 0 ? -deviation : deviation);
+
+    _jitterTotalUs += jitter;
+    portENTER_CRITICAL(&_lock);
+    _results.iterations++;
+    if (jitter > _results.jitterMaxUs) {
+      _results.jitterMaxUs = jitter;
+    }
+    if (interval > (int64_t)GATE_TASK_PERIOD_MS * 2000) {
+      _results.overruns++;
+    }
+    _results.jitterAvgUs = (uint32_t)(_jitterTotalUs / _results.iterations);
+    portEXIT_CRITICAL(&_lock);
+  }
+  _lastTickUs = now;
+}
+
+bool BenchmarkRunner::isDrained() {
+  if (_exitCount > 0) {
+    return false;
+  }
+  for (uint8_t i = 0; i < _laneCount; i++) {
+    if (_lanes[i].phase != LANE_EMPTY || _lanes[i].gate->getState() != STATE_IDLE) {
+      return false;
+    }
+  }
+
+  portENTER_CRITICAL(&_lock);
+  bool published = (_results.eventsPublished >= _results.eventsQueued);
+  portEXIT_CRITICAL(&_lock);
+  return published;
+}
+
+void BenchmarkRunner::finish(const char* status) {
+  uint64_t now = TimeSync::monotonicMillis();
+
+  // Hand the gates back to their sensors and readers
+  for (uint8_t i = 0; i < _laneCount; i++) {
+    Lane& lane = _lanes[i];
+    lane.gate->simulateSensor(false);
+    if (lane.gate->getState() != STATE_IDLE) {
+      lane.gate->reset();
+    }
+    _rfid.injectCard(lane.reader, CardUid());
+    lane.phase = LANE_EMPTY;
+  }
+
+  // Free the bays of cars that never left, then drop the synthetic cards
+  for (uint8_t card = 0; card < BENCHMARK_CARDS; card++) {
+    int slot = _slots.findSlotByCard(makeCard(card));
+    if (slot > 0) {
+      _slots.releaseSlot(slot);
+    }
+  }
+  _rfid.abortTransaction();
+
+  _phase = RUN_IDLE;
+
+  portENTER_CRITICAL(&_lock);
+  _tracking = false;
+  _results.status = status;
+  _results.durationMs = (uint32_t)(now - _startMs);
+  portEXIT_CRITICAL(&_lock);
+
+  DEBUG_PRINTF("■ Benchmark %s after %lu ms\n", status, (unsigned long)(now - _startMs));
+}
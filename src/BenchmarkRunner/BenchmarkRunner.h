@@ -0,0 +1,253 @@
+/**
+ * @file BenchmarkRunner.h
+ * @brief On-device throughput test with synthetic traffic
+ * @details Replays cars through the real gate path: the runner simulates
+ *          the IR sensors (GateController::simulateSensor()) and shows
+ *          synthetic cards to the readers (RFIDManager::injectCard()),
+ *          while the lane processing in the gate task (reader scheduling,
+ *          authorization, slot allocation), the outbox and MQTT publishing
+ *          run unchanged. It reports
+ *          sustained events per second, gate loop jitter and the time from
+ *          an event being queued to it being published.
+ *
+ *          Synthetic cards are 4-byte UIDs BE 4C 00 nn. The whitelisted
+ *          ones are added inside an open whitelist transaction, so they
+ *          never reach flash and disappear when the run ends.
+ */
+
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "../Config.h"
+#include "../CardUid/CardUid.h"
+#include "../RFIDManager/RFIDManager.h"
+#include "../SlotManager/SlotManager.h"
+#include "../GateController/GateController.h"
+#include "../TaskPipeline/TaskPipeline.h"
+#include "../EventOutbox/EventOutbox.h"
+#include "../LatencyTracer/LatencyTracer.h"
+
+/**
+ * @struct BenchmarkResults
+ * @brief Outcome of a benchmark run (or progress of the current one)
+ */
+struct BenchmarkResults {
+  const char* status;        ///< "running", "completed", "stopped", "incomplete", or why a start was refused
+  uint32_t durationMs;       ///< Start to finish, including the drain
+  uint32_t carsIn;           ///< Entrances where the barrier opened
+  uint32_t carsOut;          ///< Exits where the barrier opened
+  uint32_t denied;           ///< Unknown cards and full-garage refusals
+  uint32_t abandoned;        ///< Cars given up after BENCHMARK_STEP_TIMEOUT_MS
+  uint32_t eventsQueued;     ///< Entry/exit events the run produced
+  uint32_t eventsPublished;  ///< Of which published so far
+  uint32_t timedEvents;      ///< Published events with a delivery time
+  uint32_t deliveryAvgUs;    ///< Mean time from queued to published
+  uint32_t deliveryMaxUs;    ///< Slowest event
+  uint32_t iterations;       ///< Gate task iterations
+  uint32_t jitterAvgUs;      ///< Mean deviation of the wake interval from GATE_TASK_PERIOD_MS
+  uint32_t jitterMaxUs;      ///< Largest deviation
+  uint32_t overruns;         ///< Wake intervals longer than twice the period
+};
+
+/**
+ * @class BenchmarkRunner
+ * @brief Drives synthetic cars through every lane
+ *
+ * One car at a time per lane: it covers the sensor once the gate is idle,
+ * shows its card when the gate asks for one, and clears the sensor once
+ * the barrier opened or the gate refused it. Entry lanes take the next
+ * card that is not already on the premises; cars that entered queue for
+ * whichever exit lane frees up first. Every BENCHMARK_UNKNOWN_EVERY-th arrival shows a card that is
+ * not on the whitelist. After the run time, arrivals stop and the run
+ * ends once every car has left and every event has been published, or
+ * after BENCHMARK_DRAIN_TIMEOUT_MS.
+ *
+ * start(), stop() and update() belong to the gate task, onEventPublished()
+ * and getResults() to the network task.
+ *
+ * Example usage:
+ * @code
+ * BenchmarkRunner bench(rfid, slots, gates, lanes, LANE_COUNT);
+ * bench.start(60000);
+ *
+ * // gate task, every iteration, before the gate logic
+ * if (bench.update()) {
+ *   // run finished: publish bench.getResults()
+ * }
+ * @endcode
+ */
+class BenchmarkRunner {
+public:
+  /**
+   * @brief Constructor
+   * @param rfid Whitelist and readers
+   * @param slots Slot manager (synthetic cars still parked are released at the end)
+   * @param gates Gate of each lane (lane N reads with RFID reader N)
+   * @param lanes Lane configuration, same order
+   * @param laneCount Number of lanes (at most LANE_COUNT)
+   */
+  BenchmarkRunner(RFIDManager& rfid, SlotManager& slots, GateController* gates,
+                  const LaneConfig* lanes, uint8_t laneCount);
+
+  /**
+   * @brief Start a run
+   * @details Refused while running, while any gate is busy or when the
+   *          whitelist has no room for the synthetic cards; the refusal
+   *          is left in the results. Resets the LatencyTracer histograms
+   *          so they cover the run.
+   * @param durationMs How long cars keep arriving (ms)
+   * @return true if started
+   */
+  bool start(unsigned long durationMs);
+
+  /**
+   * @brief End the run now and restore the whitelist, sensors and slots
+   */
+  void stop();
+
+  /**
+   * @brief Record a start refused by the caller
+   * @param status Reason string literal, reported as the status
+   */
+  void reject(const char* status);
+
+  /**
+   * @brief Move the synthetic cars along (call every gate iteration)
+   * @return true if the run ended during this call
+   */
+  bool update();
+
+  /**
+   * @brief Check if a run is in progress
+   * @return true between start() and the end of the run
+   */
+  bool isRunning() const;
+
+  /**
+   * @brief Note an entry/exit event handed to the network task
+   * @param type PUBLISH_ENTRY or PUBLISH_EXIT
+   * @param uid Card of the event (other than synthetic ones are ignored)
+   */
+  void onEventQueued(PublishType type, const CardUid& uid);
+
+  /**
+   * @brief Note an event the broker accepted
+   * @param record Published outbox record
+   */
+  void onEventPublished(const OutboxRecord& record);
+
+  /**
+   * @brief Get the results of the current or last run
+   * @param results Output
+   */
+  void getResults(BenchmarkResults& results);
+
+private:
+  /**
+   * @enum RunPhase
+   * @brief Progress of a run
+   */
+  enum RunPhase {
+    RUN_IDLE,          ///< No run
+    RUN_ARRIVING,      ///< Cars arrive at the entry lanes
+    RUN_DRAINING       ///< No more arrivals; waiting for exits and publishing
+  };
+
+  /**
+   * @enum LanePhase
+   * @brief What the car at a barrier is doing
+   */
+  enum LanePhase {
+    LANE_EMPTY,        ///< No car
+    LANE_ARRIVING,     ///< Sensor covered, waiting for the gate to ask for a card
+    LANE_AT_READER,    ///< Card shown, waiting for the answer
+    LANE_LEAVING       ///< Sensor cleared, waiting for the gate to see it
+  };
+
+  /**
+   * @struct Lane
+   * @brief One gate and the synthetic car at it
+   */
+  struct Lane {
+    GateController* gate;            ///< Gate under test
+    uint8_t reader;                  ///< Its reader (lane number)
+    bool entry;                      ///< Entry lane (else exit)
+    LanePhase phase;                 ///< Car progress
+    uint64_t phaseStart;             ///< Monotonic ms the phase began
+    uint8_t card;                    ///< Synthetic card number of the car
+    bool granted;                    ///< Barrier opened for it
+  };
+
+  RFIDManager& _rfid;                ///< Whitelist and readers
+  SlotManager& _slots;               ///< Slots of the synthetic cars
+  Lane _lanes[LANE_COUNT];           ///< Lanes under test
+  uint8_t _laneCount;                ///< Entries of _lanes in use
+  RunPhase _phase;                   ///< Run progress
+  uint64_t _startMs;                 ///< Monotonic ms the run started
+  uint64_t _arrivalsEndMs;           ///< Last arrival time
+  uint64_t _drainEndMs;              ///< Give up waiting after this
+  uint32_t _arrivals;                ///< Cars sent to the entrance
+  uint8_t _nextCard;                 ///< Round-robin cursor over the known cards
+  bool _busy[BENCHMARK_CARDS];       ///< Known card's car is at an entry lane or inside
+  uint8_t _exitQueue[BENCHMARK_CARDS];  ///< Parked cars in entry order
+  uint8_t _exitHead;                 ///< Oldest entry of _exitQueue
+  uint8_t _exitCount;                ///< Entries in _exitQueue
+  uint64_t _lastTickUs;              ///< esp_timer us of the previous update()
+  uint64_t _jitterTotalUs;           ///< Sum of wake interval deviations
+  uint64_t _queuedAt[BENCHMARK_CARDS + BENCHMARK_UNKNOWN_CARDS][2];  ///< esp_timer us per card, entry/exit (0 = none pending)
+  uint64_t _deliveryTotalUs;         ///< Sum of delivery times
+  bool _tracking;                    ///< Events are being counted
+  BenchmarkResults _results;         ///< Counters of the current or last run
+  portMUX_TYPE _lock;                ///< Guards _queuedAt, _tracking and the event counters
+
+  /**
+   * @brief Build a synthetic card UID
+   * @param card Card number (below BENCHMARK_CARDS: whitelisted)
+   * @return UID BE 4C 00 card
+   */
+  static CardUid makeCard(uint8_t card);
+
+  /**
+   * @brief Recognise a synthetic card
+   * @param uid Card UID
+   * @return Card number, or -1 for any other card
+   */
+  static int cardNumber(const CardUid& uid);
+
+  /**
+   * @brief Pick the next car for an empty lane
+   * @param isEntrance true for an entry lane
+   * @param card Output card number
+   * @return true if a car is ready
+   */
+  bool nextCar(bool isEntrance, uint8_t& card);
+
+  /**
+   * @brief Advance the car at one lane
+   * @param lane Lane
+   * @param now Monotonic ms
+   */
+  void driveLane(Lane& lane, uint64_t now);
+
+  /**
+   * @brief Track the gate task wake interval
+   */
+  void recordTick();
+
+  /**
+   * @brief Check whether every car has left and every event was published
+   * @return true if nothing is outstanding
+   */
+  bool isDrained();
+
+  /**
+   * @brief End the run and put the system back as it was
+   * @param status Final status string literal
+   */
+  void finish(const char* status);
+};
+
+#endif // BENCHMARKRUNNER_H
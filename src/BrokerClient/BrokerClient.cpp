@@ -0,0 +1,360 @@
+/**
+ * @file BrokerClient.cpp
+ * @brief Implementation of the non-blocking, session-resuming TLS client
+ */
+
+#include "BrokerClient.h"
+#include <lwip/tcpip.h>
+#if !CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY
+#include <esp_crt_bundle.h>
+#endif
+
+BrokerClient::BrokerClient()
+  : _port(0),
+    _caCert(nullptr),
+    _phase(PHASE_IDLE),
+    _phaseStart(0),
+    _tls(nullptr),
+    _session(nullptr),
+    _addressValid(false),
+    _resolvedAt(0),
+    _lookup(LOOKUP_FAILED),
+    _lookupAddress(0),
+    _lookups(0),
+    _handshakeMs(0),
+    _resumeOffers(0),
+    _rxPos(0),
+    _rxLen(0) {
+  _host[0] = '\0';
+  _addressText[0] = '\0';
+  memset(&_cfg, 0, sizeof(_cfg));
+}
+
+BrokerClient::~BrokerClient() {
+  stop();
+  clearSession();
+}
+
+void BrokerClient::setCACert(const char* rootCA) {
+  _caCert = rootCA;
+}
+
+void BrokerClient::startConnect(const char* host, uint16_t port) {
+  stop();
+  _port = port;
+
+  if (strlen(host) >= sizeof(_host)) {
+    DEBUG_PRINTLN("✗ Broker host name too long");
+    return;
+  }
+
+  bool cached = _addressValid && strcmp(host, _host) == 0 &&
+                millis() - _resolvedAt < MQTT_DNS_TTL;
+  if (cached) {
+    if (!beginHandshake()) {
+      fail("TLS setup failed");
+    }
+    return;
+  }
+
+  // The answer arrives in the lwIP task; pollConnect() picks it up
+  strcpy(_host, host);
+  _addressValid = false;
+  _lookups++;
+  _lookup.store(LOOKUP_PENDING, std::memory_order_relaxed);
+  _phase = PHASE_RESOLVING;
+  _phaseStart = millis();
+  if (tcpip_callback(startLookup, this) != ERR_OK) {
+    _lookup.store(LOOKUP_FAILED, std::memory_order_relaxed);
+  }
+}
+
+BrokerConnectStatus BrokerClient::pollConnect() {
+  switch (_phase) {
+    case PHASE_IDLE:
+      return BROKER_CONNECT_FAILED;
+
+    case PHASE_CONNECTED:
+      return BROKER_CONNECT_READY;
+
+    case PHASE_RESOLVING: {
+      uint8_t lookup = _lookup.load(std::memory_order_acquire);
+      if (lookup == LOOKUP_PENDING) {
+        if (millis() - _phaseStart >= MQTT_CONNECT_TIMEOUT) {
+          return fail("DNS lookup timed out");
+        }
+        return BROKER_CONNECT_PENDING;
+      }
+      if (lookup == LOOKUP_FAILED) {
+        return fail("DNS lookup failed");
+      }
+
+      _address = IPAddress(_lookupAddress);
+      _addressValid = true;
+      _resolvedAt = millis();
+      DEBUG_PRINT("✓ Broker resolved: ");
+      DEBUG_PRINTLN(_address.toString());
+
+      if (!beginHandshake()) {
+        return fail("TLS setup failed");
+      }
+      return BROKER_CONNECT_PENDING;
+    }
+
+    case PHASE_HANDSHAKE:
+      break;
+  }
+
+  // One step of the TCP connect or the handshake; never waits for the peer
+  int result = esp_tls_conn_new_async(_addressText, strlen(_addressText), _port,
+                                      &_cfg, _tls);
+  if (result == 0) {
+    if (millis() - _phaseStart >= MQTT_CONNECT_TIMEOUT) {
+      return fail("TLS connect timed out");
+    }
+    return BROKER_CONNECT_PENDING;
+  }
+  if (result < 0) {
+    // A session the broker turned down is not worth offering again
+    clearSession();
+    return fail("TLS connect failed");
+  }
+
+  _handshakeMs = millis() - _phaseStart;
+  _phase = PHASE_CONNECTED;
+  _rxPos = 0;
+  _rxLen = 0;
+  storeSession();
+  return BROKER_CONNECT_READY;
+}
+
+int BrokerClient::connect(const char* host, uint16_t port) {
+  startConnect(host, port);
+  return waitConnected();
+}
+
+int BrokerClient::connect(IPAddress ip, uint16_t port) {
+  // The resolver answers address literals at once
+  return connect(ip.toString().c_str(), port);
+}
+
+size_t BrokerClient::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+size_t BrokerClient::write(const uint8_t* buffer, size_t size) {
+  if (_phase != PHASE_CONNECTED) {
+    return 0;
+  }
+
+  // The socket is non-blocking: wait for room, but not forever
+  size_t sent = 0;
+  unsigned long start = millis();
+  while (sent < size) {
+    ssize_t result = esp_tls_conn_write(_tls, buffer + sent, size - sent);
+    if (result > 0) {
+      sent += result;
+    } else if ((result == ESP_TLS_ERR_SSL_WANT_WRITE || result == ESP_TLS_ERR_SSL_WANT_READ) &&
+               millis() - start < MQTT_CONNECT_TIMEOUT) {
+      delay(1);
+    } else {
+      DEBUG_PRINTLN("✗ TLS write failed");
+      stop();
+      break;
+    }
+  }
+  return sent;
+}
+
+int BrokerClient::available() {
+  return fill();
+}
+
+int BrokerClient::read() {
+  if (fill() == 0) {
+    return -1;
+  }
+  return _rx[_rxPos++];
+}
+
+int BrokerClient::read(uint8_t* buffer, size_t size) {
+  size_t count = 0;
+  while (count < size && fill() > 0) {
+    size_t chunk = _rxLen - _rxPos;
+    if (chunk > size - count) {
+      chunk = size - count;
+    }
+    memcpy(buffer + count, _rx + _rxPos, chunk);
+    _rxPos += chunk;
+    count += chunk;
+  }
+  return count;
+}
+
+int BrokerClient::peek() {
+  if (fill() == 0) {
+    return -1;
+  }
+  return _rx[_rxPos];
+}
+
+void BrokerClient::flush() {
+  // write() hands everything to the socket before returning
+}
+
+void BrokerClient::stop() {
+  if (_tls != nullptr) {
+    esp_tls_conn_destroy(_tls);
+    _tls = nullptr;
+  }
+  _phase = PHASE_IDLE;
+  _rxPos = 0;
+  _rxLen = 0;
+}
+
+uint8_t BrokerClient::connected() {
+  // Reading also notices a connection the broker closed
+  if (_phase == PHASE_CONNECTED) {
+    fill();
+  }
+  return _phase == PHASE_CONNECTED || _rxPos < _rxLen;
+}
+
+BrokerClient::operator bool() {
+  return connected();
+}
+
+void BrokerClient::clearAddressCache() {
+  _addressValid = false;
+}
+
+void BrokerClient::clearSession() {
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+  if (_session != nullptr) {
+    esp_tls_free_client_session((esp_tls_client_session_t*)_session);
+    _session = nullptr;
+  }
+#endif
+}
+
+unsigned long BrokerClient::getLookupCount() const {
+  return _lookups;
+}
+
+unsigned long BrokerClient::getHandshakeTime() const {
+  return _handshakeMs;
+}
+
+unsigned long BrokerClient::getResumeOffers() const {
+  return _resumeOffers;
+}
+
+void BrokerClient::startLookup(void* arg) {
+  BrokerClient* client = (BrokerClient*)arg;
+  ip_addr_t address;
+  err_t err = dns_gethostbyname(client->_host, &address, onLookup, client);
+  if (err == ERR_OK) {
+    // Cached by lwIP, or an address literal
+    onLookup(client->_host, &address, client);
+  } else if (err != ERR_INPROGRESS) {
+    onLookup(client->_host, nullptr, client);
+  }
+}
+
+void BrokerClient::onLookup(const char* name, const ip_addr_t* address, void* arg) {
+  BrokerClient* client = (BrokerClient*)arg;
+  if (address != nullptr && IP_IS_V4(address)) {
+    client->_lookupAddress = ip_2_ip4(address)->addr;
+    client->_lookup.store(LOOKUP_DONE, std::memory_order_release);
+  } else {
+    client->_lookup.store(LOOKUP_FAILED, std::memory_order_release);
+  }
+}
+
+bool BrokerClient::beginHandshake() {
+  _tls = esp_tls_init();
+  if (_tls == nullptr) {
+    return false;
+  }
+
+  // Connect to the cached address; SNI and the certificate check use the
+  // host name. Each poll waits at most 1 ms for the TCP connect.
+  memset(&_cfg, 0, sizeof(_cfg));
+  _cfg.non_block = true;
+  _cfg.timeout_ms = 1;
+  _cfg.common_name = _host;
+  if (_caCert != nullptr) {
+    _cfg.cacert_buf = (const unsigned char*)_caCert;
+    _cfg.cacert_bytes = strlen(_caCert) + 1;
+  }
+#if !CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY
+  else {
+    _cfg.crt_bundle_attach = esp_crt_bundle_attach;
+  }
+#endif
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+  if (_session != nullptr) {
+    _cfg.client_session = (esp_tls_client_session_t*)_session;
+    _resumeOffers++;
+  }
+#endif
+
+  strncpy(_addressText, _address.toString().c_str(), sizeof(_addressText) - 1);
+  _addressText[sizeof(_addressText) - 1] = '\0';
+  _phase = PHASE_HANDSHAKE;
+  _phaseStart = millis();
+  return true;
+}
+
+BrokerConnectStatus BrokerClient::fail(const char* what) {
+  DEBUG_PRINT("✗ Broker connect: ");
+  DEBUG_PRINTLN(what);
+
+  // The broker may have moved; look it up again next time
+  _addressValid = false;
+  stop();
+  return BROKER_CONNECT_FAILED;
+}
+
+void BrokerClient::storeSession() {
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+  esp_tls_client_session_t* session = esp_tls_get_client_session(_tls);
+  if (session != nullptr) {
+    clearSession();
+    _session = session;
+  }
+#endif
+}
+
+int BrokerClient::fill() {
+  if (_rxPos < _rxLen) {
+    return _rxLen - _rxPos;
+  }
+  if (_phase != PHASE_CONNECTED) {
+    return 0;
+  }
+
+  ssize_t result = esp_tls_conn_read(_tls, _rx, sizeof(_rx));
+  if (result > 0) {
+    _rxPos = 0;
+    _rxLen = result;
+    return result;
+  }
+  if (result == ESP_TLS_ERR_SSL_WANT_READ || result == ESP_TLS_ERR_SSL_WANT_WRITE) {
+    return 0;
+  }
+
+  // 0: closed by the broker; anything else: the connection broke
+  stop();
+  return 0;
+}
+
+int BrokerClient::waitConnected() {
+  for (;;) {
+    BrokerConnectStatus status = pollConnect();
+    if (status != BROKER_CONNECT_PENDING) {
+      return status == BROKER_CONNECT_READY ? 1 : 0;
+    }
+    delay(1);
+  }
+}
@@ -0,0 +1,236 @@
+/**
+ * @file BrokerClient.h
+ * @brief Non-blocking TLS client for the MQTT broker with session resumption
+ * @details WiFiClientSecure runs the DNS lookup, the TCP connect and the
+ *          whole TLS handshake inside one blocking call, with no way to keep
+ *          a TLS session between connects. BrokerClient is an Arduino Client
+ *          on ESP-IDF's esp_tls instead:
+ *          - startConnect() / pollConnect() run the lookup (lwIP's
+ *            asynchronous resolver) and esp_tls's asynchronous connect one
+ *            step per call, so the caller's loop keeps running.
+ *          - After each handshake the TLS session (ticket or session ID) is
+ *            kept and offered on the next connect, which turns a reconnect
+ *            after a WiFi blip into an abbreviated handshake (one round trip
+ *            and no certificate exchange) when the broker accepts it.
+ *          - The broker's address is cached and only looked up again after
+ *            a failed connect or once MQTT_DNS_TTL has passed; SNI and
+ *            certificate checks still use the host name.
+ */
+
+#ifndef BROKERCLIENT_H
+#define BROKERCLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <atomic>
+#include <esp_tls.h>
+#include <lwip/dns.h>
+#include "../Config.h"
+
+/**
+ * @enum BrokerConnectStatus
+ * @brief Progress of a connect attempt (see pollConnect())
+ */
+enum BrokerConnectStatus {
+  BROKER_CONNECT_PENDING,   ///< Still resolving or handshaking; poll again
+  BROKER_CONNECT_READY,     ///< TLS session established
+  BROKER_CONNECT_FAILED     ///< Attempt over; the client is stopped
+};
+
+/**
+ * @class BrokerClient
+ * @brief Arduino Client over esp_tls with a cached address and TLS session
+ *
+ * Only one task may use an instance. Reads and writes are non-blocking at
+ * the socket; write() waits for room for at most MQTT_CONNECT_TIMEOUT.
+ *
+ * Session resumption needs CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS in the
+ * ESP-IDF configuration; without it every connect is a full handshake.
+ *
+ * Example usage:
+ * @code
+ * BrokerClient client;
+ * PubSubClient mqtt(client);
+ * client.startConnect(MQTT_SERVER, MQTT_PORT);
+ * // in the loop
+ * if (client.pollConnect() == BROKER_CONNECT_READY) {
+ *   mqtt.connect(clientId);   // sees a connected client; sends CONNECT
+ * }
+ * @endcode
+ */
+class BrokerClient : public Client {
+public:
+  /**
+   * @brief Constructor
+   */
+  BrokerClient();
+
+  /**
+   * @brief Destructor (closes the connection, frees the stored session)
+   */
+  ~BrokerClient();
+
+  /**
+   * @brief Verify the broker against a root CA instead of the default
+   * @details Default: no verification where the IDF configuration allows
+   *          it (CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY), otherwise the
+   *          built-in certificate bundle
+   * @param rootCA PEM certificate (must stay valid)
+   */
+  void setCACert(const char* rootCA);
+
+  /**
+   * @brief Start a connect attempt (returns immediately)
+   * @details Closes any open connection first
+   * @param host Broker host name (also used for SNI)
+   * @param port Broker port
+   */
+  void startConnect(const char* host, uint16_t port);
+
+  /**
+   * @brief Advance the current connect attempt
+   * @details Each call does one non-blocking step. A phase (lookup, or TCP
+   *          connect plus handshake) that takes longer than
+   *          MQTT_CONNECT_TIMEOUT fails the attempt.
+   * @return Progress of the attempt
+   */
+  BrokerConnectStatus pollConnect();
+
+  /**
+   * @brief Connect and wait for the result (Client interface)
+   * @details Blocking; MQTTHandler uses startConnect()/pollConnect()
+   * @return 1 if connected, 0 otherwise
+   */
+  int connect(const char* host, uint16_t port) override;
+
+  /**
+   * @brief Connect to an address and wait for the result (Client interface)
+   * @return 1 if connected, 0 otherwise
+   */
+  int connect(IPAddress ip, uint16_t port) override;
+
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buffer, size_t size) override;
+  int peek() override;
+  void flush() override;
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override;
+
+  /**
+   * @brief Forget the cached address (e.g. after the network changed)
+   */
+  void clearAddressCache();
+
+  /**
+   * @brief Forget the stored TLS session (next connect does a full handshake)
+   */
+  void clearSession();
+
+  /**
+   * @brief Get number of DNS lookups performed
+   * @return Lookup count
+   */
+  unsigned long getLookupCount() const;
+
+  /**
+   * @brief Get duration of the last successful TCP + TLS handshake
+   * @return Milliseconds, or 0 if never connected
+   */
+  unsigned long getHandshakeTime() const;
+
+  /**
+   * @brief Get number of handshakes that offered a stored TLS session
+   * @return Count (the broker may still have chosen a full handshake)
+   */
+  unsigned long getResumeOffers() const;
+
+private:
+  /**
+   * @enum Phase
+   * @brief Where the current attempt is
+   */
+  enum Phase : uint8_t {
+    PHASE_IDLE,        ///< No attempt, no connection
+    PHASE_RESOLVING,   ///< Waiting for the DNS answer
+    PHASE_HANDSHAKE,   ///< esp_tls connecting
+    PHASE_CONNECTED    ///< Session up
+  };
+
+  /**
+   * @enum Lookup
+   * @brief DNS answer state, written by the lwIP task
+   */
+  enum Lookup : uint8_t {
+    LOOKUP_PENDING,    ///< Sent, no answer yet
+    LOOKUP_DONE,       ///< _lookupAddress holds the answer
+    LOOKUP_FAILED      ///< No address
+  };
+
+  char _host[64];                    ///< Host name of the current attempt / cache
+  uint16_t _port;                    ///< Port of the current attempt
+  const char* _caCert;               ///< Root CA, or nullptr for the default
+  Phase _phase;                      ///< Attempt / connection state
+  unsigned long _phaseStart;         ///< millis() the current phase began
+  esp_tls_t* _tls;                   ///< Open connection (or attempt)
+  esp_tls_cfg_t _cfg;                ///< Settings of the current attempt
+  char _addressText[16];             ///< _address as text, for esp_tls
+  void* _session;                    ///< Stored TLS session (esp_tls_client_session_t)
+  IPAddress _address;                ///< Cached broker address
+  bool _addressValid;                ///< _address may be used
+  unsigned long _resolvedAt;         ///< Time of the last lookup
+  std::atomic<uint8_t> _lookup;      ///< Lookup state (see Lookup)
+  uint32_t _lookupAddress;           ///< IPv4 answer (valid once LOOKUP_DONE)
+  unsigned long _lookups;            ///< DNS lookups performed
+  unsigned long _handshakeMs;        ///< Last successful handshake duration
+  unsigned long _resumeOffers;       ///< Handshakes offered a stored session
+  uint8_t _rx[128];                  ///< Decrypted bytes not read yet
+  uint8_t _rxPos;                    ///< Next byte in _rx
+  uint8_t _rxLen;                    ///< Bytes in _rx
+
+  /**
+   * @brief Send the DNS query for _host (from the lwIP task)
+   * @param arg BrokerClient
+   */
+  static void startLookup(void* arg);
+
+  /**
+   * @brief DNS answer callback (runs in the lwIP task)
+   */
+  static void onLookup(const char* name, const ip_addr_t* address, void* arg);
+
+  /**
+   * @brief Open the TLS connection to _address
+   * @return false if esp_tls could not start
+   */
+  bool beginHandshake();
+
+  /**
+   * @brief End the attempt after a failure
+   * @param what What failed (for the log)
+   * @return BROKER_CONNECT_FAILED
+   */
+  BrokerConnectStatus fail(const char* what);
+
+  /**
+   * @brief Keep the session of the connection just established
+   */
+  void storeSession();
+
+  /**
+   * @brief Refill _rx from the connection without waiting
+   * @return Bytes now buffered
+   */
+  int fill();
+
+  /**
+   * @brief Run an attempt to completion (blocking Client interface)
+   * @return 1 if connected, 0 otherwise
+   */
+  int waitConnected();
+};
+
+#endif // BROKERCLIENT_H
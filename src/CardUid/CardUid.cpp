@@ -0,0 +1,97 @@
+/**
+ * @file CardUid.cpp
+ * @brief Implementation of packed card UID helpers
+ */
+
+#include "CardUid.h"
+
+/**
+ * @brief Convert a hex digit to its value
+ * @return 0-15, or -1 if not a hex digit
+ */
+static int hexDigitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+void CardUid::clear() {
+  memset(bytes, 0, sizeof(bytes));
+  length = 0;
+}
+
+bool CardUid::isEmpty() const {
+  return length == 0;
+}
+
+bool CardUid::fromHex(const char* hex) {
+  clear();
+
+  if (hex == nullptr) {
+    return false;
+  }
+
+  size_t len = strlen(hex);
+  if (len == 0 || (len % 2) != 0 || len > CARD_UID_MAX_LENGTH * 2) {
+    return false;
+  }
+
+  for (size_t i = 0; i < len; i += 2) {
+    int high = hexDigitValue(hex[i]);
+    int low = hexDigitValue(hex[i + 1]);
+    if (high < 0 || low < 0) {
+      clear();
+      return false;
+    }
+    bytes[i / 2] = (uint8_t)((high << 4) | low);
+  }
+
+  length = len / 2;
+  return true;
+}
+
+void CardUid::fromBytes(const uint8_t* data, uint8_t len) {
+  clear();
+
+  if (len > CARD_UID_MAX_LENGTH) {
+    len = CARD_UID_MAX_LENGTH;
+  }
+
+  memcpy(bytes, data, len);
+  length = len;
+}
+
+size_t CardUid::toHex(char* buffer, size_t size) const {
+  static const char digits[] = "0123456789ABCDEF";
+
+  if (buffer == nullptr || size == 0) {
+    return 0;
+  }
+
+  size_t written = 0;
+  for (uint8_t i = 0; i < length && written + 2 < size; i++) {
+    buffer[written++] = digits[bytes[i] >> 4];
+    buffer[written++] = digits[bytes[i] & 0x0F];
+  }
+  buffer[written] = '\0';
+
+  return written;
+}
+
+uint32_t CardUid::hash() const {
+  uint32_t h = 2166136261u;
+  for (uint8_t i = 0; i < length; i++) {
+    h ^= bytes[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+bool CardUid::operator==(const CardUid& other) const {
+  return length == other.length && memcmp(bytes, other.bytes, length) == 0;
+}
+
+bool CardUid::operator!=(const CardUid& other) const {
+  return !(*this == other);
+}
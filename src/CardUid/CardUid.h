@@ -0,0 +1,78 @@
+/**
+ * @file CardUid.h
+ * @brief Packed binary RFID card UID
+ * @details ISO14443A UIDs are 4, 7 or 10 bytes. Storing them as raw bytes
+ *          plus a length instead of hex strings halves their size and makes
+ *          comparison and hashing a few byte operations.
+ */
+
+#ifndef CARDUID_H
+#define CARDUID_H
+
+#include <Arduino.h>
+
+#define CARD_UID_MAX_LENGTH 10                            // Longest ISO14443A UID (bytes)
+#define CARD_UID_HEX_SIZE (CARD_UID_MAX_LENGTH * 2 + 1)   // Hex string buffer incl. terminator
+
+/**
+ * @struct CardUid
+ * @brief Card UID as raw bytes plus length (length 0 = no card)
+ *
+ * Plain data: safe to copy, store in EEPROM and pass through queues.
+ *
+ * Example usage:
+ * @code
+ * CardUid uid;
+ * uid.fromHex("0A1B2C3D");
+ * char hex[CARD_UID_HEX_SIZE];
+ * uid.toHex(hex, sizeof(hex));
+ * @endcode
+ */
+struct CardUid {
+  uint8_t bytes[CARD_UID_MAX_LENGTH];   ///< UID bytes (first length bytes valid)
+  uint8_t length;                       ///< Number of valid bytes
+
+  /**
+   * @brief Reset to the empty UID
+   */
+  void clear();
+
+  /**
+   * @brief Check if no UID is stored
+   * @return true if empty
+   */
+  bool isEmpty() const;
+
+  /**
+   * @brief Parse a hex string ("0A1B2C3D", case-insensitive)
+   * @param hex Null-terminated hex string
+   * @return true if valid, false otherwise (UID is cleared)
+   */
+  bool fromHex(const char* hex);
+
+  /**
+   * @brief Copy raw UID bytes
+   * @param data UID bytes
+   * @param len Number of bytes (truncated to CARD_UID_MAX_LENGTH)
+   */
+  void fromBytes(const uint8_t* data, uint8_t len);
+
+  /**
+   * @brief Format as upper-case hex string
+   * @param buffer Output buffer (CARD_UID_HEX_SIZE bytes is always enough)
+   * @param size Buffer size
+   * @return Number of characters written (excluding terminator)
+   */
+  size_t toHex(char* buffer, size_t size) const;
+
+  /**
+   * @brief FNV-1a hash of the UID bytes
+   * @return 32-bit hash
+   */
+  uint32_t hash() const;
+
+  bool operator==(const CardUid& other) const;
+  bool operator!=(const CardUid& other) const;
+};
+
+#endif // CARDUID_H
@@ -0,0 +1,84 @@
+/**
+ * @file CommandRegistry.cpp
+ * @brief Implementation of the MQTT command table
+ */
+
+#include "CommandRegistry.h"
+
+static_assert((COMMAND_INDEX_SIZE & (COMMAND_INDEX_SIZE - 1)) == 0,
+              "COMMAND_INDEX_SIZE must be a power of two");
+static_assert(COMMAND_INDEX_SIZE >= 2 * COMMAND_MAX,
+              "COMMAND_INDEX_SIZE must keep the load factor at or below 0.5");
+static_assert(COMMAND_MAX <= 127, "Command rows must fit the int8_t index");
+
+CommandRegistry::CommandRegistry() : _table(nullptr), _count(0) {
+  for (int i = 0; i < COMMAND_INDEX_SIZE; i++) {
+    _index[i].command = -1;
+  }
+}
+
+bool CommandRegistry::begin(const CommandSpec* table, uint8_t count) {
+  _table = table;
+  _count = 0;
+  for (int i = 0; i < COMMAND_INDEX_SIZE; i++) {
+    _index[i].command = -1;
+  }
+
+  bool success = true;
+  for (uint8_t row = 0; row < count; row++) {
+    if (_count >= COMMAND_MAX) {
+      DEBUG_PRINTF("✗ Command table full, %s dropped\n", table[row].name);
+      success = false;
+      continue;
+    }
+    if (find(table[row].name) != nullptr) {
+      DEBUG_PRINTF("✗ Command %s registered twice\n", table[row].name);
+      success = false;
+      continue;
+    }
+
+    uint32_t hash = hashName(table[row].name);
+    uint32_t bucket = hash & (COMMAND_INDEX_SIZE - 1);
+    while (_index[bucket].command != -1) {
+      bucket = (bucket + 1) & (COMMAND_INDEX_SIZE - 1);
+    }
+    _index[bucket].hash = hash;
+    _index[bucket].command = row;
+    _count++;
+  }
+  return success;
+}
+
+const CommandSpec* CommandRegistry::find(const char* name) const {
+  if (name == nullptr || _table == nullptr) {
+    return nullptr;
+  }
+
+  // Linear probing; a hash match is confirmed by comparing the name
+  uint32_t hash = hashName(name);
+  uint32_t bucket = hash & (COMMAND_INDEX_SIZE - 1);
+  for (int probe = 0; probe < COMMAND_INDEX_SIZE; probe++) {
+    const Bucket& entry = _index[bucket];
+    if (entry.command == -1) {
+      return nullptr;
+    }
+    if (entry.hash == hash && strcmp(_table[entry.command].name, name) == 0) {
+      return &_table[entry.command];
+    }
+    bucket = (bucket + 1) & (COMMAND_INDEX_SIZE - 1);
+  }
+  return nullptr;
+}
+
+uint8_t CommandRegistry::getCount() const {
+  return _count;
+}
+
+uint32_t CommandRegistry::hashName(const char* name) {
+  uint32_t hash = 2166136261u;
+  while (*name != '\0') {
+    hash ^= (uint8_t)*name++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file CommandRegistry.h
+ * @brief Name-to-handler table for MQTT commands
+ * @details The commands are a constant table; begin() hashes their names
+ *          into a small open-addressing index, so a lookup costs one hash
+ *          and usually one string compare instead of a strcmp per known
+ *          command. The index is read-only afterwards, so the network task
+ *          (acknowledging) and the gate task (executing) can both look
+ *          commands up.
+ */
+
+#ifndef COMMANDREGISTRY_H
+#define COMMANDREGISTRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../Config.h"
+
+/**
+ * @brief Command handler
+ * @param doc Parsed command
+ * @return Result status string literal ("ok" or why it failed)
+ */
+typedef const char* (*CommandHandler)(JsonDocument& doc);
+
+/**
+ * @enum CommandFlags
+ * @brief Per-command options
+ */
+enum CommandFlags {
+  COMMAND_KEEPS_BENCHMARK = 1 << 0   ///< Runs alongside a benchmark instead of ending it
+};
+
+/**
+ * @struct CommandSpec
+ * @brief One table row
+ */
+struct CommandSpec {
+  const char* name;          ///< Value of the "command" field
+  CommandHandler handler;    ///< Runs the command (gate task)
+  uint8_t flags;             ///< CommandFlags bits
+};
+
+/**
+ * @class CommandRegistry
+ * @brief Looks commands up by name
+ *
+ * Example usage:
+ * @code
+ * static const CommandSpec table[] = {
+ *   {"get_status", handleGetStatusCommand, COMMAND_KEEPS_BENCHMARK},
+ * };
+ * CommandRegistry registry;
+ * registry.begin(table, sizeof(table) / sizeof(table[0]));
+ *
+ * const CommandSpec* spec = registry.find("get_status");
+ * if (spec != nullptr) {
+ *   const char* result = spec->handler(doc);
+ * }
+ * @endcode
+ */
+class CommandRegistry {
+public:
+  /**
+   * @brief Constructor
+   */
+  CommandRegistry();
+
+  /**
+   * @brief Index a command table (call once, before any find())
+   * @param table Commands (must outlive the registry)
+   * @param count Rows in table
+   * @return true if indexed, false if it has more than COMMAND_MAX
+   *         commands or a name twice (later rows are then skipped)
+   */
+  bool begin(const CommandSpec* table, uint8_t count);
+
+  /**
+   * @brief Find a command
+   * @param name Command name
+   * @return Table row, or nullptr if unknown
+   */
+  const CommandSpec* find(const char* name) const;
+
+  /**
+   * @brief Get the number of indexed commands
+   * @return Commands
+   */
+  uint8_t getCount() const;
+
+private:
+  /**
+   * @struct Bucket
+   * @brief Index slot
+   */
+  struct Bucket {
+    uint32_t hash;           ///< Hash of the name
+    int8_t command;          ///< Table row (-1 = empty)
+  };
+
+  const CommandSpec* _table;          ///< Commands
+  uint8_t _count;                     ///< Rows indexed
+  Bucket _index[COMMAND_INDEX_SIZE];  ///< Open-addressing index over the names
+
+  /**
+   * @brief FNV-1a hash of a name (same as CardUid::hash())
+   */
+  static uint32_t hashName(const char* name);
+};
+
+#endif // COMMANDREGISTRY_H
@@ -14,25 +14,70 @@
 // WiFi Credentials (UPDATE THESE FOR YOUR NETWORK)
 #define WIFI_SSID "Cnt3"
 #define WIFI_PASSWORD "123456987"
-#define WIFI_CHECK_INTERVAL 10000 // Check WiFi connection every 10 seconds
+#define WIFI_CONNECT_TIMEOUT 15000 // Give up on one association attempt after this (ms)
+#define WIFI_BACKOFF_MIN 1000      // First retry delay after a failed attempt (ms)
+#define WIFI_BACKOFF_MAX 60000     // Retry delay ceiling (ms)
+#define NETWORK_MAX_LISTENERS 4    // Link state change subscribers
+
+// Fast Boot
+#define FAST_BOOT_ENABLED 1        // Gates start before WiFi/NTP/MQTT, which come up in the network task
+#define WIFI_CACHE_LINK 1          // Join the last AP by cached BSSID/channel (skips the scan)
+#define WIFI_CACHE_STATIC_IP 0     // Reuse the cached IP without DHCP; only if the router reserves it
+#define WIFI_NVS_NAMESPACE "wifi"  // Cached link parameters
 
 // MQTT Broker Settings (HiveMQ Cloud Configuration)
-#define Hive "d17c7b0faa964c81bb1a8c203be8b280.s1.eu.hivemq.cloud" // HiveMQ Cloud cluster URL
+#define MQTT_SERVER "d17c7b0faa964c81bb1a8c203be8b280.s1.eu.hivemq.cloud" // HiveMQ Cloud cluster URL
 #define MQTT_PORT 8883                                             // TLS/SSL port for HiveMQ Cloud
 #define MQTT_USERNAME "dung123"                                    // HiveMQ Cloud username
 #define MQTT_PASSWORD "Iot2025@"                                   // HiveMQ Cloud password
-#define MQTT_BUFFER_SIZE 512                                       // Increased for JSON messages
+#define MQTT_BUFFER_SIZE 1024                                      // Room for batched event messages
+#define JSON_TX_ARENA_SIZE 4096  // Fixed arena for building outgoing JSON, incl. event batches (bytes)
+#define JSON_RX_ARENA_SIZE 4096  // Fixed arena for parsing one incoming command (bytes)
 
 // MQTT Topics
 #define MQTT_TOPIC_ENTRY "parking/events/entry"
 #define MQTT_TOPIC_EXIT "parking/events/exit"
 #define MQTT_TOPIC_SCAN "parking/events/scan"
+#define MQTT_TOPIC_DENIED "parking/events/denied"  // Repeated denials folded by the deny cache
 #define MQTT_TOPIC_SYSTEM "parking/system"
 #define MQTT_TOPIC_COMMANDS "parking/commands"
+#define MQTT_TOPIC_WHITELIST_ACK "parking/whitelist/ack"
+#define MQTT_TOPIC_COMMAND_ACK "parking/commands/ack"        // Command accepted/refused (commands with an "id")
+#define MQTT_TOPIC_COMMAND_RESULT "parking/commands/result"  // Outcome once the gate task ran it
+#define MQTT_TOPIC_METRICS "parking/system/metrics"  // Latency histograms (get_metrics)
+#define MQTT_TOPIC_BENCHMARK "parking/system/benchmark"  // Benchmark mode results
+#define MQTT_TOPIC_ENTRY_V2 "parking/v2/events/entry"  // MessagePack entry events
+#define MQTT_TOPIC_EXIT_V2 "parking/v2/events/exit"    // MessagePack exit events
+#define MQTT_TOPIC_EVENT_BATCH "parking/events/batch"        // Several entry/exit events
+#define MQTT_TOPIC_EVENT_BATCH_V2 "parking/v2/events/batch"  // MessagePack event batch
+
+// Command Dispatch (see CommandRegistry)
+#define COMMAND_MAX 16          // Commands the registry can hold
+#define COMMAND_INDEX_SIZE 32   // Hash index buckets (power of two, at least 2x COMMAND_MAX)
+
+// Event Wire Format
+#define EVENT_ENCODING_JSON 0     // Self-describing JSON on parking/events/*
+#define EVENT_ENCODING_MSGPACK 1  // MessagePack with short keys on parking/v2/events/*
+#define MQTT_EVENT_ENCODING EVENT_ENCODING_JSON  // Use MSGPACK on metered uplinks
 
 // MQTT Connection
-#define MQTT_RECONNECT_INTERVAL 5000 // Try reconnect every 5 seconds
-#define STATUS_UPDATE_INTERVAL 30000 // Send status update every 30 seconds
+#define MQTT_BACKOFF_MIN 500         // Retry delay after the first failed connect (ms)
+#define MQTT_BACKOFF_MAX 60000       // Retry delay cap; doubles per failure up to this (ms)
+#define MQTT_CONNECT_TIMEOUT 5000    // Bound on each of DNS lookup, TCP + TLS handshake and CONNACK (ms)
+#define MQTT_DNS_TTL 3600000         // Re-resolve the broker address after 1 hour
+#define STATUS_UPDATE_INTERVAL 30000 // Check for status changes every 30 seconds
+#define STATUS_FULL_INTERVAL 300000  // Full status snapshot at least every 5 minutes
+#define STATUS_RSSI_HYSTERESIS 6     // RSSI change (dBm) that counts as a status change
+
+// Event Outbox (entry/exit events survive MQTT outages)
+#define OUTBOX_PARTITION "outbox"      // Dedicated NVS partition (see partitions.csv)
+#define OUTBOX_NVS_NAMESPACE "events"
+#define OUTBOX_RAM_CAPACITY 16         // Events buffered in RAM before spilling to flash
+#define OUTBOX_FLASH_CAPACITY 512      // Events kept in flash; the oldest are dropped beyond this
+#define OUTBOX_DRAIN_BATCH 8           // Event messages published per network task cycle
+#define EVENT_BATCH_WINDOW 500         // Hold events up to this long (ms) to coalesce them
+#define EVENT_BATCH_MAX 6              // Events per batched message (also bounded by MQTT_BUFFER_SIZE)
+#define OUTBOX_STATUS_SIZE 20          // Stored status string incl. terminator
 
 // ==================== TIME SYNC CONFIGURATION ====================
 
@@ -40,17 +85,47 @@
 #define NTP_SERVER "pool.ntp.org"
 #define GMT_OFFSET_SEC 25200 // GMT+7 for Vietnam (7 * 3600)
 #define DAYLIGHT_OFFSET_SEC 0
-#define NTP_SYNC_TIMEOUT 5000 // NTP sync timeout in ms
+#define NTP_RESYNC_INTERVAL 3600000 // Background SNTP resync period in ms (min 15000)
+#define NTP_DRIFT_MIN_INTERVAL 600000 // Syncs closer than this (ms) do not update the drift estimate
+#define NTP_DRIFT_MAX_PPM 500 // Larger estimates are clock steps, not drift, and are discarded
+#define NTP_SLEW_MAX_PPM 500 // Rate at which a resync correction is blended into timestamps
+#define NTP_STEP_THRESHOLD_MS 1000 // Larger resync corrections are stepped instead of slewed
+#define NTP_VALID_EPOCH 1700000000UL // Timestamps below this are uptime seconds (taken before sync)
 
 // ==================== PARKING SYSTEM CONFIGURATION ====================
 
 // Slot Management
 #define TOTAL_SLOTS 10    // Total number of parking slots
+#define SLOT_NVS_NAMESPACE "slots"  // Occupancy survives reboot (one NVS record per occupied slot)
+
+// Slot Zones: contiguous slot ranges {first, last, access mask}, tried in
+// order. The mask has one bit per RFIDAccessLevel allowed to park there.
+// Slot numbers run from the entrance towards the exit.
+#define SLOT_MAX_ZONES 4
+#define SLOT_ZONE_ACCESS(level) (1 << (level))
+#define SLOT_ZONE_ALL_LEVELS (SLOT_ZONE_ACCESS(ACCESS_REGULAR) | SLOT_ZONE_ACCESS(ACCESS_ADMIN) | SLOT_ZONE_ACCESS(ACCESS_TEMPORARY))
+#define SLOT_ZONES { {1, TOTAL_SLOTS, SLOT_ZONE_ALL_LEVELS} }
+#define SLOT_ALLOCATION_POLICY SLOT_POLICY_ROUND_ROBIN  // Spread wear across each zone
+#ifndef MAX_RFID_CARDS  // Benchmark builds override both (see [env:native_whitelist_*])
 #define MAX_RFID_CARDS 50 // Maximum cards in whitelist
+#define RFID_INDEX_SIZE 128 // Whitelist hash buckets (power of two, >= 2 * MAX_RFID_CARDS)
+#endif
+
+// Whitelist Storage Configuration (one NVS record per card)
+#define WHITELIST_NVS_NAMESPACE "whitelist"
+#define WHITELIST_STORE_LAYOUT 1 // Stored record layout version (bump on RFIDCard change)
+#define RECORD_STORE_MAX_RECORD_SIZE 64 // Largest record RecordStore accepts (bytes)
+#define WHITELIST_SNAPSHOT_TIMEOUT 10000 // Abandon a chunked snapshot if the next chunk is this late (ms)
+#define WHITELIST_PENDING_NAMES 24 // Distinct owner names held in RAM until written; more go to staging records
+
+// Record pools: whitelist entries and slot records are allocated once at
+// boot, in PSRAM on boards that have it (e.g. WROVER with -DBOARD_HAS_PSRAM)
+#define RECORD_POOL_USE_PSRAM true
 
-// EEPROM Configuration
+// Legacy EEPROM image, imported once into NVS on first boot
 #define EEPROM_SIZE 4096
-#define EEPROM_MAGIC 0xABCD1234 // Magic number for EEPROM validation
+#define EEPROM_MAGIC 0xABCD1234 // Magic number of the EEPROM whitelist (hex string UIDs)
+#define EEPROM_LEGACY_CARDS 50  // Card slots in the legacy EEPROM image
 
 // ==================== HARDWARE PIN DEFINITIONS ====================
 
@@ -73,6 +148,30 @@
 #define RFID_OUT_SS 5   // SPI SS pin for exit RFID
 #define RFID_OUT_RST 17 // RST pin for exit RFID
 
+// LANES (one row per barrier: name, LCD label, direction, IR, servo, RFID SS, RFID RST)
+// All readers share the SPI bus (SCK 18, MISO 19, MOSI 23); each needs its own SS pin.
+// Entry lanes share LCD row 0, exit lanes row 1.
+#ifndef LANE_COUNT
+#define LANE_COUNT 2
+#define LANES { \
+  {"ENTRANCE", "IN",  LANE_ENTRY, IR_IN_PIN,  SERVO_IN_PIN,  RFID_IN_SS,  RFID_IN_RST}, \
+  {"EXIT",     "OUT", LANE_EXIT,  IR_OUT_PIN, SERVO_OUT_PIN, RFID_OUT_SS, RFID_OUT_RST} }
+#endif
+#define MAX_LANES 8 // Upper bound for LANE_COUNT
+
+// ==================== RFID POLLING CONFIGURATION ====================
+
+#define RFID_POLL_ONLY_WHEN_WAITING true // Poll a reader only while its gate waits for a card
+#define RFID_IDLE_ANTENNA_OFF true       // Switch the RF field off while a reader is idle
+#define RFID_POLLS_PER_ITERATION 2       // Reader polls per gate iteration, shared by all lanes
+                                         // (an empty poll holds the SPI bus for up to ~25 ms)
+
+// ==================== IR SENSOR CONFIGURATION ====================
+
+#define IR_INTERRUPT_MODE true  // Capture IR edges in a GPIO ISR (false = poll pin)
+#define IR_DEBOUNCE_MS 50       // Level must be stable this long to count (ms)
+#define IR_EDGE_BUFFER_SIZE 16  // ISR edge ring capacity (power of two)
+
 // ==================== SERVO CONFIGURATION ====================
 
 #define SERVO_FREQ 50        // Standard servo frequency (50Hz)
@@ -86,6 +185,31 @@
 #define GATE_CLOSE_DELAY 2000         // Delay before closing gate (ms)
 #define CARD_SCAN_TIMEOUT 10000       // Timeout for card scanning (ms)
 #define DISPLAY_MESSAGE_DURATION 2000 // Duration to show messages (ms)
+#define MANUAL_OPEN_DURATION 5000     // Remote open_barrier hold time (ms)
+#define SCHEDULER_MAX_TIMERS 8        // Pending timers per TimerScheduler
+
+// ==================== RTOS TASK CONFIGURATION ====================
+
+// Gate/RFID/IR path runs alone on the APP core so network stalls never delay it
+#define GATE_TASK_CORE 1
+#define GATE_TASK_PRIORITY 5
+#define GATE_TASK_STACK_SIZE 8192
+#define GATE_TASK_PERIOD_MS 5 // Gate state machine tick
+
+// WiFi, MQTT and LCD share the PRO core with the WiFi/TCP stack
+#define NETWORK_TASK_CORE 0
+#define NETWORK_TASK_PRIORITY 3
+#define NETWORK_TASK_STACK_SIZE 8192
+#define NETWORK_TASK_PERIOD_MS 10 // Max wait for queued publishes per pass
+
+#define DISPLAY_TASK_CORE 0
+#define DISPLAY_TASK_PRIORITY 1
+#define DISPLAY_TASK_STACK_SIZE 3072
+
+// Inter-task queue depths
+#define PUBLISH_QUEUE_LENGTH 16 // Gate events waiting for MQTT
+#define COMMAND_QUEUE_LENGTH 4  // MQTT commands waiting for the gate task (backend paces whitelist sync)
+#define DISPLAY_QUEUE_LENGTH 8  // LCD updates waiting for the display task
 
 // ==================== RFID CARD ACCESS LEVELS ====================
 
@@ -96,6 +220,23 @@ enum RFIDAccessLevel
   ACCESS_TEMPORARY = 2 // Temporary/guest access
 };
 
+// ==================== SLOT ALLOCATION POLICIES ====================
+
+enum SlotAllocationPolicy
+{
+  SLOT_POLICY_LOWEST,      // Lowest free slot number in the zone
+  SLOT_POLICY_ROUND_ROBIN, // Next free slot after the last one allocated in the zone
+  SLOT_POLICY_NEAREST_EXIT // Highest free slot number in the zone
+};
+
+// ==================== LANE DIRECTIONS ====================
+
+enum LaneDirection
+{
+  LANE_ENTRY, // Cars enter the garage (slot allocated, entry event)
+  LANE_EXIT   // Cars leave the garage (slot released, exit event)
+};
+
 // ==================== GATE STATE ENUMERATION ====================
 
 enum GateState
@@ -103,13 +244,56 @@ enum GateState
   STATE_IDLE,         // No vehicle detected
   STATE_WAITING_CARD, // Vehicle detected, waiting for RFID
   STATE_BARRIER_OPEN, // Barrier is open
-  STATE_CLOSING_DELAY // Waiting before closing barrier
+  STATE_CLOSING_DELAY, // Waiting before closing barrier
+  STATE_MESSAGE_HOLD  // Showing denied/full result before returning to idle
 };
 
+// ==================== LATENCY TRACING ====================
+
+#define LATENCY_TRACE_ENABLED 1        // Per-stage latency histograms
+#define LATENCY_HISTOGRAM_BUCKETS 48   // Two buckets per power of two of us (~16 s range)
+#define STATUS_INCLUDE_METRICS 0       // Add p50/p99/max to full status snapshots
+
+// ==================== HEALTH MONITORING ====================
+
+#define HEALTH_MAX_TASKS 4             // Tasks whose stack high-water mark is reported
+#define HEALTH_LOOP_WARN_US 20000      // Gate iteration this slow is reported at once (us)
+#define HEALTH_HEAP_WARN 20000         // Free heap below this is reported at once (bytes)
+
+// ==================== BENCHMARK MODE ====================
+// Synthetic traffic through the real gate path; see BenchmarkRunner.
+// Off by default: the runs publish entry/exit events like real cars.
+
+#ifndef BENCHMARK_MODE_ENABLED  // [env:esp32doit-devkit-v1-benchmark] sets 1
+#define BENCHMARK_MODE_ENABLED 0       // Accept the "benchmark" command
+#endif
+#ifndef BENCHMARK_AUTOSTART_S
+#define BENCHMARK_AUTOSTART_S 0        // Run once for this long after MQTT connects (s, 0 = off)
+#endif
+#define BENCHMARK_DEFAULT_DURATION_S 60  // Run length when the command gives none (s)
+#define BENCHMARK_MAX_DURATION_S 3600  // Longest accepted run (s)
+#define BENCHMARK_CARDS 16             // Synthetic whitelisted cards (cars in circulation)
+#define BENCHMARK_UNKNOWN_CARDS 4      // Synthetic cards not on the whitelist
+#define BENCHMARK_UNKNOWN_EVERY 10     // Every Nth arrival shows an unknown card (0 = never)
+#define BENCHMARK_STEP_TIMEOUT_MS 15000  // Car stuck this long in one step is abandoned (ms)
+#define BENCHMARK_DRAIN_TIMEOUT_MS 30000 // Wait for cars to leave and events to publish (ms)
+
+// ==================== DENIED CARD CACHE ====================
+
+// A card refused at a lane is remembered for DENY_CACHE_TTL_MS: repeat taps
+// are refused without a whitelist lookup and not published one by one; the
+// window ends with one summary on MQTT_TOPIC_DENIED. Whitelist changes
+// invalidate the cache.
+#define DENY_CACHE_ENABLED 1
+#define DENY_CACHE_SIZE 8         // Cards remembered across all lanes
+#define DENY_CACHE_TTL_MS 60000   // Window from the first denial of a card at a lane (ms)
+
 // ==================== DEBUG & LOGGING ====================
 
 #define SERIAL_BAUD_RATE 115200
+#ifndef DEBUG_ENABLED  // [env:native] builds with -DDEBUG_ENABLED=0
 #define DEBUG_ENABLED true // Enable/disable debug logging
+#endif
 
 // Debug logging macro
 #if DEBUG_ENABLED
@@ -0,0 +1,103 @@
+/**
+ * @file DenyCache.cpp
+ * @brief Implementation of the refused card cache
+ */
+
+#include "DenyCache.h"
+
+DenyCache::DenyCache() : _folded(0) {
+  clear();
+}
+
+bool DenyCache::isDenied(uint8_t lane, const CardUid& uid, uint32_t revision,
+                         uint64_t now) const {
+  int index = find(lane, uid);
+  return index >= 0 && !isClosed(_entries[index], now, revision);
+}
+
+bool DenyCache::recordDenial(uint8_t lane, const CardUid& uid, uint32_t revision,
+                             uint64_t now) {
+  int index = find(lane, uid);
+  if (index >= 0 && !isClosed(_entries[index], now, revision)) {
+    DenySummary& summary = _entries[index].summary;
+    if (summary.repeats < UINT16_MAX) {
+      summary.repeats++;
+    }
+    summary.lastMs = now;
+    _folded++;
+    return false;
+  }
+
+  // A closed window that was not popped yet: its repeats are reported by
+  // popSummary() first in the gate task, so reusing the slot drops nothing
+  if (index < 0) {
+    int oldest = -1;
+    for (int i = 0; i < DENY_CACHE_SIZE; i++) {
+      const Entry& entry = _entries[i];
+      if (!entry.used) {
+        index = i;
+        break;
+      }
+      if (entry.summary.repeats == 0 &&
+          (oldest < 0 || entry.summary.firstMs < _entries[oldest].summary.firstMs)) {
+        oldest = i;
+      }
+    }
+    if (index < 0) {
+      index = oldest;
+    }
+  }
+
+  // Every window has repeats to report: publish this card uncached
+  if (index < 0) {
+    return true;
+  }
+
+  Entry& entry = _entries[index];
+  entry.used = true;
+  entry.revision = revision;
+  entry.summary.uid = uid;
+  entry.summary.lane = lane;
+  entry.summary.repeats = 0;
+  entry.summary.firstMs = now;
+  entry.summary.lastMs = now;
+  return true;
+}
+
+bool DenyCache::popSummary(uint64_t now, uint32_t revision, DenySummary& summary) {
+  for (int i = 0; i < DENY_CACHE_SIZE; i++) {
+    Entry& entry = _entries[i];
+    if (!entry.used || !isClosed(entry, now, revision)) {
+      continue;
+    }
+
+    entry.used = false;
+    if (entry.summary.repeats > 0) {
+      summary = entry.summary;
+      return true;
+    }
+  }
+  return false;
+}
+
+void DenyCache::clear() {
+  memset(_entries, 0, sizeof(_entries));
+}
+
+uint32_t DenyCache::getFoldedCount() const {
+  return _folded;
+}
+
+int DenyCache::find(uint8_t lane, const CardUid& uid) const {
+  for (int i = 0; i < DENY_CACHE_SIZE; i++) {
+    const Entry& entry = _entries[i];
+    if (entry.used && entry.summary.lane == lane && entry.summary.uid == uid) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool DenyCache::isClosed(const Entry& entry, uint64_t now, uint32_t revision) {
+  return entry.revision != revision || now - entry.summary.firstMs >= DENY_CACHE_TTL_MS;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file DenyCache.h
+ * @brief Negative cache and per-card rate limit for refused cards
+ * @details The same unknown card is often tapped again and again. Each
+ *          refusal used to publish its own denied_unauthorized event; the
+ *          cache keeps the first one and folds the rest of the window into
+ *          a single summary, and answers the repeats without a whitelist
+ *          lookup.
+ */
+
+#ifndef DENYCACHE_H
+#define DENYCACHE_H
+
+#include <Arduino.h>
+#include "../Config.h"
+#include "../CardUid/CardUid.h"
+
+/**
+ * @struct DenySummary
+ * @brief Refusals of one card at one lane that were not published singly
+ */
+struct DenySummary {
+  CardUid uid;               ///< Refused card
+  uint8_t lane;              ///< Lane it was refused at
+  uint16_t repeats;          ///< Refusals after the published one
+  uint64_t firstMs;          ///< Monotonic ms of the published refusal
+  uint64_t lastMs;           ///< Monotonic ms of the latest repeat
+};
+
+/**
+ * @class DenyCache
+ * @brief Remembers recently refused cards per lane
+ *
+ * A window opens at the first refusal of a card at a lane and lasts
+ * DENY_CACHE_TTL_MS. Only that first refusal is published; repeats are
+ * counted and, once the window closes, reported by popSummary(). A window
+ * also closes as soon as the whitelist revision changes, so a card that
+ * was just added is never refused from cache.
+ *
+ * When all DENY_CACHE_SIZE entries are taken, the oldest entry without
+ * repeats makes room; if every entry has repeats, the new card is not
+ * cached and its refusals are published as before.
+ *
+ * Example usage:
+ * @code
+ * DenyCache cache;
+ *
+ * if (cache.isDenied(lane, uid, rfid.getRevision(), now)) {
+ *   // refuse without a lookup
+ * }
+ *
+ * // on EVENT_CARD_DENIED
+ * if (cache.recordDenial(lane, uid, rfid.getRevision(), now)) {
+ *   // first refusal in the window: publish it
+ * }
+ *
+ * DenySummary summary;
+ * while (cache.popSummary(now, rfid.getRevision(), summary)) {
+ *   // publish the summary
+ * }
+ * @endcode
+ */
+class DenyCache {
+public:
+  /**
+   * @brief Constructor
+   */
+  DenyCache();
+
+  /**
+   * @brief Check if a card has an open window at a lane
+   * @param lane Lane of the reader
+   * @param uid Card UID
+   * @param revision Current whitelist revision
+   * @param now Monotonic ms
+   * @return true if the card was refused there within DENY_CACHE_TTL_MS
+   */
+  bool isDenied(uint8_t lane, const CardUid& uid, uint32_t revision,
+                uint64_t now) const;
+
+  /**
+   * @brief Record a refusal
+   * @param lane Lane of the reader
+   * @param uid Card UID
+   * @param revision Current whitelist revision
+   * @param now Monotonic ms
+   * @return true if it should be published (no open window), false if
+   *         it was folded into the window
+   */
+  bool recordDenial(uint8_t lane, const CardUid& uid, uint32_t revision,
+                    uint64_t now);
+
+  /**
+   * @brief Close one finished window that had repeats
+   * @details Windows without repeats are dropped silently
+   * @param now Monotonic ms
+   * @param revision Current whitelist revision (older windows close now)
+   * @param summary Output
+   * @return true if a summary was written
+   */
+  bool popSummary(uint64_t now, uint32_t revision, DenySummary& summary);
+
+  /**
+   * @brief Forget every card without reporting
+   */
+  void clear();
+
+  /**
+   * @brief Get the number of refusals folded since boot
+   * @return Refusals not published singly
+   */
+  uint32_t getFoldedCount() const;
+
+private:
+  /**
+   * @struct Entry
+   * @brief One open window
+   */
+  struct Entry {
+    DenySummary summary;     ///< Card, lane and counts
+    uint32_t revision;       ///< Whitelist revision the refusal was made against
+    bool used;               ///< Slot holds a window
+  };
+
+  Entry _entries[DENY_CACHE_SIZE];   ///< Open windows
+  uint32_t _folded;                  ///< Refusals folded since boot
+
+  /**
+   * @brief Find the open window of a card at a lane
+   * @return Entry index, or -1
+   */
+  int find(uint8_t lane, const CardUid& uid) const;
+
+  /**
+   * @brief Check if a window is over
+   */
+  static bool isClosed(const Entry& entry, uint64_t now, uint32_t revision);
+};
+
+#endif // DENYCACHE_H
@@ -0,0 +1,82 @@
+/**
+ * @file DisplayCompositor.cpp
+ * @brief Implementation of the LCD message compositor
+ */
+
+#include "DisplayCompositor.h"
+
+DisplayCompositor::DisplayCompositor() {
+  memset(_layers, 0, sizeof(_layers));
+}
+
+void DisplayCompositor::apply(const DisplayMessage& msg) {
+  if (msg.priority >= DISPLAY_PRIO_COUNT) {
+    return;
+  }
+
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    if (!(msg.rowMask & (1 << row))) {
+      continue;
+    }
+
+    Layer& layer = _layers[msg.priority][row];
+    uint8_t id = timerId(msg.priority, row);
+
+    if (msg.clear) {
+      layer.active = false;
+      _expiry.cancel(id);
+      continue;
+    }
+
+    memcpy(layer.text, msg.lines[row], sizeof(layer.text));
+    layer.text[LCD_COLS] = '\0';
+    layer.active = true;
+
+    // A new message restarts (or removes) the lifetime of the old one
+    if (msg.durationMs == 0) {
+      _expiry.cancel(id);
+    } else if (!_expiry.schedule(id, msg.durationMs)) {
+      DEBUG_PRINTLN("⚠ Display: no timer left, message stays until replaced");
+    }
+  }
+}
+
+void DisplayCompositor::render(LCDDisplay& lcd) {
+  uint8_t id;
+  while (_expiry.popExpired(TimeSync::monotonicMillis(), id)) {
+    _layers[id / LCD_ROWS][id % LCD_ROWS].active = false;
+  }
+
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    const Layer& layer = _layers[getVisiblePriority(row)][row];
+    lcd.setLine(row, layer.active ? layer.text : "");
+  }
+}
+
+TickType_t DisplayCompositor::getWaitTicks() const {
+  uint64_t deadline;
+  if (!_expiry.nextDeadline(deadline)) {
+    return portMAX_DELAY;
+  }
+
+  uint64_t now = TimeSync::monotonicMillis();
+  if (deadline <= now) {
+    return 0;
+  }
+
+  // Round up so the layer has expired when the task wakes
+  return pdMS_TO_TICKS(deadline - now) + 1;
+}
+
+DisplayPriority DisplayCompositor::getVisiblePriority(uint8_t row) const {
+  for (int priority = DISPLAY_PRIO_COUNT - 1; priority > DISPLAY_PRIO_IDLE; priority--) {
+    if (_layers[priority][row].active) {
+      return (DisplayPriority)priority;
+    }
+  }
+  return DISPLAY_PRIO_IDLE;
+}
+
+uint8_t DisplayCompositor::timerId(uint8_t priority, uint8_t row) {
+  return priority * LCD_ROWS + row;
+}
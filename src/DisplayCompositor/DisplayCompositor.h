@@ -0,0 +1,93 @@
+/**
+ * @file DisplayCompositor.h
+ * @brief Prioritized, timed message layers for the 2-row LCD
+ * @details Every DisplayPriority has one slot per row. A row shows the
+ *          highest-priority slot that holds text; timed slots expire on
+ *          a TimerScheduler instead of a delay(), uncovering whatever lies
+ *          beneath. The display task owns the compositor.
+ */
+
+#ifndef DISPLAYCOMPOSITOR_H
+#define DISPLAYCOMPOSITOR_H
+
+#include <Arduino.h>
+#include "../Config.h"
+#include "../TaskPipeline/TaskPipeline.h"
+#include "../TimerScheduler/TimerScheduler.h"
+#include "../LCDDisplay/LCDDisplay.h"
+
+/**
+ * @class DisplayCompositor
+ * @brief Composes the LCD rows from layered messages
+ *
+ * An emergency banner hides everything; a denied notice on the entrance
+ * row hides the "Scan Card" prompt only until it expires; the slot count
+ * shows whenever nothing else claims a row. The gate task never waits for
+ * a message to go away.
+ *
+ * Example usage:
+ * @code
+ * DisplayCompositor compositor;
+ * DisplayMessage msg;
+ * while (pipeline.receiveDisplay(msg, compositor.getWaitTicks())) {
+ *   compositor.apply(msg);
+ * }
+ * compositor.render(lcd);
+ * lcd.flush();
+ * @endcode
+ */
+class DisplayCompositor {
+public:
+  /**
+   * @brief Constructor
+   */
+  DisplayCompositor();
+
+  /**
+   * @brief Set or clear layer rows from a queued message
+   * @param msg Message from TaskPipeline::receiveDisplay()
+   */
+  void apply(const DisplayMessage& msg);
+
+  /**
+   * @brief Drop expired layers and write the visible rows to the frame buffer
+   * @param lcd Display whose frame buffer receives the rows (not flushed)
+   */
+  void render(LCDDisplay& lcd);
+
+  /**
+   * @brief Get how long the display task may sleep
+   * @return Ticks until the next layer expires, or portMAX_DELAY
+   */
+  TickType_t getWaitTicks() const;
+
+  /**
+   * @brief Get the layer a row currently shows
+   * @param row Row number
+   * @return Highest layer holding text for the row
+   */
+  DisplayPriority getVisiblePriority(uint8_t row) const;
+
+private:
+  /**
+   * @struct Layer
+   * @brief Text one priority level holds for one row
+   */
+  struct Layer {
+    char text[LCD_COLS + 1];  ///< Row text
+    bool active;              ///< Layer holds text
+  };
+
+  Layer _layers[DISPLAY_PRIO_COUNT][LCD_ROWS];  ///< [priority][row]
+  TimerScheduler _expiry;   ///< Deadlines of timed layers (id = priority * rows + row)
+
+  /**
+   * @brief Get the timer id of a layer row
+   * @param priority Display layer
+   * @param row Row number
+   * @return Timer identifier
+   */
+  static uint8_t timerId(uint8_t priority, uint8_t row);
+};
+
+#endif // DISPLAYCOMPOSITOR_H
@@ -0,0 +1,200 @@
+/**
+ * @file EventOutbox.cpp
+ * @brief Implementation of the store-and-forward event outbox
+ */
+
+#include "EventOutbox.h"
+
+static_assert(sizeof(OutboxRecord) == 52, "OutboxRecord layout changed; stored events would be misread");
+
+EventOutbox::EventOutbox()
+  : _store(OUTBOX_NVS_NAMESPACE, sizeof(OutboxRecord), OUTBOX_PARTITION),
+    _storeReady(false),
+    _ramHead(0),
+    _ramCount(0),
+    _flashHead(0),
+    _flashCount(0),
+    _flashDirty(false),
+    _flashFrontValid(false),
+    _bootId(0),
+    _nextSequence(1),
+    _dropped(0),
+    _replayed(0) {
+}
+
+bool EventOutbox::begin() {
+  _storeReady = _store.begin();
+  if (!_storeReady) {
+    // No stored boot counter (e.g. a partition table without "outbox").
+    // A random id with the top bit set keeps (boot, seq) unique across
+    // reboots and never equals a counter value.
+    _bootId = esp_random() | 0x80000000u;
+    DEBUG_PRINTLN("✗ Event outbox: flash unavailable, buffering in RAM only");
+    return false;
+  }
+
+  uint32_t head = 0;
+  uint32_t count = 0;
+  uint32_t boot = 0;
+  _store.readMeta("head", head);
+  _store.readMeta("count", count);
+  _store.readMeta("boot", boot);
+
+  if (head >= OUTBOX_FLASH_CAPACITY || count > OUTBOX_FLASH_CAPACITY) {
+    head = 0;
+    count = 0;
+  }
+
+  _flashHead = head;
+  _flashCount = count;
+
+  // Sequence numbers restart each boot; the boot id keeps them unique
+  _bootId = boot + 1;
+  _store.writeMeta("boot", _bootId);
+
+  DEBUG_PRINTF("✓ Event outbox ready: boot %u, %u stored events\n",
+               (unsigned)_bootId, (unsigned)_flashCount);
+  return true;
+}
+
+void EventOutbox::push(const PublishMessage& msg) {
+  if (_ramCount == OUTBOX_RAM_CAPACITY) {
+    if (_storeReady) {
+      spill();
+    } else {
+      _ramHead = (_ramHead + 1) % OUTBOX_RAM_CAPACITY;
+      _ramCount--;
+      _dropped++;
+    }
+  }
+
+  OutboxRecord& record = _ram[(_ramHead + _ramCount) % OUTBOX_RAM_CAPACITY];
+  memset(&record, 0, sizeof(record));
+  record.bootId = _bootId;
+  record.sequence = _nextSequence++;
+  record.type = msg.type;
+  record.cardUID = msg.cardUID;
+  strncpy(record.status, msg.status != nullptr ? msg.status : "", OUTBOX_STATUS_SIZE - 1);
+  record.slotNumber = msg.slotNumber;
+  record.availableSlots = msg.availableSlots;
+  record.duration = msg.duration;
+  record.timestamp = msg.timestamp;
+
+  _ramCount++;
+}
+
+bool EventOutbox::peek(OutboxRecord& record) {
+  // Flash events are always older than RAM events
+  while (_flashCount > 0) {
+    if (_flashFrontValid || _store.readRecord(_flashHead, &_flashFront)) {
+      _flashFrontValid = true;
+      record = _flashFront;
+      return true;
+    }
+
+    // Unreadable record: skip it rather than stall the queue
+    DEBUG_PRINTF("✗ Event outbox: stored event %u unreadable\n", (unsigned)_flashHead);
+    dropOldestStored();
+  }
+
+  if (_ramCount > 0) {
+    record = _ram[_ramHead];
+    return true;
+  }
+
+  return false;
+}
+
+bool EventOutbox::peekAt(uint16_t index, OutboxRecord& record) {
+  if (index == 0) {
+    return peek(record);
+  }
+
+  if (index < _flashCount) {
+    return _store.readRecord((_flashHead + index) % OUTBOX_FLASH_CAPACITY, &record);
+  }
+
+  index -= _flashCount;
+  if (index < _ramCount) {
+    record = _ram[(_ramHead + index) % OUTBOX_RAM_CAPACITY];
+    return true;
+  }
+
+  return false;
+}
+
+void EventOutbox::pop() {
+  if (_flashCount > 0) {
+    _flashHead = (_flashHead + 1) % OUTBOX_FLASH_CAPACITY;
+    _flashCount--;
+    _flashFrontValid = false;
+    _flashDirty = true;
+    _replayed++;
+  } else if (_ramCount > 0) {
+    _ramHead = (_ramHead + 1) % OUTBOX_RAM_CAPACITY;
+    _ramCount--;
+  }
+}
+
+void EventOutbox::spill() {
+  if (!_storeReady || _ramCount == 0) {
+    return;
+  }
+
+  _store.beginTransaction();
+
+  while (_ramCount > 0) {
+    if (_flashCount == OUTBOX_FLASH_CAPACITY) {
+      dropOldestStored();
+    }
+
+    uint16_t slot = (_flashHead + _flashCount) % OUTBOX_FLASH_CAPACITY;
+    if (!_store.writeRecord(slot, &_ram[_ramHead])) {
+      break;
+    }
+
+    _flashCount++;
+    _ramHead = (_ramHead + 1) % OUTBOX_RAM_CAPACITY;
+    _ramCount--;
+  }
+
+  writePosition();
+  _store.commitTransaction();
+
+  DEBUG_PRINTF("✓ Event outbox: %u events held in flash\n", (unsigned)_flashCount);
+}
+
+void EventOutbox::sync() {
+  if (!_flashDirty) {
+    return;
+  }
+
+  _store.beginTransaction();
+  writePosition();
+  _store.commitTransaction();
+}
+
+OutboxStats EventOutbox::getStats() const {
+  OutboxStats stats;
+  stats.pending = _ramCount + _flashCount;
+  stats.stored = _flashCount;
+  stats.dropped = _dropped;
+  stats.replayed = _replayed;
+  stats.sequence = _nextSequence - 1;
+  stats.bootId = _bootId;
+  return stats;
+}
+
+void EventOutbox::dropOldestStored() {
+  _flashHead = (_flashHead + 1) % OUTBOX_FLASH_CAPACITY;
+  _flashCount--;
+  _flashFrontValid = false;
+  _flashDirty = true;
+  _dropped++;
+}
+
+void EventOutbox::writePosition() {
+  _store.writeMeta("head", _flashHead);
+  _store.writeMeta("count", _flashCount);
+  _flashDirty = false;
+}
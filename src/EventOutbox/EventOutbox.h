@@ -0,0 +1,153 @@
+/**
+ * @file EventOutbox.h
+ * @brief Store-and-forward outbox for entry/exit events
+ * @details Events are buffered in a small RAM ring and published from
+ *          there while MQTT is up. When MQTT is down the RAM ring is spilled
+ *          into a flash ring in a dedicated NVS partition, which is replayed
+ *          oldest-first once the broker is back. Each event carries a
+ *          sequence number, unique per (boot id, sequence), so the backend
+ *          can drop replays it has already processed.
+ */
+
+#ifndef EVENTOUTBOX_H
+#define EVENTOUTBOX_H
+
+#include <Arduino.h>
+#include "../Config.h"
+#include "../CardUid/CardUid.h"
+#include "../RecordStore/RecordStore.h"
+#include "../TaskPipeline/TaskPipeline.h"
+
+/**
+ * @struct OutboxRecord
+ * @brief Entry/exit event as stored in the outbox (packed, 52 bytes)
+ */
+struct OutboxRecord {
+  uint32_t bootId;                     ///< Boot the event was recorded in
+  uint32_t sequence;                   ///< Per-boot sequence number (from 1)
+  uint8_t type;                        ///< PUBLISH_ENTRY or PUBLISH_EXIT
+  CardUid cardUID;                     ///< Card UID
+  char status[OUTBOX_STATUS_SIZE];     ///< Status string ("success", ...)
+  int16_t slotNumber;                  ///< Slot number (0 = none)
+  int16_t availableSlots;              ///< Available slots at event time
+  uint32_t duration;                   ///< Parking duration in seconds (exit only)
+  uint32_t timestamp;                  ///< Event timestamp
+};
+
+/**
+ * @struct OutboxStats
+ * @brief Outbox counters reported in the status message
+ */
+struct OutboxStats {
+  uint32_t pending;     ///< Events not yet published (RAM + flash)
+  uint32_t stored;      ///< Of which held in flash
+  uint32_t dropped;     ///< Events lost because the flash ring was full
+  uint32_t replayed;    ///< Events published from flash after an outage
+  uint32_t sequence;    ///< Last sequence number assigned
+  uint32_t bootId;      ///< Boot id the sequence numbers belong to
+};
+
+/**
+ * @class EventOutbox
+ * @brief Bounded two-tier event queue with flash persistence
+ *
+ * Only the network task may use an instance.
+ *
+ * Example usage:
+ * @code
+ * EventOutbox outbox;
+ * outbox.begin();
+ * outbox.push(msg);
+ * OutboxRecord record;
+ * while (mqttConnected && outbox.peek(record) && publish(record)) {
+ *   outbox.pop();
+ * }
+ * outbox.sync();
+ * @endcode
+ */
+class EventOutbox {
+public:
+  /**
+   * @brief Constructor
+   */
+  EventOutbox();
+
+  /**
+   * @brief Open flash storage, restore undelivered events, start a new boot id
+   * @details Without the outbox partition events are held in RAM only and
+   *          lost on reset; the boot id is then random instead of counted.
+   * @return true if flash storage is available (RAM buffering works regardless)
+   */
+  bool begin();
+
+  /**
+   * @brief Queue an entry/exit event and assign its sequence number
+   * @param msg Event from the gate task
+   */
+  void push(const PublishMessage& msg);
+
+  /**
+   * @brief Get the oldest undelivered event
+   * @param record Output parameter
+   * @return true if an event is pending
+   */
+  bool peek(OutboxRecord& record);
+
+  /**
+   * @brief Get an undelivered event by position, for batching
+   * @param index 0 = oldest (same as peek())
+   * @param record Output parameter
+   * @return true if that many events are pending and it could be read
+   */
+  bool peekAt(uint16_t index, OutboxRecord& record);
+
+  /**
+   * @brief Remove the oldest event after it was published
+   */
+  void pop();
+
+  /**
+   * @brief Move all RAM events into flash (one commit)
+   * @details Called while MQTT is down so an outage survives a reboot
+   */
+  void spill();
+
+  /**
+   * @brief Persist the flash ring position after pop() calls (one commit)
+   */
+  void sync();
+
+  /**
+   * @brief Get outbox counters
+   * @return Current statistics
+   */
+  OutboxStats getStats() const;
+
+private:
+  RecordStore _store;                          ///< Flash ring storage
+  bool _storeReady;                            ///< Flash ring usable
+  OutboxRecord _ram[OUTBOX_RAM_CAPACITY];      ///< Newest events
+  uint16_t _ramHead;                           ///< Oldest RAM event
+  uint16_t _ramCount;                          ///< Events in RAM
+  uint16_t _flashHead;                         ///< Oldest flash event
+  uint16_t _flashCount;                        ///< Events in flash
+  bool _flashDirty;                            ///< Ring position not persisted
+  OutboxRecord _flashFront;                    ///< Cached oldest flash event
+  bool _flashFrontValid;                       ///< _flashFront is loaded
+  uint32_t _bootId;                            ///< Incremented every boot (random without flash)
+  uint32_t _nextSequence;                      ///< Next sequence to assign
+  uint32_t _dropped;                           ///< Events dropped (ring full)
+  uint32_t _replayed;                          ///< Events published from flash
+
+  /**
+   * @brief Drop the oldest flash event to make room
+   */
+  void dropOldestStored();
+
+  /**
+   * @brief Write ring position meta values
+   */
+  void writePosition();
+};
+
+#endif // EVENTOUTBOX_H
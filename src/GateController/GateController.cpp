@@ -5,22 +5,60 @@
 
 #include "GateController.h"
 
-GateController::GateController(const char* name, uint8_t irPin, uint8_t servoPin)
+static_assert((IR_EDGE_BUFFER_SIZE & (IR_EDGE_BUFFER_SIZE - 1)) == 0,
+              "IR_EDGE_BUFFER_SIZE must be a power of two");
+
+GateController::GateController(const char* name, uint8_t irPin, uint8_t servoPin,
+                               uint8_t lane)
   : _name(name),
+    _lane(lane),
     _irPin(irPin),
     _servoPin(servoPin),
     _state(STATE_IDLE),
-    _lastScannedCard(""),
     _stateStartTime(0),
+    _firstOpenAt(0),
     _eventCallback(nullptr),
     _vehicleWasDetected(false),
-    _initialized(false) {
+    _vehicleDetected(false),
+    _rawDetected(false),
+    _lastEdgeTime(0),
+    _initialized(false),
+    _simulated(false),
+    _simulatedDetected(false),
+    _edgeHead(0),
+    _edgeTail(0),
+    _edgeOverflow(false) {
+  _lastScannedCard.clear();
+}
+
+GateController::GateController()
+  : GateController("GATE", 0, 0) {
+}
+
+void GateController::configure(uint8_t lane, const LaneConfig& config) {
+  _lane = lane;
+  _name = config.name;
+  _irPin = config.irPin;
+  _servoPin = config.servoPin;
+}
+
+uint8_t GateController::getLane() const {
+  return _lane;
 }
 
 bool GateController::begin() {
   // Initialize IR sensor pin
   pinMode(_irPin, INPUT_PULLUP);
   
+  // Seed the debounce filter with the current level
+  _rawDetected = (digitalRead(_irPin) == LOW);
+  _vehicleDetected = _rawDetected;
+  _lastEdgeTime = TimeSync::monotonicMillis();
+  
+#if IR_INTERRUPT_MODE
+  attachInterruptArg(digitalPinToInterrupt(_irPin), irEdgeISR, this, CHANGE);
+#endif
+  
   // Initialize servo
   _servo.setPeriodHertz(SERVO_FREQ);
   _servo.attach(_servoPin, SERVO_MIN_PULSE, SERVO_MAX_PULSE);
@@ -29,10 +67,10 @@ bool GateController::begin() {
   _servo.write(SERVO_CLOSED_ANGLE);
   
   _state = STATE_IDLE;
-  _stateStartTime = millis();
+  _stateStartTime = TimeSync::monotonicMillis();
   _initialized = true;
   
-  DEBUG_PRINTF("✓ Gate controller '%s' initialized\n", _name.c_str());
+  DEBUG_PRINTF("✓ Gate controller '%s' initialized\n", _name);
   
   return true;
 }
@@ -42,16 +80,25 @@ void GateController::update() {
     return;
   }
   
-  bool vehicleDetected = readIRSensor();
+  // Fire due deadlines before looking at the sensor
+  uint8_t timerId;
+  while (_timers.popExpired(TimeSync::monotonicMillis(), timerId)) {
+    handleTimer(timerId);
+  }
+  
+  bool vehicleDetected = sampleIRSensor();
   
   switch (_state) {
     case STATE_IDLE:
       // Check for vehicle detection
       if (vehicleDetected && !_vehicleWasDetected) {
-        DEBUG_PRINTF("→ %s: Vehicle detected\n", _name.c_str());
+        // Edges carry ms timestamps, so this stage has ms resolution
+        LatencyTracer::record(TRACE_IR_DEBOUNCE,
+                              (uint32_t)(TimeSync::monotonicMillis() - _lastEdgeTime) * 1000);
+        DEBUG_PRINTF("→ %s: Vehicle detected\n", _name);
         setState(STATE_WAITING_CARD);
         
-        GateEventData eventData;
+        GateEventData eventData = {};
         eventData.event = EVENT_VEHICLE_DETECTED;
         fireEvent(eventData);
       }
@@ -60,88 +107,74 @@ void GateController::update() {
     case STATE_WAITING_CARD:
       // Check if vehicle left without scanning
       if (!vehicleDetected && _vehicleWasDetected) {
-        DEBUG_PRINTF("← %s: Vehicle left without scanning\n", _name.c_str());
+        DEBUG_PRINTF("← %s: Vehicle left without scanning\n", _name);
         setState(STATE_IDLE);
         
-        GateEventData eventData;
+        GateEventData eventData = {};
         eventData.event = EVENT_VEHICLE_LEFT;
         fireEvent(eventData);
       }
-      
-      // Timeout after waiting too long
-      if (getStateElapsedTime() > CARD_SCAN_TIMEOUT) {
-        DEBUG_PRINTF("⏱ %s: Card scan timeout\n", _name.c_str());
-        setState(STATE_IDLE);
-        
-        GateEventData eventData;
-        eventData.event = EVENT_TIMEOUT;
-        fireEvent(eventData);
-      }
       break;
       
     case STATE_BARRIER_OPEN:
       // Check if vehicle has passed (IR sensor no longer detecting)
       if (!vehicleDetected && _vehicleWasDetected) {
-        DEBUG_PRINTF("→ %s: Vehicle passed through\n", _name.c_str());
+        DEBUG_PRINTF("→ %s: Vehicle passed through\n", _name);
         setState(STATE_CLOSING_DELAY);
         
-        GateEventData eventData;
+        GateEventData eventData = {};
         eventData.event = EVENT_VEHICLE_PASSED;
         fireEvent(eventData);
       }
       break;
       
     case STATE_CLOSING_DELAY:
-      // Wait for delay period before closing
-      if (getStateElapsedTime() >= GATE_CLOSE_DELAY) {
-        DEBUG_PRINTF("← %s: Closing barrier\n", _name.c_str());
-        closeGate();
-        setState(STATE_IDLE);
-      }
+    case STATE_MESSAGE_HOLD:
+      // Waiting for a scheduled deadline
       break;
   }
   
   _vehicleWasDetected = vehicleDetected;
 }
 
-void GateController::handleCardScanned(const String& cardUID, bool authorized,
+void GateController::handleCardScanned(const CardUid& cardUID, bool authorized,
                                       int slotNumber, bool parkingFull) {
   if (_state != STATE_WAITING_CARD) {
     DEBUG_PRINTF("⚠ %s: Card scan ignored (not in WAITING_CARD state)\n", 
-                 _name.c_str());
+                 _name);
     return;
   }
   
   _lastScannedCard = cardUID;
   
-  DEBUG_PRINTF("RFID scanned at %s: %s\n", _name.c_str(), cardUID.c_str());
+  char uidHex[CARD_UID_HEX_SIZE];
+  cardUID.toHex(uidHex, sizeof(uidHex));
+  DEBUG_PRINTF("RFID scanned at %s: %s\n", _name, uidHex);
   
-  GateEventData eventData;
+  GateEventData eventData = {};
   eventData.cardUID = cardUID;
   eventData.slotNumber = slotNumber;
   
   if (!authorized) {
     // Unauthorized card
-    DEBUG_PRINTF("✗ %s: Access denied - unauthorized card\n", _name.c_str());
+    DEBUG_PRINTF("✗ %s: Access denied - unauthorized card\n", _name);
     eventData.event = EVENT_CARD_DENIED;
     fireEvent(eventData);
     
-    // Brief delay to show message, then return to idle
-    delay(DISPLAY_MESSAGE_DURATION);
-    setState(STATE_IDLE);
+    // Hold the message, then return to idle from handleTimer()
+    setState(STATE_MESSAGE_HOLD);
     
   } else if (parkingFull) {
     // Parking is full
-    DEBUG_PRINTF("✗ %s: Access denied - parking full\n", _name.c_str());
+    DEBUG_PRINTF("✗ %s: Access denied - parking full\n", _name);
     eventData.event = EVENT_PARKING_FULL;
     fireEvent(eventData);
     
-    delay(DISPLAY_MESSAGE_DURATION);
-    setState(STATE_IDLE);
+    setState(STATE_MESSAGE_HOLD);
     
   } else {
     // Access granted
-    DEBUG_PRINTF("✓ %s: Access granted - Slot %d\n", _name.c_str(), slotNumber);
+    DEBUG_PRINTF("✓ %s: Access granted - Slot %d\n", _name, slotNumber);
     eventData.event = EVENT_CARD_SCANNED;
     fireEvent(eventData);
     
@@ -153,18 +186,22 @@ void GateController::openGate(unsigned long duration) {
   setServoAngle(SERVO_OPEN_ANGLE);
   setState(STATE_BARRIER_OPEN);
   
-  DEBUG_PRINTF("✓ %s: Barrier opened\n", _name.c_str());
+  DEBUG_PRINTF("✓ %s: Barrier opened\n", _name);
+  
+  if (_firstOpenAt == 0) {
+    _firstOpenAt = TimeSync::monotonicMillis();
+    DEBUG_PRINTF("%s: first opening %lu ms after boot\n", _name, (unsigned long)_firstOpenAt);
+  }
   
   // If duration specified, schedule auto-close
   if (duration > 0) {
-    // This would require a timer implementation
-    // For now, we rely on vehicle detection
+    _timers.schedule(TIMER_AUTO_CLOSE, duration);
   }
 }
 
 void GateController::closeGate() {
   setServoAngle(SERVO_CLOSED_ANGLE);
-  DEBUG_PRINTF("✓ %s: Barrier closed\n", _name.c_str());
+  DEBUG_PRINTF("✓ %s: Barrier closed\n", _name);
 }
 
 bool GateController::isOpen() const {
@@ -175,46 +212,174 @@ GateState GateController::getState() const {
   return _state;
 }
 
+unsigned long GateController::getFirstOpenTime() const {
+  return (unsigned long)_firstOpenAt;
+}
+
 void GateController::setEventCallback(GateEventCallback callback) {
   _eventCallback = callback;
-  DEBUG_PRINTF("✓ %s: Event callback set\n", _name.c_str());
+  DEBUG_PRINTF("✓ %s: Event callback set\n", _name);
 }
 
-String GateController::getLastScannedCard() const {
+const CardUid& GateController::getLastScannedCard() const {
   return _lastScannedCard;
 }
 
 void GateController::reset() {
   closeGate();
   setState(STATE_IDLE);
-  _lastScannedCard = "";
-  DEBUG_PRINTF("✓ %s: Reset to idle state\n", _name.c_str());
+  _lastScannedCard.clear();
+  DEBUG_PRINTF("✓ %s: Reset to idle state\n", _name);
 }
 
 bool GateController::isVehicleDetected() const {
-  return readIRSensor();
+  return _vehicleDetected;
 }
 
-bool GateController::readIRSensor() const {
+void GateController::simulateSensor(bool active, bool detected) {
+  if (_simulated && !active) {
+    // Whatever the pin did meanwhile was discarded; start from its level
+    recordIRLevel(digitalRead(_irPin) == LOW, TimeSync::monotonicMillis());
+  }
+  _simulated = active;
+  _simulatedDetected = detected;
+}
+
+void IRAM_ATTR GateController::irEdgeISR(void* arg) {
+  GateController* gate = static_cast<GateController*>(arg);
+  
+  uint8_t head = gate->_edgeHead.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) & (IR_EDGE_BUFFER_SIZE - 1);
+  
+  if (next == gate->_edgeTail.load(std::memory_order_acquire)) {
+    // Ring full; update() resynchronises from the pin
+    gate->_edgeOverflow = true;
+    return;
+  }
+  
   // IR sensor is active LOW (LOW = vehicle detected)
-  return (digitalRead(_irPin) == LOW);
+  // esp_timer is IRAM-safe; same clock as TimeSync::monotonicMillis()
+  gate->_edges[head].timestamp = (uint64_t)esp_timer_get_time() / 1000;
+  gate->_edges[head].detected = (digitalRead(gate->_irPin) == LOW);
+  gate->_edgeHead.store(next, std::memory_order_release);
+}
+
+bool GateController::sampleIRSensor() {
+#if IR_INTERRUPT_MODE
+  uint8_t tail = _edgeTail.load(std::memory_order_relaxed);
+  uint8_t head = _edgeHead.load(std::memory_order_acquire);
+  
+  // Edges are drained even while simulated so the ring never overflows
+  while (tail != head) {
+    if (!_simulated) {
+      recordIRLevel(_edges[tail].detected, _edges[tail].timestamp);
+    }
+    tail = (tail + 1) & (IR_EDGE_BUFFER_SIZE - 1);
+  }
+  _edgeTail.store(tail, std::memory_order_release);
+  
+  // Read the clock after draining so no edge is newer than now
+  uint64_t now = TimeSync::monotonicMillis();
+  
+  if (_edgeOverflow) {
+    _edgeOverflow = false;
+    if (!_simulated) {
+      recordIRLevel(digitalRead(_irPin) == LOW, now);
+    }
+  }
+#else
+  uint64_t now = TimeSync::monotonicMillis();
+  
+  // IR sensor is active LOW (LOW = vehicle detected)
+  if (!_simulated) {
+    recordIRLevel(digitalRead(_irPin) == LOW, now);
+  }
+#endif
+  
+  if (_simulated) {
+    recordIRLevel(_simulatedDetected, now);
+  }
+  
+  // Accept a new level only once it has been stable for the debounce window
+  if (_rawDetected != _vehicleDetected && now - _lastEdgeTime >= IR_DEBOUNCE_MS) {
+    _vehicleDetected = _rawDetected;
+  }
+  
+  return _vehicleDetected;
+}
+
+void GateController::recordIRLevel(bool detected, uint64_t timestamp) {
+  if (detected != _rawDetected) {
+    _rawDetected = detected;
+    _lastEdgeTime = timestamp;
+  }
 }
 
 void GateController::setServoAngle(int angle) {
+  TraceScope trace(TRACE_SERVO);
   _servo.write(angle);
 }
 
+void GateController::handleTimer(uint8_t timerId) {
+  GateEventData eventData = {};
+  
+  switch (timerId) {
+    case TIMER_SCAN_TIMEOUT:
+      DEBUG_PRINTF("⏱ %s: Card scan timeout\n", _name);
+      setState(STATE_IDLE);
+      
+      eventData.event = EVENT_TIMEOUT;
+      fireEvent(eventData);
+      break;
+      
+    case TIMER_MESSAGE_HOLD:
+      setState(STATE_IDLE);
+      break;
+      
+    case TIMER_AUTO_CLOSE:
+    case TIMER_CLOSE_DELAY:
+      DEBUG_PRINTF("← %s: Closing barrier\n", _name);
+      closeGate();
+      setState(STATE_IDLE);
+      
+      eventData.event = EVENT_GATE_CLOSED;
+      fireEvent(eventData);
+      break;
+  }
+}
+
 void GateController::setState(GateState newState) {
   _state = newState;
-  _stateStartTime = millis();
+  _stateStartTime = TimeSync::monotonicMillis();
+  
+  // Every state owns at most one deadline; leaving a state drops it
+  _timers.clear();
+  
+  switch (newState) {
+    case STATE_WAITING_CARD:
+      _timers.schedule(TIMER_SCAN_TIMEOUT, CARD_SCAN_TIMEOUT);
+      break;
+      
+    case STATE_MESSAGE_HOLD:
+      _timers.schedule(TIMER_MESSAGE_HOLD, DISPLAY_MESSAGE_DURATION);
+      break;
+      
+    case STATE_CLOSING_DELAY:
+      _timers.schedule(TIMER_CLOSE_DELAY, GATE_CLOSE_DELAY);
+      break;
+      
+    default:
+      break;
+  }
 }
 
-void GateController::fireEvent(const GateEventData& eventData) {
+void GateController::fireEvent(GateEventData& eventData) {
+  eventData.lane = _lane;
   if (_eventCallback != nullptr) {
     _eventCallback(eventData);
   }
 }
 
 unsigned long GateController::getStateElapsedTime() const {
-  return millis() - _stateStartTime;
+  return (unsigned long)(TimeSync::monotonicMillis() - _stateStartTime);
 }
@@ -1,7 +1,7 @@
 /**
  * @file GateController.h
  * @brief Gate controller with state machine logic
- * @details Manages entrance/exit gate with IR sensor, servo, and RFID
+ * @details Manages one lane's barrier with IR sensor, servo, and RFID
  */
 
 #ifndef GATECONTROLLER_H
@@ -9,7 +9,12 @@
 
 #include <Arduino.h>
 #include <ESP32Servo.h>
+#include <atomic>
 #include "../Config.h"
+#include "../TimeSync/TimeSync.h"
+#include "../TimerScheduler/TimerScheduler.h"
+#include "../LatencyTracer/LatencyTracer.h"
+#include "../CardUid/CardUid.h"
 
 /**
  * @enum GateEvent
@@ -23,7 +28,8 @@ enum GateEvent {
   EVENT_CARD_DENIED,         ///< Invalid RFID card scanned
   EVENT_PARKING_FULL,        ///< Parking is full
   EVENT_VEHICLE_PASSED,      ///< Vehicle passed through gate
-  EVENT_TIMEOUT              ///< Operation timeout
+  EVENT_TIMEOUT,             ///< Operation timeout
+  EVENT_GATE_CLOSED          ///< Barrier closed automatically
 };
 
 /**
@@ -32,17 +38,40 @@ enum GateEvent {
  */
 struct GateEventData {
   GateEvent event;           ///< Event type
-  String cardUID;            ///< Card UID (if applicable)
+  uint8_t lane;              ///< Lane of the gate that fired it
+  CardUid cardUID;           ///< Card UID (if applicable)
   int slotNumber;            ///< Assigned slot number (if applicable)
   unsigned long duration;    ///< Parking duration (exit only)
 };
 
+/**
+ * @struct LaneConfig
+ * @brief Hardware and role of one lane (see LANES in Config.h)
+ */
+struct LaneConfig {
+  const char* name;          ///< Gate name for debugging
+  const char* label;         ///< Short LCD label ("IN", "OUT", ...)
+  LaneDirection direction;   ///< Entry or exit
+  uint8_t irPin;             ///< IR sensor pin
+  uint8_t servoPin;          ///< Servo motor pin
+  uint8_t rfidSsPin;         ///< Reader SPI SS pin
+  uint8_t rfidRstPin;        ///< Reader RST pin
+};
+
 // Forward declaration for callback
 typedef void (*GateEventCallback)(const GateEventData& eventData);
 
 /**
  * @class GateController
- * @brief Controls a single gate (entrance or exit) with state machine
+ * @brief Controls a single gate (one lane) with state machine
+ * 
+ * The state machine never blocks: message holds, the scan timeout, timed
+ * manual opens and the closing delay are deadlines in a TimerScheduler
+ * that update() services.
+ * 
+ * With IR_INTERRUPT_MODE the IR pin is never polled: a CHANGE interrupt
+ * timestamps edges into a lock-free single-producer ring buffer and
+ * update() replays them through an IR_DEBOUNCE_MS stability filter.
  * 
  * Example usage:
  * @code
@@ -51,8 +80,8 @@ typedef void (*GateEventCallback)(const GateEventData& eventData);
  * entranceGate.setEventCallback(myEventHandler);
  * 
  * void loop() {
- *   String cardUID = rfidManager.readCard(...);
- *   if (!cardUID.isEmpty()) {
+ *   CardUid cardUID;
+ *   if (rfidManager.readCard(..., cardUID)) {
  *     entranceGate.handleCardScanned(cardUID, authorized);
  *   }
  *   entranceGate.update();
@@ -66,8 +95,28 @@ public:
    * @param name Gate name for debugging ("ENTRANCE" or "EXIT")
    * @param irPin IR sensor pin number
    * @param servoPin Servo motor pin number
+   * @param lane Lane number reported in events
    */
-  GateController(const char* name, uint8_t irPin, uint8_t servoPin);
+  GateController(const char* name, uint8_t irPin, uint8_t servoPin,
+                 uint8_t lane = 0);
+
+  /**
+   * @brief Constructor for gates set up later with configure()
+   */
+  GateController();
+
+  /**
+   * @brief Assign the lane's pins (before begin())
+   * @param lane Lane number reported in events
+   * @param config Lane hardware
+   */
+  void configure(uint8_t lane, const LaneConfig& config);
+
+  /**
+   * @brief Get the lane number
+   * @return Lane passed to the constructor or configure()
+   */
+  uint8_t getLane() const;
 
   /**
    * @brief Initialize gate controller
@@ -87,12 +136,13 @@ public:
    * @param slotNumber Assigned slot number (entrance) or found slot (exit)
    * @param parkingFull Whether parking is full (entrance only)
    */
-  void handleCardScanned(const String& cardUID, bool authorized, 
+  void handleCardScanned(const CardUid& cardUID, bool authorized, 
                         int slotNumber = -1, bool parkingFull = false);
 
   /**
    * @brief Manually open gate (emergency or remote command)
-   * @param duration How long to keep gate open (ms), 0 = until vehicle passes
+   * @param duration Auto-close after this many ms if no vehicle passes,
+   *                 0 = stay open until a vehicle passes
    */
   void openGate(unsigned long duration = 0);
 
@@ -123,7 +173,7 @@ public:
    * @brief Get last scanned card UID
    * @return Last card UID
    */
-  String getLastScannedCard() const;
+  const CardUid& getLastScannedCard() const;
 
   /**
    * @brief Reset gate to idle state
@@ -132,27 +182,97 @@ public:
 
   /**
    * @brief Check if vehicle is currently detected
+   * @details Returns the debounced state from the last update(); does not
+   *          touch the pin
    * @return true if detected, false otherwise
    */
   bool isVehicleDetected() const;
 
+  /**
+   * @brief Get when the barrier first opened since boot
+   * @return Monotonic milliseconds, or 0 if it has not opened yet
+   */
+  unsigned long getFirstOpenTime() const;
+
+  /**
+   * @brief Replace the IR sensor with a simulated level (benchmark mode)
+   * @details While active, real edges are discarded and the simulated level
+   *          goes through the same debounce filter as the pin would.
+   *          Deactivating resynchronises from the pin.
+   * @param active true to simulate, false to use the sensor again
+   * @param detected Simulated level (true = vehicle)
+   */
+  void simulateSensor(bool active, bool detected = false);
+
 private:
-  String _name;                      ///< Gate name for debugging
+  const char* _name;                 ///< Gate name for debugging
+  uint8_t _lane;                     ///< Lane number reported in events
   uint8_t _irPin;                    ///< IR sensor pin
   uint8_t _servoPin;                 ///< Servo motor pin
   Servo _servo;                      ///< Servo object
   GateState _state;                  ///< Current state
-  String _lastScannedCard;           ///< Last scanned card UID
-  unsigned long _stateStartTime;     ///< Time when current state started
+  CardUid _lastScannedCard;          ///< Last scanned card UID
+  uint64_t _stateStartTime;          ///< Monotonic ms when current state started
+  uint64_t _firstOpenAt;             ///< Monotonic ms of the first opening (0 = none)
   GateEventCallback _eventCallback;  ///< Event callback function
   bool _vehicleWasDetected;          ///< Previous vehicle detection state
+  bool _vehicleDetected;             ///< Debounced vehicle detection state
+  bool _rawDetected;                 ///< Latest undebounced sensor level
+  uint64_t _lastEdgeTime;            ///< Monotonic ms of latest raw level change
   bool _initialized;                 ///< Initialization status
+  bool _simulated;                   ///< IR level comes from simulateSensor()
+  bool _simulatedDetected;           ///< Simulated IR level
+  TimerScheduler _timers;            ///< Pending state deadlines
+
+  /**
+   * @enum TimerId
+   * @brief Deadlines scheduled by the state machine
+   */
+  enum TimerId {
+    TIMER_SCAN_TIMEOUT,    ///< Give up waiting for a card
+    TIMER_MESSAGE_HOLD,    ///< End of denied/full message hold
+    TIMER_AUTO_CLOSE,      ///< End of timed manual open
+    TIMER_CLOSE_DELAY      ///< Close barrier after vehicle passed
+  };
+
+  /**
+   * @brief React to an expired timer
+   * @param timerId Expired timer
+   */
+  void handleTimer(uint8_t timerId);
+
+  /**
+   * @struct IREdge
+   * @brief Sensor level change captured by the ISR
+   */
+  struct IREdge {
+    uint64_t timestamp;        ///< Monotonic ms at the edge
+    bool detected;             ///< Level after the edge (true = vehicle)
+  };
+
+  IREdge _edges[IR_EDGE_BUFFER_SIZE];  ///< ISR -> update() edge ring
+  std::atomic<uint8_t> _edgeHead;      ///< Next write slot (ISR only)
+  std::atomic<uint8_t> _edgeTail;      ///< Next read slot (update() only)
+  volatile bool _edgeOverflow;         ///< Ring filled up, edges were lost
+
+  /**
+   * @brief GPIO CHANGE interrupt handler
+   * @param arg GateController instance
+   */
+  static void IRAM_ATTR irEdgeISR(void* arg);
+
+  /**
+   * @brief Consume pending IR edges (or poll the pin) and debounce
+   * @return Debounced vehicle detection state
+   */
+  bool sampleIRSensor();
 
   /**
-   * @brief Read IR sensor state
-   * @return true if vehicle detected, false otherwise
+   * @brief Feed a raw sensor level into the debounce filter
+   * @param detected Raw level (true = vehicle)
+   * @param timestamp Monotonic ms the level was observed
    */
-  bool readIRSensor() const;
+  void recordIRLevel(bool detected, uint64_t timestamp);
 
   /**
    * @brief Set servo position
@@ -161,16 +281,16 @@ private:
   void setServoAngle(int angle);
 
   /**
-   * @brief Transition to new state
+   * @brief Transition to new state and (re)arm its deadline
    * @param newState New state to transition to
    */
   void setState(GateState newState);
 
   /**
    * @brief Fire event callback
-   * @param eventData Event data to send
+   * @param eventData Event data to send (its lane is filled in)
    */
-  void fireEvent(const GateEventData& eventData);
+  void fireEvent(GateEventData& eventData);
 
   /**
    * @brief Get time elapsed in current state
@@ -0,0 +1,73 @@
+/**
+ * @file HealthMonitor.cpp
+ * @brief Implementation of the runtime health counters
+ */
+
+#include "HealthMonitor.h"
+
+HealthMonitor::HealthMonitor()
+  : _iterationStart(0),
+    _iterations(0),
+    _loopMaxUs(0),
+    _loopMaxEverUs(0),
+    _windowStart(0),
+    _taskCount(0),
+    _lock(portMUX_INITIALIZER_UNLOCKED) {
+}
+
+bool HealthMonitor::addTask(const char* name, TaskHandle_t handle) {
+  if (handle == nullptr || _taskCount >= HEALTH_MAX_TASKS) {
+    return false;
+  }
+
+  _taskNames[_taskCount] = name;
+  _tasks[_taskCount] = handle;
+  _taskCount++;
+  return true;
+}
+
+void HealthMonitor::beginIteration() {
+  _iterationStart = (uint64_t)esp_timer_get_time();
+}
+
+void HealthMonitor::endIteration() {
+  uint32_t elapsed = (uint32_t)((uint64_t)esp_timer_get_time() - _iterationStart);
+
+  portENTER_CRITICAL(&_lock);
+  _iterations++;
+  if (elapsed > _loopMaxUs) {
+    _loopMaxUs = elapsed;
+  }
+  if (elapsed > _loopMaxEverUs) {
+    _loopMaxEverUs = elapsed;
+  }
+  portEXIT_CRITICAL(&_lock);
+}
+
+void HealthMonitor::sample(HealthStats& stats) {
+  uint64_t now = (uint64_t)esp_timer_get_time();
+
+  portENTER_CRITICAL(&_lock);
+  uint32_t iterations = _iterations;
+  uint64_t windowStart = _windowStart;
+  stats.loopMaxUs = _loopMaxUs;
+  stats.loopMaxEverUs = _loopMaxEverUs;
+  _iterations = 0;
+  _loopMaxUs = 0;
+  _windowStart = now;
+  portEXIT_CRITICAL(&_lock);
+
+  uint64_t windowUs = now - windowStart;
+  stats.loopRate = (windowUs > 0) ? (uint32_t)((uint64_t)iterations * 1000000ULL / windowUs) : 0;
+
+  stats.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  stats.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  stats.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+
+  // ESP-IDF reports stack high-water marks in bytes
+  stats.taskCount = _taskCount;
+  for (uint8_t i = 0; i < _taskCount; i++) {
+    stats.tasks[i].name = _taskNames[i];
+    stats.tasks[i].freeBytes = uxTaskGetStackHighWaterMark(_tasks[i]);
+  }
+}
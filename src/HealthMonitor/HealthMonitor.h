@@ -0,0 +1,108 @@
+/**
+ * @file HealthMonitor.h
+ * @brief Gate loop timing, heap and task stack telemetry
+ * @details The gate task brackets each iteration with beginIteration() and
+ *          endIteration(); the network task takes a sample() for every
+ *          status message. Heap figures cover 8-bit capable memory, where
+ *          Arduino Strings live, so a shrinking largest block shows
+ *          fragmentation before allocations start to fail.
+ */
+
+#ifndef HEALTHMONITOR_H
+#define HEALTHMONITOR_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "../Config.h"
+
+/**
+ * @struct TaskStackInfo
+ * @brief Stack headroom of one task
+ */
+struct TaskStackInfo {
+  const char* name;        ///< Task name literal
+  uint32_t freeBytes;      ///< Smallest free stack seen by FreeRTOS
+};
+
+/**
+ * @struct HealthStats
+ * @brief One health sample
+ */
+struct HealthStats {
+  uint32_t loopRate;       ///< Gate iterations per second since the last sample
+  uint32_t loopMaxUs;      ///< Slowest iteration since the last sample
+  uint32_t loopMaxEverUs;  ///< Slowest iteration since boot
+  uint32_t freeHeap;       ///< Free heap now (bytes)
+  uint32_t largestBlock;   ///< Largest allocatable block now (bytes)
+  uint32_t minFreeHeap;    ///< Lowest free heap since boot (bytes)
+  uint32_t wifiReconnects; ///< NetworkManager::getReconnectCount()
+  uint8_t taskCount;       ///< Valid entries in tasks
+  TaskStackInfo tasks[HEALTH_MAX_TASKS];  ///< Stack high-water marks
+};
+
+/**
+ * @class HealthMonitor
+ * @brief Collects runtime health counters for the status message
+ *
+ * Example usage:
+ * @code
+ * HealthMonitor health;
+ * health.addTask("gate", gateTaskHandle);
+ *
+ * // gate task
+ * health.beginIteration();
+ * runGateLogic();
+ * health.endIteration();
+ *
+ * // network task
+ * HealthStats stats;
+ * health.sample(stats);
+ * @endcode
+ */
+class HealthMonitor {
+public:
+  /**
+   * @brief Constructor
+   */
+  HealthMonitor();
+
+  /**
+   * @brief Report a task's stack high-water mark
+   * @param name Name literal used in reports
+   * @param handle Task handle
+   * @return true if added, false if HEALTH_MAX_TASKS are registered
+   */
+  bool addTask(const char* name, TaskHandle_t handle);
+
+  /**
+   * @brief Mark the start of a gate loop iteration
+   */
+  void beginIteration();
+
+  /**
+   * @brief Mark the end of a gate loop iteration
+   */
+  void endIteration();
+
+  /**
+   * @brief Take a sample and start a new measurement window
+   * @param stats Output sample (wifiReconnects is left for the caller)
+   */
+  void sample(HealthStats& stats);
+
+private:
+  uint64_t _iterationStart;    ///< esp_timer us at beginIteration()
+  uint32_t _iterations;        ///< Iterations in the current window
+  uint32_t _loopMaxUs;         ///< Slowest iteration in the current window
+  uint32_t _loopMaxEverUs;     ///< Slowest iteration since boot
+  uint64_t _windowStart;       ///< esp_timer us the window began
+  const char* _taskNames[HEALTH_MAX_TASKS];  ///< Registered task names
+  TaskHandle_t _tasks[HEALTH_MAX_TASKS];     ///< Registered task handles
+  uint8_t _taskCount;          ///< Registered tasks
+  portMUX_TYPE _lock;          ///< Guards the loop counters across tasks
+};
+
+#endif // HEALTHMONITOR_H
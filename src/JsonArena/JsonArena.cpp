@@ -0,0 +1,126 @@
+/**
+ * @file JsonArena.cpp
+ * @brief Implementation of the fixed-buffer JSON allocator
+ */
+
+#include "JsonArena.h"
+
+/**
+ * @struct ArenaBlockHeader
+ * @brief Bookkeeping stored in front of every block (keeps 8-byte alignment)
+ */
+struct ArenaBlockHeader {
+  uint32_t size;       ///< Usable block size (aligned)
+  uint32_t previous;   ///< Header offset of the block before this one
+};
+
+static const size_t ARENA_ALIGN = 8;
+static const size_t ARENA_HEADER = sizeof(ArenaBlockHeader);
+static const uint32_t ARENA_NO_BLOCK = 0xFFFFFFFF;
+
+static_assert(ARENA_HEADER % ARENA_ALIGN == 0, "Arena header must preserve alignment");
+
+static size_t alignSize(size_t size) {
+  return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+JsonArena::JsonArena(uint8_t* buffer, size_t capacity)
+  : _buffer(buffer),
+    _capacity(capacity),
+    _used(0),
+    _lastBlock(ARENA_NO_BLOCK),
+    _peak(0),
+    _failures(0) {
+}
+
+void* JsonArena::allocate(size_t size) {
+  size_t aligned = alignSize(size);
+  if (_used + ARENA_HEADER + aligned > _capacity) {
+    _failures++;
+    return nullptr;
+  }
+
+  ArenaBlockHeader* header = reinterpret_cast<ArenaBlockHeader*>(_buffer + _used);
+  header->size = aligned;
+  header->previous = _lastBlock;
+
+  _lastBlock = _used;
+  _used += ARENA_HEADER + aligned;
+  if (_used > _peak) {
+    _peak = _used;
+  }
+
+  return _buffer + _lastBlock + ARENA_HEADER;
+}
+
+void JsonArena::deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  // Only the newest block can be returned; the rest waits for reset()
+  size_t header = headerOf(ptr);
+  if (header == _lastBlock) {
+    _lastBlock = reinterpret_cast<ArenaBlockHeader*>(_buffer + header)->previous;
+    _used = header;
+  }
+}
+
+void* JsonArena::reallocate(void* ptr, size_t newSize) {
+  if (ptr == nullptr) {
+    return allocate(newSize);
+  }
+
+  size_t header = headerOf(ptr);
+  size_t oldSize = blockSize(header);
+  size_t aligned = alignSize(newSize);
+
+  // Newest block: grow or shrink in place
+  if (header == _lastBlock) {
+    if (header + ARENA_HEADER + aligned > _capacity) {
+      _failures++;
+      return nullptr;
+    }
+    reinterpret_cast<ArenaBlockHeader*>(_buffer + header)->size = aligned;
+    _used = header + ARENA_HEADER + aligned;
+    if (_used > _peak) {
+      _peak = _used;
+    }
+    return ptr;
+  }
+
+  if (aligned <= oldSize) {
+    return ptr;
+  }
+
+  void* moved = allocate(newSize);
+  if (moved != nullptr) {
+    memcpy(moved, ptr, oldSize);
+  }
+  return moved;
+}
+
+void JsonArena::reset() {
+  _used = 0;
+  _lastBlock = ARENA_NO_BLOCK;
+}
+
+size_t JsonArena::getUsed() const {
+  return _used;
+}
+
+size_t JsonArena::getPeak() const {
+  return _peak;
+}
+
+unsigned long JsonArena::getFailures() const {
+  return _failures;
+}
+
+size_t JsonArena::headerOf(void* ptr) const {
+  return static_cast<uint8_t*>(ptr) - _buffer - ARENA_HEADER;
+}
+
+size_t JsonArena::blockSize(size_t header) const {
+  return reinterpret_cast<const ArenaBlockHeader*>(_buffer + header)->size;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file JsonArena.h
+ * @brief Fixed-buffer allocator for ArduinoJson documents
+ * @details ArduinoJson 7 documents allocate their memory pools and strings
+ *          through an Allocator. Backing a document with a JsonArena keeps
+ *          it inside a preallocated buffer, so building or parsing a message
+ *          never touches the heap. The arena is reset between messages.
+ */
+
+#ifndef JSONARENA_H
+#define JSONARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../Config.h"
+
+/**
+ * @class JsonArena
+ * @brief Bump allocator over a caller-provided buffer
+ *
+ * Freeing or resizing the most recent block is done in place, which covers
+ * how ArduinoJson grows and shrinks its pools; other frees are ignored until
+ * reset(). Exhaustion makes allocate() return nullptr, which ArduinoJson
+ * reports through JsonDocument::overflowed() / DeserializationError::NoMemory.
+ *
+ * Example usage:
+ * @code
+ * static uint8_t buffer[JSON_ARENA_SIZE];
+ * JsonArena arena(buffer, sizeof(buffer));
+ * arena.reset();
+ * JsonDocument doc(&arena);
+ * deserializeJson(doc, payload, length);
+ * @endcode
+ */
+class JsonArena : public ArduinoJson::Allocator {
+public:
+  /**
+   * @brief Constructor
+   * @param buffer Backing storage (must outlive the arena)
+   * @param capacity Buffer size in bytes
+   */
+  JsonArena(uint8_t* buffer, size_t capacity);
+
+  void* allocate(size_t size) override;
+  void deallocate(void* ptr) override;
+  void* reallocate(void* ptr, size_t newSize) override;
+
+  /**
+   * @brief Release everything (no document may still use the arena)
+   */
+  void reset();
+
+  /**
+   * @brief Get bytes currently allocated
+   * @return Used bytes including block headers
+   */
+  size_t getUsed() const;
+
+  /**
+   * @brief Get highest usage since construction
+   * @return Peak bytes, for sizing JSON_ARENA_SIZE
+   */
+  size_t getPeak() const;
+
+  /**
+   * @brief Get number of allocations refused for lack of space
+   * @return Failure count
+   */
+  unsigned long getFailures() const;
+
+private:
+  uint8_t* _buffer;          ///< Backing storage
+  size_t _capacity;          ///< Storage size
+  size_t _used;              ///< Bump offset
+  size_t _lastBlock;         ///< Offset of the most recent block header
+  size_t _peak;              ///< Highest _used seen
+  unsigned long _failures;   ///< Refused allocations
+
+  /**
+   * @brief Get the header offset of a block
+   * @param ptr Block returned by allocate()
+   * @return Header offset
+   */
+  size_t headerOf(void* ptr) const;
+
+  /**
+   * @brief Read the size stored in a block header
+   * @param header Header offset
+   * @return Block size in bytes
+   */
+  size_t blockSize(size_t header) const;
+};
+
+#endif // JSONARENA_H
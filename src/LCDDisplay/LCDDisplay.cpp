@@ -7,9 +7,12 @@
 
 LCDDisplay::LCDDisplay() 
   : _lcd(LCD_ADDRESS, LCD_COLS, LCD_ROWS),
-    _line1Content(""),
-    _line2Content(""),
+    _cursorCol(0),
+    _cursorRow(0),
+    _cellWrites(0),
     _initialized(false) {
+  memset(_frame, ' ', sizeof(_frame));
+  memset(_shown, ' ', sizeof(_shown));
 }
 
 bool LCDDisplay::begin() {
@@ -21,6 +24,9 @@ bool LCDDisplay::begin() {
   _lcd.backlight();
   _lcd.clear();
   
+  // A cleared panel shows spaces everywhere
+  memset(_shown, ' ', sizeof(_shown));
+  
   _initialized = true;
   DEBUG_PRINTLN("✓ LCD display initialized");
   
@@ -31,57 +37,75 @@ void LCDDisplay::clear() {
   if (!_initialized) return;
   
   _lcd.clear();
-  _line1Content = "";
-  _line2Content = "";
+  memset(_frame, ' ', sizeof(_frame));
+  memset(_shown, ' ', sizeof(_shown));
 }
 
-void LCDDisplay::updateLine(uint8_t row, const String& text) {
-  if (!_initialized || row > 1) return;
-  
-  String formattedText = formatLine(text);
-  
-  _lcd.setCursor(0, row);
-  _lcd.print(formattedText);
+void LCDDisplay::setLine(uint8_t row, const char* text) {
+  if (row >= LCD_ROWS) return;
   
-  // Store current content
-  if (row == 0) {
-    _line1Content = formattedText;
-  } else {
-    _line2Content = formattedText;
+  formatLine(row, text != nullptr ? text : "");
+}
+
+uint8_t LCDDisplay::flush() {
+  if (!_initialized) return 0;
+  
+  uint8_t written = 0;
+  
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    uint8_t col = 0;
+    while (col < LCD_COLS) {
+      if (_frame[row][col] == _shown[row][col]) {
+        col++;
+        continue;
+      }
+  
+      // Send the run of changed cells after a single cursor move. A lone
+      // unchanged cell costs no more to rewrite than a new cursor command.
+      _lcd.setCursor(col, row);
+      while (col < LCD_COLS &&
+             (_frame[row][col] != _shown[row][col] ||
+              (col + 1 < LCD_COLS && _frame[row][col + 1] != _shown[row][col + 1]))) {
+        _lcd.write((uint8_t)_frame[row][col]);
+        _shown[row][col] = _frame[row][col];
+        written++;
+        col++;
+      }
+    }
   }
+  
+  _cellWrites += written;
+  return written;
 }
 
-void LCDDisplay::showMessage(const String& line1, const String& line2) {
-  if (!_initialized) return;
+void LCDDisplay::updateLine(uint8_t row, const char* text) {
+  if (!_initialized || row >= LCD_ROWS) return;
   
-  updateLine(0, line1);
-  updateLine(1, line2);
+  setLine(row, text);
+  flush();
 }
 
-void LCDDisplay::showTemporaryMessage(const String& line1, const String& line2, 
-                                     unsigned long duration) {
+void LCDDisplay::showMessage(const char* line1, const char* line2) {
   if (!_initialized) return;
   
-  // Save current content
-  String savedLine1 = _line1Content;
-  String savedLine2 = _line2Content;
-  
-  // Show temporary message
-  showMessage(line1, line2);
-  delay(duration);
-  
-  // Restore previous content
-  showMessage(savedLine1, savedLine2);
+  setLine(0, line1);
+  setLine(1, line2);
+  flush();
 }
 
 void LCDDisplay::setCursor(uint8_t col, uint8_t row) {
   if (!_initialized) return;
-  _lcd.setCursor(col, row);
+  _cursorCol = col;
+  _cursorRow = row;
 }
 
-void LCDDisplay::print(const String& text) {
-  if (!_initialized) return;
-  _lcd.print(text);
+void LCDDisplay::print(const char* text) {
+  if (!_initialized || text == nullptr || _cursorRow >= LCD_ROWS) return;
+  
+  while (*text != '\0' && _cursorCol < LCD_COLS) {
+    _frame[_cursorRow][_cursorCol++] = *text++;
+  }
+  flush();
 }
 
 void LCDDisplay::setBacklight(bool on) {
@@ -97,29 +121,32 @@ void LCDDisplay::setBacklight(bool on) {
 void LCDDisplay::displaySlotStatus(int availableSlots, int totalSlots, uint8_t row) {
   if (!_initialized) return;
   
-  String message = "Slots: " + String(availableSlots) + "/" + String(totalSlots);
+  char message[LCD_COLS + 1];
+  snprintf(message, sizeof(message), "Slots: %d/%d", availableSlots, totalSlots);
   updateLine(row, message);
 }
 
-void LCDDisplay::displayGateStatus(const String& gate, const String& status, uint8_t row) {
+void LCDDisplay::displayGateStatus(const char* gate, const char* status, uint8_t row) {
   if (!_initialized) return;
   
-  String message = gate + ": " + status;
+  char message[LCD_COLS + 1];
+  snprintf(message, sizeof(message), "%s: %s", gate, status);
   updateLine(row, message);
 }
 
-String LCDDisplay::formatLine(const String& text) const {
-  String formatted = text;
-  
-  // Truncate if too long
-  if (formatted.length() > LCD_COLS) {
-    formatted = formatted.substring(0, LCD_COLS);
+unsigned long LCDDisplay::getCellWrites() const {
+  return _cellWrites;
+}
+
+void LCDDisplay::formatLine(uint8_t row, const char* text) {
+  // Copy up to a full row, then pad with spaces
+  uint8_t col = 0;
+  while (col < LCD_COLS && text[col] != '\0') {
+    _frame[row][col] = text[col];
+    col++;
   }
   
-  // Pad with spaces if too short
-  while (formatted.length() < LCD_COLS) {
-    formatted += " ";
+  while (col < LCD_COLS) {
+    _frame[row][col++] = ' ';
   }
-  
-  return formatted;
 }
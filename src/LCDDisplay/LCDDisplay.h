@@ -2,7 +2,10 @@
  * @file LCDDisplay.h
  * @brief LCD display manager with I2C interface
  * @details Provides a clean wrapper around LiquidCrystal_I2C library
- *          with thread-safe operations and message formatting
+ *          with thread-safe operations and message formatting. Text is
+ *          composed in a shadow frame buffer; flush() sends only the cells
+ *          that differ from what the panel already shows, since every
+ *          character costs about 1 ms on the I2C backpack.
  */
 
 #ifndef LCDDISPLAY_H
@@ -21,8 +24,11 @@
  * @code
  * LCDDisplay lcd;
  * lcd.begin();
- * lcd.updateLine(0, "Hello World");
- * lcd.showMessage("Status", "Ready", 2000);
+ * lcd.updateLine(0, "Hello World");   // writes the changed cells now
+ *
+ * lcd.setLine(0, "IN: Ready");         // compose without I2C traffic
+ * lcd.setLine(1, "Slots: 4/5");
+ * lcd.flush();                         // one pass over the changes
  * @endcode
  */
 class LCDDisplay {
@@ -44,27 +50,32 @@ public:
   void clear();
 
   /**
-   * @brief Update a single line with text (auto-padded to 16 chars)
+   * @brief Set a line in the frame buffer (auto-padded to 16 chars)
+   * @details Nothing is sent until flush()
    * @param row Row number (0 or 1)
-   * @param text Text to display (max 16 chars)
+   * @param text Text to display (truncated to 16 chars)
    */
-  void updateLine(uint8_t row, const String& text);
+  void setLine(uint8_t row, const char* text);
 
   /**
-   * @brief Display two-line message
-   * @param line1 Text for first line
-   * @param line2 Text for second line
+   * @brief Send the cells that changed since the last flush
+   * @return Number of characters written to the panel
    */
-  void showMessage(const String& line1, const String& line2);
+  uint8_t flush();
 
   /**
-   * @brief Display temporary message then restore previous content
+   * @brief Update a single line with text (auto-padded to 16 chars)
+   * @param row Row number (0 or 1)
+   * @param text Text to display (max 16 chars)
+   */
+  void updateLine(uint8_t row, const char* text);
+
+  /**
+   * @brief Display two-line message
    * @param line1 Text for first line
    * @param line2 Text for second line
-   * @param duration Duration in milliseconds
    */
-  void showTemporaryMessage(const String& line1, const String& line2, 
-                           unsigned long duration);
+  void showMessage(const char* line1, const char* line2);
 
   /**
    * @brief Set cursor position
@@ -75,9 +86,11 @@ public:
 
   /**
    * @brief Print text at current cursor position
+   * @details Goes through the frame buffer; text past the end of the row
+   *          is dropped
    * @param text Text to print
    */
-  void print(const String& text);
+  void print(const char* text);
 
   /**
    * @brief Turn backlight on/off
@@ -99,20 +112,29 @@ public:
    * @param status Status message
    * @param row Row to display on (0 or 1)
    */
-  void displayGateStatus(const String& gate, const String& status, uint8_t row);
+  void displayGateStatus(const char* gate, const char* status, uint8_t row);
+
+  /**
+   * @brief Get number of characters sent to the panel since boot
+   * @return Character count
+   */
+  unsigned long getCellWrites() const;
 
 private:
   LiquidCrystal_I2C _lcd;    ///< LCD object instance
-  String _line1Content;       ///< Current line 1 content (for restore)
-  String _line2Content;       ///< Current line 2 content (for restore)
+  char _frame[LCD_ROWS][LCD_COLS];   ///< Content wanted on the panel
+  char _shown[LCD_ROWS][LCD_COLS];   ///< Content the panel shows now
+  uint8_t _cursorCol;         ///< Column for print()
+  uint8_t _cursorRow;         ///< Row for print()
+  unsigned long _cellWrites;  ///< Characters sent since boot
   bool _initialized;          ///< Initialization status
 
   /**
-   * @brief Pad or truncate string to 16 characters
+   * @brief Pad or truncate text to 16 characters into a frame row
+   * @param row Row number
    * @param text Input text
-   * @return Formatted string
    */
-  String formatLine(const String& text) const;
+  void formatLine(uint8_t row, const char* text);
 };
 
 #endif // LCDDISPLAY_H
@@ -0,0 +1,122 @@
+/**
+ * @file LatencyTracer.cpp
+ * @brief Implementation of the per-stage latency histograms
+ */
+
+#include "LatencyTracer.h"
+
+LatencyTracer::Histogram LatencyTracer::_histograms[TRACE_STAGE_COUNT];
+portMUX_TYPE LatencyTracer::_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const STAGE_NAMES[TRACE_STAGE_COUNT] = {
+  "ir_debounce",
+  "card_read",
+  "authorize",
+  "slot_allocate",
+  "servo",
+  "card_to_open",
+  "mqtt_publish",
+  "event_delivery"
+};
+
+uint64_t LatencyTracer::now() {
+#if LATENCY_TRACE_ENABLED
+  return (uint64_t)esp_timer_get_time();
+#else
+  return 0;
+#endif
+}
+
+void LatencyTracer::record(TraceStage stage, uint32_t micros) {
+#if LATENCY_TRACE_ENABLED
+  if (stage >= TRACE_STAGE_COUNT) {
+    return;
+  }
+
+  uint8_t bucket = bucketOf(micros);
+
+  portENTER_CRITICAL(&_lock);
+  Histogram& histogram = _histograms[stage];
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  if (micros > histogram.maxUs) {
+    histogram.maxUs = micros;
+  }
+  portEXIT_CRITICAL(&_lock);
+#endif
+}
+
+void LatencyTracer::recordSince(TraceStage stage, uint64_t startUs) {
+#if LATENCY_TRACE_ENABLED
+  uint64_t elapsed = now() - startUs;
+  record(stage, elapsed > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)elapsed);
+#endif
+}
+
+void LatencyTracer::getStats(TraceStage stage, StageStats& stats) {
+  memset(&stats, 0, sizeof(stats));
+  if (stage >= TRACE_STAGE_COUNT) {
+    return;
+  }
+
+  // Work on a copy so the lock is held only for the memcpy
+  Histogram copy;
+  portENTER_CRITICAL(&_lock);
+  memcpy(&copy, &_histograms[stage], sizeof(copy));
+  portEXIT_CRITICAL(&_lock);
+
+  stats.count = copy.count;
+  stats.maxUs = copy.maxUs;
+  stats.p50Us = percentile(copy, 50);
+  stats.p99Us = percentile(copy, 99);
+}
+
+void LatencyTracer::reset() {
+  portENTER_CRITICAL(&_lock);
+  memset(_histograms, 0, sizeof(_histograms));
+  portEXIT_CRITICAL(&_lock);
+}
+
+const char* LatencyTracer::getStageName(TraceStage stage) {
+  return (stage < TRACE_STAGE_COUNT) ? STAGE_NAMES[stage] : "unknown";
+}
+
+uint8_t LatencyTracer::bucketOf(uint32_t micros) {
+  if (micros < 2) {
+    return (uint8_t)micros;
+  }
+
+  // Two buckets per octave: the top bit picks the octave, the next one the half
+  uint8_t msb = 31 - __builtin_clz(micros);
+  uint8_t bucket = msb * 2 + ((micros >> (msb - 1)) & 1);
+  return (bucket < LATENCY_HISTOGRAM_BUCKETS) ? bucket : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+uint32_t LatencyTracer::bucketUpperBound(uint8_t bucket) {
+  if (bucket < 2) {
+    return bucket;
+  }
+
+  uint8_t msb = bucket / 2;
+  uint32_t half = 1UL << (msb - 1);
+  uint32_t lower = (1UL << msb) + ((bucket & 1) ? half : 0);
+  return lower + half - 1;
+}
+
+uint32_t LatencyTracer::percentile(const Histogram& histogram, uint8_t percent) {
+  if (histogram.count == 0) {
+    return 0;
+  }
+
+  // Rank of the sample at the percentile, rounded up
+  uint32_t rank = (uint32_t)(((uint64_t)histogram.count * percent + 99) / 100);
+  uint32_t seen = 0;
+  for (uint8_t bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; bucket++) {
+    seen += histogram.buckets[bucket];
+    if (seen >= rank) {
+      uint32_t bound = bucketUpperBound(bucket);
+      return (bound < histogram.maxUs) ? bound : histogram.maxUs;
+    }
+  }
+  return histogram.maxUs;
+}
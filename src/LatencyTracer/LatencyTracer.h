@@ -0,0 +1,169 @@
+/**
+ * @file LatencyTracer.h
+ * @brief Per-stage latency histograms for the gate path
+ * @details Stages are timed with esp_timer (microseconds, shared by both
+ *          cores) and binned into log-scale histograms of fixed size, two
+ *          buckets per power of two. Percentiles are therefore accurate to
+ *          within a quarter of the value; the maximum is exact.
+ */
+
+#ifndef LATENCYTRACER_H
+#define LATENCYTRACER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "../Config.h"
+
+/**
+ * @enum TraceStage
+ * @brief Instrumented points on the way from IR trigger to barrier open
+ */
+enum TraceStage {
+  TRACE_IR_DEBOUNCE,     ///< Raw IR edge to debounced vehicle detection
+  TRACE_CARD_READ,       ///< RFIDManager::readCard()
+  TRACE_AUTHORIZE,       ///< Whitelist lookup
+  TRACE_SLOT_ALLOCATE,   ///< SlotManager::allocateSlot()
+  TRACE_SERVO,           ///< GateController::setServoAngle()
+  TRACE_CARD_TO_OPEN,    ///< Card read started to barrier commanded open
+  TRACE_MQTT_PUBLISH,    ///< MQTTHandler::publishJSON()
+  TRACE_EVENT_DELIVERY,  ///< Entry/exit event queued to published (benchmark mode)
+  TRACE_STAGE_COUNT      ///< Number of stages
+};
+
+/**
+ * @struct StageStats
+ * @brief Summary of one stage histogram
+ */
+struct StageStats {
+  uint32_t count;        ///< Samples recorded
+  uint32_t p50Us;        ///< Median (bucket upper bound)
+  uint32_t p99Us;        ///< 99th percentile (bucket upper bound)
+  uint32_t maxUs;        ///< Largest sample
+};
+
+/**
+ * @class LatencyTracer
+ * @brief Records stage durations from any task
+ *
+ * All members are static: there is one trace table per firmware, so the
+ * modules on the gate path can record without being handed an instance.
+ * Recording takes a short spinlock and never allocates; with
+ * LATENCY_TRACE_ENABLED set to 0 it compiles to nothing.
+ *
+ * Example usage:
+ * @code
+ * {
+ *   TraceScope trace(TRACE_CARD_READ);
+ *   reader.PICC_ReadCardSerial();
+ * }                                   // duration recorded here
+ *
+ * StageStats stats;
+ * LatencyTracer::getStats(TRACE_CARD_READ, stats);
+ * @endcode
+ */
+class LatencyTracer {
+public:
+  /**
+   * @brief Get a trace timestamp
+   * @return Microseconds since boot
+   */
+  static uint64_t now();
+
+  /**
+   * @brief Record a stage duration
+   * @param stage Stage
+   * @param micros Duration in microseconds
+   */
+  static void record(TraceStage stage, uint32_t micros);
+
+  /**
+   * @brief Record the time elapsed since a timestamp from now()
+   * @param stage Stage
+   * @param startUs Start timestamp
+   */
+  static void recordSince(TraceStage stage, uint64_t startUs);
+
+  /**
+   * @brief Summarize a stage
+   * @param stage Stage
+   * @param stats Output summary (all zero if no samples)
+   */
+  static void getStats(TraceStage stage, StageStats& stats);
+
+  /**
+   * @brief Discard all samples
+   */
+  static void reset();
+
+  /**
+   * @brief Get the stage name used in reports
+   * @param stage Stage
+   * @return Name string literal
+   */
+  static const char* getStageName(TraceStage stage);
+
+private:
+  /**
+   * @struct Histogram
+   * @brief Samples of one stage
+   */
+  struct Histogram {
+    uint32_t buckets[LATENCY_HISTOGRAM_BUCKETS];  ///< Sample counts
+    uint32_t count;                               ///< Total samples
+    uint32_t maxUs;                               ///< Largest sample
+  };
+
+  static Histogram _histograms[TRACE_STAGE_COUNT];  ///< One per stage
+  static portMUX_TYPE _lock;                        ///< Guards _histograms
+
+  /**
+   * @brief Map a duration to its bucket
+   * @param micros Duration in microseconds
+   * @return Bucket index
+   */
+  static uint8_t bucketOf(uint32_t micros);
+
+  /**
+   * @brief Get the largest duration a bucket holds
+   * @param bucket Bucket index
+   * @return Microseconds
+   */
+  static uint32_t bucketUpperBound(uint8_t bucket);
+
+  /**
+   * @brief Find a percentile in a histogram copy
+   * @param histogram Histogram
+   * @param percent Percentile (1-100)
+   * @return Microseconds (at most the exact maximum)
+   */
+  static uint32_t percentile(const Histogram& histogram, uint8_t percent);
+};
+
+/**
+ * @class TraceScope
+ * @brief Records the lifetime of a scope as a stage duration
+ */
+class TraceScope {
+public:
+  /**
+   * @brief Start timing
+   * @param stage Stage recorded when the scope ends
+   */
+  explicit TraceScope(TraceStage stage)
+    : _stage(stage), _start(LatencyTracer::now()) {}
+
+  /**
+   * @brief Stop timing and record
+   */
+  ~TraceScope() { LatencyTracer::recordSince(_stage, _start); }
+
+private:
+  TraceStage _stage;  ///< Stage to record
+  uint64_t _start;    ///< Trace timestamp at construction
+
+  TraceScope(const TraceScope&);
+  TraceScope& operator=(const TraceScope&);
+};
+
+#endif // LATENCYTRACER_H
@@ -8,14 +8,98 @@
 // Initialize static instance pointer
 MQTTHandler* MQTTHandler::_instance = nullptr;
 
+#if MQTT_EVENT_ENCODING == EVENT_ENCODING_MSGPACK
+// Compact status codes (index = code); mirrored in the backend event codec
+static const char* const EVENT_STATUS_CODES[] = {
+  "success",
+  "success_no_slot",
+  "denied_unauthorized",
+  "denied_full"
+};
+#endif
+
+// Room left in the PubSubClient buffer for the MQTT header and topic
+static const size_t PUBLISH_HEADER_RESERVE = 64;
+
+#if MQTT_EVENT_ENCODING != EVENT_ENCODING_MSGPACK
+/**
+ * @brief Fill the fields shared by JSON entry/exit events
+ */
+static void fillJsonEvent(JsonObject doc, bool isExit, const char* uidHex,
+                          int slotId, const char* status, int availableSlots,
+                          unsigned long timestamp, uint32_t bootId,
+                          uint32_t sequence) {
+  doc["action"] = isExit ? "exit" : "entry";
+  doc["card_uid"] = uidHex;
+  doc["slot_id"] = slotId;
+  doc["gate"] = isExit ? "exit" : "entrance";
+  doc["status"] = status;
+  doc["available_slots"] = availableSlots;
+  doc["timestamp"] = timestamp;
+  if (sequence != 0) {
+    doc["boot"] = bootId;
+    doc["seq"] = sequence;
+  }
+}
+#endif
+
+#if MQTT_EVENT_ENCODING == EVENT_ENCODING_MSGPACK
+/**
+ * @brief Fill the fields shared by compact entry/exit events
+ * @details Keys: u = card UID, s = slot, st = status code (or string),
+ *          a = available slots, t = timestamp, b/q = outbox boot/sequence.
+ *          The action and gate are implied by the topic.
+ */
+static void fillCompactEvent(JsonObject doc, const char* uidHex, int slotId,
+                             const char* status, int availableSlots,
+                             unsigned long timestamp, uint32_t bootId,
+                             uint32_t sequence) {
+  doc["u"] = uidHex;
+  doc["s"] = slotId;
+  
+  int code = -1;
+  for (size_t i = 0; i < sizeof(EVENT_STATUS_CODES) / sizeof(EVENT_STATUS_CODES[0]); i++) {
+    if (strcmp(status, EVENT_STATUS_CODES[i]) == 0) {
+      code = i;
+      break;
+    }
+  }
+  if (code >= 0) {
+    doc["st"] = code;
+  } else {
+    doc["st"] = status;
+  }
+  
+  doc["a"] = availableSlots;
+  doc["t"] = timestamp;
+  if (sequence != 0) {
+    doc["b"] = bootId;
+    doc["q"] = sequence;
+  }
+}
+#endif
+
 MQTTHandler::MQTTHandler() 
   : _mqttClient(_wifiClient),
     _server(MQTT_SERVER),
     _port(MQTT_PORT),
     _commandCallback(nullptr),
-    _lastReconnectAttempt(0),
+    _clock(nullptr),
+    _networkUp(false),
+    _linkState(MQTT_LINK_WAIT_NETWORK),
+    _nextAttemptAt(0),
+    _backoff(MQTT_BACKOFF_MIN, MQTT_BACKOFF_MAX),
+    _connectAttempts(0),
+    _sessionCount(0),
     _publishCount(0),
-    _receiveCount(0) {
+    _receiveCount(0),
+    _txArena(_txArenaBuffer, sizeof(_txArenaBuffer)),
+    _rxArena(_rxArenaBuffer, sizeof(_rxArenaBuffer)),
+    _lastStatus(),
+    _statusSent(false),
+    _lastFullStatus(0),
+    _statusSuppressed(0),
+    _boot() {
   
   // Set static instance pointer for callback
   _instance = this;
@@ -36,15 +120,17 @@ bool MQTTHandler::begin(const char* server, int port) {
   DEBUG_PRINT(":");
   DEBUG_PRINTLN(_port);
   
-  // Configure TLS/SSL for HiveMQ Cloud
-  _wifiClient.setInsecure();  // Skip certificate validation (for development)
+  // TLS/SSL for HiveMQ Cloud: BrokerClient skips certificate validation
+  // when the IDF configuration allows it (for development).
   // For production, use: _wifiClient.setCACert(root_ca); with a proper certificate
   
-  DEBUG_PRINTLN("✓ TLS/SSL configured (insecure mode for testing)");
-  
   _mqttClient.setServer(_server.c_str(), _port);
   _mqttClient.setCallback(mqttCallback);
   _mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+  _mqttClient.setSocketTimeout((MQTT_CONNECT_TIMEOUT + 999) / 1000);
+  
+  // Link changes after this arrive through onNetworkLink()
+  _networkUp = (WiFi.status() == WL_CONNECTED);
   
   return reconnect();
 }
@@ -54,31 +140,105 @@ bool MQTTHandler::isConnected() {
 }
 
 void MQTTHandler::update() {
-  unsigned long currentTime = millis();
+  bool wifiUp = _networkUp;
+  
+  switch (_linkState) {
+    case MQTT_LINK_CONNECTED:
+      if (_mqttClient.connected()) {
+        _mqttClient.loop();
+        return;
+      }
+      DEBUG_PRINTLN("⚠ MQTT connection lost");
+      // Retry right away: most drops are a brief WiFi blip
+      _linkState = wifiUp ? MQTT_LINK_BACKOFF : MQTT_LINK_WAIT_NETWORK;
+      _backoff.reset();
+      _nextAttemptAt = TimeSync::monotonicMillis();
+      break;
+      
+    case MQTT_LINK_WAIT_NETWORK:
+      if (!wifiUp) {
+        return;
+      }
+      // WiFi is back; the old session is gone, so reconnect immediately
+      _linkState = MQTT_LINK_BACKOFF;
+      _backoff.reset();
+      _nextAttemptAt = TimeSync::monotonicMillis();
+      break;
+      
+    case MQTT_LINK_BACKOFF:
+      if (!wifiUp) {
+        _linkState = MQTT_LINK_WAIT_NETWORK;
+        return;
+      }
+      break;
+      
+    case MQTT_LINK_CONNECTING:
+      if (!wifiUp) {
+        _wifiClient.stop();
+        _linkState = MQTT_LINK_WAIT_NETWORK;
+        return;
+      }
+      finishConnect();
+      return;
+  }
   
-  if (!_mqttClient.connected()) {
-    // Try to reconnect periodically
-    if (currentTime - _lastReconnectAttempt >= MQTT_RECONNECT_INTERVAL) {
-      _lastReconnectAttempt = currentTime;
-      reconnect();
-    }
-  } else {
-    _mqttClient.loop();
+  if (_linkState == MQTT_LINK_BACKOFF &&
+      TimeSync::monotonicMillis() >= _nextAttemptAt) {
+    reconnect();
   }
 }
 
 bool MQTTHandler::reconnect() {
   if (_mqttClient.connected()) {
+    _linkState = MQTT_LINK_CONNECTED;
     return true;
   }
   
+  if (!_networkUp) {
+    _linkState = MQTT_LINK_WAIT_NETWORK;
+    return false;
+  }
+  
+  if (_linkState == MQTT_LINK_CONNECTING) {
+    return finishConnect();
+  }
+  
+  _connectAttempts++;
+  
   DEBUG_PRINT("Attempting MQTT connection (");
   DEBUG_PRINT(_clientId);
-  DEBUG_PRINT(")...");
+  DEBUG_PRINTLN(")...");
   
-  // Connect with username and password
+  // Lookup and handshake continue in update(); see finishConnect()
+  _wifiClient.startConnect(_server.c_str(), _port);
+  _linkState = MQTT_LINK_CONNECTING;
+  return finishConnect();
+}
+
+bool MQTTHandler::finishConnect() {
+  BrokerConnectStatus status = _wifiClient.pollConnect();
+  if (status == BROKER_CONNECT_PENDING) {
+    return false;
+  }
+  if (status == BROKER_CONNECT_FAILED) {
+    scheduleRetry();
+    return false;
+  }
+  
+  // The TLS session is up, so PubSubClient only sends CONNECT (username
+  // and password) and waits for CONNACK
   if (_mqttClient.connect(_clientId.c_str(), MQTT_USERNAME, MQTT_PASSWORD)) {
-    DEBUG_PRINTLN(" connected!");
+    DEBUG_PRINTF("✓ MQTT connected (TLS handshake %lu ms)\n", _wifiClient.getHandshakeTime());
+    
+    _linkState = MQTT_LINK_CONNECTED;
+    _backoff.reset();
+    _sessionCount++;
+    if (_boot.mqttMs == 0) {
+      _boot.mqttMs = (uint32_t)TimeSync::monotonicMillis();
+    }
+    
+    // The broker session is new; start the status diff from a full snapshot
+    _statusSent = false;
     
     // Subscribe to command topic
     if (_mqttClient.subscribe(MQTT_TOPIC_COMMANDS)) {
@@ -88,34 +248,41 @@ bool MQTTHandler::reconnect() {
     
     return true;
   } else {
-    DEBUG_PRINT(" failed, rc=");
+    DEBUG_PRINT("✗ MQTT connect failed, rc=");
     DEBUG_PRINTLN(_mqttClient.state());
+    _wifiClient.stop();
+    scheduleRetry();
     return false;
   }
 }
 
-bool MQTTHandler::publishEntry(const String& cardUID, int slotId, 
-                               const String& status, int availableSlots, 
-                               unsigned long timestamp) {
+bool MQTTHandler::publishEntry(const CardUid& cardUID, int slotId, 
+                               const char* status, int availableSlots, 
+                               unsigned long timestamp, uint32_t bootId,
+                               uint32_t sequence) {
   if (!isConnected()) {
     return false;
   }
   
-  JsonDocument doc;
-  doc["action"] = "entry";
-  doc["card_uid"] = cardUID;
-  doc["slot_id"] = slotId;
-  doc["gate"] = "entrance";
-  doc["status"] = status;
-  doc["available_slots"] = availableSlots;
-  doc["timestamp"] = timestamp;
-  
+  char uidHex[CARD_UID_HEX_SIZE];
+  cardUID.toHex(uidHex, sizeof(uidHex));
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
+#if MQTT_EVENT_ENCODING == EVENT_ENCODING_MSGPACK
+  fillCompactEvent(doc.to<JsonObject>(), uidHex, slotId, status,
+                   availableSlots, timestamp, bootId, sequence);
+  bool result = publishMsgPack(MQTT_TOPIC_ENTRY_V2, doc);
+#else
+  fillJsonEvent(doc.to<JsonObject>(), false, uidHex, slotId, status,
+                availableSlots, timestamp, bootId, sequence);
   bool result = publishJSON(MQTT_TOPIC_ENTRY, doc);
+#endif
   
   if (result) {
     _publishCount++;
     DEBUG_PRINT("✓ Published entry: ");
-    DEBUG_PRINT(cardUID);
+    DEBUG_PRINT(uidHex);
     if (slotId > 0) {
       DEBUG_PRINT(" -> Slot ");
       DEBUG_PRINT(slotId);
@@ -132,29 +299,35 @@ bool MQTTHandler::publishEntry(const String& cardUID, int slotId,
   return result;
 }
 
-bool MQTTHandler::publishExit(const String& cardUID, int slotId, 
-                              const String& status, unsigned long duration,
-                              int availableSlots, unsigned long timestamp) {
+bool MQTTHandler::publishExit(const CardUid& cardUID, int slotId, 
+                              const char* status, unsigned long duration,
+                              int availableSlots, unsigned long timestamp,
+                              uint32_t bootId, uint32_t sequence) {
   if (!isConnected()) {
     return false;
   }
   
-  JsonDocument doc;
-  doc["action"] = "exit";
-  doc["card_uid"] = cardUID;
-  doc["slot_id"] = slotId;
-  doc["gate"] = "exit";
-  doc["status"] = status;
+  char uidHex[CARD_UID_HEX_SIZE];
+  cardUID.toHex(uidHex, sizeof(uidHex));
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
+#if MQTT_EVENT_ENCODING == EVENT_ENCODING_MSGPACK
+  fillCompactEvent(doc.to<JsonObject>(), uidHex, slotId, status,
+                   availableSlots, timestamp, bootId, sequence);
+  doc["d"] = duration;
+  bool result = publishMsgPack(MQTT_TOPIC_EXIT_V2, doc);
+#else
+  fillJsonEvent(doc.to<JsonObject>(), true, uidHex, slotId, status,
+                availableSlots, timestamp, bootId, sequence);
   doc["duration"] = duration;
-  doc["available_slots"] = availableSlots;
-  doc["timestamp"] = timestamp;
-  
   bool result = publishJSON(MQTT_TOPIC_EXIT, doc);
+#endif
   
   if (result) {
     _publishCount++;
     DEBUG_PRINT("✓ Published exit: ");
-    DEBUG_PRINT(cardUID);
+    DEBUG_PRINT(uidHex);
     DEBUG_PRINT(" <- Slot ");
     DEBUG_PRINT(slotId);
     DEBUG_PRINT(" (");
@@ -165,43 +338,318 @@ bool MQTTHandler::publishExit(const String& cardUID, int slotId,
   return result;
 }
 
+size_t MQTTHandler::publishEventBatch(const OutboxRecord* records, size_t count) {
+  if (!isConnected() || count == 0) {
+    return 0;
+  }
+  
+  // Shrink the batch until it fits the arena and the MQTT buffer
+  for (; count > 1; count--) {
+    _txArena.reset();
+    JsonDocument doc(&_txArena);
+    JsonArray events = doc["events"].to<JsonArray>();
+    
+    for (size_t i = 0; i < count; i++) {
+      const OutboxRecord& record = records[i];
+      bool isExit = (record.type == PUBLISH_EXIT);
+      char uidHex[CARD_UID_HEX_SIZE];
+      record.cardUID.toHex(uidHex, sizeof(uidHex));
+      
+      JsonObject event = events.add<JsonObject>();
+#if MQTT_EVENT_ENCODING == EVENT_ENCODING_MSGPACK
+      // k = kind (0 entry, 1 exit): a batch has no per-event topic
+      event["k"] = isExit ? 1 : 0;
+      fillCompactEvent(event, uidHex, record.slotNumber, record.status,
+                       record.availableSlots, record.timestamp,
+                       record.bootId, record.sequence);
+      if (isExit) {
+        event["d"] = record.duration;
+      }
+#else
+      fillJsonEvent(event, isExit, uidHex, record.slotNumber, record.status,
+                    record.availableSlots, record.timestamp,
+                    record.bootId, record.sequence);
+      if (isExit) {
+        event["duration"] = record.duration;
+      }
+#endif
+    }
+    
+    if (doc.overflowed()) {
+      continue;
+    }
+#if MQTT_EVENT_ENCODING == EVENT_ENCODING_MSGPACK
+    if (measureMsgPack(doc) > sizeof(_txBuffer) - PUBLISH_HEADER_RESERVE) {
+      continue;
+    }
+    bool result = publishMsgPack(MQTT_TOPIC_EVENT_BATCH_V2, doc);
+#else
+    if (measureJson(doc) > sizeof(_txBuffer) - PUBLISH_HEADER_RESERVE) {
+      continue;
+    }
+    bool result = publishJSON(MQTT_TOPIC_EVENT_BATCH, doc);
+#endif
+    
+    if (!result) {
+      return 0;
+    }
+    _publishCount++;
+    DEBUG_PRINTF("✓ Published %u events in one batch\n", (unsigned)count);
+    return count;
+  }
+  
+  // A single event keeps its own topic
+  const OutboxRecord& record = records[0];
+  bool result;
+  if (record.type == PUBLISH_ENTRY) {
+    result = publishEntry(record.cardUID, record.slotNumber, record.status,
+                          record.availableSlots, record.timestamp,
+                          record.bootId, record.sequence);
+  } else {
+    result = publishExit(record.cardUID, record.slotNumber, record.status,
+                         record.duration, record.availableSlots,
+                         record.timestamp, record.bootId, record.sequence);
+  }
+  return result ? 1 : 0;
+}
+
 bool MQTTHandler::publishStatus(int totalSlots, int availableSlots, 
                                 int authorizedCards, bool emergencyMode,
-                                int rssi, unsigned long uptime) {
+                                int rssi, unsigned long uptime,
+                                const OutboxStats& outbox, const HealthStats& health,
+                                bool full) {
   if (!isConnected()) {
     return false;
   }
   
-  JsonDocument doc;
+  uint64_t currentTime = TimeSync::monotonicMillis();
+  if (!_statusSent || currentTime - _lastFullStatus >= STATUS_FULL_INTERVAL) {
+    full = true;
+  }
+  
+  const StatusSnapshot& last = _lastStatus;
+  bool slotsChanged = full || totalSlots != last.totalSlots ||
+                      availableSlots != last.availableSlots;
+  bool cardsChanged = full || authorizedCards != last.authorizedCards;
+  bool emergencyChanged = full || emergencyMode != last.emergencyMode;
+  bool rssiChanged = full || abs(rssi - last.rssi) >= STATUS_RSSI_HYSTERESIS;
+  bool outboxChanged = full || outbox.pending != last.outboxPending ||
+                       outbox.stored != last.outboxStored ||
+                       outbox.dropped != last.outboxDropped;
+  bool bootChanged = full || _boot.firstGateOpenMs != last.firstGateOpenMs;
+  bool healthAlarm = health.loopMaxUs >= HEALTH_LOOP_WARN_US ||
+                     health.freeHeap < HEALTH_HEAP_WARN;
+  bool healthChanged = full || healthAlarm;
+  
+  // Uptime and sequence numbers always move; on their own they are not news
+  if (!slotsChanged && !cardsChanged && !emergencyChanged && !rssiChanged &&
+      !outboxChanged && !bootChanged && !healthChanged) {
+    _statusSuppressed++;
+    return true;
+  }
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
   doc["type"] = "status";
-  doc["timestamp"] = millis() / 1000;
-  doc["total_slots"] = totalSlots;
-  doc["available_slots"] = availableSlots;
-  doc["occupied_slots"] = totalSlots - availableSlots;
-  doc["authorized_cards"] = authorizedCards;
-  doc["emergency_mode"] = emergencyMode;
-  doc["wifi_rssi"] = rssi;
+  doc["timestamp"] = (_clock != nullptr) ? _clock->getTimestamp() : TimeSync::monotonicSeconds();
+  if (!full) {
+    // Only changed fields follow; the backend merges them into its snapshot
+    doc["partial"] = true;
+  }
+  if (slotsChanged) {
+    doc["total_slots"] = totalSlots;
+    doc["available_slots"] = availableSlots;
+    doc["occupied_slots"] = totalSlots - availableSlots;
+  }
+  if (cardsChanged) {
+    doc["authorized_cards"] = authorizedCards;
+  }
+  if (emergencyChanged) {
+    doc["emergency_mode"] = emergencyMode;
+  }
+  if (rssiChanged) {
+    doc["wifi_rssi"] = rssi;
+  }
   doc["uptime"] = uptime;
   
+  if (outboxChanged) {
+    JsonObject outboxObj = doc["outbox"].to<JsonObject>();
+    outboxObj["pending"] = outbox.pending;
+    outboxObj["stored"] = outbox.stored;
+    outboxObj["dropped"] = outbox.dropped;
+    outboxObj["replayed"] = outbox.replayed;
+    outboxObj["boot"] = outbox.bootId;
+    outboxObj["seq"] = outbox.sequence;
+  }
+  
+  if (healthChanged) {
+    JsonObject healthObj = doc["health"].to<JsonObject>();
+    healthObj["loop_hz"] = health.loopRate;
+    healthObj["loop_max_us"] = health.loopMaxUs;
+    healthObj["loop_max_ever_us"] = health.loopMaxEverUs;
+    healthObj["heap_free"] = health.freeHeap;
+    healthObj["heap_largest"] = health.largestBlock;
+    healthObj["heap_min"] = health.minFreeHeap;
+    JsonObject stacks = healthObj["stack_free"].to<JsonObject>();
+    for (uint8_t i = 0; i < health.taskCount; i++) {
+      stacks[health.tasks[i].name] = health.tasks[i].freeBytes;
+    }
+    healthObj["wifi_reconnects"] = health.wifiReconnects;
+    healthObj["mqtt_attempts"] = _connectAttempts;
+    healthObj["mqtt_sessions"] = _sessionCount;
+    healthObj["tls_handshake_ms"] = _wifiClient.getHandshakeTime();
+    healthObj["tls_resume_offers"] = _wifiClient.getResumeOffers();
+  }
+  
+#if STATUS_INCLUDE_METRICS
+  if (full) {
+    addLatencyStats(doc["latency"].to<JsonObject>());
+  }
+#endif
+  
+  if (bootChanged) {
+    JsonObject bootObj = doc["boot"].to<JsonObject>();
+    bootObj["ready_ms"] = _boot.readyMs;
+    bootObj["mqtt_ms"] = _boot.mqttMs;
+    if (_boot.firstGateOpenMs != 0) {
+      bootObj["first_open_ms"] = _boot.firstGateOpenMs;
+    }
+  }
+  
   bool result = publishJSON(MQTT_TOPIC_SYSTEM, doc);
   
   if (result) {
     _publishCount++;
-    DEBUG_PRINTLN("✓ Published system status");
+    _statusSent = true;
+    if (full) {
+      _lastFullStatus = currentTime;
+    }
+    
+    _lastStatus.totalSlots = totalSlots;
+    _lastStatus.availableSlots = availableSlots;
+    _lastStatus.authorizedCards = authorizedCards;
+    _lastStatus.emergencyMode = emergencyMode;
+    if (rssiChanged) {
+      // Keep the reported value as the reference so slow drift still shows
+      _lastStatus.rssi = rssi;
+    }
+    _lastStatus.outboxPending = outbox.pending;
+    _lastStatus.outboxStored = outbox.stored;
+    _lastStatus.outboxDropped = outbox.dropped;
+    _lastStatus.firstGateOpenMs = _boot.firstGateOpenMs;
+    
+    DEBUG_PRINTLN(full ? "✓ Published system status" : "✓ Published status changes");
+  }
+  
+  return result;
+}
+
+bool MQTTHandler::publishMetrics() {
+  if (!isConnected()) {
+    return false;
+  }
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
+  doc["type"] = "metrics";
+  doc["timestamp"] = (_clock != nullptr) ? _clock->getTimestamp() : TimeSync::monotonicSeconds();
+  doc["uptime"] = TimeSync::monotonicSeconds();
+  addLatencyStats(doc["stages"].to<JsonObject>());
+  
+  bool result = publishJSON(MQTT_TOPIC_METRICS, doc);
+  
+  if (result) {
+    _publishCount++;
+    DEBUG_PRINTLN("✓ Published latency metrics");
   }
   
   return result;
 }
 
-bool MQTTHandler::publishScanEvent(const String& cardUID, const String& gate, 
+bool MQTTHandler::publishBenchmark(const BenchmarkResults& results) {
+  if (!isConnected()) {
+    return false;
+  }
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
+  doc["type"] = "benchmark";
+  doc["status"] = results.status;
+  doc["timestamp"] = (_clock != nullptr) ? _clock->getTimestamp() : TimeSync::monotonicSeconds();
+  doc["duration_ms"] = results.durationMs;
+  doc["cars_in"] = results.carsIn;
+  doc["cars_out"] = results.carsOut;
+  doc["denied"] = results.denied;
+  doc["abandoned"] = results.abandoned;
+  
+  JsonObject events = doc["events"].to<JsonObject>();
+  events["queued"] = results.eventsQueued;
+  events["published"] = results.eventsPublished;
+  events["per_sec"] = (results.durationMs > 0) ?
+                        results.eventsPublished * 1000.0f / results.durationMs : 0.0f;
+  
+  // Queued by the gate task to accepted by the broker, microseconds
+  JsonObject delivery = doc["delivery"].to<JsonObject>();
+  delivery["n"] = results.timedEvents;
+  delivery["avg"] = results.deliveryAvgUs;
+  delivery["max"] = results.deliveryMaxUs;
+  
+  // Gate task wake interval against GATE_TASK_PERIOD_MS, microseconds
+  JsonObject loop = doc["loop"].to<JsonObject>();
+  loop["iterations"] = results.iterations;
+  loop["period_ms"] = GATE_TASK_PERIOD_MS;
+  loop["jitter_avg"] = results.jitterAvgUs;
+  loop["jitter_max"] = results.jitterMaxUs;
+  loop["overruns"] = results.overruns;
+  
+  addLatencyStats(doc["stages"].to<JsonObject>());
+  
+  bool result = publishJSON(MQTT_TOPIC_BENCHMARK, doc);
+  
+  if (result) {
+    _publishCount++;
+    DEBUG_PRINTF("✓ Published benchmark results (%s)\n", results.status);
+  }
+  
+  return result;
+}
+
+bool MQTTHandler::publishWhitelistAck(uint32_t version, const char* status,
+                                      int cardCount) {
+  if (!isConnected()) {
+    return false;
+  }
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
+  doc["type"] = "whitelist_ack";
+  doc["version"] = version;
+  doc["status"] = status;
+  doc["cards"] = cardCount;
+  
+  bool result = publishJSON(MQTT_TOPIC_WHITELIST_ACK, doc);
+  
+  if (result) {
+    _publishCount++;
+    DEBUG_PRINTF("✓ Published whitelist ack: v%u (%s)\n", (unsigned)version, status);
+  }
+  
+  return result;
+}
+
+bool MQTTHandler::publishScanEvent(const CardUid& cardUID, const char* gate, 
                                    unsigned long timestamp) {
   if (!isConnected()) {
     return false;
   }
   
-  JsonDocument doc;
+  char uidHex[CARD_UID_HEX_SIZE];
+  cardUID.toHex(uidHex, sizeof(uidHex));
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
   doc["type"] = "card_scanned";
-  doc["card_uid"] = cardUID;
+  doc["card_uid"] = uidHex;
   doc["gate"] = gate;
   doc["timestamp"] = timestamp;
   
@@ -210,7 +658,7 @@ bool MQTTHandler::publishScanEvent(const String& cardUID, const String& gate,
   if (result) {
     _publishCount++;
     DEBUG_PRINT("✓ Published scan event: ");
-    DEBUG_PRINT(cardUID);
+    DEBUG_PRINT(uidHex);
     DEBUG_PRINT(" at ");
     DEBUG_PRINT(gate);
     DEBUG_PRINTLN(" gate");
@@ -219,15 +667,142 @@ bool MQTTHandler::publishScanEvent(const String& cardUID, const String& gate,
   return result;
 }
 
+bool MQTTHandler::publishDeniedSummary(const CardUid& cardUID, const char* gate, uint8_t lane,
+                                       uint16_t repeats, unsigned long windowS,
+                                       unsigned long timestamp) {
+  if (!isConnected()) {
+    return false;
+  }
+  
+  char uidHex[CARD_UID_HEX_SIZE];
+  cardUID.toHex(uidHex, sizeof(uidHex));
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
+  doc["type"] = "denied_summary";
+  doc["card_uid"] = uidHex;
+  doc["gate"] = gate;
+  doc["lane"] = lane;
+  doc["status"] = "denied_unauthorized";
+  doc["repeats"] = repeats;
+  doc["window_s"] = windowS;
+  doc["timestamp"] = timestamp;
+  
+  bool result = publishJSON(MQTT_TOPIC_DENIED, doc);
+  
+  if (result) {
+    _publishCount++;
+    DEBUG_PRINTF("✓ Published denied summary: %s x%u at %s gate\n",
+                 uidHex, (unsigned)repeats, gate);
+  }
+  
+  return result;
+}
+
+bool MQTTHandler::publishCommandAck(uint32_t commandId, const char* command,
+                                    const char* status) {
+  if (!isConnected()) {
+    return false;
+  }
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
+  doc["type"] = "command_ack";
+  doc["id"] = commandId;
+  if (command != nullptr) {
+    doc["command"] = command;
+  }
+  doc["status"] = status;
+  
+  bool result = publishJSON(MQTT_TOPIC_COMMAND_ACK, doc);
+  
+  if (result) {
+    _publishCount++;
+    DEBUG_PRINTF("✓ Published command ack: #%u (%s)\n", (unsigned)commandId, status);
+  }
+  
+  return result;
+}
+
+bool MQTTHandler::publishCommandResult(uint32_t commandId, const char* command,
+                                       const char* status, unsigned long timestamp) {
+  if (!isConnected()) {
+    return false;
+  }
+  
+  _txArena.reset();
+  JsonDocument doc(&_txArena);
+  doc["type"] = "command_result";
+  doc["id"] = commandId;
+  doc["command"] = command;
+  doc["status"] = status;
+  doc["timestamp"] = timestamp;
+  
+  bool result = publishJSON(MQTT_TOPIC_COMMAND_RESULT, doc);
+  
+  if (result) {
+    _publishCount++;
+    DEBUG_PRINTF("✓ Published command result: #%u %s (%s)\n",
+                 (unsigned)commandId, command, status);
+  }
+  
+  return result;
+}
+
 bool MQTTHandler::publishJSON(const char* topic, JsonDocument& doc) {
   if (!isConnected()) {
     return false;
   }
   
-  String jsonString;
-  serializeJson(doc, jsonString);
+  if (doc.overflowed()) {
+    DEBUG_PRINT("✗ JSON arena exhausted for topic: ");
+    DEBUG_PRINTLN(topic);
+    return false;
+  }
+  
+  // serializeJson() truncates at the buffer end; a full buffer means it did
+  size_t length = serializeJson(doc, _txBuffer, sizeof(_txBuffer));
+  if (length >= sizeof(_txBuffer) - 1) {
+    DEBUG_PRINT("✗ JSON payload too large for topic: ");
+    DEBUG_PRINTLN(topic);
+    return false;
+  }
+  
+  uint64_t traceStart = LatencyTracer::now();
+  bool result = _mqttClient.publish(topic, (const uint8_t*)_txBuffer, length);
+  LatencyTracer::recordSince(TRACE_MQTT_PUBLISH, traceStart);
+  
+  if (!result) {
+    DEBUG_PRINT("✗ MQTT publish failed to topic: ");
+    DEBUG_PRINTLN(topic);
+  }
+  
+  return result;
+}
+
+bool MQTTHandler::publishMsgPack(const char* topic, JsonDocument& doc) {
+  if (!isConnected()) {
+    return false;
+  }
   
-  bool result = _mqttClient.publish(topic, jsonString.c_str());
+  if (doc.overflowed()) {
+    DEBUG_PRINT("✗ JSON arena exhausted for topic: ");
+    DEBUG_PRINTLN(topic);
+    return false;
+  }
+  
+  // serializeMsgPack() has no terminator to spare, so measure first
+  size_t length = measureMsgPack(doc);
+  if (length > sizeof(_txBuffer)) {
+    DEBUG_PRINT("✗ MessagePack payload too large for topic: ");
+    DEBUG_PRINTLN(topic);
+    return false;
+  }
+  serializeMsgPack(doc, (uint8_t*)_txBuffer, sizeof(_txBuffer));
+  
+  uint64_t traceStart = LatencyTracer::now();
+  bool result = _mqttClient.publish(topic, (const uint8_t*)_txBuffer, length);
+  LatencyTracer::recordSince(TRACE_MQTT_PUBLISH, traceStart);
   
   if (!result) {
     DEBUG_PRINT("✗ MQTT publish failed to topic: ");
@@ -237,11 +812,65 @@ bool MQTTHandler::publishJSON(const char* topic, JsonDocument& doc) {
   return result;
 }
 
+void MQTTHandler::addLatencyStats(JsonObject stages) {
+  for (uint8_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+    StageStats stats;
+    LatencyTracer::getStats((TraceStage)i, stats);
+    if (stats.count == 0) {
+      continue;
+    }
+    
+    // Microseconds
+    JsonObject stage = stages[LatencyTracer::getStageName((TraceStage)i)].to<JsonObject>();
+    stage["n"] = stats.count;
+    stage["p50"] = stats.p50Us;
+    stage["p99"] = stats.p99Us;
+    stage["max"] = stats.maxUs;
+  }
+}
+
 void MQTTHandler::setCommandCallback(MQTTCommandCallback callback) {
   _commandCallback = callback;
   DEBUG_PRINTLN("✓ MQTT command callback set");
 }
 
+void MQTTHandler::setClock(const TimeSync* clock) {
+  _clock = clock;
+}
+
+void MQTTHandler::setBootTiming(uint32_t readyMs, uint32_t firstGateOpenMs) {
+  _boot.readyMs = readyMs;
+  _boot.firstGateOpenMs = firstGateOpenMs;
+}
+
+void MQTTHandler::onNetworkLink(bool linkUp) {
+  if (_instance != nullptr) {
+    _instance->handleNetworkLink(linkUp);
+  }
+}
+
+void MQTTHandler::handleNetworkLink(bool linkUp) {
+  _networkUp = linkUp;
+  
+  if (linkUp) {
+    // New IP: the next update() connects without waiting for a backoff
+    if (_linkState != MQTT_LINK_CONNECTED) {
+      _linkState = MQTT_LINK_BACKOFF;
+      _backoff.reset();
+      _nextAttemptAt = TimeSync::monotonicMillis();
+    }
+  } else {
+    // The socket died with the link; drop it instead of waiting for keep-alive
+    if (_linkState == MQTT_LINK_CONNECTED) {
+      DEBUG_PRINTLN("⚠ MQTT connection lost with WiFi");
+      _mqttClient.disconnect();
+    } else if (_linkState == MQTT_LINK_CONNECTING) {
+      _wifiClient.stop();
+    }
+    _linkState = MQTT_LINK_WAIT_NETWORK;
+  }
+}
+
 bool MQTTHandler::subscribe(const char* topic) {
   if (!isConnected()) {
     return false;
@@ -260,6 +889,22 @@ bool MQTTHandler::subscribe(const char* topic) {
   return result;
 }
 
+MQTTLinkState MQTTHandler::getLinkState() const {
+  return _linkState;
+}
+
+unsigned long MQTTHandler::getConnectAttempts() const {
+  return _connectAttempts;
+}
+
+void MQTTHandler::scheduleRetry() {
+  unsigned long delayMs = _backoff.next();
+  _nextAttemptAt = TimeSync::monotonicMillis() + delayMs;
+  _linkState = MQTT_LINK_BACKOFF;
+  
+  DEBUG_PRINTF("MQTT retry in %lu ms\n", delayMs);
+}
+
 int MQTTHandler::getState() {
   return _mqttClient.state();
 }
@@ -272,6 +917,14 @@ unsigned long MQTTHandler::getReceiveCount() const {
   return _receiveCount;
 }
 
+unsigned long MQTTHandler::getSuppressedStatusCount() const {
+  return _statusSuppressed;
+}
+
+unsigned long MQTTHandler::getSessionCount() const {
+  return _sessionCount;
+}
+
 String MQTTHandler::generateClientId() {
   return "ESP32Parking-" + String(random(0xffff), HEX);
 }
@@ -288,18 +941,12 @@ void MQTTHandler::handleMessage(char* topic, byte* payload, unsigned int length)
   DEBUG_PRINT("MQTT message received on topic: ");
   DEBUG_PRINTLN(topic);
   
-  // Convert payload to string
-  String message = "";
-  for (unsigned int i = 0; i < length; i++) {
-    message += (char)payload[i];
-  }
-  
-  DEBUG_PRINT("Payload: ");
-  DEBUG_PRINTLN(message);
+  DEBUG_PRINTF("Payload: %.*s\n", (int)length, (const char*)payload);
   
-  // Parse JSON
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, message);
+  // Parse straight from PubSubClient's buffer into the fixed arena
+  _rxArena.reset();
+  JsonDocument doc(&_rxArena);
+  DeserializationError error = deserializeJson(doc, (const char*)payload, length);
   
   if (error) {
     DEBUG_PRINT("✗ JSON parse error: ");
@@ -1,7 +1,14 @@
 /**
  * @file MQTTHandler.h
  * @brief MQTT client with JSON message handling
- * @details Manages MQTT connection, publishes events, subscribes to commands
+ * @details Manages MQTT connection, publishes events, subscribes to commands.
+ *          Messages are built and parsed in fixed arenas and serialized into
+ *          a static buffer, so publishing and receiving never allocate.
+ *          Entry/exit events are sent as JSON or, with MQTT_EVENT_ENCODING
+ *          set to EVENT_ENCODING_MSGPACK, as compact MessagePack on the
+ *          parking/v2 event topics. Events waiting together are coalesced
+ *          into one batch message and status updates only carry the fields
+ *          that changed, since broker message count is what costs money.
  */
 
 #ifndef MQTTHANDLER_H
@@ -10,8 +17,54 @@
 #include <Arduino.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
-#include <WiFiClientSecure.h>
+#include <WiFi.h>
 #include "../Config.h"
+#include "../BrokerClient/BrokerClient.h"
+#include "../CardUid/CardUid.h"
+#include "../EventOutbox/EventOutbox.h"
+#include "../JsonArena/JsonArena.h"
+#include "../TimeSync/TimeSync.h"
+#include "../LatencyTracer/LatencyTracer.h"
+#include "../RetryBackoff/RetryBackoff.h"
+#include "../HealthMonitor/HealthMonitor.h"
+#include "../BenchmarkRunner/BenchmarkRunner.h"
+
+/**
+ * @struct StatusSnapshot
+ * @brief Status values last published, for change detection
+ */
+struct StatusSnapshot {
+  int totalSlots;           ///< Total number of slots
+  int availableSlots;       ///< Available slots
+  int authorizedCards;      ///< Cards in the whitelist
+  bool emergencyMode;       ///< Emergency mode status
+  int rssi;                 ///< WiFi RSSI last reported
+  uint32_t outboxPending;   ///< Outbox events not yet published
+  uint32_t outboxStored;    ///< Of which held in flash
+  uint32_t outboxDropped;   ///< Outbox events lost
+  uint32_t firstGateOpenMs; ///< Boot timing: first barrier opening
+};
+
+/**
+ * @struct BootTiming
+ * @brief Milestones of this boot, monotonic ms (0 = not reached yet)
+ */
+struct BootTiming {
+  uint32_t readyMs;          ///< Gates accepting cards
+  uint32_t mqttMs;           ///< First broker session
+  uint32_t firstGateOpenMs;  ///< First barrier opening
+};
+
+/**
+ * @enum MQTTLinkState
+ * @brief Connection state machine driven by update()
+ */
+enum MQTTLinkState {
+  MQTT_LINK_WAIT_NETWORK,  ///< WiFi down; nothing to try
+  MQTT_LINK_BACKOFF,       ///< Waiting for the next connect attempt
+  MQTT_LINK_CONNECTING,    ///< Lookup / TLS handshake in progress; update() polls it
+  MQTT_LINK_CONNECTED      ///< Session up
+};
 
 // Forward declarations for callback
 class MQTTHandler;
@@ -25,7 +78,7 @@ typedef void (*MQTTCommandCallback)(const char* command, JsonDocument& doc);
  * @code
  * MQTTHandler mqtt;
  * mqtt.begin();
- * mqtt.publishEntry("0A1B2C3D", 5, "success");
+ * mqtt.publishEntry(cardUid, 5, "success", availableSlots, timestamp);
  * mqtt.setCommandCallback(myCommandHandler);
  * @endcode
  */
@@ -40,7 +93,7 @@ public:
    * @brief Initialize MQTT client
    * @param server MQTT broker address (nullptr = use Config.h default)
    * @param port MQTT broker port (0 = use Config.h default)
-   * @return true if connected, false otherwise
+   * @return true if connected, false otherwise (the attempt goes on in update())
    */
   bool begin(const char* server = nullptr, int port = 0);
 
@@ -52,16 +105,42 @@ public:
 
   /**
    * @brief Update MQTT client (call in loop)
-   * @details Handles reconnection and processes incoming messages
+   * @details Processes incoming messages and drives the reconnect state
+   *          machine. While backing off it only checks the schedule; while
+   *          connecting it advances the DNS lookup or TLS handshake by one
+   *          non-blocking step (see reconnect()). The first attempt after
+   *          WiFi comes back (see onNetworkLink()) or the session drops is
+   *          immediate; failures back off exponentially with jitter.
    */
   void update();
 
   /**
-   * @brief Attempt to reconnect to MQTT broker
-   * @return true if connected, false otherwise
+   * @brief Start a connection attempt to the MQTT broker now
+   * @details Returns at once: the DNS lookup (skipped while the cached
+   *          address is valid) and the TCP connect plus TLS handshake run
+   *          in later update() calls, each phase bounded by
+   *          MQTT_CONNECT_TIMEOUT. The handshake offers the TLS session of
+   *          the previous connection, so a reconnect after a WiFi blip
+   *          usually takes one round trip. Only the wait for CONNACK
+   *          blocks, for at most the socket timeout. Only the network task
+   *          calls it.
+   * @return true if connected, false while connecting or after a failure
+   *         (next attempt is scheduled)
    */
   bool reconnect();
 
+  /**
+   * @brief Get connection state
+   * @return Current link state
+   */
+  MQTTLinkState getLinkState() const;
+
+  /**
+   * @brief Get number of connect attempts since boot
+   * @return Attempt count
+   */
+  unsigned long getConnectAttempts() const;
+
   /**
    * @brief Publish entry event
    * @param cardUID Card UID
@@ -69,10 +148,13 @@ public:
    * @param status Status message ("success", "denied_full", etc.)
    * @param availableSlots Number of available slots
    * @param timestamp Unix timestamp
+   * @param bootId Outbox boot id (with sequence: backend dedupe key)
+   * @param sequence Outbox sequence number (0 = omit)
    * @return true if published successfully
    */
-  bool publishEntry(const String& cardUID, int slotId, const String& status,
-                   int availableSlots, unsigned long timestamp);
+  bool publishEntry(const CardUid& cardUID, int slotId, const char* status,
+                   int availableSlots, unsigned long timestamp,
+                   uint32_t bootId = 0, uint32_t sequence = 0);
 
   /**
    * @brief Publish exit event
@@ -82,24 +164,70 @@ public:
    * @param duration Parking duration in seconds
    * @param availableSlots Number of available slots
    * @param timestamp Unix timestamp
+   * @param bootId Outbox boot id (with sequence: backend dedupe key)
+   * @param sequence Outbox sequence number (0 = omit)
    * @return true if published successfully
    */
-  bool publishExit(const String& cardUID, int slotId, const String& status,
+  bool publishExit(const CardUid& cardUID, int slotId, const char* status,
                   unsigned long duration, int availableSlots, 
-                  unsigned long timestamp);
+                  unsigned long timestamp, uint32_t bootId = 0,
+                  uint32_t sequence = 0);
+
+  /**
+   * @brief Publish several outbox events, batched where possible
+   * @details Sends as many of the events as fit into one message on the
+   *          batch topic; a single event goes to its entry/exit topic.
+   * @param records Events, oldest first
+   * @param count Number of events
+   * @return Number of events published (0 on failure)
+   */
+  size_t publishEventBatch(const OutboxRecord* records, size_t count);
 
   /**
    * @brief Publish system status update
+   * @details Compared with the last published status: nothing is sent when
+   *          nothing changed, otherwise only the changed fields are sent,
+   *          flagged "partial". A full snapshot goes out after connecting,
+   *          every STATUS_FULL_INTERVAL, and when requested. Health counters
+   *          always change, so they go out with full snapshots, or at once
+   *          when the gate loop is slow or the heap runs low.
    * @param totalSlots Total number of slots
    * @param availableSlots Number of available slots
    * @param authorizedCards Number of authorized cards
    * @param emergencyMode Emergency mode status
    * @param rssi WiFi RSSI
    * @param uptime System uptime in seconds
-   * @return true if published successfully
+   * @param outbox Event outbox counters
+   * @param health Runtime health sample
+   * @param full Send every field regardless of changes
+   * @return true if published successfully or nothing needed sending
    */
   bool publishStatus(int totalSlots, int availableSlots, int authorizedCards,
-                    bool emergencyMode, int rssi, unsigned long uptime);
+                    bool emergencyMode, int rssi, unsigned long uptime,
+                    const OutboxStats& outbox, const HealthStats& health,
+                    bool full = false);
+
+  /**
+   * @brief Acknowledge a whitelist sync command
+   * @param version Whitelist version now applied
+   * @param status "applied", "incomplete", "current" or "resync"
+   * @param cardCount Cards in the whitelist
+   * @return true if published successfully
+   */
+  bool publishWhitelistAck(uint32_t version, const char* status, int cardCount);
+
+  /**
+   * @brief Publish per-stage latency percentiles (get_metrics)
+   * @return true if published successfully
+   */
+  bool publishMetrics();
+
+  /**
+   * @brief Publish benchmark mode results with the run's stage latencies
+   * @param results Results of the current or last run
+   * @return true if published successfully
+   */
+  bool publishBenchmark(const BenchmarkResults& results);
 
   /**
    * @brief Publish card scan event (scan mode)
@@ -108,9 +236,43 @@ public:
    * @param timestamp Unix timestamp
    * @return true if published successfully
    */
-  bool publishScanEvent(const String& cardUID, const String& gate, 
+  bool publishScanEvent(const CardUid& cardUID, const char* gate, 
                        unsigned long timestamp);
 
+  /**
+   * @brief Publish repeated refusals of one card folded by the deny cache
+   * @param cardUID Refused card UID
+   * @param gate Gate name ("entrance" or "exit")
+   * @param lane Lane index
+   * @param repeats Refusals after the one published as an entry event
+   * @param windowS Seconds from the first to the last refusal
+   * @param timestamp Unix timestamp the summary was made
+   * @return true if published successfully
+   */
+  bool publishDeniedSummary(const CardUid& cardUID, const char* gate, uint8_t lane,
+                            uint16_t repeats, unsigned long windowS,
+                            unsigned long timestamp);
+
+  /**
+   * @brief Acknowledge a command as soon as it was received
+   * @param commandId Correlation id the command carried
+   * @param command Command name (nullptr if unknown)
+   * @param status "accepted", "unknown_command" or "queue_full"
+   * @return true if published successfully
+   */
+  bool publishCommandAck(uint32_t commandId, const char* command, const char* status);
+
+  /**
+   * @brief Publish the outcome of an acknowledged command
+   * @param commandId Correlation id the command carried
+   * @param command Command name
+   * @param status "ok" or why the command failed
+   * @param timestamp Unix timestamp the command finished
+   * @return true if published successfully
+   */
+  bool publishCommandResult(uint32_t commandId, const char* command, const char* status,
+                            unsigned long timestamp);
+
   /**
    * @brief Publish custom JSON message
    * @param topic MQTT topic
@@ -119,12 +281,44 @@ public:
    */
   bool publishJSON(const char* topic, JsonDocument& doc);
 
+  /**
+   * @brief Publish a document encoded as MessagePack
+   * @param topic MQTT topic
+   * @param doc Document to publish
+   * @return true if published successfully
+   */
+  bool publishMsgPack(const char* topic, JsonDocument& doc);
+
   /**
    * @brief Set command callback function
    * @param callback Function to call when command received
    */
   void setCommandCallback(MQTTCommandCallback callback);
 
+  /**
+   * @brief Set the clock used to timestamp status messages
+   * @param clock Time service (nullptr = seconds since boot)
+   */
+  void setClock(const TimeSync* clock);
+
+  /**
+   * @brief Set the boot milestones reported in the status message
+   * @details The first broker connection is recorded here; the other
+   *          milestones come from the caller.
+   * @param readyMs Monotonic ms when the gates were ready
+   * @param firstGateOpenMs Monotonic ms of the first opening (0 = none yet)
+   */
+  void setBootTiming(uint32_t readyMs, uint32_t firstGateOpenMs);
+
+  /**
+   * @brief NetworkManager link listener
+   * @details Register with NetworkManager::addLinkListener(). A new IP
+   *          triggers an immediate connect attempt; a lost link drops the
+   *          session at once. Runs in the task that calls both update()s.
+   * @param linkUp true when WiFi obtained an IP, false when it dropped
+   */
+  static void onNetworkLink(bool linkUp);
+
   /**
    * @brief Subscribe to additional topic
    * @param topic Topic to subscribe to
@@ -150,16 +344,67 @@ public:
    */
   unsigned long getReceiveCount() const;
 
+  /**
+   * @brief Get number of status updates skipped because nothing changed
+   * @return Suppressed update count
+   */
+  unsigned long getSuppressedStatusCount() const;
+
+  /**
+   * @brief Get number of broker sessions established since boot
+   * @return Session count
+   */
+  unsigned long getSessionCount() const;
+
 private:
-  WiFiClientSecure _wifiClient;     ///< Secure WiFi client for MQTT (TLS/SSL)
+  BrokerClient _wifiClient;         ///< Secure WiFi client for MQTT (TLS/SSL, resumes sessions)
   PubSubClient _mqttClient;         ///< MQTT client instance
   String _server;                   ///< MQTT broker address
   int _port;                        ///< MQTT broker port
   String _clientId;                 ///< MQTT client ID
   MQTTCommandCallback _commandCallback;  ///< Command callback function
-  unsigned long _lastReconnectAttempt;   ///< Last reconnect attempt time
+  const TimeSync* _clock;           ///< Wall-clock source for status messages
+  bool _networkUp;                  ///< WiFi link state from NetworkManager
+  MQTTLinkState _linkState;         ///< Reconnect state machine
+  uint64_t _nextAttemptAt;          ///< Earliest monotonic ms of the next attempt
+  RetryBackoff _backoff;            ///< Delay before the next attempt
+  unsigned long _connectAttempts;   ///< Connect attempts since boot
+  unsigned long _sessionCount;      ///< Successful connects since boot
   unsigned long _publishCount;      ///< Number of published messages
   unsigned long _receiveCount;      ///< Number of received messages
+  alignas(8) uint8_t _txArenaBuffer[JSON_TX_ARENA_SIZE];  ///< Storage for outgoing documents
+  alignas(8) uint8_t _rxArenaBuffer[JSON_RX_ARENA_SIZE];  ///< Storage for incoming documents
+  JsonArena _txArena;               ///< Allocator for outgoing documents
+  JsonArena _rxArena;               ///< Allocator for incoming documents
+  char _txBuffer[MQTT_BUFFER_SIZE]; ///< Serialized outgoing payload
+  StatusSnapshot _lastStatus;       ///< Status values last published
+  bool _statusSent;                 ///< _lastStatus is valid for this session
+  uint64_t _lastFullStatus;         ///< Monotonic ms of the last full snapshot
+  unsigned long _statusSuppressed;  ///< Status updates skipped (no change)
+  BootTiming _boot;                 ///< Boot milestones for the status message
+
+  /**
+   * @brief Advance the current attempt; send CONNECT once TLS is up
+   * @return true if the MQTT session is up
+   */
+  bool finishConnect();
+
+  /**
+   * @brief Schedule the next attempt after a failure
+   */
+  void scheduleRetry();
+
+  /**
+   * @brief Add one object per traced stage with samples
+   * @param stages Object to fill
+   */
+  void addLatencyStats(JsonObject stages);
+
+  /**
+   * @brief React to a WiFi link change
+   * @param linkUp New link state
+   */
+  void handleNetworkLink(bool linkUp);
 
   /**
    * @brief Generate unique client ID
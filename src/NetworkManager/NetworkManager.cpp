@@ -5,18 +5,41 @@
 
 #include "NetworkManager.h"
 
-NetworkManager::NetworkManager() 
+// Event group bits
+static const EventBits_t NET_BIT_LINK_UP = BIT0;       ///< Level: have an IP
+static const EventBits_t NET_BIT_GOT_IP = BIT1;        ///< Edge: IP obtained
+static const EventBits_t NET_BIT_DISCONNECTED = BIT2;  ///< Edge: link dropped
+
+// Disconnect reason the driver reports when WiFi.begin() leaves the old AP
+static const uint8_t WIFI_REASON_SELF_LEAVE = 8;
+
+static_assert(sizeof(WiFiLinkCache) == 24, "WiFiLinkCache layout changed; cached links would be misread");
+  
+// Initialize static instance pointer
+NetworkManager* NetworkManager::_instance = nullptr;
+
+NetworkManager::NetworkManager()
   : _ssid(WIFI_SSID),
     _password(WIFI_PASSWORD),
     _autoReconnect(true),
-    _lastCheckTime(0),
+    _events(nullptr),
+    _linkState(WIFI_LINK_DOWN),
+    _attemptStart(0),
+    _nextAttemptAt(0),
+    _backoff(WIFI_BACKOFF_MIN, WIFI_BACKOFF_MAX),
     _connectionTime(0),
     _reconnectCount(0),
-    _wasConnected(false) {
+    _disconnectReason(0),
+    _listenerCount(0),
+    _cacheStore(WIFI_NVS_NAMESPACE, sizeof(WiFiLinkCache)),
+    _cacheValid(false),
+    _useCache(false) {
+  
+  // Set static instance pointer for callback
+  _instance = this;
 }
 
-bool NetworkManager::begin(const char* ssid, const char* password, 
-                          unsigned long timeout) {
+bool NetworkManager::begin(const char* ssid, const char* password) {
   // Use provided credentials or defaults from Config.h
   if (ssid != nullptr) {
     _ssid = String(ssid);
@@ -25,16 +48,43 @@ bool NetworkManager::begin(const char* ssid, const char* password,
     _password = String(password);
   }
   
-  DEBUG_PRINT("Connecting to WiFi: ");
-  DEBUG_PRINTLN(_ssid);
+  if (_events == nullptr) {
+    _events = xEventGroupCreate();
+    if (_events == nullptr) {
+      DEBUG_PRINTLN("✗ WiFi: failed to create event group");
+      return false;
+    }
+    WiFi.onEvent(onWiFiEvent);
+  }
   
+#if WIFI_CACHE_LINK
+  _cacheValid = _cacheStore.begin() && _cacheStore.readRecord(0, &_cache);
+  _useCache = _cacheValid;
+#endif
+  
+  // The driver's own flash copy of the config is not needed and costs a write
+  WiFi.persistent(false);
   WiFi.mode(WIFI_STA);
   
-  return connect(timeout);
+  // Retries are ours (with backoff); the driver must not race them
+  WiFi.setAutoReconnect(false);
+  
+  startAttempt();
+  return true;
+}
+
+bool NetworkManager::waitForConnection(unsigned long timeout) {
+  if (_events == nullptr) {
+    return false;
+  }
+  
+  EventBits_t bits = xEventGroupWaitBits(_events, NET_BIT_LINK_UP, pdFALSE, pdTRUE,
+                                         pdMS_TO_TICKS(timeout));
+  return (bits & NET_BIT_LINK_UP) != 0;
 }
 
 bool NetworkManager::isConnected() const {
-  return (WiFi.status() == WL_CONNECTED);
+  return _events != nullptr && (xEventGroupGetBits(_events) & NET_BIT_LINK_UP) != 0;
 }
 
 int NetworkManager::getRSSI() const {
@@ -63,56 +113,135 @@ String NetworkManager::getSSID() const {
 }
 
 void NetworkManager::disconnect() {
+  bool wasUp = (_linkState == WIFI_LINK_UP);
+  _linkState = WIFI_LINK_DOWN;
   WiFi.disconnect();
   DEBUG_PRINTLN("WiFi disconnected");
+  
+  if (wasUp) {
+    notifyListeners(false);
+  }
 }
 
-bool NetworkManager::reconnect(unsigned long timeout) {
+void NetworkManager::reconnect() {
   DEBUG_PRINTLN("Attempting WiFi reconnection...");
   
-  disconnect();
-  delay(100);
-  
-  bool success = connect(timeout);
-  
-  if (success) {
-    _reconnectCount++;
+  if (_linkState == WIFI_LINK_UP) {
+    notifyListeners(false);
   }
   
-  return success;
+  _backoff.reset();
+  _reconnectCount++;
+  startAttempt();
 }
 
 void NetworkManager::update() {
-  unsigned long currentTime = millis();
-  
-  // Check connection status periodically
-  if (currentTime - _lastCheckTime >= WIFI_CHECK_INTERVAL) {
-    _lastCheckTime = currentTime;
-    
-    bool currentlyConnected = isConnected();
-    
-    // Connection lost
-    if (_wasConnected && !currentlyConnected) {
-      DEBUG_PRINTLN("⚠ WiFi connection lost");
-      
+  if (_events == nullptr) {
+    return;
+  }
+  
+  // Take the edges first, then read the level they left behind
+  EventBits_t edges = xEventGroupClearBits(_events, NET_BIT_GOT_IP | NET_BIT_DISCONNECTED);
+  bool linkUp = (xEventGroupGetBits(_events) & NET_BIT_LINK_UP) != 0;
+  uint64_t now = TimeSync::monotonicMillis();
+  
+  if (edges & NET_BIT_DISCONNECTED) {
+    if (_linkState == WIFI_LINK_UP) {
+      DEBUG_PRINTF("⚠ WiFi connection lost (reason %u)\n", _disconnectReason);
+      notifyListeners(false);
+  
+      // Retry right away: most drops are a brief AP blip
       if (_autoReconnect) {
-        reconnect(10000);
+        _linkState = WIFI_LINK_BACKOFF;
+        _backoff.reset();
+        _nextAttemptAt = now;
+      } else {
+        _linkState = WIFI_LINK_DOWN;
+      }
+    } else if (_linkState == WIFI_LINK_CONNECTING &&
+               _disconnectReason != WIFI_REASON_SELF_LEAVE) {
+      DEBUG_PRINTF("✗ WiFi connection failed (reason %u)\n", _disconnectReason);
+      if (_useCache) {
+        // The AP may have moved channel or been replaced: scan right away
+        DEBUG_PRINTLN("⚠ Cached WiFi link failed, scanning");
+        _useCache = false;
+        _linkState = WIFI_LINK_BACKOFF;
+        _nextAttemptAt = now;
+      } else if (_autoReconnect) {
+        scheduleRetry();
+      } else {
+        _linkState = WIFI_LINK_DOWN;
       }
     }
-    
-    // Connection established
-    if (!_wasConnected && currentlyConnected) {
-      DEBUG_PRINTLN("✓ WiFi connection established");
-      _connectionTime = currentTime;
-    }
-    
-    _wasConnected = currentlyConnected;
+  }
+  
+  if ((edges & NET_BIT_GOT_IP) && linkUp && _linkState != WIFI_LINK_UP) {
+    _linkState = WIFI_LINK_UP;
+    _backoff.reset();
+    _connectionTime = now;
+  
+    DEBUG_PRINTF("✓ WiFi connected in %lu ms\n", (unsigned long)(now - _attemptStart));
+    DEBUG_PRINT("✓ IP Address: ");
+    DEBUG_PRINTLN(WiFi.localIP());
+    DEBUG_PRINT("✓ RSSI: ");
+    DEBUG_PRINT(WiFi.RSSI());
+    DEBUG_PRINTLN(" dBm");
+  
+#if WIFI_CACHE_LINK
+    saveLinkCache();
+#endif
+    notifyListeners(true);
+  }
+  
+  switch (_linkState) {
+    case WIFI_LINK_CONNECTING:
+      if (now - _attemptStart >= WIFI_CONNECT_TIMEOUT) {
+        DEBUG_PRINTLN("✗ WiFi connection timed out");
+        WiFi.disconnect();
+        if (_useCache) {
+          _useCache = false;
+          _linkState = WIFI_LINK_BACKOFF;
+          _nextAttemptAt = now;
+        } else {
+          scheduleRetry();
+        }
+      }
+      break;
+  
+    case WIFI_LINK_BACKOFF:
+      if (now >= _nextAttemptAt) {
+        _reconnectCount++;
+        startAttempt();
+      }
+      break;
+  
+    case WIFI_LINK_DOWN:
+    case WIFI_LINK_UP:
+      break;
   }
 }
 
+bool NetworkManager::addLinkListener(NetworkLinkCallback callback) {
+  if (callback == nullptr || _listenerCount >= NETWORK_MAX_LISTENERS) {
+    return false;
+  }
+  
+  _listeners[_listenerCount++] = callback;
+  return true;
+}
+
+WiFiLinkState NetworkManager::getLinkState() const {
+  return _linkState;
+}
+
 void NetworkManager::setAutoReconnect(bool enable) {
   _autoReconnect = enable;
   DEBUG_PRINTF("Auto-reconnect %s\n", enable ? "enabled" : "disabled");
+  
+  if (enable && _linkState == WIFI_LINK_DOWN && _events != nullptr) {
+    _linkState = WIFI_LINK_BACKOFF;
+    _nextAttemptAt = TimeSync::monotonicMillis();
+  }
 }
 
 bool NetworkManager::isAutoReconnectEnabled() const {
@@ -120,53 +249,106 @@ bool NetworkManager::isAutoReconnectEnabled() const {
 }
 
 unsigned long NetworkManager::getConnectionUptime() const {
-  if (!isConnected() || _connectionTime == 0) {
+  if (_linkState != WIFI_LINK_UP) {
     return 0;
   }
-  return (millis() - _connectionTime) / 1000;
+  return (unsigned long)((TimeSync::monotonicMillis() - _connectionTime) / 1000);
 }
 
 int NetworkManager::getReconnectCount() const {
   return _reconnectCount;
 }
 
-bool NetworkManager::connect(unsigned long timeout) {
-  WiFi.begin(_ssid.c_str(), _password.c_str());
+uint8_t NetworkManager::getLastDisconnectReason() const {
+  return _disconnectReason;
+}
+
+void NetworkManager::onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  NetworkManager* self = _instance;
+  if (self == nullptr || self->_events == nullptr) {
+    return;
+  }
+  
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      xEventGroupSetBits(self->_events, NET_BIT_LINK_UP | NET_BIT_GOT_IP);
+      break;
   
-  unsigned long startTime = millis();
-  int attempts = 0;
-  
-  while (WiFi.status() != WL_CONNECTED && 
-         (millis() - startTime) < timeout) {
-    delay(500);
-    DEBUG_PRINT(".");
-    attempts++;
-    
-    // Give up after reasonable attempts
-    if (attempts > timeout / 500) {
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      self->_disconnectReason = info.wifi_sta_disconnected.reason;
+      xEventGroupClearBits(self->_events, NET_BIT_LINK_UP);
+      xEventGroupSetBits(self->_events, NET_BIT_DISCONNECTED);
       break;
+  
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      // Usually follows a disconnect that was already reported
+      if (xEventGroupClearBits(self->_events, NET_BIT_LINK_UP) & NET_BIT_LINK_UP) {
+        xEventGroupSetBits(self->_events, NET_BIT_DISCONNECTED);
+      }
+      break;
+  
+    default:
+      break;
+  }
+}
+
+void NetworkManager::startAttempt() {
+  DEBUG_PRINT("Connecting to WiFi: ");
+  DEBUG_PRINTLN(_ssid);
+  
+  _linkState = WIFI_LINK_CONNECTING;
+  _attemptStart = TimeSync::monotonicMillis();
+  
+  if (_useCache) {
+#if WIFI_CACHE_STATIC_IP
+    // Skip DHCP as well as the scan
+    if (_cache.ip != 0) {
+      WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway),
+                  IPAddress(_cache.subnet), IPAddress(_cache.dns));
     }
+#endif
+    WiFi.begin(_ssid.c_str(), _password.c_str(), _cache.channel, _cache.bssid);
+    return;
   }
   
-  if (WiFi.status() == WL_CONNECTED) {
-    DEBUG_PRINTLN();
-    DEBUG_PRINTLN("✓ WiFi connected");
-    DEBUG_PRINT("✓ IP Address: ");
-    DEBUG_PRINTLN(WiFi.localIP());
-    DEBUG_PRINT("✓ RSSI: ");
-    DEBUG_PRINT(WiFi.RSSI());
-    DEBUG_PRINTLN(" dBm");
-    
-    _connectionTime = millis();
-    _wasConnected = true;
-    
-    return true;
-  } else {
-    DEBUG_PRINTLN();
-    DEBUG_PRINTLN("✗ WiFi connection failed");
-    DEBUG_PRINT("✗ Status: ");
-    DEBUG_PRINTLN(WiFi.status());
-    
-    return false;
+#if WIFI_CACHE_STATIC_IP
+  // Back to DHCP after a failed cached attempt
+  WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+#endif
+  WiFi.begin(_ssid.c_str(), _password.c_str());
+}
+  
+void NetworkManager::saveLinkCache() {
+  WiFiLinkCache current;
+  memset(&current, 0, sizeof(current));
+  memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+  current.channel = WiFi.channel();
+  current.ip = (uint32_t)WiFi.localIP();
+  current.gateway = (uint32_t)WiFi.gatewayIP();
+  current.subnet = (uint32_t)WiFi.subnetMask();
+  current.dns = (uint32_t)WiFi.dnsIP(0);
+  
+  // Reconnects to the same AP are the common case; spare the flash
+  if (!_cacheValid || memcmp(&current, &_cache, sizeof(current)) != 0) {
+    _cache = current;
+    _cacheValid = _cacheStore.writeRecord(0, &_cache);
+    DEBUG_PRINTF("✓ WiFi link cached (channel %u)\n", current.channel);
+  }
+  
+  // The next reconnect goes straight back to this AP
+  _useCache = _cacheValid;
+}
+
+void NetworkManager::scheduleRetry() {
+  unsigned long delayMs = _backoff.next();
+  _nextAttemptAt = TimeSync::monotonicMillis() + delayMs;
+  _linkState = WIFI_LINK_BACKOFF;
+  
+  DEBUG_PRINTF("WiFi retry in %lu ms\n", delayMs);
+}
+
+void NetworkManager::notifyListeners(bool linkUp) {
+  for (uint8_t i = 0; i < _listenerCount; i++) {
+    _listeners[i](linkUp);
   }
 }
@@ -1,7 +1,12 @@
 /**
  * @file NetworkManager.h
  * @brief WiFi connection and network management
- * @details Handles WiFi connection, reconnection logic, and status monitoring
+ * @details Handles WiFi connection, reconnection logic, and status monitoring.
+ *          Connection progress arrives through WiFi.onEvent(); update() runs
+ *          a non-blocking state machine that retries with exponential
+ *          backoff and tells subscribers when the link goes up or down.
+ *          The last AP's BSSID/channel (and optionally the IP lease) are
+ *          cached in NVS so the next boot can join without scanning.
  */
 
 #ifndef NETWORKMANAGER_H
@@ -9,18 +14,60 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 #include "../Config.h"
+#include "../TimeSync/TimeSync.h"
+#include "../RecordStore/RecordStore.h"
+#include "../RetryBackoff/RetryBackoff.h"
+
+/**
+ * @enum WiFiLinkState
+ * @brief Connection state machine driven by update()
+ */
+enum WiFiLinkState {
+  WIFI_LINK_DOWN,        ///< Not connected and not retrying (auto-reconnect off)
+  WIFI_LINK_CONNECTING,  ///< Association/DHCP in progress
+  WIFI_LINK_BACKOFF,     ///< Waiting for the next attempt
+  WIFI_LINK_UP           ///< Connected with an IP address
+};
+
+/**
+ * @struct WiFiLinkCache
+ * @brief Parameters of the last successful connection (NVS record, 24 bytes)
+ */
+struct WiFiLinkCache {
+  uint8_t bssid[6];       ///< Access point BSSID
+  uint8_t channel;        ///< Access point channel
+  uint8_t reserved;       ///< Padding, always 0
+  uint32_t ip;            ///< Leased address
+  uint32_t gateway;       ///< Gateway address
+  uint32_t subnet;        ///< Subnet mask
+  uint32_t dns;           ///< Primary DNS server
+};
+
+/**
+ * @brief Link state change callback, called from NetworkManager::update()
+ * @param linkUp true when an IP was obtained, false when the link dropped
+ */
+typedef void (*NetworkLinkCallback)(bool linkUp);
 
 /**
  * @class NetworkManager
  * @brief Manages WiFi connection and network status
- * 
+ *
+ * The WiFi event handler runs in the system event task and only sets
+ * event-group bits; state changes and listener calls happen in whichever
+ * task calls update(), so listeners need no locking of their own.
+ *
  * Example usage:
  * @code
  * NetworkManager network;
+ * network.addLinkListener(onLinkChange);
  * network.begin();
- * if (network.isConnected()) {
- *   String ip = network.getIPAddress();
+ *
+ * void loop() {
+ *   network.update();   // never blocks
  * }
  * @endcode
  */
@@ -32,19 +79,24 @@ public:
   NetworkManager();
 
   /**
-   * @brief Initialize and connect to WiFi
+   * @brief Start connecting to WiFi in the background
    * @param ssid WiFi SSID (nullptr = use Config.h default)
    * @param password WiFi password (nullptr = use Config.h default)
-   * @param timeout Connection timeout in milliseconds
-   * @return true if connected, false otherwise
+   * @return true if the first attempt was started
+   */
+  bool begin(const char* ssid = nullptr,
+             const char* password = nullptr);
+
+  /**
+   * @brief Wait until connected (for boot code only; blocks the caller)
+   * @param timeout Maximum wait in milliseconds
+   * @return true if connected, false on timeout
    */
-  bool begin(const char* ssid = nullptr, 
-             const char* password = nullptr,
-             unsigned long timeout = 15000);
+  bool waitForConnection(unsigned long timeout);
 
   /**
    * @brief Check if WiFi is connected
-   * @return true if connected, false otherwise
+   * @return true if connected with an IP address, false otherwise
    */
   bool isConnected() const;
 
@@ -73,23 +125,35 @@ public:
   String getSSID() const;
 
   /**
-   * @brief Disconnect from WiFi
+   * @brief Disconnect from WiFi (no automatic reconnect until reconnect())
    */
   void disconnect();
 
   /**
-   * @brief Attempt to reconnect to WiFi
-   * @param timeout Timeout in milliseconds
-   * @return true if reconnected, false otherwise
+   * @brief Start a new connection attempt now, skipping any backoff
    */
-  bool reconnect(unsigned long timeout = 10000);
+  void reconnect();
 
   /**
    * @brief Update network status (call periodically in loop)
-   * @details Automatically reconnects if connection lost
+   * @details Applies pending WiFi events, notifies listeners, and starts
+   *          the next attempt when the backoff expires. Never waits.
    */
   void update();
 
+  /**
+   * @brief Subscribe to link state changes
+   * @param callback Function called from update() on every change
+   * @return true if added, false if NETWORK_MAX_LISTENERS are registered
+   */
+  bool addLinkListener(NetworkLinkCallback callback);
+
+  /**
+   * @brief Get connection state
+   * @return Current link state
+   */
+  WiFiLinkState getLinkState() const;
+
   /**
    * @brief Set auto-reconnect behavior
    * @param enable true to enable auto-reconnect, false to disable
@@ -114,21 +178,60 @@ public:
    */
   int getReconnectCount() const;
 
+  /**
+   * @brief Get the reason code of the last disconnect
+   * @return wifi_err_reason_t value, or 0 if never disconnected
+   */
+  uint8_t getLastDisconnectReason() const;
+
 private:
+  static NetworkManager* _instance;  ///< Receiver of WiFi events
+
   String _ssid;                      ///< Stored SSID
   String _password;                  ///< Stored password
   bool _autoReconnect;               ///< Auto-reconnect enabled
-  unsigned long _lastCheckTime;      ///< Last connection check time
-  unsigned long _connectionTime;     ///< Time of last successful connection
+  EventGroupHandle_t _events;        ///< Bits set by the WiFi event handler
+  WiFiLinkState _linkState;          ///< Reconnect state machine
+  uint64_t _attemptStart;            ///< Monotonic ms the current attempt began
+  uint64_t _nextAttemptAt;           ///< Monotonic ms of the next attempt
+  RetryBackoff _backoff;             ///< Delay before the next attempt
+  uint64_t _connectionTime;          ///< Monotonic ms of last successful connection
   int _reconnectCount;               ///< Number of reconnection attempts
-  bool _wasConnected;                ///< Previous connection state
+  volatile uint8_t _disconnectReason;  ///< Reason of the last disconnect event
+  NetworkLinkCallback _listeners[NETWORK_MAX_LISTENERS];  ///< Link subscribers
+  uint8_t _listenerCount;            ///< Registered listeners
+  RecordStore _cacheStore;           ///< NVS home of _cache
+  WiFiLinkCache _cache;              ///< Last successful link parameters
+  bool _cacheValid;                  ///< _cache was loaded or saved
+  bool _useCache;                    ///< Next attempt uses _cache
+
+  /**
+   * @brief WiFi event handler (runs in the system event task)
+   * @param event Event id
+   * @param info Event payload
+   */
+  static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+
+  /**
+   * @brief Start an association attempt (returns immediately)
+   */
+  void startAttempt();
+
+  /**
+   * @brief Schedule the next attempt after a failure
+   */
+  void scheduleRetry();
+
+  /**
+   * @brief Store the current link parameters if they changed
+   */
+  void saveLinkCache();
 
   /**
-   * @brief Connect to WiFi (internal)
-   * @param timeout Timeout in milliseconds
-   * @return true if connected, false otherwise
+   * @brief Call every listener
+   * @param linkUp New link state
    */
-  bool connect(unsigned long timeout);
+  void notifyListeners(bool linkUp);
 };
 
 #endif // NETWORKMANAGER_H
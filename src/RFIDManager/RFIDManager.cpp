@@ -5,87 +5,187 @@
 
 #include "RFIDManager.h"
 
+static_assert((RFID_INDEX_SIZE & (RFID_INDEX_SIZE - 1)) == 0,
+              "RFID_INDEX_SIZE must be a power of two");
+static_assert(RFID_INDEX_SIZE >= 2 * MAX_RFID_CARDS,
+              "RFID_INDEX_SIZE must keep the load factor at or below 0.5");
+static_assert(LANE_COUNT >= 1 && LANE_COUNT <= MAX_LANES,
+              "LANE_COUNT must be between 1 and MAX_LANES");
+static_assert(2 * MAX_RFID_CARDS < 0x8000,
+              "Record and staging indexes must leave the top bit of a name reference free");
+static_assert(WHITELIST_PENDING_NAMES >= DEFAULT_CARD_COUNT,
+              "WHITELIST_PENDING_NAMES must hold the default cards");
+static_assert(sizeof(RFIDCard) == 48, "RFIDCard layout changed; stored whitelists would be misread");
+static_assert(sizeof(LegacyCard) == 60, "LegacyCard must match the EEPROM image of earlier firmware");
+static_assert(sizeof(EEPROMData) <= EEPROM_SIZE, "Legacy EEPROM image does not fit EEPROM_SIZE");
+
 RFIDManager::RFIDManager() 
-  : _rfidEntrance(RFID_IN_SS, RFID_IN_RST),
-    _rfidExit(RFID_OUT_SS, RFID_OUT_RST),
+  : _readerCount(0),
     _numCards(0),
-    _initialized(false) {
+    _initialized(false),
+    _store(WHITELIST_NVS_NAMESPACE, sizeof(RFIDCard)),
+    _storedCount(0),
+    _inTransaction(false),
+    _spilledNames(0),
+    _version(0),
+    _revision(0) {
+  memset(_pendingNames, 0, sizeof(_pendingNames));
+  rebuildIndex();
+  
+  // PCD_Init() leaves the antenna on
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    _pollingEnabled[lane] = true;
+    _injected[lane].clear();
+  }
+}
+
+bool RFIDManager::addReader(uint8_t ssPin, uint8_t rstPin) {
+  if (_readerCount >= LANE_COUNT) {
+    DEBUG_PRINTLN("✗ No room for another RFID reader");
+    return false;
+  }
+  
+  _readerPins[_readerCount][0] = ssPin;
+  _readerPins[_readerCount][1] = rstPin;
+  _readerCount++;
+  return true;
+}
+
+uint8_t RFIDManager::getReaderCount() const {
+  return _readerCount;
 }
 
 bool RFIDManager::begin() {
-  // Initialize EEPROM
-  EEPROM.begin(EEPROM_SIZE);
-  initializeEEPROM();
+  // PSRAM is only usable from here on, not at static initialisation
+  _cards.allocate();
   
-  // Initialize SPI bus (shared between two readers)
+  // Open per-record whitelist storage and load it
+  bool loaded = _store.begin();
+  if (loaded) {
+    initializeStorage();
+  }
+  
+  // Initialize SPI bus (shared by all readers)
   SPI.begin();
   
-  // Initialize RFID readers
-  _rfidEntrance.PCD_Init();
-  _rfidExit.PCD_Init();
+  // Deselect every reader first so none answers while another is set up
+  for (uint8_t lane = 0; lane < _readerCount; lane++) {
+    pinMode(_readerPins[lane][0], OUTPUT);
+    digitalWrite(_readerPins[lane][0], HIGH);
+  }
   
-  // Load whitelist from EEPROM
-  bool loaded = loadFromEEPROM();
+  // Initialize RFID readers
+  for (uint8_t lane = 0; lane < _readerCount; lane++) {
+    _readers[lane].PCD_Init(_readerPins[lane][0], _readerPins[lane][1]);
+  }
   
   _initialized = true;
-  DEBUG_PRINTLN("✓ RFID Manager initialized");
-  DEBUG_PRINTF("✓ Loaded %d authorized cards\n", _numCards);
+  DEBUG_PRINTF("✓ RFID Manager initialized (%u readers)\n", (unsigned)_readerCount);
+  DEBUG_PRINTF("✓ Loaded %d authorized cards (%u byte pool in %s)\n", _numCards,
+               (unsigned)_cards.bytes(), _cards.isInPsram() ? "PSRAM" : "internal RAM");
   
-  // Print card list
+  // Print card list (names stay in flash)
   for (int i = 0; i < _numCards; i++) {
-    DEBUG_PRINTF("  Card %d: %s (%s) - Level %d - %s\n", 
+    char uidHex[CARD_UID_HEX_SIZE];
+    _cards[i].uid.toHex(uidHex, sizeof(uidHex));
+    DEBUG_PRINTF("  Card %d: %s - Level %d - %s\n", 
                  i + 1, 
-                 _authorizedCards[i].uid,
-                 _authorizedCards[i].ownerName,
-                 _authorizedCards[i].accessLevel,
-                 _authorizedCards[i].isActive ? "Active" : "Inactive");
+                 uidHex,
+                 (int)_cards[i].level,
+                 _cards[i].active ? "Active" : "Inactive");
   }
   
   return loaded;
 }
 
-String RFIDManager::readCard(GateType gate) {
-  MFRC522* reader = (gate == GATE_ENTRANCE) ? &_rfidEntrance : &_rfidExit;
+bool RFIDManager::readCard(uint8_t lane, CardUid& uid) {
+  uid.clear();
+  
+  if (lane >= _readerCount || !_pollingEnabled[lane]) {
+    return false;
+  }
+  
+  if (!_injected[lane].isEmpty()) {
+    uid = _injected[lane];
+    _injected[lane].clear();
+    return true;
+  }
+  
+  MFRC522* reader = &_readers[lane];
+  uint64_t traceStart = LatencyTracer::now();
   
   // Check for new card
   if (!reader->PICC_IsNewCardPresent() || !reader->PICC_ReadCardSerial()) {
-    return "";
+    return false;
   }
   
-  // Build UID string
-  String uid = "";
-  for (byte i = 0; i < reader->uid.size; i++) {
-    if (reader->uid.uidByte[i] < 0x10) {
-      uid += "0";
-    }
-    uid += String(reader->uid.uidByte[i], HEX);
-  }
-  uid.toUpperCase();
+  // Copy raw UID bytes; hex formatting happens only where text is needed
+  uid.fromBytes(reader->uid.uidByte, reader->uid.size);
   
   // Halt card and stop encryption
   reader->PICC_HaltA();
   reader->PCD_StopCrypto1();
   
-  return uid;
+  // Only successful reads: empty polls would swamp the histogram
+  LatencyTracer::recordSince(TRACE_CARD_READ, traceStart);
+  return true;
 }
 
-bool RFIDManager::isAuthorized(const String& uid, int& accessLevel) const {
-  for (int i = 0; i < _numCards; i++) {
-    if (uid.equals(_authorizedCards[i].uid) && _authorizedCards[i].isActive) {
-      accessLevel = _authorizedCards[i].accessLevel;
-      return true;
-    }
+void RFIDManager::setPollingEnabled(uint8_t lane, bool enabled) {
+  if (lane >= _readerCount || _pollingEnabled[lane] == enabled) {
+    return;
+  }
+  
+  _pollingEnabled[lane] = enabled;
+  
+#if RFID_IDLE_ANTENNA_OFF
+  MFRC522* reader = &_readers[lane];
+  if (enabled) {
+    reader->PCD_AntennaOn();
+  } else {
+    reader->PCD_AntennaOff();
+  }
+#endif
+}
+
+bool RFIDManager::isPollingEnabled(uint8_t lane) const {
+  return lane < _readerCount && _pollingEnabled[lane];
+}
+
+void RFIDManager::injectCard(uint8_t lane, const CardUid& uid) {
+  if (lane < _readerCount) {
+    _injected[lane] = uid;
+  }
+}
+
+bool RFIDManager::isAuthorized(const CardUid& uid, int& accessLevel) const {
+  TraceScope trace(TRACE_AUTHORIZE);
+  int index = findCardIndex(uid);
+  if (index == -1 || !_cards[index].active) {
+    return false;
   }
-  return false;
+  
+  accessLevel = _cards[index].level;
+  return true;
 }
 
-bool RFIDManager::isAuthorized(const String& uid) const {
+bool RFIDManager::isAuthorized(const CardUid& uid) const {
   int accessLevel;
   return isAuthorized(uid, accessLevel);
 }
 
-bool RFIDManager::addCard(const String& uid, const String& ownerName, 
+bool RFIDManager::addCard(const CardUid& uid, const char* ownerName, 
                          int accessLevel) {
+  if (uid.isEmpty()) {
+    DEBUG_PRINTLN("Invalid card UID");
+    return false;
+  }
+  
+  if (accessLevel < 0 || accessLevel > 7) {
+    DEBUG_PRINTLN("Invalid access level");
+    return false;
+  }
+  
   // Check if card already exists
   if (findCardIndex(uid) != -1) {
     DEBUG_PRINTLN("Card already exists");
@@ -98,67 +198,142 @@ bool RFIDManager::addCard(const String& uid, const String& ownerName,
     return false;
   }
   
-  // Add new card
-  uid.toCharArray(_authorizedCards[_numCards].uid, 20);
-  ownerName.toCharArray(_authorizedCards[_numCards].ownerName, 32);
-  _authorizedCards[_numCards].accessLevel = accessLevel;
-  _authorizedCards[_numCards].isActive = true;
+  // Add new card; the name waits in RAM (or a staging record) until its
+  // record is written
+  CardEntry& card = _cards[_numCards];
+  card.name = _numCards;
+  if (!setName(card, ownerName)) {
+    DEBUG_PRINTLN("✗ No room to store the owner name");
+    return false;
+  }
+  card.uid = uid;
+  card.level = accessLevel;
+  card.active = true;
+  card.marked = 0;
   
+  indexCard(_numCards);
+  markDirty(_numCards);
   _numCards++;
   
-  DEBUG_PRINTF("✓ Added card: %s (%s)\n", uid.c_str(), ownerName.c_str());
+  char uidHex[CARD_UID_HEX_SIZE];
+  uid.toHex(uidHex, sizeof(uidHex));
+  DEBUG_PRINTF("✓ Added card: %s (%s)\n", uidHex, ownerName);
   
-  return saveToEEPROM();
+  return persist();
+}
+
+bool RFIDManager::upsertCard(const CardUid& uid, const char* ownerName,
+                             int accessLevel) {
+  if (findCardIndex(uid) != -1) {
+    return updateCard(uid, ownerName, accessLevel);
+  }
+  return addCard(uid, ownerName != nullptr ? ownerName : "Unknown", accessLevel);
 }
 
-bool RFIDManager::removeCard(const String& uid) {
+bool RFIDManager::removeCard(const CardUid& uid) {
   int index = findCardIndex(uid);
   if (index == -1) {
     return false;
   }
   
-  // Shift remaining cards
-  for (int i = index; i < _numCards - 1; i++) {
-    _authorizedCards[i] = _authorizedCards[i + 1];
+  removeAt(index);
+  rebuildIndex();
+  
+  char uidHex[CARD_UID_HEX_SIZE];
+  uid.toHex(uidHex, sizeof(uidHex));
+  DEBUG_PRINTF("✓ Removed card: %s\n", uidHex);
+  
+  return persist();
+}
+
+void RFIDManager::clearMarks() {
+  for (int i = 0; i < _numCards; i++) {
+    _cards[i].marked = 0;
+  }
+}
+
+bool RFIDManager::markCard(const CardUid& uid) {
+  int index = findCardIndex(uid);
+  if (index == -1) {
+    return false;
   }
   
-  _numCards--;
+  _cards[index].marked = 1;
+  return true;
+}
+
+int RFIDManager::removeUnmarked() {
+  // Walk backwards: the card moved into a gap comes from above, where
+  // every card has already been checked and kept
+  int removed = 0;
+  for (int i = _numCards - 1; i >= 0; i--) {
+    if (!_cards[i].marked) {
+      removeAt(i);
+      removed++;
+    }
+  }
   
-  DEBUG_PRINTF("✓ Removed card: %s\n", uid.c_str());
+  if (removed == 0) {
+    return 0;
+  }
   
-  return saveToEEPROM();
+  rebuildIndex();
+  DEBUG_PRINTF("✓ Removed %d unmarked cards\n", removed);
+  persist();
+  return removed;
 }
 
-bool RFIDManager::updateCard(const String& uid, const char* ownerName, 
+bool RFIDManager::updateCard(const CardUid& uid, const char* ownerName, 
                              int accessLevel) {
   int index = findCardIndex(uid);
-  if (index == -1) {
+  if (index == -1 || accessLevel > 7) {
     return false;
   }
   
   // Update owner name if provided
-  if (ownerName != nullptr) {
-    strncpy(_authorizedCards[index].ownerName, ownerName, 32);
-    _authorizedCards[index].ownerName[31] = '\0';
+  if (ownerName != nullptr && !setName(_cards[index], ownerName)) {
+    DEBUG_PRINTLN("✗ No room to store the owner name");
+    return false;
   }
   
   // Update access level if valid
   if (accessLevel >= 0) {
-    _authorizedCards[index].accessLevel = accessLevel;
+    _cards[index].level = accessLevel;
   }
   
-  DEBUG_PRINTF("✓ Updated card: %s\n", uid.c_str());
+  char uidHex[CARD_UID_HEX_SIZE];
+  uid.toHex(uidHex, sizeof(uidHex));
+  DEBUG_PRINTF("✓ Updated card: %s\n", uidHex);
   
-  return saveToEEPROM();
+  markDirty(index);
+  return persist();
 }
 
-bool RFIDManager::getCardInfo(const String& uid, RFIDCard& card) const {
+bool RFIDManager::getCardInfo(const CardUid& uid, RFIDCard& card) const {
   int index = findCardIndex(uid);
   if (index == -1) {
     return false;
   }
   
-  card = _authorizedCards[index];
+  toCard(_cards[index], card);
+  return true;
+}
+
+bool RFIDManager::getCardAt(int index, RFIDCard& card) const {
+  if (index < 0 || index >= _numCards) {
+    return false;
+  }
+  
+  toCard(_cards[index], card);
+  return true;
+}
+
+bool RFIDManager::getCardUidAt(int index, CardUid& uid) const {
+  if (index < 0 || index >= _numCards) {
+    return false;
+  }
+  
+  uid = _cards[index].uid;
   return true;
 }
 
@@ -166,95 +341,128 @@ int RFIDManager::getCardCount() const {
   return _numCards;
 }
 
-bool RFIDManager::saveToEEPROM() {
-  EEPROMData data;
-  data.magic = EEPROM_MAGIC;
-  data.numCards = _numCards;
-  
-  for (int i = 0; i < _numCards; i++) {
-    data.cards[i] = _authorizedCards[i];
+bool RFIDManager::saveToStorage() {
+  // Includes stale tail records so a shrunken list erases them
+  int limit = max(_numCards, _storedCount);
+  for (int i = 0; i < limit; i++) {
+    markDirty(i);
+  }
+  return flushDirty();
+}
+
+bool RFIDManager::loadFromStorage() {
+  uint32_t layout = 0;
+  uint32_t count = 0;
+  
+  // Validate layout version and card count
+  if (!_store.readMeta("layout", layout) || layout != WHITELIST_STORE_LAYOUT ||
+      !_store.readMeta("count", count) || count > MAX_RFID_CARDS) {
+    DEBUG_PRINTLN("✗ Whitelist storage corrupted or not initialized");
+    return false;
   }
   
-  EEPROM.put(0, data);
-  bool success = EEPROM.commit();
+  // Only the UID and flags stay in RAM; names are read back on demand.
+  // A flush cut short can leave count above the last record: keep the
+  // records before the gap rather than falling back to the defaults.
+  uint32_t loaded = 0;
+  while (loaded < count) {
+    RFIDCard record;
+    if (!_store.readRecord(loaded, &record)) {
+      DEBUG_PRINTF("✗ Whitelist record %u missing, keeping %u cards\n",
+                   (unsigned)loaded, (unsigned)loaded);
+      break;
+    }
+    
+    CardEntry& card = _cards[loaded];
+    card.uid = record.uid;
+    card.active = record.isActive;
+    card.level = record.accessLevel;
+    card.name = loaded;
+    loaded++;
+  }
   
-  if (success) {
-    DEBUG_PRINTF("✓ Saved %d cards to EEPROM\n", _numCards);
-  } else {
-    DEBUG_PRINTLN("✗ EEPROM save failed");
+  // Lists written before versioning count as never synced
+  uint32_t version = 0;
+  _store.readMeta("version", version);
+  
+  // _storedCount stays at the stored count, so the next flush rewrites it
+  // and erases anything left behind the gap
+  _numCards = loaded;
+  _storedCount = count;
+  _version = version;
+  _inTransaction = false;
+  for (int i = 0; i < MAX_RFID_CARDS; i++) {
+    _cards[i].dirty = 0;
   }
+  memset(_pendingNames, 0, sizeof(_pendingNames));
+  dropSpilledNames();
+  rebuildIndex();
+  _revision++;
   
-  return success;
+  DEBUG_PRINTF("✓ Loaded %d cards from storage\n", _numCards);
+  return true;
 }
 
-bool RFIDManager::loadFromEEPROM() {
-  EEPROMData data;
-  EEPROM.get(0, data);
-  
-  // Validate magic number and card count
-  if (data.magic == EEPROM_MAGIC && 
-      data.numCards >= 0 && 
-      data.numCards <= MAX_RFID_CARDS) {
-    
-    _numCards = data.numCards;
-    for (int i = 0; i < _numCards; i++) {
-      _authorizedCards[i] = data.cards[i];
-    }
-    
-    DEBUG_PRINTF("✓ Loaded %d cards from EEPROM\n", _numCards);
-    return true;
-    
-  } else {
-    DEBUG_PRINTLN("✗ EEPROM data corrupted or not initialized");
-    return false;
+void RFIDManager::beginTransaction() {
+  _inTransaction = true;
+}
+
+bool RFIDManager::commitTransaction() {
+  _inTransaction = false;
+  return flushDirty();
+}
+
+void RFIDManager::abortTransaction() {
+  _inTransaction = false;
+  if (!loadFromStorage()) {
+    resetToDefaults();
   }
 }
 
+uint32_t RFIDManager::getWhitelistVersion() const {
+  return _version;
+}
+
+uint32_t RFIDManager::getRevision() const {
+  return _revision;
+}
+
+bool RFIDManager::setWhitelistVersion(uint32_t version) {
+  _version = version;
+  return persist();
+}
+
 void RFIDManager::resetToDefaults() {
   DEBUG_PRINTLN("Resetting RFID whitelist to defaults...");
   
+  for (int i = 0; i < _numCards; i++) {
+    releaseName(_cards[i]);
+  }
   _numCards = DEFAULT_CARD_COUNT;
+  _version = 0;
+  
+  setCard(0, DEFAULT_CARD_1_UID, DEFAULT_CARD_1_NAME, DEFAULT_CARD_1_LEVEL);
+  setCard(1, DEFAULT_CARD_2_UID, DEFAULT_CARD_2_NAME, DEFAULT_CARD_2_LEVEL);
+  setCard(2, DEFAULT_CARD_3_UID, DEFAULT_CARD_3_NAME, DEFAULT_CARD_3_LEVEL);
+  setCard(3, DEFAULT_CARD_4_UID, DEFAULT_CARD_4_NAME, DEFAULT_CARD_4_LEVEL);
+  setCard(4, DEFAULT_CARD_5_UID, DEFAULT_CARD_5_NAME, DEFAULT_CARD_5_LEVEL);
+  rebuildIndex();
   
-  // Card 1: Admin
-  strcpy(_authorizedCards[0].uid, DEFAULT_CARD_1_UID);
-  strcpy(_authorizedCards[0].ownerName, DEFAULT_CARD_1_NAME);
-  _authorizedCards[0].accessLevel = DEFAULT_CARD_1_LEVEL;
-  _authorizedCards[0].isActive = true;
-  
-  // Card 2: User1
-  strcpy(_authorizedCards[1].uid, DEFAULT_CARD_2_UID);
-  strcpy(_authorizedCards[1].ownerName, DEFAULT_CARD_2_NAME);
-  _authorizedCards[1].accessLevel = DEFAULT_CARD_2_LEVEL;
-  _authorizedCards[1].isActive = true;
-  
-  // Card 3: User2
-  strcpy(_authorizedCards[2].uid, DEFAULT_CARD_3_UID);
-  strcpy(_authorizedCards[2].ownerName, DEFAULT_CARD_3_NAME);
-  _authorizedCards[2].accessLevel = DEFAULT_CARD_3_LEVEL;
-  _authorizedCards[2].isActive = true;
-  
-  // Card 4: Your Card 1
-  strcpy(_authorizedCards[3].uid, DEFAULT_CARD_4_UID);
-  strcpy(_authorizedCards[3].ownerName, DEFAULT_CARD_4_NAME);
-  _authorizedCards[3].accessLevel = DEFAULT_CARD_4_LEVEL;
-  _authorizedCards[3].isActive = true;
-  
-  // Card 5: Your Card 2
-  strcpy(_authorizedCards[4].uid, DEFAULT_CARD_5_UID);
-  strcpy(_authorizedCards[4].ownerName, DEFAULT_CARD_5_NAME);
-  _authorizedCards[4].accessLevel = DEFAULT_CARD_5_LEVEL;
-  _authorizedCards[4].isActive = true;
-  
-  saveToEEPROM();
+  saveToStorage();
   
   DEBUG_PRINTLN("✓ Reset to default cards");
 }
 
 bool RFIDManager::clearAllCards() {
   DEBUG_PRINTLN("Clearing all cards from whitelist...");
+  for (int i = 0; i < _numCards; i++) {
+    releaseName(_cards[i]);
+    markDirty(i);
+  }
   _numCards = 0;
+  rebuildIndex();
   
-  bool success = saveToEEPROM();
+  bool success = persist();
   if (success) {
     DEBUG_PRINTLN("✓ All cards cleared");
   } else {
@@ -264,27 +472,313 @@ bool RFIDManager::clearAllCards() {
   return success;
 }
 
-MFRC522* RFIDManager::getReader(GateType gate) {
-  return (gate == GATE_ENTRANCE) ? &_rfidEntrance : &_rfidExit;
+MFRC522* RFIDManager::getReader(uint8_t lane) {
+  return (lane < _readerCount) ? &_readers[lane] : nullptr;
 }
 
-void RFIDManager::initializeEEPROM() {
-  int magic;
-  EEPROM.get(0, magic);
+void RFIDManager::initializeStorage() {
+  if (loadFromStorage()) {
+    DEBUG_PRINTLN("✓ Whitelist storage already initialized");
+    return;
+  }
   
-  if (magic != EEPROM_MAGIC) {
-    DEBUG_PRINTLN("Initializing EEPROM with default cards...");
-    resetToDefaults();
-  } else {
-    DEBUG_PRINTLN("✓ EEPROM already initialized");
+  if (migrateFromEEPROM()) {
+    return;
+  }
+  
+  DEBUG_PRINTLN("Initializing whitelist storage with default cards...");
+  resetToDefaults();
+}
+
+bool RFIDManager::migrateFromEEPROM() {
+  if (!EEPROM.begin(EEPROM_SIZE)) {
+    return false;
+  }
+  
+  uint32_t magic = 0;
+  int numCards = 0;
+  EEPROM.get(offsetof(EEPROMData, magic), magic);
+  EEPROM.get(offsetof(EEPROMData, numCards), numCards);
+  
+  if (magic != EEPROM_MAGIC || numCards < 0 ||
+      numCards > EEPROM_LEGACY_CARDS || numCards > MAX_RFID_CARDS) {
+    EEPROM.end();
+    return false;
+  }
+  
+  DEBUG_PRINTF("Migrating %d cards from EEPROM...\n", numCards);
+  
+  // One card at a time: the whole image is too large for the stack
+  bool success = true;
+  int migrated = 0;
+  _store.beginTransaction();
+  for (int i = 0; i < numCards; i++) {
+    LegacyCard legacy;
+    EEPROM.get(offsetof(EEPROMData, cards) + i * sizeof(LegacyCard), legacy);
+    legacy.uid[sizeof(legacy.uid) - 1] = '\0';
+    
+    RFIDCard record = {};
+    if (!record.uid.fromHex(legacy.uid)) {
+      DEBUG_PRINTF("✗ Skipping EEPROM card %d: bad UID\n", i);
+      continue;
+    }
+    record.isActive = legacy.isActive;
+    record.accessLevel = (legacy.accessLevel >= 0 && legacy.accessLevel <= 7)
+                         ? legacy.accessLevel : ACCESS_REGULAR;
+    strncpy(record.ownerName, legacy.ownerName, sizeof(record.ownerName) - 1);
+    success = _store.writeRecord(migrated, &record) && success;
+    
+    CardEntry& card = _cards[migrated];
+    card.uid = record.uid;
+    card.active = record.isActive;
+    card.level = record.accessLevel;
+    card.dirty = 0;
+    card.name = migrated;
+    migrated++;
+  }
+  EEPROM.end();
+  
+  _numCards = migrated;
+  rebuildIndex();
+  
+  if (!success) {
+    _store.commitTransaction();
+    return false;
+  }
+  return flushDirty();
+}
+
+void RFIDManager::removeAt(int index) {
+  // Move the last card into the gap. Its name reference still points at
+  // its old, higher-numbered record.
+  releaseName(_cards[index]);
+  _numCards--;
+  if (index != _numCards) {
+    _cards[index] = _cards[_numCards];
+    markDirty(index);
+  }
+  markDirty(_numCards);
+}
+
+void RFIDManager::markDirty(int index) {
+  _cards[index].dirty = 1;
+  _revision++;
+}
+
+bool RFIDManager::persist() {
+  if (_inTransaction) {
+    return true;
   }
+  return flushDirty();
 }
 
-int RFIDManager::findCardIndex(const String& uid) const {
+bool RFIDManager::flushDirty() {
+  bool success = true;
+  int written = 0;
+  int limit = max(_numCards, _storedCount);
+  
+  _store.beginTransaction();
+  
+  // The transaction only defers nvs_commit; every write and erase reaches
+  // flash at once. So the order is: live records, then count, then the
+  // stale tail. An interrupted flush leaves count at or below the last
+  // stored record (a shrink may briefly show a moved card twice), and
+  // loadFromStorage() keeps whatever precedes a gap.
+  //
+  // Ascending order matters: a card moved by removeCard() reads its name
+  // from its old record, which always lies above its new position
   for (int i = 0; i < _numCards; i++) {
-    if (uid.equals(_authorizedCards[i].uid)) {
-      return i;
+    CardEntry& card = _cards[i];
+    if (!card.dirty) {
+      continue;
+    }
+    
+    RFIDCard record;
+    toCard(card, record);
+    if (_store.writeRecord(i, &record)) {
+      releaseName(card);
+      card.name = i;
+      card.dirty = 0;
+      written++;
+    } else {
+      success = false;
+      if (card.name < MAX_RFID_CARDS && card.name != i) {
+        // The old record may be overwritten further on: keep the name elsewhere
+        setName(card, record.ownerName);
+      }
+    }
+  }
+  
+  // A failed record write leaves count where it was, so it never covers
+  // a record that is not there yet
+  bool counted = success && _store.writeMeta("count", _numCards);
+  success = counted && success;
+  
+  for (int i = _numCards; i < limit; i++) {
+    CardEntry& card = _cards[i];
+    if (!card.dirty) {
+      continue;
+    }
+    
+    // Erasing below the stored count would open a gap
+    if (counted && _store.eraseRecord(i)) {
+      card.dirty = 0;
+      written++;
+    } else {
+      success = false;
+    }
+  }
+  
+  success = _store.writeMeta("version", _version) && success;
+  success = _store.writeMeta("layout", WHITELIST_STORE_LAYOUT) && success;
+  success = _store.commitTransaction() && success;
+  
+  if (success) {
+    // Every entry now reads its name from its own record
+    _storedCount = _numCards;
+    dropSpilledNames();
+    DEBUG_PRINTF("✓ Saved %d cards (%d records touched)\n", _numCards, written);
+  } else {
+    DEBUG_PRINTLN("✗ Whitelist save failed");
+  }
+  
+  return success;
+}
+
+int RFIDManager::findCardIndex(const CardUid& uid) const {
+  // Linear probing; the table is at most half full so probes stay short
+  uint32_t bucket = uid.hash() & (RFID_INDEX_SIZE - 1);
+  
+  for (int probe = 0; probe < RFID_INDEX_SIZE; probe++) {
+    int16_t cardIndex = _index[bucket];
+    if (cardIndex == -1) {
+      return -1;
+    }
+    if (_cards[cardIndex].uid == uid) {
+      return cardIndex;
     }
+    bucket = (bucket + 1) & (RFID_INDEX_SIZE - 1);
   }
   return -1;
 }
+
+void RFIDManager::indexCard(int cardIndex) {
+  uint32_t bucket = _cards[cardIndex].uid.hash() & (RFID_INDEX_SIZE - 1);
+  
+  while (_index[bucket] != -1) {
+    bucket = (bucket + 1) & (RFID_INDEX_SIZE - 1);
+  }
+  _index[bucket] = cardIndex;
+}
+
+void RFIDManager::rebuildIndex() {
+  for (int i = 0; i < RFID_INDEX_SIZE; i++) {
+    _index[i] = -1;
+  }
+  for (int i = 0; i < _numCards; i++) {
+    indexCard(i);
+  }
+}
+
+void RFIDManager::setCard(int index, const char* uid, const char* ownerName,
+                          int accessLevel) {
+  CardEntry& card = _cards[index];
+  markDirty(index);
+  card.uid.fromHex(uid);
+  card.name = index;
+  setName(card, ownerName);  // Always fits: see the static_assert above
+  card.level = accessLevel;
+  card.active = true;
+}
+
+bool RFIDManager::setName(CardEntry& entry, const char* ownerName) {
+  const size_t length = sizeof(_pendingNames[0].text) - 1;
+  int slot = -1;
+  int freeSlot = -1;
+  for (int i = 0; i < WHITELIST_PENDING_NAMES; i++) {
+    if (_pendingNames[i].refs == 0) {
+      if (freeSlot < 0) {
+        freeSlot = i;
+      }
+    } else if (strncmp(_pendingNames[i].text, ownerName, length) == 0) {
+      slot = i;
+      break;
+    }
+  }
+  
+  if (slot < 0 && freeSlot < 0) {
+    return spillName(entry, ownerName);
+  }
+  
+  if (slot < 0) {
+    slot = freeSlot;
+    strncpy(_pendingNames[slot].text, ownerName, length);
+    _pendingNames[slot].text[length] = '\0';
+  }
+  
+  // Take the new reference first: it may be the slot being released
+  _pendingNames[slot].refs++;
+  releaseName(entry);
+  entry.name = NAME_PENDING | slot;
+  return true;
+}
+
+bool RFIDManager::spillName(CardEntry& entry, const char* ownerName) {
+  // Staging records sit above the whitelist records and are only read
+  // through name references, so an aborted transaction leaves no trace
+  if (_spilledNames >= MAX_RFID_CARDS) {
+    return false;
+  }
+  
+  RFIDCard record;
+  memset(&record, 0, sizeof(record));
+  record.uid = entry.uid;
+  strncpy(record.ownerName, ownerName, sizeof(record.ownerName) - 1);
+  
+  uint16_t staging = MAX_RFID_CARDS + _spilledNames;
+  if (!_store.writeRecord(staging, &record)) {
+    return false;
+  }
+  
+  _spilledNames++;
+  releaseName(entry);
+  entry.name = staging;
+  return true;
+}
+
+void RFIDManager::dropSpilledNames() {
+  for (int i = 0; i < _spilledNames; i++) {
+    _store.eraseRecord(MAX_RFID_CARDS + i);
+  }
+  _spilledNames = 0;
+}
+
+void RFIDManager::releaseName(CardEntry& entry) {
+  if (entry.name & NAME_PENDING) {
+    _pendingNames[entry.name & ~NAME_PENDING].refs--;
+  }
+}
+
+void RFIDManager::readName(const CardEntry& entry, char* name) const {
+  if (entry.name & NAME_PENDING) {
+    memcpy(name, _pendingNames[entry.name & ~NAME_PENDING].text, 32);
+    return;
+  }
+  
+  RFIDCard record;
+  if (_store.readRecord(entry.name, &record)) {
+    memcpy(name, record.ownerName, 32);
+    name[31] = '\0';
+  } else {
+    name[0] = '\0';
+  }
+}
+
+void RFIDManager::toCard(const CardEntry& entry, RFIDCard& card) const {
+  // Zeroed first so stored bytes are deterministic
+  memset(&card, 0, sizeof(card));
+  card.uid = entry.uid;
+  card.isActive = entry.active;
+  card.accessLevel = entry.level;
+  readName(entry, card.ownerName);
+}
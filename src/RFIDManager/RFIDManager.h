@@ -1,8 +1,17 @@
 /**
  * @file RFIDManager.h
- * @brief RFID card management with EEPROM persistence
- * @details Handles RFID card reading, whitelist management,
- *          and EEPROM storage for persistent card database
+ * @brief RFID card management with NVS persistence
+ * @details Handles RFID card reading (one MFRC522 per lane on a shared
+ *          SPI bus), whitelist management,
+ *          and per-record NVS storage for the persistent card database.
+ *          Only changed records are written back; bulk edits can be
+ *          grouped in a transaction that commits once.
+ *          Lookups go through an open-addressing hash index over the
+ *          packed binary UIDs, so authorization cost does not grow with
+ *          the whitelist.
+ *          RAM holds 14 bytes per card (UID, flags, name reference) in a
+ *          RecordPool; owner names live only in the flash records, apart
+ *          from the few that are waiting to be written.
  */
 
 #ifndef RFIDMANAGER_H
@@ -13,13 +22,28 @@
 #include <MFRC522.h>
 #include <EEPROM.h>
 #include "../Config.h"
+#include "../CardUid/CardUid.h"
+#include "../RecordStore/RecordStore.h"
+#include "../RecordPool/RecordPool.h"
+#include "../LatencyTracer/LatencyTracer.h"
 
 /**
  * @struct RFIDCard
- * @brief Structure to hold RFID card information
+ * @brief Full card information, and the stored record layout (48 bytes)
  */
 struct RFIDCard {
-  char uid[20];              ///< Card UID in hex string format
+  CardUid uid;               ///< Card UID (packed binary)
+  bool isActive;             ///< Card activation status
+  int accessLevel;           ///< Access level (0=regular, 1=admin, 2=temp)
+  char ownerName[32];        ///< Owner name for identification
+};
+
+/**
+ * @struct LegacyCard
+ * @brief Card record of the EEPROM image written by earlier firmware
+ */
+struct LegacyCard {
+  char uid[20];              ///< Card UID as an uppercase hex string
   bool isActive;             ///< Card activation status
   int accessLevel;           ///< Access level (0=regular, 1=admin, 2=temp)
   char ownerName[32];        ///< Owner name for identification
@@ -27,12 +51,12 @@ struct RFIDCard {
 
 /**
  * @struct EEPROMData
- * @brief Structure for EEPROM storage format
+ * @brief Legacy EEPROM image layout (read once for migration)
  */
 struct EEPROMData {
-  int magic;                           ///< Magic number for validation
-  int numCards;                        ///< Number of stored cards
-  RFIDCard cards[MAX_RFID_CARDS];     ///< Card database array
+  uint32_t magic;                          ///< Magic number for validation
+  int numCards;                            ///< Number of stored cards
+  LegacyCard cards[EEPROM_LEGACY_CARDS];   ///< Card database array
 };
 
 /**
@@ -42,9 +66,12 @@ struct EEPROMData {
  * Example usage:
  * @code
  * RFIDManager rfidMgr;
+ * rfidMgr.addReader(RFID_IN_SS, RFID_IN_RST);    // lane 0
+ * rfidMgr.addReader(RFID_OUT_SS, RFID_OUT_RST);  // lane 1
  * rfidMgr.begin();
- * String uid = rfidMgr.readCard(RFIDManager::GATE_ENTRANCE);
- * if (rfidMgr.isAuthorized(uid)) {
+ * CardUid uid;
+ * if (rfidMgr.readCard(0, uid) &&
+ *     rfidMgr.isAuthorized(uid)) {
  *   // Grant access
  * }
  * @endcode
@@ -52,80 +79,163 @@ struct EEPROMData {
 class RFIDManager {
 public:
   /**
-   * @enum GateType
-   * @brief Gate identifier for RFID readers
+   * @brief Constructor
+   */
+  RFIDManager();
+
+  /**
+   * @brief Register the reader of the next lane (before begin())
+   * @details Lanes are numbered in call order, starting at 0
+   * @param ssPin SPI SS pin
+   * @param rstPin RST pin
+   * @return true if added, false if LANE_COUNT readers are registered
    */
-  enum GateType {
-    GATE_ENTRANCE,    ///< Entrance gate RFID reader
-    GATE_EXIT         ///< Exit gate RFID reader
-  };
+  bool addReader(uint8_t ssPin, uint8_t rstPin);
 
   /**
-   * @brief Constructor
+   * @brief Get the number of registered readers
+   * @return Readers added with addReader()
    */
-  RFIDManager();
+  uint8_t getReaderCount() const;
 
   /**
-   * @brief Initialize RFID readers and load whitelist from EEPROM
+   * @brief Initialize RFID readers and load whitelist from storage
    * @return true if successful, false otherwise
    */
   bool begin();
 
   /**
-   * @brief Read RFID card from specified gate
-   * @param gate Gate to read from (GATE_ENTRANCE or GATE_EXIT)
-   * @return Card UID as hex string, empty string if no card detected
+   * @brief Read RFID card from a lane's reader
+   * @details Returns immediately without SPI traffic while polling is
+   *          disabled for the lane
+   * @param lane Lane to read from
+   * @param uid Output parameter for the card UID (cleared if none)
+   * @return true if a card was read, false otherwise
    */
-  String readCard(GateType gate);
+  bool readCard(uint8_t lane, CardUid& uid);
+
+  /**
+   * @brief Enable or disable card polling on a reader
+   * @details Only transitions cost SPI traffic. With RFID_IDLE_ANTENNA_OFF
+   *          the reader's RF field is switched off while disabled.
+   * @param lane Lane whose reader to change
+   * @param enabled true to poll, false to idle the reader
+   */
+  void setPollingEnabled(uint8_t lane, bool enabled);
+
+  /**
+   * @brief Check if a reader is being polled
+   * @param lane Lane to check
+   * @return true if polling is enabled
+   */
+  bool isPollingEnabled(uint8_t lane) const;
+
+  /**
+   * @brief Answer the next poll of a reader with a given card (benchmark mode)
+   * @details The card is returned by the next readCard() on that lane that
+   *          finds polling enabled, without SPI traffic
+   * @param lane Lane whose reader the card is shown to
+   * @param uid Card UID (empty to withdraw a pending card)
+   */
+  void injectCard(uint8_t lane, const CardUid& uid);
 
   /**
    * @brief Check if card UID is authorized
+   * @details Touches RAM only
    * @param uid Card UID to check
    * @param accessLevel Output parameter for access level
    * @return true if authorized, false otherwise
    */
-  bool isAuthorized(const String& uid, int& accessLevel) const;
+  bool isAuthorized(const CardUid& uid, int& accessLevel) const;
 
   /**
    * @brief Check if card is authorized (without access level)
    * @param uid Card UID to check
    * @return true if authorized, false otherwise
    */
-  bool isAuthorized(const String& uid) const;
+  bool isAuthorized(const CardUid& uid) const;
 
   /**
    * @brief Add new card to whitelist
    * @param uid Card UID
    * @param ownerName Owner name
-   * @param accessLevel Access level
-   * @return true if added successfully, false if full
+   * @param accessLevel Access level (0..7)
+   * @return true if added successfully, false if full, invalid or
+   *         WHITELIST_PENDING_NAMES other names are waiting for flash
    */
-  bool addCard(const String& uid, const String& ownerName, int accessLevel);
+  bool addCard(const CardUid& uid, const char* ownerName, int accessLevel);
+
+  /**
+   * @brief Add a card, or update it if already present
+   * @param uid Card UID
+   * @param ownerName Owner name (nullptr keeps an existing name)
+   * @param accessLevel Access level (0..7)
+   * @return true if stored, false if full or invalid
+   */
+  bool upsertCard(const CardUid& uid, const char* ownerName, int accessLevel);
 
   /**
    * @brief Remove card from whitelist
    * @param uid Card UID to remove
    * @return true if removed, false if not found
    */
-  bool removeCard(const String& uid);
+  bool removeCard(const CardUid& uid);
+
+  /**
+   * @brief Clear the sweep mark of every card
+   * @details Starts a sweep: mark the cards to keep with markCard(), then
+   *          drop the rest with removeUnmarked() (whitelist snapshots)
+   */
+  void clearMarks();
+
+  /**
+   * @brief Mark a card as kept by the current sweep
+   * @param uid Card UID
+   * @return true if the card is on the list
+   */
+  bool markCard(const CardUid& uid);
+
+  /**
+   * @brief Remove every card not marked since clearMarks()
+   * @details One pass over the list and one index rebuild
+   * @return Cards removed
+   */
+  int removeUnmarked();
 
   /**
    * @brief Update card information
    * @param uid Card UID
    * @param ownerName New owner name (nullptr to keep unchanged)
    * @param accessLevel New access level (-1 to keep unchanged)
-   * @return true if updated, false if not found
+   * @return true if updated, false if not found or the name could not be held
    */
-  bool updateCard(const String& uid, const char* ownerName = nullptr, 
+  bool updateCard(const CardUid& uid, const char* ownerName = nullptr, 
                   int accessLevel = -1);
 
   /**
    * @brief Get card information
+   * @details The owner name is read from flash unless it is still pending
    * @param uid Card UID
    * @param card Output parameter for card data
    * @return true if found, false otherwise
    */
-  bool getCardInfo(const String& uid, RFIDCard& card) const;
+  bool getCardInfo(const CardUid& uid, RFIDCard& card) const;
+
+  /**
+   * @brief Get card by position
+   * @param index Position (0 to getCardCount() - 1)
+   * @param card Output parameter for card data
+   * @return true if index is valid
+   */
+  bool getCardAt(int index, RFIDCard& card) const;
+
+  /**
+   * @brief Get the UID of a card by position (RAM only)
+   * @param index Position (0 to getCardCount() - 1)
+   * @param uid Output parameter for the card UID
+   * @return true if index is valid
+   */
+  bool getCardUidAt(int index, CardUid& uid) const;
 
   /**
    * @brief Get number of authorized cards
@@ -134,19 +244,64 @@ public:
   int getCardCount() const;
 
   /**
-   * @brief Save current whitelist to EEPROM
+   * @brief Write the whole whitelist to storage
+   * @details Records whose stored bytes already match are skipped
    * @return true if saved successfully
    */
-  bool saveToEEPROM();
+  bool saveToStorage();
 
   /**
-   * @brief Load whitelist from EEPROM
+   * @brief Load whitelist from storage
+   * @details Discards uncommitted changes of an open transaction. A list
+   *          whose count runs past a missing record (interrupted flush)
+   *          is loaded up to the gap.
    * @return true if loaded successfully
    */
-  bool loadFromEEPROM();
+  bool loadFromStorage();
 
   /**
-   * @brief Reset EEPROM to default cards
+   * @brief Group whitelist changes so they are written and committed once
+   * @details add/remove/update/clear only mark records dirty until
+   *          commitTransaction()
+   */
+  void beginTransaction();
+
+  /**
+   * @brief Write all records changed since beginTransaction() and commit
+   * @return true if saved successfully
+   */
+  bool commitTransaction();
+
+  /**
+   * @brief Drop uncommitted changes and reload the stored whitelist
+   */
+  void abortTransaction();
+
+  /**
+   * @brief Get the backend whitelist version the stored list reflects
+   * @return Version (0 = never synced)
+   */
+  uint32_t getWhitelistVersion() const;
+
+  /**
+   * @brief Get a counter that changes with every whitelist edit
+   * @details Includes uncommitted and reloaded changes, so cached
+   *          authorization answers can tell they are stale
+   * @return Revision (local, not persisted)
+   */
+  uint32_t getRevision() const;
+
+  /**
+   * @brief Set the whitelist version
+   * @details Persisted together with the pending records, so inside a
+   *          transaction it only takes effect on commit
+   * @param version New version
+   * @return true if saved successfully
+   */
+  bool setWhitelistVersion(uint32_t version);
+
+  /**
+   * @brief Reset whitelist to default cards
    */
   void resetToDefaults();
 
@@ -158,29 +313,163 @@ public:
 
   /**
    * @brief Get RFID reader object (for advanced operations)
-   * @param gate Gate to get reader for
-   * @return Pointer to MFRC522 object
+   * @param lane Lane to get reader for
+   * @return Pointer to MFRC522 object, nullptr for an unknown lane
    */
-  MFRC522* getReader(GateType gate);
+  MFRC522* getReader(uint8_t lane);
 
 private:
-  MFRC522 _rfidEntrance;              ///< Entrance RFID reader
-  MFRC522 _rfidExit;                  ///< Exit RFID reader
-  RFIDCard _authorizedCards[MAX_RFID_CARDS];  ///< Card whitelist
+  /**
+   * @struct CardEntry
+   * @brief Whitelist entry as kept in RAM
+   */
+  struct CardEntry {
+    CardUid uid;             ///< Card UID (packed binary)
+    uint8_t active : 1;      ///< Card may pass
+    uint8_t level : 3;       ///< Access level
+    uint8_t dirty : 1;       ///< Differs from its stored record (also set on tail entries to erase)
+    uint8_t marked : 1;      ///< Kept by the current sweep (RAM only, see markCard())
+    uint16_t name;           ///< Record holding the owner name (whitelist or staging), or NAME_PENDING | pending slot
+  };
+
+  /**
+   * @struct PendingName
+   * @brief Owner name not yet written to flash (shared by equal names)
+   */
+  struct PendingName {
+    char text[32];           ///< Null-terminated name
+    uint16_t refs;           ///< Entries using it (0 = free)
+  };
+
+  static const uint16_t NAME_PENDING = 0x8000;   ///< CardEntry::name flag
+
+  MFRC522 _readers[LANE_COUNT];       ///< Per-lane RFID readers
+  uint8_t _readerPins[LANE_COUNT][2]; ///< Per-lane SS and RST pins
+  uint8_t _readerCount;               ///< Readers registered with addReader()
+  RecordPool<CardEntry, MAX_RFID_CARDS> _cards;  ///< Card whitelist
+  PendingName _pendingNames[WHITELIST_PENDING_NAMES];  ///< Names waiting for flushDirty()
+  int16_t _index[RFID_INDEX_SIZE];    ///< Hash buckets -> card index (-1 = empty)
   int _numCards;                      ///< Current number of cards
   bool _initialized;                  ///< Initialization status
+  bool _pollingEnabled[LANE_COUNT];   ///< Per-lane polling state
+  CardUid _injected[LANE_COUNT];      ///< Per-lane card from injectCard()
+  RecordStore _store;                 ///< One NVS record per whitelist entry
+  int _storedCount;                   ///< Records currently in storage
+  bool _inTransaction;                ///< Writes deferred to commitTransaction()
+  int _spilledNames;                  ///< Staging records in use (from MAX_RFID_CARDS up)
+  uint32_t _version;                  ///< Backend whitelist version
+  uint32_t _revision;                 ///< Bumped on every whitelist edit
+
+  /**
+   * @brief Load stored whitelist, migrating or seeding defaults if needed
+   */
+  void initializeStorage();
+
+  /**
+   * @brief Import the whitelist from the legacy EEPROM image
+   * @details Reads and stores one card at a time, parsing the hex string
+   *          UIDs; unparseable ones are skipped
+   * @return true if a valid image was found and imported
+   */
+  bool migrateFromEEPROM();
+
+  /**
+   * @brief Drop the entry at an index without rebuilding the index
+   * @details Moves the last card into the gap so only two records change
+   * @param index Entry index
+   */
+  void removeAt(int index);
+
+  /**
+   * @brief Mark a whitelist entry as needing a write
+   * @param index Entry index
+   */
+  void markDirty(int index);
+
+  /**
+   * @brief Persist dirty entries unless a transaction is open
+   * @return true if successful
+   */
+  bool persist();
+
+  /**
+   * @brief Write dirty entries, erase dropped tail records and commit once
+   * @return true if successful
+   */
+  bool flushDirty();
+
+  /**
+   * @brief Give an entry an owner name, sharing a pending slot if possible
+   * @details Once every pending slot is taken the name is spilled to a
+   *          staging record instead
+   * @param entry Entry (its previous pending name is released)
+   * @param ownerName Owner name
+   * @return true if held, false if it could not be stored anywhere
+   */
+  bool setName(CardEntry& entry, const char* ownerName);
+
+  /**
+   * @brief Write an owner name to the next staging record
+   * @param entry Entry (its previous pending name is released)
+   * @param ownerName Owner name
+   * @return true if written
+   */
+  bool spillName(CardEntry& entry, const char* ownerName);
+
+  /**
+   * @brief Erase the staging records once nothing refers to them
+   */
+  void dropSpilledNames();
+
+  /**
+   * @brief Drop an entry's claim on its pending name
+   * @param entry Entry
+   */
+  void releaseName(CardEntry& entry);
+
+  /**
+   * @brief Copy a card's owner name
+   * @details Pending names come from RAM, others from the stored record
+   * @param entry Entry
+   * @param name Output buffer (32 bytes)
+   */
+  void readName(const CardEntry& entry, char* name) const;
 
   /**
-   * @brief Initialize EEPROM with default cards if needed
+   * @brief Fill full card information from an entry
+   * @param entry Entry
+   * @param card Output
    */
-  void initializeEEPROM();
+  void toCard(const CardEntry& entry, RFIDCard& card) const;
 
   /**
-   * @brief Find card index in whitelist
-   * @param uid Card UID to find
+   * @brief Find card index through the hash index
+   * @param uid Packed card UID to find
    * @return Index if found, -1 otherwise
    */
-  int findCardIndex(const String& uid) const;
+  int findCardIndex(const CardUid& uid) const;
+
+  /**
+   * @brief Insert a card into the hash index
+   * @param cardIndex Index into _cards
+   */
+  void indexCard(int cardIndex);
+
+  /**
+   * @brief Rebuild the hash index from _cards
+   * @details Used after bulk changes and removals (linear probing has no
+   *          cheap delete)
+   */
+  void rebuildIndex();
+
+  /**
+   * @brief Fill a whitelist entry
+   * @param index Entry to fill
+   * @param uid Card UID as hex string
+   * @param ownerName Owner name
+   * @param accessLevel Access level
+   */
+  void setCard(int index, const char* uid, const char* ownerName, int accessLevel);
 };
 
 #endif // RFIDMANAGER_H
@@ -0,0 +1,104 @@
+/**
+ * @file ReaderScheduler.cpp
+ * @brief Implementation of the RFID reader poll scheduler
+ */
+
+#include "ReaderScheduler.h"
+
+ReaderScheduler::ReaderScheduler() {
+  begin(LANE_COUNT);
+}
+
+void ReaderScheduler::begin(uint8_t laneCount) {
+  _laneCount = (laneCount > MAX_LANES) ? MAX_LANES : laneCount;
+  _nextWaiting = 0;
+  _nextIdle = 0;
+  _maxPollGap = 0;
+  for (uint8_t lane = 0; lane < MAX_LANES; lane++) {
+    _waiting[lane] = false;
+    _sincePoll[lane] = 0;
+  }
+}
+
+void ReaderScheduler::setWaiting(uint8_t lane, bool waiting) {
+  if (lane >= _laneCount) {
+    return;
+  }
+  
+  // A lane starts its wait as if it had just been polled
+  if (waiting && !_waiting[lane]) {
+    _sincePoll[lane] = 0;
+  }
+  _waiting[lane] = waiting;
+}
+
+bool ReaderScheduler::isWaiting(uint8_t lane) const {
+  return lane < _laneCount && _waiting[lane];
+}
+
+uint8_t ReaderScheduler::schedule(uint8_t* lanes, uint8_t budget, bool pollIdle) {
+  uint8_t count = 0;
+  
+  pick(true, _nextWaiting, lanes, count, budget);
+  
+  // Track how long each waiting lane has gone without a poll
+  for (uint8_t lane = 0; lane < _laneCount; lane++) {
+    if (!_waiting[lane]) {
+      continue;
+    }
+    
+    bool polled = false;
+    for (uint8_t i = 0; i < count; i++) {
+      polled = polled || (lanes[i] == lane);
+    }
+    
+    if (polled) {
+      _sincePoll[lane] = 0;
+    } else if (_sincePoll[lane] < UINT8_MAX) {
+      _sincePoll[lane]++;
+    }
+    
+    // Gap counts polls apart: polled every iteration = 1
+    uint8_t gap = polled ? 1 : _sincePoll[lane] + 1;
+    if (gap > _maxPollGap) {
+      _maxPollGap = gap;
+    }
+  }
+  
+  if (pollIdle) {
+    pick(false, _nextIdle, lanes, count, budget);
+  }
+  
+  return count;
+}
+
+uint8_t ReaderScheduler::getMaxPollGap() const {
+  return _maxPollGap;
+}
+
+uint8_t ReaderScheduler::pollInterval(uint8_t waiting, uint8_t budget) {
+  if (waiting == 0 || budget == 0) {
+    return 0;
+  }
+  return (waiting + budget - 1) / budget;
+}
+
+void ReaderScheduler::pick(bool waiting, uint8_t& cursor, uint8_t* lanes,
+                           uint8_t& count, uint8_t budget) {
+  if (_laneCount == 0) {
+    return;
+  }
+  
+  uint8_t first = count;
+  for (uint8_t i = 0; i < _laneCount && count < budget; i++) {
+    uint8_t lane = (cursor + i) % _laneCount;
+    if (_waiting[lane] == waiting) {
+      lanes[count++] = lane;
+    }
+  }
+  
+  // Resume after the last lane served so no lane is skipped twice in a row
+  if (count > first) {
+    cursor = (lanes[count - 1] + 1) % _laneCount;
+  }
+}
@@ -0,0 +1,110 @@
+/**
+ * @file ReaderScheduler.h
+ * @brief Shares the SPI bus between the lanes' RFID readers
+ * @details A reader poll without a card holds the bus until the MFRC522
+ *          times out, so polling every reader on every gate iteration
+ *          makes each iteration slower as lanes are added. The scheduler
+ *          hands out a fixed number of polls per iteration instead.
+ */
+
+#ifndef READERSCHEDULER_H
+#define READERSCHEDULER_H
+
+#include <Arduino.h>
+#include "../Config.h"
+
+/**
+ * @class ReaderScheduler
+ * @brief Round-robin reader poll budget with priority to waiting lanes
+ *
+ * Lanes whose gate waits for a card are served first, round-robin from
+ * the lane after the last one polled; idle lanes only get polls left
+ * over. With W waiting lanes and a budget of B polls, every waiting lane
+ * is polled at least once every ceil(W / B) iterations, and an iteration
+ * never spends more than B polls however many lanes there are.
+ *
+ * Example usage:
+ * @code
+ * ReaderScheduler scheduler;
+ * scheduler.begin(LANE_COUNT);
+ *
+ * // gate task, every iteration
+ * scheduler.setWaiting(lane, gates[lane].getState() == STATE_WAITING_CARD);
+ * uint8_t polled[LANE_COUNT];
+ * uint8_t count = scheduler.schedule(polled, RFID_POLLS_PER_ITERATION, false);
+ * for (uint8_t i = 0; i < count; i++) {
+ *   // read the card at lane polled[i]
+ * }
+ * @endcode
+ */
+class ReaderScheduler {
+public:
+  /**
+   * @brief Constructor
+   */
+  ReaderScheduler();
+
+  /**
+   * @brief Set the number of lanes and forget all state
+   * @param laneCount Lanes to schedule (at most MAX_LANES)
+   */
+  void begin(uint8_t laneCount);
+
+  /**
+   * @brief Mark whether a lane's gate is waiting for a card
+   * @param lane Lane number
+   * @param waiting true while the gate is in STATE_WAITING_CARD
+   */
+  void setWaiting(uint8_t lane, bool waiting);
+
+  /**
+   * @brief Check if a lane is marked waiting
+   * @param lane Lane number
+   * @return true if waiting
+   */
+  bool isWaiting(uint8_t lane) const;
+
+  /**
+   * @brief Pick the lanes to poll this iteration
+   * @param lanes Output, one entry per lane
+   * @param budget Polls allowed this iteration
+   * @param pollIdle Give left-over polls to lanes that are not waiting
+   * @return Number of lanes written to lanes
+   */
+  uint8_t schedule(uint8_t* lanes, uint8_t budget, bool pollIdle);
+
+  /**
+   * @brief Get the longest a waiting lane went without a poll
+   * @return Iterations between polls, worst case since begin()
+   */
+  uint8_t getMaxPollGap() const;
+
+  /**
+   * @brief Worst-case poll interval of a waiting lane
+   * @param waiting Lanes waiting for a card
+   * @param budget Polls per iteration
+   * @return Iterations between polls of one waiting lane (ceil(waiting / budget))
+   */
+  static uint8_t pollInterval(uint8_t waiting, uint8_t budget);
+
+private:
+  uint8_t _laneCount;                ///< Lanes scheduled
+  bool _waiting[MAX_LANES];          ///< Gate waits for a card
+  uint8_t _sincePoll[MAX_LANES];     ///< Iterations since the lane was last polled while waiting
+  uint8_t _nextWaiting;              ///< First lane to consider among waiting lanes
+  uint8_t _nextIdle;                 ///< First lane to consider among idle lanes
+  uint8_t _maxPollGap;               ///< Largest poll gap seen
+
+  /**
+   * @brief Fill the budget from one class of lanes, round-robin
+   * @param waiting Which class to take (waiting or idle lanes)
+   * @param cursor Round-robin cursor of that class (advanced past the last pick)
+   * @param lanes Output array
+   * @param count Entries already in lanes (updated)
+   * @param budget Polls allowed this iteration
+   */
+  void pick(bool waiting, uint8_t& cursor, uint8_t* lanes, uint8_t& count,
+            uint8_t budget);
+};
+
+#endif // READERSCHEDULER_H
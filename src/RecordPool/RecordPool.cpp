@@ -0,0 +1,40 @@
+/**
+ * @file RecordPool.cpp
+ * @brief Pool memory allocation
+ */
+
+#include "RecordPool.h"
+
+size_t PoolMemory::_psramBytes = 0;
+size_t PoolMemory::_internalBytes = 0;
+
+void* PoolMemory::allocate(size_t bytes, bool& psram) {
+  void* memory = nullptr;
+  psram = false;
+
+#if RECORD_POOL_USE_PSRAM
+  // Fails without PSRAM; the pool then goes to internal RAM
+  memory = heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (memory != nullptr) {
+    psram = true;
+    _psramBytes += bytes;
+    return memory;
+  }
+#endif
+
+  memory = heap_caps_calloc(1, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (memory == nullptr) {
+    DEBUG_PRINTF("✗ No room for a %u byte record pool\n", (unsigned)bytes);
+    abort();
+  }
+  _internalBytes += bytes;
+  return memory;
+}
+
+size_t PoolMemory::getPsramBytes() {
+  return _psramBytes;
+}
+
+size_t PoolMemory::getInternalBytes() {
+  return _internalBytes;
+}
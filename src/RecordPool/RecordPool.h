@@ -0,0 +1,112 @@
+/**
+ * @file RecordPool.h
+ * @brief Fixed-capacity record tables, placed in PSRAM when the board has it
+ * @details The whitelist and slot tables are sized at compile time but
+ *          allocated once, from their owner's begin(): from PSRAM if
+ *          RECORD_POOL_USE_PSRAM is set and the board has it, otherwise
+ *          from internal RAM. Not from the constructor: the owners are
+ *          globals, and Arduino-ESP32 adds PSRAM to the heap only after
+ *          static initialisation. Owners keep their hash indexes and bitmaps in
+ *          internal RAM, so only the record reads go through the PSRAM
+ *          cache.
+ */
+
+#ifndef RECORDPOOL_H
+#define RECORDPOOL_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <type_traits>
+#include "../Config.h"
+
+/**
+ * @class PoolMemory
+ * @brief Allocates the pools and keeps count of where they went
+ */
+class PoolMemory {
+public:
+  /**
+   * @brief Allocate zeroed pool memory (never returns nullptr)
+   * @details Stops the system if neither PSRAM nor internal RAM has room:
+   *          pool sizes are fixed at compile time, so this is a
+   *          configuration error, not a runtime condition
+   * @param bytes Size in bytes
+   * @param psram Output, true if placed in PSRAM
+   * @return Zeroed memory
+   */
+  static void* allocate(size_t bytes, bool& psram);
+
+  /**
+   * @brief Get the pool bytes placed in PSRAM
+   * @return Bytes
+   */
+  static size_t getPsramBytes();
+
+  /**
+   * @brief Get the pool bytes placed in internal RAM
+   * @return Bytes
+   */
+  static size_t getInternalBytes();
+
+private:
+  static size_t _psramBytes;      ///< Allocated from PSRAM
+  static size_t _internalBytes;   ///< Allocated from internal RAM
+};
+
+/**
+ * @class RecordPool
+ * @brief Array of N records of type T, allocated once and never freed
+ * @tparam T Plain record type (zero-initialised, never constructed)
+ * @tparam N Number of records
+ *
+ * Example usage:
+ * @code
+ * RecordPool<ParkingSlot, TOTAL_SLOTS> slots;   // No memory yet
+ * slots.allocate();                             // In the owner's begin()
+ * slots[0].occupied = true;
+ * @endcode
+ */
+template <typename T, int N>
+class RecordPool {
+  static_assert(N > 0, "A record pool needs at least one record");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Pool records are calloc'ed and copied bytewise, never constructed");
+
+public:
+  RecordPool() : _items(nullptr), _psram(false) {}
+
+  /**
+   * @brief Allocate the records, zeroed (later calls do nothing)
+   * @details Call from the owner's begin(); records must not be accessed
+   *          before
+   */
+  void allocate() {
+    if (_items == nullptr) {
+      _items = static_cast<T*>(PoolMemory::allocate(sizeof(T) * N, _psram));
+    }
+  }
+
+  RecordPool(const RecordPool&) = delete;
+  RecordPool& operator=(const RecordPool&) = delete;
+
+  T& operator[](int index) { return _items[index]; }
+  const T& operator[](int index) const { return _items[index]; }
+
+  /**
+   * @brief Check where the records live
+   * @return true if in PSRAM
+   */
+  bool isInPsram() const { return _psram; }
+
+  /**
+   * @brief Get the pool size
+   * @return sizeof(T) * N
+   */
+  static constexpr size_t bytes() { return sizeof(T) * N; }
+
+private:
+  T* _items;     ///< N records
+  bool _psram;   ///< _items is in PSRAM
+};
+
+#endif // RECORDPOOL_H
@@ -0,0 +1,201 @@
+/**
+ * @file RecordStore.cpp
+ * @brief Implementation of NVS-backed record storage
+ */
+
+#include "RecordStore.h"
+
+RecordStore::RecordStore(const char* nvsNamespace, size_t recordSize,
+                         const char* partition)
+  : _namespace(nvsNamespace),
+    _partition(partition),
+    _recordSize(recordSize),
+    _handle(0),
+    _open(false),
+    _inTransaction(false),
+    _pendingCommit(false),
+    _writeCount(0),
+    _skippedCount(0),
+    _commitCount(0) {
+}
+
+bool RecordStore::begin() {
+  if (_recordSize > RECORD_STORE_MAX_RECORD_SIZE) {
+    DEBUG_PRINTF("✗ RecordStore '%s': record size %u too large\n",
+                 _namespace, (unsigned)_recordSize);
+    return false;
+  }
+
+  esp_err_t err;
+  if (_partition == nullptr) {
+    // The Arduino core initialises the default NVS partition at boot
+    err = nvs_open(_namespace, NVS_READWRITE, &_handle);
+  } else {
+    err = nvs_flash_init_partition(_partition);
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+      DEBUG_PRINTF("⚠ RecordStore: formatting partition '%s'\n", _partition);
+      nvs_flash_erase_partition(_partition);
+      err = nvs_flash_init_partition(_partition);
+    }
+    if (err == ESP_OK) {
+      err = nvs_open_from_partition(_partition, _namespace, NVS_READWRITE, &_handle);
+    }
+  }
+  
+  if (err != ESP_OK) {
+    DEBUG_PRINTF("✗ RecordStore '%s': nvs_open failed (%d)\n", _namespace, err);
+    return false;
+  }
+
+  _open = true;
+  DEBUG_PRINTF("✓ RecordStore '%s' opened\n", _namespace);
+  return true;
+}
+
+bool RecordStore::readRecord(uint16_t index, void* record) const {
+  if (!_open) {
+    return false;
+  }
+
+  char key[8];
+  recordKey(index, key);
+
+  size_t length = _recordSize;
+  esp_err_t err = nvs_get_blob(_handle, key, record, &length);
+  return (err == ESP_OK && length == _recordSize);
+}
+
+bool RecordStore::writeRecord(uint16_t index, const void* record) {
+  if (!_open) {
+    return false;
+  }
+
+  char key[8];
+  recordKey(index, key);
+
+  // Skip the flash write entirely if the record is unchanged
+  uint8_t existing[RECORD_STORE_MAX_RECORD_SIZE];
+  size_t length = _recordSize;
+  if (nvs_get_blob(_handle, key, existing, &length) == ESP_OK &&
+      length == _recordSize &&
+      memcmp(existing, record, _recordSize) == 0) {
+    _skippedCount++;
+    return true;
+  }
+
+  if (nvs_set_blob(_handle, key, record, _recordSize) != ESP_OK) {
+    DEBUG_PRINTF("✗ RecordStore '%s': write %s failed\n", _namespace, key);
+    return false;
+  }
+
+  _writeCount++;
+  return commitIfNeeded();
+}
+
+bool RecordStore::eraseRecord(uint16_t index) {
+  if (!_open) {
+    return false;
+  }
+
+  char key[8];
+  recordKey(index, key);
+
+  esp_err_t err = nvs_erase_key(_handle, key);
+  if (err == ESP_ERR_NVS_NOT_FOUND) {
+    return true;
+  }
+  if (err != ESP_OK) {
+    return false;
+  }
+
+  _writeCount++;
+  return commitIfNeeded();
+}
+
+bool RecordStore::readMeta(const char* key, uint32_t& value) const {
+  if (!_open) {
+    return false;
+  }
+  return nvs_get_u32(_handle, key, &value) == ESP_OK;
+}
+
+bool RecordStore::writeMeta(const char* key, uint32_t value) {
+  if (!_open) {
+    return false;
+  }
+
+  uint32_t existing;
+  if (nvs_get_u32(_handle, key, &existing) == ESP_OK && existing == value) {
+    _skippedCount++;
+    return true;
+  }
+
+  if (nvs_set_u32(_handle, key, value) != ESP_OK) {
+    return false;
+  }
+
+  _writeCount++;
+  return commitIfNeeded();
+}
+
+bool RecordStore::eraseAll() {
+  if (!_open) {
+    return false;
+  }
+
+  if (nvs_erase_all(_handle) != ESP_OK) {
+    return false;
+  }
+
+  _writeCount++;
+  return commitIfNeeded();
+}
+
+void RecordStore::beginTransaction() {
+  _inTransaction = true;
+}
+
+bool RecordStore::commitTransaction() {
+  _inTransaction = false;
+
+  if (!_pendingCommit) {
+    return true;
+  }
+  return commitIfNeeded();
+}
+
+bool RecordStore::isInTransaction() const {
+  return _inTransaction;
+}
+
+unsigned long RecordStore::getWriteCount() const {
+  return _writeCount;
+}
+
+unsigned long RecordStore::getSkippedCount() const {
+  return _skippedCount;
+}
+
+unsigned long RecordStore::getCommitCount() const {
+  return _commitCount;
+}
+
+void RecordStore::recordKey(uint16_t index, char* key) {
+  snprintf(key, 8, "r%u", index);
+}
+
+bool RecordStore::commitIfNeeded() {
+  if (_inTransaction) {
+    _pendingCommit = true;
+    return true;
+  }
+
+  _pendingCommit = false;
+  if (nvs_commit(_handle) != ESP_OK) {
+    DEBUG_PRINTF("✗ RecordStore '%s': commit failed\n", _namespace);
+    return false;
+  }
+
+  _commitCount++;
+  return true;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file RecordStore.h
+ * @brief Record-level persistent storage on top of ESP32 NVS
+ * @details Stores fixed-size records under per-record NVS keys ("r0", "r1",
+ *          ...) in a private namespace, plus a few named 32-bit meta values.
+ *          NVS is log-structured and wear-levelled, so updating one record
+ *          appends one entry instead of rewriting a whole image. A store can
+ *          live in the default NVS partition or in a dedicated one.
+ */
+
+#ifndef RECORDSTORE_H
+#define RECORDSTORE_H
+
+#include <Arduino.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include "../Config.h"
+
+/**
+ * @class RecordStore
+ * @brief Fixed-size record storage with write skipping and transactions
+ *
+ * Writes that would not change the stored bytes are skipped. Outside a
+ * transaction every write is committed immediately; inside one, commits
+ * are deferred until commitTransaction() so a bulk update costs a single
+ * commit.
+ *
+ * Example usage:
+ * @code
+ * RecordStore store("whitelist", sizeof(RFIDCard));
+ * store.begin();
+ * store.beginTransaction();
+ * store.writeRecord(0, &card);
+ * store.writeMeta("count", 1);
+ * store.commitTransaction();
+ * @endcode
+ */
+class RecordStore {
+public:
+  /**
+   * @brief Constructor
+   * @param nvsNamespace NVS namespace (max 15 chars)
+   * @param recordSize Size of each record in bytes
+   *                   (max RECORD_STORE_MAX_RECORD_SIZE)
+   * @param partition NVS partition label (nullptr = default "nvs")
+   */
+  RecordStore(const char* nvsNamespace, size_t recordSize,
+              const char* partition = nullptr);
+
+  /**
+   * @brief Open the NVS namespace
+   * @details A dedicated partition is initialised here and erased if it
+   *          holds no valid NVS data
+   * @return true if successful
+   */
+  bool begin();
+
+  /**
+   * @brief Read a record
+   * @param index Record index
+   * @param record Output buffer of recordSize bytes
+   * @return true if the record exists and has the expected size
+   */
+  bool readRecord(uint16_t index, void* record) const;
+
+  /**
+   * @brief Write a record (skipped if the stored bytes are identical)
+   * @param index Record index
+   * @param record Record data of recordSize bytes
+   * @return true if stored
+   */
+  bool writeRecord(uint16_t index, const void* record);
+
+  /**
+   * @brief Delete a record
+   * @param index Record index
+   * @return true if deleted or not present
+   */
+  bool eraseRecord(uint16_t index);
+
+  /**
+   * @brief Read a named meta value
+   * @param key Meta key (max 15 chars, must not start with 'r')
+   * @param value Output parameter
+   * @return true if present
+   */
+  bool readMeta(const char* key, uint32_t& value) const;
+
+  /**
+   * @brief Write a named meta value (skipped if unchanged)
+   * @param key Meta key
+   * @param value Value to store
+   * @return true if stored
+   */
+  bool writeMeta(const char* key, uint32_t value);
+
+  /**
+   * @brief Delete every record and meta value in the namespace
+   * @return true if successful
+   */
+  bool eraseAll();
+
+  /**
+   * @brief Defer commits until commitTransaction()
+   */
+  void beginTransaction();
+
+  /**
+   * @brief Commit all writes since beginTransaction()
+   * @return true if committed
+   */
+  bool commitTransaction();
+
+  /**
+   * @brief Check if a transaction is open
+   * @return true if inside a transaction
+   */
+  bool isInTransaction() const;
+
+  /**
+   * @brief Get number of record/meta writes that reached flash
+   * @return Write count
+   */
+  unsigned long getWriteCount() const;
+
+  /**
+   * @brief Get number of writes skipped because nothing changed
+   * @return Skipped write count
+   */
+  unsigned long getSkippedCount() const;
+
+  /**
+   * @brief Get number of NVS commits
+   * @return Commit count
+   */
+  unsigned long getCommitCount() const;
+
+private:
+  const char* _namespace;        ///< NVS namespace
+  const char* _partition;        ///< NVS partition label (nullptr = default)
+  size_t _recordSize;            ///< Bytes per record
+  nvs_handle_t _handle;          ///< Open NVS handle
+  bool _open;                    ///< Namespace opened successfully
+  bool _inTransaction;           ///< Commits deferred
+  bool _pendingCommit;           ///< Writes waiting for commit
+  unsigned long _writeCount;     ///< Writes that reached flash
+  unsigned long _skippedCount;   ///< Writes skipped as unchanged
+  unsigned long _commitCount;    ///< NVS commits
+
+  /**
+   * @brief Build the NVS key for a record
+   * @param index Record index
+   * @param key Output buffer (at least 8 bytes)
+   */
+  static void recordKey(uint16_t index, char* key);
+
+  /**
+   * @brief Commit now, or mark pending inside a transaction
+   * @return true if successful
+   */
+  bool commitIfNeeded();
+};
+
+#endif // RECORDSTORE_H
@@ -0,0 +1,22 @@
+/**
+ * @file RetryBackoff.cpp
+ * @brief Implementation of jittered exponential backoff
+ */
+
+#include "RetryBackoff.h"
+
+RetryBackoff::RetryBackoff(unsigned long minDelay, unsigned long maxDelay)
+  : _min(minDelay),
+    _max(maxDelay),
+    _ceiling(minDelay) {
+}
+
+unsigned long RetryBackoff::next() {
+  unsigned long delayMs = _ceiling / 2 + esp_random() % (_ceiling / 2);
+  _ceiling = (_ceiling >= _max / 2) ? _max : _ceiling * 2;
+  return delayMs;
+}
+
+void RetryBackoff::reset() {
+  _ceiling = _min;
+}
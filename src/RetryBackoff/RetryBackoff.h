@@ -0,0 +1,55 @@
+/**
+ * @file RetryBackoff.h
+ * @brief Jittered exponential backoff for reconnect attempts
+ * @details Shared by the WiFi link (NetworkManager) and the broker session
+ *          (MQTTHandler), which retry on the same schedule with their own
+ *          limits.
+ */
+
+#ifndef RETRYBACKOFF_H
+#define RETRYBACKOFF_H
+
+#include <Arduino.h>
+
+/**
+ * @class RetryBackoff
+ * @brief Retry delay that doubles per failure, with random jitter
+ *
+ * Each delay is drawn from [ceiling/2, ceiling), so controllers that lost
+ * the AP or the broker together do not retry in lockstep. The ceiling
+ * starts at the minimum and doubles per failure up to the maximum.
+ *
+ * Example usage:
+ * @code
+ * RetryBackoff backoff(WIFI_BACKOFF_MIN, WIFI_BACKOFF_MAX);
+ * unsigned long delayMs = backoff.next();   // after a failed attempt
+ * backoff.reset();                          // once connected
+ * @endcode
+ */
+class RetryBackoff {
+public:
+  /**
+   * @brief Constructor
+   * @param minDelay First retry ceiling (ms, at least 2)
+   * @param maxDelay Ceiling cap (ms)
+   */
+  RetryBackoff(unsigned long minDelay, unsigned long maxDelay);
+
+  /**
+   * @brief Delay before the next attempt, then double the ceiling
+   * @return Delay in ms
+   */
+  unsigned long next();
+
+  /**
+   * @brief Start again from the minimum (after a success)
+   */
+  void reset();
+
+private:
+  unsigned long _min;       ///< First retry ceiling (ms)
+  unsigned long _max;       ///< Ceiling cap (ms)
+  unsigned long _ceiling;   ///< Current ceiling (ms)
+};
+
+#endif // RETRYBACKOFF_H
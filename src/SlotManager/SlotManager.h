@@ -1,7 +1,17 @@
 /**
  * @file SlotManager.h
  * @brief Parking slot allocation and tracking system
- * @details Manages 10 parking slots with card assignment tracking
+ * @details Manages a fixed number of parking slots with card assignment
+ *          tracking. Free slots are kept in a two-level bitmap and cards are
+ *          mapped to their slot through an open-addressing hash index, so
+ *          allocate, find and release take constant time at any garage size.
+ *          Slots are grouped into zones restricted by access level; an
+ *          allocation policy picks the slot inside a zone, and per-zone
+ *          free counters are kept incrementally.
+ *          Occupied slots are persisted as one NVS record each, so parked
+ *          cars and their entry times survive a reboot. Durations are
+ *          measured on the monotonic clock; wall-clock entry times are only
+ *          reported, and used for cars that entered before a reboot.
  */
 
 #ifndef SLOTMANAGER_H
@@ -9,50 +19,155 @@
 
 #include <Arduino.h>
 #include "../Config.h"
+#include "../CardUid/CardUid.h"
+#include "../RecordStore/RecordStore.h"
+#include "../RecordPool/RecordPool.h"
+#include "../TimeSync/TimeSync.h"
+#include "../LatencyTracer/LatencyTracer.h"
 
 /**
  * @struct ParkingSlot
- * @brief Structure to hold parking slot information
+ * @brief Structure to hold parking slot information (20 bytes)
+ * @details The slot number is the position in the table plus one
  */
 struct ParkingSlot {
-  bool occupied;                ///< Occupation status
-  char cardUID[20];            ///< UID of card assigned to this slot
-  unsigned long entryTime;      ///< Entry timestamp
-  int slotNumber;              ///< Slot identifier (1-based)
+  CardUid cardUID;             ///< UID of card assigned to this slot
+  uint8_t occupied : 1;        ///< Occupation status
+  uint8_t restored : 1;        ///< Entered before the last reboot (entryUptime invalid)
+  uint32_t entryTime;          ///< Entry wall-clock time (Unix seconds, 0 = unknown)
+  uint32_t entryUptime;        ///< Monotonic seconds at entry (this boot)
 };
 
 /**
- * @class SlotManager
+ * @struct SlotRecord
+ * @brief Occupied slot as stored in NVS (packed, 16 bytes)
+ */
+struct SlotRecord {
+  CardUid cardUID;        ///< UID of card assigned to the slot
+  uint8_t reserved;       ///< Padding, always 0
+  uint32_t entryTime;     ///< Entry wall-clock time (Unix seconds, 0 = unknown)
+};
+
+/**
+ * @struct SlotZone
+ * @brief Contiguous range of slots open to a set of access levels
+ */
+struct SlotZone {
+  int16_t firstSlot;      ///< First slot number (1-based, inclusive)
+  int16_t lastSlot;       ///< Last slot number (inclusive)
+  uint8_t accessMask;     ///< SLOT_ZONE_ACCESS() bits of levels allowed
+};
+
+/**
+ * @brief Smallest power of two holding 2 * slots (keeps the load factor <= 0.5)
+ */
+static constexpr int slotIndexSize(int slots, int size = 1) {
+  return (size >= 2 * slots) ? size : slotIndexSize(slots, size * 2);
+}
+
+/**
+ * @class SlotManagerT
  * @brief Manages parking slot allocation and tracking
- * 
+ * @tparam N Number of slots (1-based slot numbers 1..N)
+ *
+ * A card is placed in the first zone (in table order) that admits its
+ * access level and has a free slot; the zone's free counter makes skipping
+ * full zones O(1). Within the zone the policy decides: lowest slot, round
+ * robin, or nearest the exit. The free bitmap has a summary word with one
+ * bit per bitmap word that still has a free slot, so each search is a few
+ * count-leading/trailing-zeros operations for up to 1024 slots.
+ *
  * Example usage:
  * @code
- * SlotManager slotMgr;
+ * SlotManagerT<400> slotMgr(timeSync);
  * slotMgr.begin();
- * int slot = slotMgr.allocateSlot("0A1B2C3D");
+ * slotMgr.setPolicy(SLOT_POLICY_ROUND_ROBIN);
+ * int slot = slotMgr.allocateSlot(cardUid, ACCESS_REGULAR);
  * unsigned long duration = slotMgr.releaseSlot(slot);
  * @endcode
  */
-class SlotManager {
+template <int N>
+class SlotManagerT {
+  static_assert(N > 0 && N <= 32767, "Slot count must fit the int16_t index");
+
 public:
   /**
    * @brief Constructor
+   * @param clock Time service for entry timestamps (must outlive the manager)
    */
-  SlotManager();
+  explicit SlotManagerT(const TimeSync& clock);
 
   /**
-   * @brief Initialize slot manager
-   * @return true if successful
+   * @brief Initialize slot manager and restore persisted occupancy
+   * @return true if successful (occupancy is kept in RAM only if NVS fails)
    */
   bool begin();
 
+  /**
+   * @brief Stamp slots taken before the first NTP sync (call every gate iteration)
+   * @details Their records were stored without an entry time. Once the
+   *          clock syncs, the entry time is derived from the monotonic one
+   *          and the records are rewritten, so a reboot before the car
+   *          leaves still bills the full stay. Does nothing after that.
+   */
+  void update();
+
   /**
    * @brief Allocate a parking slot to a card
    * @param cardUID Card UID to assign
-   * @param entryTime Entry timestamp (0 = use current time)
-   * @return Slot number (1-based), or -1 if no slots available
+   * @param accessLevel Card access level (selects the zones it may use)
+   * @return Slot number (1-based), or -1 if no slot is available to it
+   */
+  int allocateSlot(const CardUid& cardUID, int accessLevel = ACCESS_REGULAR);
+
+  /**
+   * @brief Replace the zone table
+   * @details Zones must lie within 1..N and must not overlap. Slots outside
+   *          every zone are never allocated.
+   * @param zones Zone table (copied)
+   * @param count Number of zones (max SLOT_MAX_ZONES)
+   * @return true if the table was valid and applied
+   */
+  bool configureZones(const SlotZone* zones, int count);
+
+  /**
+   * @brief Select how a slot is chosen within a zone
+   * @param policy Allocation policy
+   */
+  void setPolicy(SlotAllocationPolicy policy);
+
+  /**
+   * @brief Get the allocation policy
+   * @return Current policy
+   */
+  SlotAllocationPolicy getPolicy() const;
+
+  /**
+   * @brief Get number of zones
+   * @return Zone count
+   */
+  int getZoneCount() const;
+
+  /**
+   * @brief Get free slots in a zone
+   * @param zone Zone index (0-based)
+   * @return Free slots, or 0 for an invalid zone
    */
-  int allocateSlot(const String& cardUID, unsigned long entryTime = 0);
+  int getZoneAvailableSlots(int zone) const;
+
+  /**
+   * @brief Get free slots a card of the given access level could take
+   * @param accessLevel Access level
+   * @return Free slots across the zones open to that level
+   */
+  int getAvailableSlotsFor(int accessLevel) const;
+
+  /**
+   * @brief Get the zone a slot belongs to
+   * @param slotNumber Slot number (1-based)
+   * @return Zone index, or -1 if the slot is in no zone
+   */
+  int getZoneOfSlot(int slotNumber) const;
 
   /**
    * @brief Release a parking slot by slot number
@@ -67,14 +182,14 @@ public:
    * @param slotNumber Output parameter for released slot number
    * @return Duration in seconds, or 0 if card not found
    */
-  unsigned long releaseSlotByCard(const String& cardUID, int& slotNumber);
+  unsigned long releaseSlotByCard(const CardUid& cardUID, int& slotNumber);
 
   /**
    * @brief Find slot number assigned to a card
    * @param cardUID Card UID to search for
    * @return Slot number (1-based), or -1 if not found
    */
-  int findSlotByCard(const String& cardUID) const;
+  int findSlotByCard(const CardUid& cardUID) const;
 
   /**
    * @brief Check if a slot is occupied
@@ -98,7 +213,8 @@ public:
   /**
    * @brief Get slot information
    * @param slotNumber Slot number (1-based)
-   * @param slot Output parameter for slot data
+   * @param slot Output parameter for slot data (entryTime filled in if the
+   *             car entered before NTP synced)
    * @return true if valid slot number, false otherwise
    */
   bool getSlotInfo(int slotNumber, ParkingSlot& slot) const;
@@ -106,10 +222,9 @@ public:
   /**
    * @brief Get parking duration for a slot
    * @param slotNumber Slot number (1-based)
-   * @param currentTime Current timestamp
-   * @return Duration in seconds, or 0 if not occupied
+   * @return Duration in seconds, or 0 if not occupied or unknown
    */
-  unsigned long getSlotDuration(int slotNumber, unsigned long currentTime) const;
+  unsigned long getSlotDuration(int slotNumber) const;
 
   /**
    * @brief Clear all slots (for testing/reset)
@@ -118,27 +233,127 @@ public:
 
   /**
    * @brief Get array of all slots (for status reporting)
-   * @param slots Output array (must be size TOTAL_SLOTS)
+   * @param slots Output array (must be size N; entry i is slot i + 1)
    * @param maxSlots Maximum slots to copy
    * @return Number of slots copied
    */
   int getAllSlots(ParkingSlot* slots, int maxSlots) const;
 
 private:
-  ParkingSlot _slots[TOTAL_SLOTS];  ///< Array of parking slots
-  int _availableSlots;               ///< Count of available slots
-  bool _initialized;                 ///< Initialization status
+  static const int INDEX_SIZE = slotIndexSize(N);      ///< Hash buckets
+  static const int BITMAP_WORDS = (N + 31) / 32;       ///< Free-slot bitmap words
+  static const int SUMMARY_WORDS = (BITMAP_WORDS + 31) / 32;  ///< Summary words
+
+  RecordPool<ParkingSlot, N> _slots;     ///< Parking slots (PSRAM when available)
+  int _availableSlots;                   ///< Count of available slots
+  bool _initialized;                     ///< Initialization status
+  uint32_t _freeBits[BITMAP_WORDS];      ///< Bit set = slot free
+  uint32_t _freeSummary[SUMMARY_WORDS];  ///< Bit set = bitmap word has a free slot
+  int16_t _index[INDEX_SIZE];            ///< Hash buckets -> slot index (-1 = empty)
+  SlotZone _zones[SLOT_MAX_ZONES];       ///< Zone table
+  int _zoneCount;                        ///< Zones in use
+  int _zoneFree[SLOT_MAX_ZONES];         ///< Free slots per zone
+  int _zoneCursor[SLOT_MAX_ZONES];       ///< Round-robin start index per zone
+  SlotAllocationPolicy _policy;          ///< Slot choice within a zone
+  const TimeSync& _clock;                ///< Entry timestamp source
+  RecordStore _store;                    ///< Occupied slot records
+  bool _storeReady;                      ///< _store opened successfully
+  bool _entryTimesStamped;               ///< update() ran after the clock synced
 
   /**
-   * @brief Find first available slot
+   * @brief Mark every slot free and empty the index
+   */
+  void resetSlots();
+
+  /**
+   * @brief Load occupied slots from NVS
+   * @return Number of slots restored
+   */
+  int restoreSlots();
+
+  /**
+   * @brief Persist one slot (record written if occupied, erased if free)
+   * @param index Slot index (0-based)
+   */
+  void persistSlot(int index);
+
+  /**
+   * @brief Get how long a slot has been occupied
+   * @details Monotonic for cars that entered this boot; wall-clock (needs
+   *          NTP) for cars restored from NVS.
+   * @param index Slot index (0-based, occupied)
+   * @return Duration in seconds, or 0 if unknown
+   */
+  unsigned long elapsedSeconds(int index) const;
+
+  /**
+   * @brief Get the wall-clock entry time of a slot
+   * @param index Slot index (0-based)
+   * @return Unix seconds, or 0 if unknown
+   */
+  unsigned long wallEntryTime(int index) const;
+
+  /**
+   * @brief Choose a free slot for an access level
+   * @param accessLevel Access level
    * @return Slot index (0-based), or -1 if none available
    */
-  int findAvailableSlot() const;
+  int findAvailableSlot(int accessLevel) const;
+
+  /**
+   * @brief Find the lowest free slot in [from, to)
+   * @return Slot index (0-based), or -1
+   */
+  int findFreeInRange(int from, int to) const;
+
+  /**
+   * @brief Find the highest free slot in [from, to)
+   * @return Slot index (0-based), or -1
+   */
+  int findLastFreeInRange(int from, int to) const;
+
+  /**
+   * @brief Mark a slot free or taken in the bitmap and zone counters
+   * @param index Slot index (0-based)
+   * @param free true if the slot became free
+   */
+  void setFree(int index, bool free);
+
+  /**
+   * @brief Find the zone holding a slot
+   * @param index Slot index (0-based)
+   * @return Zone index, or -1
+   */
+  int zoneOfIndex(int index) const;
+
+  /**
+   * @brief Recount free slots per zone and reset cursors
+   */
+  void recountZones();
+
+  /**
+   * @brief Find a card's slot index through the hash index
+   * @param cardUID Card UID
+   * @return Slot index (0-based), or -1 if not parked
+   */
+  int findIndex(const CardUid& cardUID) const;
+
+  /**
+   * @brief Add an occupied slot to the hash index
+   * @param index Slot index (0-based)
+   */
+  void indexInsert(int index);
+
+  /**
+   * @brief Remove an occupied slot from the hash index
+   * @param index Slot index (0-based)
+   */
+  void indexRemove(int index);
 
   /**
    * @brief Validate slot number
    * @param slotNumber Slot number (1-based)
-   * @return true if valid (1-10), false otherwise
+   * @return true if valid (1-N), false otherwise
    */
   bool isValidSlotNumber(int slotNumber) const;
 
@@ -150,4 +365,10 @@ private:
   int slotNumberToIndex(int slotNumber) const;
 };
 
+// The system-wide slot manager
+typedef SlotManagerT<TOTAL_SLOTS> SlotManager;
+
+// Template member definitions
+#include "SlotManagerImpl.h"
+
 #endif // SLOTMANAGER_H
@@ -0,0 +1,651 @@
+/**
+ * @file SlotManagerImpl.h
+ * @brief Implementation of parking slot management system
+ * @details Included by SlotManager.h; templates must be visible wherever a
+ *          SlotManagerT<N> is used.
+ */
+
+#ifndef SLOTMANAGERIMPL_H
+#define SLOTMANAGERIMPL_H
+
+template <int N>
+SlotManagerT<N>::SlotManagerT(const TimeSync& clock)
+  : _availableSlots(N),
+    _initialized(false),
+    _zoneCount(1),
+    _policy(SLOT_ALLOCATION_POLICY),
+    _clock(clock),
+    _store(SLOT_NVS_NAMESPACE, sizeof(SlotRecord)),
+    _storeReady(false),
+    _entryTimesStamped(false) {
+  
+  // One zone with every slot, open to all levels
+  _zones[0].firstSlot = 1;
+  _zones[0].lastSlot = N;
+  _zones[0].accessMask = 0xFF;
+}
+
+template <int N>
+bool SlotManagerT<N>::begin() {
+  // Initialize all slots (PSRAM is only usable from here on)
+  _slots.allocate();
+  resetSlots();
+  _initialized = true;
+  
+  _storeReady = _store.begin();
+  if (_storeReady) {
+    int restored = restoreSlots();
+    if (restored > 0) {
+      DEBUG_PRINTF("✓ Restored %d occupied slots\n", restored);
+    }
+  } else {
+    DEBUG_PRINTLN("✗ Slot storage unavailable, occupancy will not survive reboot");
+  }
+  
+  DEBUG_PRINTF("✓ Slot Manager initialized with %d slots (%u byte pool in %s)\n", N,
+               (unsigned)_slots.bytes(), _slots.isInPsram() ? "PSRAM" : "internal RAM");
+  return true;
+}
+
+template <int N>
+void SlotManagerT<N>::update() {
+  if (_entryTimesStamped || !_initialized || !_clock.isSynced()) {
+    return;
+  }
+  _entryTimesStamped = true;
+  
+  // Slots restored from a previous boot keep whatever they had
+  int stamped = 0;
+  for (int i = 0; i < N; i++) {
+    if (_slots[i].occupied && !_slots[i].restored && _slots[i].entryTime == 0) {
+      _slots[i].entryTime = _clock.toWallClock(_slots[i].entryUptime);
+      persistSlot(i);
+      stamped++;
+    }
+  }
+  
+  if (stamped > 0) {
+    DEBUG_PRINTF("✓ Stored entry times of %d slots taken before NTP sync\n", stamped);
+  }
+}
+
+template <int N>
+int SlotManagerT<N>::allocateSlot(const CardUid& cardUID, int accessLevel) {
+  TraceScope trace(TRACE_SLOT_ALLOCATE);
+  
+  if (!_initialized) {
+    DEBUG_PRINTLN("✗ SlotManager not initialized");
+    return -1;
+  }
+  
+  char uidHex[CARD_UID_HEX_SIZE];
+  cardUID.toHex(uidHex, sizeof(uidHex));
+  
+  // Check if card already has a slot
+  int existingSlot = findSlotByCard(cardUID);
+  if (existingSlot != -1) {
+    DEBUG_PRINTF("⚠ Card %s already has slot %d\n", uidHex, existingSlot);
+    return existingSlot;
+  }
+  
+  // Find available slot in a zone open to this card
+  int slotIndex = findAvailableSlot(accessLevel);
+  if (slotIndex == -1) {
+    DEBUG_PRINTF("✗ No available slots for access level %d\n", accessLevel);
+    return -1;
+  }
+  
+  // Allocate slot
+  _slots[slotIndex].occupied = true;
+  _slots[slotIndex].restored = false;
+  _slots[slotIndex].cardUID = cardUID;
+  _slots[slotIndex].entryUptime = TimeSync::monotonicSeconds();
+  _slots[slotIndex].entryTime = _clock.toWallClock(_slots[slotIndex].entryUptime);
+  _availableSlots--;
+  setFree(slotIndex, false);
+  indexInsert(slotIndex);
+  persistSlot(slotIndex);
+  
+  // Round robin continues after this slot
+  int zone = zoneOfIndex(slotIndex);
+  if (zone != -1) {
+    _zoneCursor[zone] = slotIndex + 1;
+  }
+  
+  int slotNumber = slotIndex + 1;
+  DEBUG_PRINTF("✓ Allocated slot %d to card %s\n", slotNumber, uidHex);
+  
+  return slotNumber;
+}
+
+template <int N>
+bool SlotManagerT<N>::configureZones(const SlotZone* zones, int count) {
+  if (count < 1 || count > SLOT_MAX_ZONES) {
+    DEBUG_PRINTF("✗ Invalid slot zone count: %d\n", count);
+    return false;
+  }
+  
+  for (int z = 0; z < count; z++) {
+    if (zones[z].firstSlot < 1 || zones[z].lastSlot > N ||
+        zones[z].firstSlot > zones[z].lastSlot) {
+      DEBUG_PRINTF("✗ Slot zone %d out of range\n", z);
+      return false;
+    }
+    for (int other = 0; other < z; other++) {
+      if (zones[z].firstSlot <= zones[other].lastSlot &&
+          zones[other].firstSlot <= zones[z].lastSlot) {
+        DEBUG_PRINTF("✗ Slot zones %d and %d overlap\n", other, z);
+        return false;
+      }
+    }
+  }
+  
+  for (int z = 0; z < count; z++) {
+    _zones[z] = zones[z];
+  }
+  _zoneCount = count;
+  recountZones();
+  
+  DEBUG_PRINTF("✓ %d slot zones configured\n", count);
+  return true;
+}
+
+template <int N>
+void SlotManagerT<N>::setPolicy(SlotAllocationPolicy policy) {
+  _policy = policy;
+}
+
+template <int N>
+SlotAllocationPolicy SlotManagerT<N>::getPolicy() const {
+  return _policy;
+}
+
+template <int N>
+int SlotManagerT<N>::getZoneCount() const {
+  return _zoneCount;
+}
+
+template <int N>
+int SlotManagerT<N>::getZoneAvailableSlots(int zone) const {
+  if (zone < 0 || zone >= _zoneCount) {
+    return 0;
+  }
+  return _zoneFree[zone];
+}
+
+template <int N>
+int SlotManagerT<N>::getAvailableSlotsFor(int accessLevel) const {
+  int available = 0;
+  for (int z = 0; z < _zoneCount; z++) {
+    if (_zones[z].accessMask & SLOT_ZONE_ACCESS(accessLevel)) {
+      available += _zoneFree[z];
+    }
+  }
+  return available;
+}
+
+template <int N>
+int SlotManagerT<N>::getZoneOfSlot(int slotNumber) const {
+  if (!isValidSlotNumber(slotNumber)) {
+    return -1;
+  }
+  return zoneOfIndex(slotNumberToIndex(slotNumber));
+}
+
+template <int N>
+unsigned long SlotManagerT<N>::releaseSlot(int slotNumber) {
+  if (!_initialized || !isValidSlotNumber(slotNumber)) {
+    return 0;
+  }
+  
+  int index = slotNumberToIndex(slotNumber);
+  
+  if (!_slots[index].occupied) {
+    DEBUG_PRINTF("⚠ Slot %d is not occupied\n", slotNumber);
+    return 0;
+  }
+  
+  // Calculate duration
+  unsigned long duration = elapsedSeconds(index);
+  
+  // Release slot (unindex while the UID is still there)
+  char uidHex[CARD_UID_HEX_SIZE];
+  _slots[index].cardUID.toHex(uidHex, sizeof(uidHex));
+  indexRemove(index);
+  _slots[index].occupied = false;
+  _slots[index].cardUID.clear();
+  _slots[index].entryTime = 0;
+  _slots[index].restored = false;
+  _availableSlots++;
+  setFree(index, true);
+  persistSlot(index);
+  
+  DEBUG_PRINTF("✓ Released slot %d (card %s, duration %lus)\n",
+               slotNumber, uidHex, duration);
+  
+  return duration;
+}
+
+template <int N>
+unsigned long SlotManagerT<N>::releaseSlotByCard(const CardUid& cardUID, int& slotNumber) {
+  slotNumber = findSlotByCard(cardUID);
+  
+  if (slotNumber == -1) {
+    char uidHex[CARD_UID_HEX_SIZE];
+    cardUID.toHex(uidHex, sizeof(uidHex));
+    DEBUG_PRINTF("⚠ Card %s not found in any slot\n", uidHex);
+    return 0;
+  }
+  
+  return releaseSlot(slotNumber);
+}
+
+template <int N>
+int SlotManagerT<N>::findSlotByCard(const CardUid& cardUID) const {
+  int index = findIndex(cardUID);
+  return (index == -1) ? -1 : index + 1;
+}
+
+template <int N>
+bool SlotManagerT<N>::isSlotOccupied(int slotNumber) const {
+  if (!isValidSlotNumber(slotNumber)) {
+    return false;
+  }
+  
+  int index = slotNumberToIndex(slotNumber);
+  return _slots[index].occupied;
+}
+
+template <int N>
+int SlotManagerT<N>::getAvailableSlots() const {
+  return _availableSlots;
+}
+
+template <int N>
+int SlotManagerT<N>::getTotalSlots() const {
+  return N;
+}
+
+template <int N>
+bool SlotManagerT<N>::getSlotInfo(int slotNumber, ParkingSlot& slot) const {
+  if (!isValidSlotNumber(slotNumber)) {
+    return false;
+  }
+  
+  int index = slotNumberToIndex(slotNumber);
+  slot = _slots[index];
+  if (slot.occupied) {
+    slot.entryTime = wallEntryTime(index);
+  }
+  return true;
+}
+
+template <int N>
+unsigned long SlotManagerT<N>::getSlotDuration(int slotNumber) const {
+  if (!isValidSlotNumber(slotNumber)) {
+    return 0;
+  }
+  
+  int index = slotNumberToIndex(slotNumber);
+  
+  if (!_slots[index].occupied) {
+    return 0;
+  }
+  
+  return elapsedSeconds(index);
+}
+
+template <int N>
+void SlotManagerT<N>::clearAllSlots() {
+  resetSlots();
+  
+  if (_storeReady) {
+    _store.eraseAll();
+  }
+  DEBUG_PRINTLN("✓ All slots cleared");
+}
+
+template <int N>
+int SlotManagerT<N>::getAllSlots(ParkingSlot* slots, int maxSlots) const {
+  int count = (maxSlots < N) ? maxSlots : N;
+  
+  for (int i = 0; i < count; i++) {
+    slots[i] = _slots[i];
+    if (slots[i].occupied) {
+      slots[i].entryTime = wallEntryTime(i);
+    }
+  }
+  
+  return count;
+}
+
+template <int N>
+void SlotManagerT<N>::resetSlots() {
+  for (int i = 0; i < N; i++) {
+    _slots[i].occupied = false;
+    _slots[i].restored = false;
+    _slots[i].cardUID.clear();
+    _slots[i].entryTime = 0;
+    _slots[i].entryUptime = 0;
+  }
+  
+  // Every slot free; bits past N stay clear so they are never found
+  for (int z = 0; z < SLOT_MAX_ZONES; z++) {
+    _zoneFree[z] = 0;
+  }
+  for (int w = 0; w < BITMAP_WORDS; w++) {
+    _freeBits[w] = 0;
+  }
+  for (int w = 0; w < SUMMARY_WORDS; w++) {
+    _freeSummary[w] = 0;
+  }
+  for (int i = 0; i < N; i++) {
+    setFree(i, true);
+  }
+  
+  for (int i = 0; i < INDEX_SIZE; i++) {
+    _index[i] = -1;
+  }
+  
+  _availableSlots = N;
+  recountZones();
+}
+
+template <int N>
+int SlotManagerT<N>::restoreSlots() {
+  int restored = 0;
+  
+  for (int i = 0; i < N; i++) {
+    SlotRecord record;
+    if (!_store.readRecord(i, &record)) {
+      continue;
+    }
+  
+    // A card can only hold one slot; drop corrupt or duplicate records
+    if (record.cardUID.length == 0 || findIndex(record.cardUID) != -1) {
+      _store.eraseRecord(i);
+      continue;
+    }
+  
+    _slots[i].occupied = true;
+    _slots[i].cardUID = record.cardUID;
+    _slots[i].restored = true;
+    _slots[i].entryTime = record.entryTime;
+    _slots[i].entryUptime = 0;
+    _availableSlots--;
+    setFree(i, false);
+    indexInsert(i);
+    restored++;
+  }
+  
+  return restored;
+}
+
+template <int N>
+void SlotManagerT<N>::persistSlot(int index) {
+  if (!_storeReady) {
+    return;
+  }
+  
+  if (!_slots[index].occupied) {
+    _store.eraseRecord(index);
+    return;
+  }
+  
+  SlotRecord record;
+  memset(&record, 0, sizeof(record));
+  record.cardUID = _slots[index].cardUID;
+  record.entryTime = wallEntryTime(index);
+  
+  if (!_store.writeRecord(index, &record)) {
+    DEBUG_PRINTF("✗ Failed to persist slot %d\n", index + 1);
+  }
+}
+
+template <int N>
+unsigned long SlotManagerT<N>::elapsedSeconds(int index) const {
+  if (!_slots[index].restored) {
+    return TimeSync::monotonicSeconds() - _slots[index].entryUptime;
+  }
+  
+  // Entered before the reboot: only the wall clock spans both boots
+  unsigned long now;
+  if (_slots[index].entryTime == 0 || !_clock.getWallClock(now) ||
+      now < _slots[index].entryTime) {
+    DEBUG_PRINTF("⚠ Slot %d: entry time unknown, duration not measured\n",
+                 index + 1);
+    return 0;
+  }
+  return now - _slots[index].entryTime;
+}
+
+template <int N>
+unsigned long SlotManagerT<N>::wallEntryTime(int index) const {
+  // Entered before NTP synced: derive it from the monotonic entry time
+  if (_slots[index].entryTime == 0 && !_slots[index].restored) {
+    return _clock.toWallClock(_slots[index].entryUptime);
+  }
+  return _slots[index].entryTime;
+}
+
+template <int N>
+int SlotManagerT<N>::findAvailableSlot(int accessLevel) const {
+  for (int z = 0; z < _zoneCount; z++) {
+    if (!(_zones[z].accessMask & SLOT_ZONE_ACCESS(accessLevel)) ||
+        _zoneFree[z] == 0) {
+      continue;
+    }
+    
+    int from = _zones[z].firstSlot - 1;
+    int to = _zones[z].lastSlot;
+    int index = -1;
+    
+    switch (_policy) {
+      case SLOT_POLICY_ROUND_ROBIN:
+        index = findFreeInRange(_zoneCursor[z], to);
+        if (index == -1) {
+          index = findFreeInRange(from, _zoneCursor[z]);
+        }
+        break;
+        
+      case SLOT_POLICY_NEAREST_EXIT:
+        index = findLastFreeInRange(from, to);
+        break;
+        
+      case SLOT_POLICY_LOWEST:
+      default:
+        index = findFreeInRange(from, to);
+        break;
+    }
+    
+    if (index != -1) {
+      return index;
+    }
+  }
+  return -1;
+}
+
+template <int N>
+int SlotManagerT<N>::findFreeInRange(int from, int to) const {
+  if (from >= to) {
+    return -1;
+  }
+  
+  // Rest of the first word, then the next word the summary marks as free
+  int word = from / 32;
+  uint32_t bits = _freeBits[word] & (0xFFFFFFFFUL << (from % 32));
+  if (bits == 0) {
+    int lastWord = (to - 1) / 32;
+    word++;
+    bits = 0;
+    while (word <= lastWord) {
+      int s = word / 32;
+      uint32_t summary = _freeSummary[s] & (0xFFFFFFFFUL << (word % 32));
+      if (summary != 0) {
+        word = s * 32 + __builtin_ctz(summary);
+        if (word <= lastWord) {
+          bits = _freeBits[word];
+        }
+        break;
+      }
+      word = (s + 1) * 32;
+    }
+    if (bits == 0) {
+      return -1;
+    }
+  }
+  
+  int index = word * 32 + __builtin_ctz(bits);
+  return (index < to) ? index : -1;
+}
+
+template <int N>
+int SlotManagerT<N>::findLastFreeInRange(int from, int to) const {
+  if (from >= to) {
+    return -1;
+  }
+  
+  // Start of the last word, then the previous word the summary marks as free
+  int last = to - 1;
+  int word = last / 32;
+  uint32_t bits = _freeBits[word] & (0xFFFFFFFFUL >> (31 - last % 32));
+  if (bits == 0) {
+    int firstWord = from / 32;
+    word--;
+    bits = 0;
+    while (word >= firstWord) {
+      int s = word / 32;
+      uint32_t summary = _freeSummary[s] & (0xFFFFFFFFUL >> (31 - word % 32));
+      if (summary != 0) {
+        word = s * 32 + 31 - __builtin_clz(summary);
+        if (word >= firstWord) {
+          bits = _freeBits[word];
+        }
+        break;
+      }
+      word = s * 32 - 1;
+    }
+    if (bits == 0) {
+      return -1;
+    }
+  }
+  
+  int index = word * 32 + 31 - __builtin_clz(bits);
+  return (index >= from) ? index : -1;
+}
+
+template <int N>
+void SlotManagerT<N>::setFree(int index, bool free) {
+  int word = index / 32;
+  uint32_t bit = 1UL << (index % 32);
+  uint32_t summaryBit = 1UL << (word % 32);
+  
+  int zone = zoneOfIndex(index);
+  if (zone != -1 && ((_freeBits[word] & bit) != 0) != free) {
+    _zoneFree[zone] += free ? 1 : -1;
+  }
+  
+  if (free) {
+    _freeBits[word] |= bit;
+    _freeSummary[word / 32] |= summaryBit;
+  } else {
+    _freeBits[word] &= ~bit;
+    if (_freeBits[word] == 0) {
+      _freeSummary[word / 32] &= ~summaryBit;
+    }
+  }
+}
+
+template <int N>
+int SlotManagerT<N>::zoneOfIndex(int index) const {
+  int slotNumber = index + 1;
+  for (int z = 0; z < _zoneCount; z++) {
+    if (slotNumber >= _zones[z].firstSlot && slotNumber <= _zones[z].lastSlot) {
+      return z;
+    }
+  }
+  return -1;
+}
+
+template <int N>
+void SlotManagerT<N>::recountZones() {
+  for (int z = 0; z < _zoneCount; z++) {
+    _zoneFree[z] = 0;
+    _zoneCursor[z] = _zones[z].firstSlot - 1;
+    for (int i = _zones[z].firstSlot - 1; i < _zones[z].lastSlot; i++) {
+      if (!_slots[i].occupied) {
+        _zoneFree[z]++;
+      }
+    }
+  }
+}
+
+template <int N>
+int SlotManagerT<N>::findIndex(const CardUid& cardUID) const {
+  uint32_t bucket = cardUID.hash() & (INDEX_SIZE - 1);
+  
+  // Load factor <= 0.5 keeps probe chains short; an empty bucket ends one
+  for (int probe = 0; probe < INDEX_SIZE; probe++) {
+    int16_t slotIndex = _index[bucket];
+    if (slotIndex == -1) {
+      return -1;
+    }
+    if (_slots[slotIndex].cardUID == cardUID) {
+      return slotIndex;
+    }
+    bucket = (bucket + 1) & (INDEX_SIZE - 1);
+  }
+  return -1;
+}
+
+template <int N>
+void SlotManagerT<N>::indexInsert(int index) {
+  uint32_t bucket = _slots[index].cardUID.hash() & (INDEX_SIZE - 1);
+  
+  while (_index[bucket] != -1) {
+    bucket = (bucket + 1) & (INDEX_SIZE - 1);
+  }
+  _index[bucket] = index;
+}
+
+template <int N>
+void SlotManagerT<N>::indexRemove(int index) {
+  uint32_t bucket = _slots[index].cardUID.hash() & (INDEX_SIZE - 1);
+  
+  while (_index[bucket] != index) {
+    if (_index[bucket] == -1) {
+      return;
+    }
+    bucket = (bucket + 1) & (INDEX_SIZE - 1);
+  }
+  
+  // Backward-shift deletion: pull later entries of the chain into the hole
+  // so lookups never need tombstones
+  uint32_t hole = bucket;
+  uint32_t next = (hole + 1) & (INDEX_SIZE - 1);
+  while (_index[next] != -1) {
+    uint32_t home = _slots[_index[next]].cardUID.hash() & (INDEX_SIZE - 1);
+  
+    // Move the entry unless its home lies cyclically in (hole, next]
+    bool homeInRange = (hole <= next) ? (home > hole && home <= next)
+                                      : (home > hole || home <= next);
+    if (!homeInRange) {
+      _index[hole] = _index[next];
+      hole = next;
+    }
+    next = (next + 1) & (INDEX_SIZE - 1);
+  }
+  _index[hole] = -1;
+}
+
+template <int N>
+bool SlotManagerT<N>::isValidSlotNumber(int slotNumber) const {
+  return (slotNumber >= 1 && slotNumber <= N);
+}
+
+template <int N>
+int SlotManagerT<N>::slotNumberToIndex(int slotNumber) const {
+  return slotNumber - 1;
+}
+
+#endif // SLOTMANAGERIMPL_H
@@ -0,0 +1,122 @@
+/**
+ * @file TaskPipeline.cpp
+ * @brief Implementation of inter-task message queues
+ */
+
+#include "TaskPipeline.h"
+
+TaskPipeline::TaskPipeline()
+  : _publishQueue(nullptr),
+    _commandQueue(nullptr),
+    _displayQueue(nullptr),
+    _droppedCount(0) {
+}
+
+bool TaskPipeline::begin() {
+  _publishQueue = xQueueCreate(PUBLISH_QUEUE_LENGTH, sizeof(PublishMessage));
+  _commandQueue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(CommandMessage));
+  _displayQueue = xQueueCreate(DISPLAY_QUEUE_LENGTH, sizeof(DisplayMessage));
+
+  if (_publishQueue == nullptr || _commandQueue == nullptr ||
+      _displayQueue == nullptr) {
+    DEBUG_PRINTLN("✗ Task pipeline queue allocation failed");
+    return false;
+  }
+
+  DEBUG_PRINTLN("✓ Task pipeline initialized");
+  return true;
+}
+
+bool TaskPipeline::postPublish(const PublishMessage& msg) {
+  return send(_publishQueue, &msg);
+}
+
+bool TaskPipeline::receivePublish(PublishMessage& msg, TickType_t timeout) {
+  if (_publishQueue == nullptr) {
+    return false;
+  }
+  return xQueueReceive(_publishQueue, &msg, timeout) == pdTRUE;
+}
+
+bool TaskPipeline::postCommand(const char* payload, size_t length) {
+  if (length >= MQTT_BUFFER_SIZE) {
+    DEBUG_PRINTLN("✗ Command too long for pipeline");
+    _droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  CommandMessage msg;
+  memcpy(msg.payload, payload, length);
+  msg.payload[length] = '\0';
+  msg.length = length;
+
+  return send(_commandQueue, &msg);
+}
+
+bool TaskPipeline::receiveCommand(CommandMessage& msg) {
+  if (_commandQueue == nullptr) {
+    return false;
+  }
+  return xQueueReceive(_commandQueue, &msg, 0) == pdTRUE;
+}
+
+bool TaskPipeline::postDisplayLine(uint8_t row, const char* text,
+                                   DisplayPriority priority, uint32_t durationMs) {
+  if (row >= LCD_ROWS) {
+    return false;
+  }
+
+  DisplayMessage msg;
+  msg.rowMask = (1 << row);
+  msg.priority = priority;
+  msg.clear = false;
+  msg.durationMs = durationMs;
+  strncpy(msg.lines[row], text, LCD_COLS);
+  msg.lines[row][LCD_COLS] = '\0';
+
+  return send(_displayQueue, &msg);
+}
+
+bool TaskPipeline::postDisplayMessage(const char* line1, const char* line2,
+                                      DisplayPriority priority, uint32_t durationMs) {
+  DisplayMessage msg;
+  msg.rowMask = 0x03;
+  msg.priority = priority;
+  msg.clear = false;
+  msg.durationMs = durationMs;
+  strncpy(msg.lines[0], line1, LCD_COLS);
+  msg.lines[0][LCD_COLS] = '\0';
+  strncpy(msg.lines[1], line2, LCD_COLS);
+  msg.lines[1][LCD_COLS] = '\0';
+
+  return send(_displayQueue, &msg);
+}
+
+bool TaskPipeline::postDisplayClear(uint8_t rowMask, DisplayPriority priority) {
+  DisplayMessage msg;
+  msg.rowMask = rowMask;
+  msg.priority = priority;
+  msg.clear = true;
+  msg.durationMs = 0;
+
+  return send(_displayQueue, &msg);
+}
+
+bool TaskPipeline::receiveDisplay(DisplayMessage& msg, TickType_t timeout) {
+  if (_displayQueue == nullptr) {
+    return false;
+  }
+  return xQueueReceive(_displayQueue, &msg, timeout) == pdTRUE;
+}
+
+uint32_t TaskPipeline::getDroppedCount() const {
+  return _droppedCount.load(std::memory_order_relaxed);
+}
+
+bool TaskPipeline::send(QueueHandle_t queue, const void* item) {
+  if (queue == nullptr || xQueueSend(queue, item, 0) != pdTRUE) {
+    _droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file TaskPipeline.h
+ * @brief FreeRTOS queues connecting the gate, network and display tasks
+ * @details The gate task owns RFID, slots and gate state machines. It never
+ *          touches the network or the LCD directly; instead it posts
+ *          messages here which the network and display tasks drain.
+ */
+
+#ifndef TASKPIPELINE_H
+#define TASKPIPELINE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "../Config.h"
+#include "../CardUid/CardUid.h"
+
+/**
+ * @enum PublishType
+ * @brief Kind of MQTT message requested by the gate task
+ */
+enum PublishType {
+  PUBLISH_ENTRY,    ///< Entry event (parking/events/entry)
+  PUBLISH_EXIT,     ///< Exit event (parking/events/exit)
+  PUBLISH_SCAN,     ///< Scan-mode card event (parking/events/scan)
+  PUBLISH_STATUS,   ///< System status snapshot (parking/system)
+  PUBLISH_METRICS,  ///< Latency histograms (parking/system/metrics)
+  PUBLISH_BENCHMARK,  ///< Benchmark results (parking/system/benchmark)
+  PUBLISH_WHITELIST_ACK,  ///< Whitelist sync ack (parking/whitelist/ack)
+  PUBLISH_DENIED_SUMMARY,  ///< Folded repeat refusals (parking/events/denied)
+  PUBLISH_COMMAND_ACK,     ///< Command accepted or refused (parking/commands/ack)
+  PUBLISH_COMMAND_RESULT   ///< Command outcome (parking/commands/result)
+};
+
+/**
+ * @struct PublishMessage
+ * @brief Gate event queued for publishing by the network task
+ */
+struct PublishMessage {
+  PublishType type;          ///< Message kind
+  CardUid cardUID;           ///< Card UID
+  const char* status;        ///< Status string literal ("success", "denied_full", ...)
+  const char* gate;          ///< Gate name literal (scan events and denied summaries)
+  int slotNumber;            ///< Slot number (0 = none)
+  int availableSlots;        ///< Available slots when the event happened
+  unsigned long duration;    ///< Parking duration in seconds (exit), window in seconds (denied summary)
+  unsigned long timestamp;   ///< Event timestamp
+  uint32_t version;          ///< Whitelist version (whitelist ack only)
+  int cardCount;             ///< Whitelist size (whitelist ack only)
+  uint16_t repeats;          ///< Folded refusals (denied summary only)
+  uint8_t lane;              ///< Lane index (denied summary only)
+  const char* command;       ///< Command name literal (command ack/result only, nullptr = unknown)
+  uint32_t commandId;        ///< Correlation id sent with the command (command ack/result only)
+};
+
+/**
+ * @struct CommandMessage
+ * @brief Raw MQTT command JSON queued for execution by the gate task
+ */
+struct CommandMessage {
+  uint16_t length;                   ///< Payload length in bytes
+  char payload[MQTT_BUFFER_SIZE];    ///< JSON payload (null-terminated)
+};
+
+/**
+ * @enum DisplayPriority
+ * @brief Display layers, lowest first; each row shows its highest live layer
+ */
+enum DisplayPriority {
+  DISPLAY_PRIO_IDLE,       ///< Ready screen and slot count (never expires)
+  DISPLAY_PRIO_GATE,       ///< Gate status while a vehicle is at the gate
+  DISPLAY_PRIO_NOTICE,     ///< Operator feedback (scan mode, whitelist sync)
+  DISPLAY_PRIO_DENIED,     ///< Denied or parking full
+  DISPLAY_PRIO_EMERGENCY,  ///< Emergency mode
+  DISPLAY_PRIO_COUNT       ///< Number of layers
+};
+
+/**
+ * @struct DisplayMessage
+ * @brief LCD update queued for the display task
+ */
+struct DisplayMessage {
+  uint8_t rowMask;                       ///< Bit n set = update row n
+  uint8_t priority;                      ///< DisplayPriority layer to write
+  bool clear;                            ///< Remove the rows from the layer
+  uint32_t durationMs;                   ///< Lifetime (0 = until replaced or cleared)
+  char lines[LCD_ROWS][LCD_COLS + 1];    ///< Text per row
+};
+
+/**
+ * @class TaskPipeline
+ * @brief Owns the inter-task queues and provides typed send/receive wrappers
+ *
+ * All post methods are non-blocking: if a queue is full the message is
+ * dropped and counted, so the gate task can never be stalled by a slow
+ * consumer.
+ *
+ * Example usage:
+ * @code
+ * TaskPipeline pipeline;
+ * pipeline.begin();
+ * pipeline.postDisplayLine(0, "IN: Denied", DISPLAY_PRIO_DENIED, 2000);
+ * @endcode
+ */
+class TaskPipeline {
+public:
+  /**
+   * @brief Constructor
+   */
+  TaskPipeline();
+
+  /**
+   * @brief Create all queues
+   * @return true if every queue was created
+   */
+  bool begin();
+
+  /**
+   * @brief Queue a message for MQTT publishing
+   * @param msg Message to queue
+   * @return true if queued, false if the queue was full
+   */
+  bool postPublish(const PublishMessage& msg);
+
+  /**
+   * @brief Wait for the next message to publish
+   * @param msg Output message
+   * @param timeout Maximum wait in ticks
+   * @return true if a message was received
+   */
+  bool receivePublish(PublishMessage& msg, TickType_t timeout);
+
+  /**
+   * @brief Queue a raw MQTT command for the gate task
+   * @param payload JSON payload
+   * @param length Payload length
+   * @return true if queued, false if full or too long
+   */
+  bool postCommand(const char* payload, size_t length);
+
+  /**
+   * @brief Fetch the next pending command without blocking
+   * @param msg Output message
+   * @return true if a command was pending
+   */
+  bool receiveCommand(CommandMessage& msg);
+
+  /**
+   * @brief Queue a single-row LCD update
+   * @param row Row number
+   * @param text Text to display
+   * @param priority Display layer
+   * @param durationMs Lifetime in ms (0 = until replaced or cleared)
+   * @return true if queued
+   */
+  bool postDisplayLine(uint8_t row, const char* text,
+                       DisplayPriority priority = DISPLAY_PRIO_GATE,
+                       uint32_t durationMs = 0);
+
+  /**
+   * @brief Queue a two-row LCD message
+   * @param line1 Text for first row
+   * @param line2 Text for second row
+   * @param priority Display layer
+   * @param durationMs Lifetime in ms (0 = until replaced or cleared)
+   * @return true if queued
+   */
+  bool postDisplayMessage(const char* line1, const char* line2,
+                          DisplayPriority priority = DISPLAY_PRIO_IDLE,
+                          uint32_t durationMs = 0);
+
+  /**
+   * @brief Queue removal of rows from a display layer
+   * @param rowMask Bit n set = clear row n
+   * @param priority Display layer
+   * @return true if queued
+   */
+  bool postDisplayClear(uint8_t rowMask, DisplayPriority priority);
+
+  /**
+   * @brief Wait for the next LCD update
+   * @param msg Output message
+   * @param timeout Maximum wait in ticks
+   * @return true if a message was received
+   */
+  bool receiveDisplay(DisplayMessage& msg, TickType_t timeout);
+
+  /**
+   * @brief Get number of messages dropped because a queue was full
+   * @return Dropped message count
+   */
+  uint32_t getDroppedCount() const;
+
+private:
+  QueueHandle_t _publishQueue;       ///< Gate task -> network task
+  QueueHandle_t _commandQueue;       ///< Network task -> gate task
+  QueueHandle_t _displayQueue;       ///< Any task -> display task
+  std::atomic<uint32_t> _droppedCount;  ///< Messages lost to full queues (any task, either core)
+
+  /**
+   * @brief Non-blocking send with drop accounting
+   * @param queue Target queue
+   * @param item Item to copy into the queue
+   * @return true if queued
+   */
+  bool send(QueueHandle_t queue, const void* item);
+};
+
+#endif // TASKPIPELINE_H
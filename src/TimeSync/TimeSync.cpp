@@ -4,79 +4,223 @@
  */
 
 #include "TimeSync.h"
+#include <sys/time.h>
 
-TimeSync::TimeSync() : _synced(false), _bootTime(0) {
-  _bootTime = millis() / 1000;
+// Initialize static instance pointer
+TimeSync* TimeSync::_instance = nullptr;
+
+TimeSync::TimeSync()
+  : _synced(false),
+    _syncCount(0),
+    _offsetMs(0),
+    _appliedMs(0),
+    _slewMs(0),
+    _syncedAt(0),
+    _driftBaseAt(0),
+    _driftBaseOffset(0),
+    _driftPpm(0.0f),
+    _lock(portMUX_INITIALIZER_UNLOCKED) {
+  
+  // Set static instance pointer for callback
+  _instance = this;
 }
 
 bool TimeSync::begin() {
-  DEBUG_PRINTLN("Syncing time with NTP server...");
+  DEBUG_PRINTLN("Starting background NTP sync...");
   
-  // Configure NTP time
+  // Resync on a schedule. Smooth mode only keeps the system clock (unused
+  // here) from stepping; timestamps are slewed in recordSync().
+  sntp_set_time_sync_notification_cb(onSntpSync);
+  sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
+  sntp_set_sync_interval(NTP_RESYNC_INTERVAL);
+  
+  // Starts SNTP and returns; the first response arrives through onSntpSync()
   configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
   
-  struct tm timeinfo;
-  int attempts = 0;
-  const int maxAttempts = 10;
-  
-  // Try to get time from NTP server
-  while (!getLocalTime(&timeinfo) && attempts < maxAttempts) {
-    delay(500);
-    DEBUG_PRINT(".");
-    attempts++;
+  return sntp_enabled();
+}
+
+bool TimeSync::isSynced() const {
+  return _synced;
+}
+
+unsigned long TimeSync::getTimestamp() const {
+  unsigned long now;
+  if (getWallClock(now)) {
+    return now;
   }
   
-  if (attempts < maxAttempts) {
-    _synced = true;
-    DEBUG_PRINTLN("\n✓ Time synchronized with NTP");
-    
-    char buffer[64];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
-    DEBUG_PRINT("✓ Current time: ");
-    DEBUG_PRINTLN(buffer);
-    
-    return true;
-  } else {
-    _synced = false;
-    DEBUG_PRINTLN("\n✗ NTP sync failed, using millis() timestamps");
+  // Fallback: return seconds since boot
+  return monotonicSeconds();
+}
+
+bool TimeSync::getWallClock(unsigned long& unixTime) const {
+  if (!_synced) {
     return false;
   }
+  
+  unixTime = (unsigned long)(wallMillisAt(monotonicMillis()) / 1000);
+  return true;
 }
 
-bool TimeSync::isSynced() const {
-  return _synced;
+unsigned long TimeSync::toWallClock(unsigned long monotonicSec) const {
+  if (!_synced) {
+    return 0;
+  }
+  
+  return (unsigned long)(wallMillisAt((uint64_t)monotonicSec * 1000) / 1000);
 }
 
-unsigned long TimeSync::getTimestamp() const {
-  if (_synced) {
-    time_t now;
-    time(&now);
-    return (unsigned long)now;
-  } else {
-    // Fallback: return seconds since boot
-    return millis() / 1000;
+unsigned long TimeSync::correctTimestamp(unsigned long timestamp) const {
+  if (timestamp >= NTP_VALID_EPOCH || !_synced) {
+    return timestamp;
   }
+  
+  // Uptime seconds from getTimestamp() before the first sync
+  return toWallClock(timestamp);
 }
 
-bool TimeSync::getFormattedTime(char* buffer, size_t bufferSize, 
+bool TimeSync::getFormattedTime(char* buffer, size_t bufferSize,
                                  const char* format) const {
-  if (!_synced || buffer == nullptr || bufferSize == 0) {
+  unsigned long now;
+  if (buffer == nullptr || bufferSize == 0 || !getWallClock(now)) {
     return false;
   }
   
+  // Local time zone was set by configTime()
+  time_t wall = (time_t)now;
   struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    return false;
-  }
+  localtime_r(&wall, &timeinfo);
   
   strftime(buffer, bufferSize, format, &timeinfo);
   return true;
 }
 
 bool TimeSync::resync() {
-  return begin();
+  if (!sntp_enabled()) {
+    return begin();
+  }
+  
+  // Sends a request now; the reply is handled like a scheduled sync
+  return sntp_restart();
 }
 
 unsigned long TimeSync::getUptime() const {
-  return millis() / 1000;
+  return monotonicSeconds();
+}
+
+int64_t TimeSync::getOffsetMs() const {
+  portENTER_CRITICAL(&_lock);
+  int64_t offsetMs = _offsetMs;
+  portEXIT_CRITICAL(&_lock);
+  return offsetMs;
+}
+
+float TimeSync::getDriftPpm() const {
+  portENTER_CRITICAL(&_lock);
+  float drift = _driftPpm;
+  portEXIT_CRITICAL(&_lock);
+  return drift;
+}
+
+unsigned long TimeSync::getSyncAge() const {
+  if (!_synced) {
+    return 0;
+  }
+  
+  portENTER_CRITICAL(&_lock);
+  uint64_t syncedAt = _syncedAt;
+  portEXIT_CRITICAL(&_lock);
+  
+  return (unsigned long)((monotonicMillis() - syncedAt) / 1000);
+}
+
+unsigned long TimeSync::getSyncCount() const {
+  return _syncCount;
+}
+
+uint64_t TimeSync::monotonicMillis() {
+  // esp_timer counts microseconds from boot in 64 bits: no wrap in practice
+  return (uint64_t)esp_timer_get_time() / 1000;
+}
+
+unsigned long TimeSync::monotonicSeconds() {
+  return (unsigned long)(monotonicMillis() / 1000);
+}
+
+void TimeSync::onSntpSync(struct timeval* tv) {
+  if (_instance == nullptr || tv == nullptr) {
+    return;
+  }
+  
+  bool first = !_instance->_synced;
+  _instance->recordSync(tv);
+  
+  if (first) {
+    DEBUG_PRINTLN("✓ Time synchronized with NTP");
+  }
+  DEBUG_PRINTF("✓ Clock offset %lld ms, drift %.1f ppm\n",
+               (long long)_instance->getOffsetMs(), _instance->getDriftPpm());
+}
+
+void TimeSync::recordSync(const struct timeval* tv) {
+  // In smooth mode the system clock is still slewing; tv is the server time
+  uint64_t now = monotonicMillis();
+  int64_t offsetMs = (int64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000 - (int64_t)now;
+  
+  portENTER_CRITICAL(&_lock);
+  // Continue from the offset timestamps use right now; blend the rest in
+  // unless it is too large to wait for (or there is nothing to continue)
+  int64_t applied = _synced ? appliedOffsetAt(now) : offsetMs;
+  int64_t error = offsetMs - applied;
+  if (error > NTP_STEP_THRESHOLD_MS || error < -NTP_STEP_THRESHOLD_MS) {
+    applied = offsetMs;
+    error = 0;
+  }
+  _appliedMs = applied;
+  _slewMs = error;
+  
+  if (!_synced) {
+    _driftBaseAt = now;
+    _driftBaseOffset = offsetMs;
+  } else if (now - _driftBaseAt >= NTP_DRIFT_MIN_INTERVAL) {
+    // Offset change over the interval: how far the local clock fell behind
+    float drift = (float)(offsetMs - _driftBaseOffset) * 1e6f / (float)(now - _driftBaseAt);
+    if (drift > -NTP_DRIFT_MAX_PPM && drift < NTP_DRIFT_MAX_PPM) {
+      _driftPpm = drift;
+    }
+    _driftBaseAt = now;
+    _driftBaseOffset = offsetMs;
+  }
+  _offsetMs = offsetMs;
+  _syncedAt = now;
+  portEXIT_CRITICAL(&_lock);
+  
+  _syncCount++;
+  _synced = true;
+}
+
+int64_t TimeSync::appliedOffsetAt(uint64_t monotonicMs) const {
+  // Extrapolate the drift measured so far; the next sync corrects the rest
+  int64_t sinceSync = (int64_t)monotonicMs - (int64_t)_syncedAt;
+  int64_t offsetMs = _appliedMs + (int64_t)(sinceSync * (_driftPpm / 1e6f));
+  
+  // Times before the sync keep the offset they had
+  if (sinceSync > 0 && _slewMs != 0) {
+    int64_t slewed = sinceSync * NTP_SLEW_MAX_PPM / 1000000;
+    if (_slewMs > 0) {
+      offsetMs += (slewed < _slewMs) ? slewed : _slewMs;
+    } else {
+      offsetMs += (slewed < -_slewMs) ? -slewed : _slewMs;
+    }
+  }
+  return offsetMs;
+}
+
+int64_t TimeSync::wallMillisAt(uint64_t monotonicMs) const {
+  portENTER_CRITICAL(&_lock);
+  int64_t offsetMs = appliedOffsetAt(monotonicMs);
+  portEXIT_CRITICAL(&_lock);
+  
+  return (int64_t)monotonicMs + offsetMs;
 }
@@ -2,7 +2,12 @@
  * @file TimeSync.h
  * @brief NTP time synchronization manager for ESP32
  * @details Handles NTP server connection, time synchronization,
- *          and provides timestamp services
+ *          and provides timestamp services. Intervals are measured on a
+ *          64-bit monotonic clock (esp_timer) that neither wraps nor jumps
+ *          when NTP steps the system time; wall-clock time is only used
+ *          for reporting, derived from the offset measured at each sync.
+ *          SNTP runs in the background: begin() returns at once and syncs
+ *          arrive through the SNTP notification callback.
  */
 
 #ifndef TIMESYNC_H
@@ -10,17 +15,35 @@
 
 #include <Arduino.h>
 #include <time.h>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#include <freertos/FreeRTOS.h>
 #include "../Config.h"
 
 /**
  * @class TimeSync
  * @brief Manages NTP time synchronization and timestamp generation
- * 
+ *
+ * The monotonic accessors are static: there is one esp_timer per chip, so
+ * modules that only measure intervals need no TimeSync instance. Wall-clock
+ * time is the monotonic clock plus the offset (wall - monotonic) recorded at
+ * the last sync, corrected for the measured drift since then; it may be read
+ * from any task. SNTP resyncs every NTP_RESYNC_INTERVAL. A resync does not
+ * move timestamps at once: the difference to the new offset is blended in
+ * at NTP_SLEW_MAX_PPM, so wall-clock time stays continuous and monotonic.
+ * Only the first sync and corrections above NTP_STEP_THRESHOLD_MS step it.
+ *
+ * Timestamps taken before the first sync are uptime seconds; once synced,
+ * correctTimestamp() moves those from the current boot onto the wall clock.
+ *
  * Example usage:
  * @code
  * TimeSync timeSync;
- * timeSync.begin();
+ * timeSync.begin();                 // returns immediately
+ * uint64_t start = TimeSync::monotonicMillis();
  * unsigned long timestamp = timeSync.getTimestamp();
+ * // later, when publishing
+ * timestamp = timeSync.correctTimestamp(timestamp);
  * @endcode
  */
 class TimeSync {
@@ -31,8 +54,10 @@ public:
   TimeSync();
 
   /**
-   * @brief Initialize NTP time synchronization
-   * @return true if sync successful, false otherwise
+   * @brief Start background NTP synchronization
+   * @details Does not wait for the server; isSynced() turns true when the
+   *          first response arrives.
+   * @return true if SNTP was started
    */
   bool begin();
 
@@ -44,10 +69,33 @@ public:
 
   /**
    * @brief Get current Unix timestamp
-   * @return Current Unix timestamp (seconds since 1970)
+   * @return Current Unix timestamp (seconds since 1970), or monotonic
+   *         seconds since boot while not synced
    */
   unsigned long getTimestamp() const;
 
+  /**
+   * @brief Get current wall-clock time
+   * @param unixTime Output parameter for Unix seconds
+   * @return true if synced, false if wall-clock time is unknown
+   */
+  bool getWallClock(unsigned long& unixTime) const;
+
+  /**
+   * @brief Convert a monotonic time of this boot to wall-clock time
+   * @param monotonicSec Monotonic seconds since boot
+   * @return Unix seconds, or 0 if not synced
+   */
+  unsigned long toWallClock(unsigned long monotonicSec) const;
+
+  /**
+   * @brief Correct a timestamp taken by getTimestamp() before the first sync
+   * @param timestamp Timestamp from this boot
+   * @return Wall-clock timestamp, or the input if it already is one or the
+   *         clock is still not synced
+   */
+  unsigned long correctTimestamp(unsigned long timestamp) const;
+
   /**
    * @brief Get formatted date/time string
    * @param buffer Buffer to store formatted string
@@ -55,24 +103,98 @@ public:
    * @param format strftime format string (default: "%Y-%m-%d %H:%M:%S")
    * @return true if successful, false otherwise
    */
-  bool getFormattedTime(char* buffer, size_t bufferSize, 
+  bool getFormattedTime(char* buffer, size_t bufferSize,
                         const char* format = "%Y-%m-%d %H:%M:%S") const;
 
   /**
-   * @brief Retry NTP synchronization
-   * @return true if sync successful, false otherwise
+   * @brief Request an NTP sync now instead of waiting for the schedule
+   * @return true if the request was issued (the result arrives later)
    */
   bool resync();
 
   /**
    * @brief Get uptime in seconds since system boot
-   * @return Uptime in seconds
+   * @return Uptime in seconds (monotonic, does not wrap)
    */
   unsigned long getUptime() const;
 
+  /**
+   * @brief Get wall-clock minus monotonic time measured at the last sync
+   * @details Timestamps converge on it at NTP_SLEW_MAX_PPM
+   * @return Offset in milliseconds, or 0 if never synced
+   */
+  int64_t getOffsetMs() const;
+
+  /**
+   * @brief Get drift of the local clock against NTP
+   * @details Measured between syncs at least NTP_DRIFT_MIN_INTERVAL apart
+   * @return Drift in parts per million (positive = local clock is slow)
+   */
+  float getDriftPpm() const;
+
+  /**
+   * @brief Get time since the last successful sync
+   * @return Seconds, or 0 if never synced
+   */
+  unsigned long getSyncAge() const;
+
+  /**
+   * @brief Get number of syncs received since boot
+   * @return Sync count
+   */
+  unsigned long getSyncCount() const;
+
+  /**
+   * @brief Get monotonic time since boot
+   * @return Milliseconds (64-bit, never wraps)
+   */
+  static uint64_t monotonicMillis();
+
+  /**
+   * @brief Get monotonic time since boot
+   * @return Seconds
+   */
+  static unsigned long monotonicSeconds();
+
 private:
-  bool _synced;             ///< NTP synchronization status
-  unsigned long _bootTime;  ///< System boot time for fallback timestamps
+  static TimeSync* _instance;  ///< Receiver of SNTP notifications
+
+  volatile bool _synced;    ///< NTP synchronization status (set by the SNTP task)
+  unsigned long _syncCount; ///< Syncs received since boot
+  int64_t _offsetMs;        ///< Wall-clock minus monotonic ms measured at last sync
+  int64_t _appliedMs;       ///< Offset timestamps used at the last sync (continuous)
+  int64_t _slewMs;          ///< Correction still to blend in after the last sync
+  uint64_t _syncedAt;       ///< Monotonic ms of the last sync
+  uint64_t _driftBaseAt;    ///< Monotonic ms of the sync drift is measured from
+  int64_t _driftBaseOffset; ///< Offset at _driftBaseAt
+  float _driftPpm;          ///< Drift over the last measured interval
+  mutable portMUX_TYPE _lock;  ///< Guards the sync fields across tasks
+
+  /**
+   * @brief SNTP notification callback (runs in the lwIP task)
+   * @param tv Time received from the server
+   */
+  static void onSntpSync(struct timeval* tv);
+
+  /**
+   * @brief Record offset and drift from a server time
+   * @param tv Time received from the server
+   */
+  void recordSync(const struct timeval* tv);
+
+  /**
+   * @brief Get the offset timestamps use at a monotonic time (_lock held)
+   * @param monotonicMs Monotonic milliseconds since boot
+   * @return Offset in milliseconds: drift-corrected, with the slew so far
+   */
+  int64_t appliedOffsetAt(uint64_t monotonicMs) const;
+
+  /**
+   * @brief Get the drift-corrected wall-clock time at a monotonic time
+   * @param monotonicMs Monotonic milliseconds since boot
+   * @return Unix milliseconds (call only when synced)
+   */
+  int64_t wallMillisAt(uint64_t monotonicMs) const;
 };
 
 #endif // TIMESYNC_H
@@ -0,0 +1,133 @@
+/**
+ * @file TimerScheduler.cpp
+ * @brief Implementation of the min-heap deadline scheduler
+ */
+
+#include "TimerScheduler.h"
+
+TimerScheduler::TimerScheduler() : _count(0) {
+}
+
+bool TimerScheduler::schedule(uint8_t timerId, unsigned long delayMs) {
+  uint64_t deadline = TimeSync::monotonicMillis() + delayMs;
+
+  int index = indexOf(timerId);
+  if (index != -1) {
+    // Reschedule in place
+    _heap[index].deadline = deadline;
+    siftUp(index);
+    siftDown(indexOf(timerId));
+    return true;
+  }
+
+  if (_count >= SCHEDULER_MAX_TIMERS) {
+    DEBUG_PRINTF("✗ Timer scheduler full, timer %d dropped\n", timerId);
+    return false;
+  }
+
+  _heap[_count].deadline = deadline;
+  _heap[_count].id = timerId;
+  _count++;
+  siftUp(_count - 1);
+
+  return true;
+}
+
+bool TimerScheduler::cancel(uint8_t timerId) {
+  int index = indexOf(timerId);
+  if (index == -1) {
+    return false;
+  }
+
+  removeAt(index);
+  return true;
+}
+
+bool TimerScheduler::isScheduled(uint8_t timerId) const {
+  return indexOf(timerId) != -1;
+}
+
+bool TimerScheduler::popExpired(uint64_t now, uint8_t& timerId) {
+  if (_count == 0 || now < _heap[0].deadline) {
+    return false;
+  }
+
+  timerId = _heap[0].id;
+  removeAt(0);
+  return true;
+}
+
+void TimerScheduler::clear() {
+  _count = 0;
+}
+
+bool TimerScheduler::nextDeadline(uint64_t& deadline) const {
+  if (_count == 0) {
+    return false;
+  }
+
+  deadline = _heap[0].deadline;
+  return true;
+}
+
+uint8_t TimerScheduler::getPendingCount() const {
+  return _count;
+}
+
+int TimerScheduler::indexOf(uint8_t timerId) const {
+  // Capacity is a handful of entries, a scan beats an auxiliary index
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_heap[i].id == timerId) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void TimerScheduler::removeAt(uint8_t index) {
+  _count--;
+  if (index == _count) {
+    return;
+  }
+
+  _heap[index] = _heap[_count];
+  siftUp(index);
+  siftDown(index);
+}
+
+void TimerScheduler::siftUp(uint8_t index) {
+  while (index > 0) {
+    uint8_t parent = (index - 1) / 2;
+    if (_heap[index].deadline >= _heap[parent].deadline) {
+      break;
+    }
+
+    TimerEntry tmp = _heap[index];
+    _heap[index] = _heap[parent];
+    _heap[parent] = tmp;
+    index = parent;
+  }
+}
+
+void TimerScheduler::siftDown(uint8_t index) {
+  for (;;) {
+    uint8_t left = 2 * index + 1;
+    uint8_t right = left + 1;
+    uint8_t smallest = index;
+
+    if (left < _count && _heap[left].deadline < _heap[smallest].deadline) {
+      smallest = left;
+    }
+    if (right < _count && _heap[right].deadline < _heap[smallest].deadline) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      break;
+    }
+
+    TimerEntry tmp = _heap[index];
+    _heap[index] = _heap[smallest];
+    _heap[smallest] = tmp;
+    index = smallest;
+  }
+}
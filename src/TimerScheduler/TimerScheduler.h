@@ -0,0 +1,130 @@
+/**
+ * @file TimerScheduler.h
+ * @brief Fixed-capacity deadline scheduler for non-blocking state machines
+ * @details Min-heap of (deadline, timer id) pairs. Owners poll it from their
+ *          update() and react to expired ids instead of calling delay().
+ */
+
+#ifndef TIMERSCHEDULER_H
+#define TIMERSCHEDULER_H
+
+#include <Arduino.h>
+#include "../Config.h"
+#include "../TimeSync/TimeSync.h"
+
+/**
+ * @class TimerScheduler
+ * @brief Schedules one-shot timers identified by a small integer id
+ *
+ * Each id is scheduled at most once; scheduling an id again replaces its
+ * deadline. Deadlines are on the 64-bit monotonic clock of TimeSync, so
+ * they never wrap and are not moved by NTP.
+ *
+ * Example usage:
+ * @code
+ * TimerScheduler timers;
+ * timers.schedule(TIMER_AUTO_CLOSE, 5000);
+ *
+ * void update() {
+ *   uint8_t id;
+ *   while (timers.popExpired(TimeSync::monotonicMillis(), id)) {
+ *     handleTimer(id);
+ *   }
+ * }
+ * @endcode
+ */
+class TimerScheduler {
+public:
+  /**
+   * @brief Constructor
+   */
+  TimerScheduler();
+
+  /**
+   * @brief Schedule (or reschedule) a timer
+   * @param timerId Timer identifier
+   * @param delayMs Delay from now in milliseconds
+   * @return true if scheduled, false if the scheduler is full
+   */
+  bool schedule(uint8_t timerId, unsigned long delayMs);
+
+  /**
+   * @brief Cancel a pending timer
+   * @param timerId Timer identifier
+   * @return true if the timer was pending
+   */
+  bool cancel(uint8_t timerId);
+
+  /**
+   * @brief Check if a timer is pending
+   * @param timerId Timer identifier
+   * @return true if pending
+   */
+  bool isScheduled(uint8_t timerId) const;
+
+  /**
+   * @brief Remove the earliest expired timer
+   * @param now Current monotonic time in milliseconds
+   * @param timerId Output parameter for the expired timer id
+   * @return true if a timer expired, false if none are due
+   */
+  bool popExpired(uint64_t now, uint8_t& timerId);
+
+  /**
+   * @brief Get the earliest pending deadline
+   * @param deadline Output parameter for the deadline (monotonic ms)
+   * @return true if a timer is pending
+   */
+  bool nextDeadline(uint64_t& deadline) const;
+
+  /**
+   * @brief Cancel all pending timers
+   */
+  void clear();
+
+  /**
+   * @brief Get number of pending timers
+   * @return Pending timer count
+   */
+  uint8_t getPendingCount() const;
+
+private:
+  /**
+   * @struct TimerEntry
+   * @brief Heap node
+   */
+  struct TimerEntry {
+    uint64_t deadline;        ///< Expiry time (monotonic ms)
+    uint8_t id;               ///< Timer identifier
+  };
+
+  TimerEntry _heap[SCHEDULER_MAX_TIMERS];  ///< Min-heap ordered by deadline
+  uint8_t _count;                          ///< Number of pending timers
+
+  /**
+   * @brief Find heap position of a timer
+   * @param timerId Timer identifier
+   * @return Heap index, or -1 if not pending
+   */
+  int indexOf(uint8_t timerId) const;
+
+  /**
+   * @brief Remove heap node at index
+   * @param index Heap index
+   */
+  void removeAt(uint8_t index);
+
+  /**
+   * @brief Restore heap order upwards from index
+   * @param index Heap index
+   */
+  void siftUp(uint8_t index);
+
+  /**
+   * @brief Restore heap order downwards from index
+   * @param index Heap index
+   */
+  void siftDown(uint8_t index);
+};
+
+#endif // TIMERSCHEDULER_H
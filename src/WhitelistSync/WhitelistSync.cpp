@@ -0,0 +1,192 @@
+/**
+ * @file WhitelistSync.cpp
+ * @brief Implementation of versioned whitelist synchronization
+ */
+
+#include "WhitelistSync.h"
+
+WhitelistSync::WhitelistSync(RFIDManager& rfid)
+  : _rfid(rfid),
+    _snapshotActive(false),
+    _snapshotVersion(0),
+    _nextChunk(0),
+    _totalChunks(0),
+    _lastChunkTime(0),
+    _snapshotFailed(false) {
+}
+
+WhitelistAck WhitelistSync::applyDelta(JsonDocument& doc) {
+  // Deltas are relative to the stored list, not a half-received snapshot
+  if (_snapshotActive) {
+    abortSnapshot();
+  }
+
+  uint32_t base = doc["base"] | 0;
+  uint32_t version = doc["version"] | 0;
+  uint32_t current = _rfid.getWhitelistVersion();
+
+  if (version <= current) {
+    return makeAck("current");
+  }
+  if (base > current) {
+    DEBUG_PRINTF("⚠ Whitelist delta %u->%u skips local version %u\n",
+                 (unsigned)base, (unsigned)version, (unsigned)current);
+    return makeAck("resync");
+  }
+
+  bool complete = true;
+  int opCount = 0;
+
+  _rfid.beginTransaction();
+
+  JsonArray ops = doc["ops"].as<JsonArray>();
+  for (JsonObject op : ops) {
+    const char* type = op["op"] | "";
+    CardUid uid;
+    if (!uid.fromHex(op["uid"])) {
+      complete = false;
+      continue;
+    }
+
+    if (strcmp(type, "remove") == 0) {
+      // Already absent is fine: deltas may overlap
+      _rfid.removeCard(uid);
+    } else if (strcmp(type, "upsert") == 0) {
+      const char* name = op["name"];
+      int level = op["lvl"] | 0;
+      if (!_rfid.upsertCard(uid, name, level)) {
+        complete = false;
+      }
+    } else {
+      complete = false;
+    }
+    opCount++;
+  }
+
+  _rfid.setWhitelistVersion(version);
+  if (!_rfid.commitTransaction()) {
+    _rfid.abortTransaction();
+    return makeAck("resync");
+  }
+
+  DEBUG_PRINTF("✓ Whitelist delta applied: %d ops, version %u\n",
+               opCount, (unsigned)version);
+  return makeAck(complete ? "applied" : "incomplete");
+}
+
+WhitelistAck WhitelistSync::applySnapshotChunk(JsonDocument& doc) {
+  uint32_t version = doc["version"] | 0;
+  int chunk = doc["chunk"] | 0;
+  int total = doc["total"] | 1;
+
+  if (chunk == 0) {
+    if (_snapshotActive) {
+      abortSnapshot();
+    }
+
+    // The card count decides whether the list can be updated in place
+    if (!doc["count"].is<int>()) {
+      DEBUG_PRINTLN("✗ Whitelist snapshot without a card count");
+      return makeAck("resync");
+    }
+
+    _rfid.beginTransaction();
+    _snapshotActive = true;
+    _snapshotVersion = version;
+    _nextChunk = 0;
+    _totalChunks = total;
+    _snapshotFailed = false;
+
+    // Without room for old and new cards side by side, rebuild from empty
+    int incoming = doc["count"].as<int>();
+    if (incoming < 0 || _rfid.getCardCount() + incoming > MAX_RFID_CARDS) {
+      _rfid.clearAllCards();
+    }
+    _rfid.clearMarks();
+
+    DEBUG_PRINTF("🔄 Receiving whitelist snapshot v%u (%d chunks)\n",
+                 (unsigned)version, total);
+  } else if (!_snapshotActive || version != _snapshotVersion ||
+             chunk != _nextChunk) {
+    if (_snapshotActive) {
+      abortSnapshot();
+    }
+    return makeAck("resync");
+  }
+
+  JsonArray cards = doc["cards"].as<JsonArray>();
+  for (JsonObject cardObj : cards) {
+    CardUid uid;
+    if (!uid.fromHex(cardObj["uid"])) {
+      _snapshotFailed = true;
+      continue;
+    }
+
+    const char* name = cardObj["name"];
+    int level = cardObj["lvl"] | 0;
+    if (!_rfid.upsertCard(uid, name, level)) {
+      _snapshotFailed = true;
+      continue;
+    }
+    _rfid.markCard(uid);
+  }
+
+  _nextChunk++;
+  _lastChunkTime = millis();
+
+  if (_nextChunk < _totalChunks) {
+    WhitelistAck ack = makeAck("partial");
+    ack.send = false;
+    return ack;
+  }
+
+  bool complete = finishSnapshot();
+  DEBUG_PRINTF("✓ Whitelist snapshot v%u applied: %d cards\n",
+               (unsigned)_rfid.getWhitelistVersion(), _rfid.getCardCount());
+  return makeAck(complete ? "applied" : "incomplete");
+}
+
+WhitelistAck WhitelistSync::reportVersion() const {
+  return makeAck("current");
+}
+
+WhitelistAck WhitelistSync::update() {
+  if (_snapshotActive && millis() - _lastChunkTime > WHITELIST_SNAPSHOT_TIMEOUT) {
+    DEBUG_PRINTLN("⚠ Whitelist snapshot timed out");
+    abortSnapshot();
+    return makeAck("resync");
+  }
+
+  WhitelistAck ack = makeAck("current");
+  ack.send = false;
+  return ack;
+}
+
+bool WhitelistSync::isSnapshotActive() const {
+  return _snapshotActive;
+}
+
+WhitelistAck WhitelistSync::makeAck(const char* status) const {
+  WhitelistAck ack;
+  ack.send = true;
+  ack.status = status;
+  ack.version = _rfid.getWhitelistVersion();
+  ack.cardCount = _rfid.getCardCount();
+  return ack;
+}
+
+void WhitelistSync::abortSnapshot() {
+  _snapshotActive = false;
+  _rfid.abortTransaction();
+}
+
+bool WhitelistSync::finishSnapshot() {
+  // Cards the snapshot did not mention
+  _rfid.removeUnmarked();
+
+  _snapshotActive = false;
+  _rfid.setWhitelistVersion(_snapshotVersion);
+  bool committed = _rfid.commitTransaction();
+
+  return committed && !_snapshotFailed;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file WhitelistSync.h
+ * @brief Versioned delta/snapshot whitelist synchronization
+ * @details Applies whitelist commands from the backend:
+ *          - whitelist_delta:    {"base":B,"version":V,"ops":[{"op":"upsert",
+ *                                "uid":"..","lvl":0,"name":".."},
+ *                                {"op":"remove","uid":".."}]}
+ *          - whitelist_snapshot: {"version":V,"chunk":i,"total":n,
+ *                                "cards":[{"uid":"..","lvl":0}]}
+ *          - whitelist_version:  report the current version
+ *          Every completed operation is acknowledged on
+ *          MQTT_TOPIC_WHITELIST_ACK with the version now applied, so the
+ *          backend only ever sends what changed since that version.
+ */
+
+#ifndef WHITELISTSYNC_H
+#define WHITELISTSYNC_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../Config.h"
+#include "../CardUid/CardUid.h"
+#include "../RFIDManager/RFIDManager.h"
+
+/**
+ * @struct WhitelistAck
+ * @brief Acknowledgement to publish after a sync command
+ */
+struct WhitelistAck {
+  bool send;             ///< true if an ack should be published
+  const char* status;    ///< "applied", "incomplete", "current" or "resync"
+  uint32_t version;      ///< Whitelist version now applied
+  int cardCount;         ///< Cards in the whitelist
+};
+
+/**
+ * @class WhitelistSync
+ * @brief Applies versioned whitelist deltas and chunked snapshots
+ *
+ * A delta applies when base <= current version < version. Operations are
+ * idempotent, so overlapping deltas are safe; a delta whose base is ahead
+ * of the device means changes were missed and a snapshot is requested.
+ * Snapshots update the list in place (cards missing from the snapshot are
+ * removed only after the last chunk), so valid cards keep working while
+ * chunks arrive, and everything is committed to flash once. Cards seen in
+ * the snapshot are marked on the whitelist entries themselves
+ * (RFIDManager::markCard()), so no second copy of the list is kept.
+ *
+ * Example usage:
+ * @code
+ * WhitelistSync sync(rfidManager);
+ * WhitelistAck ack = sync.applyDelta(doc);
+ * if (ack.send) {
+ *   // publish ack
+ * }
+ * @endcode
+ */
+class WhitelistSync {
+public:
+  /**
+   * @brief Constructor
+   * @param rfid Whitelist to keep in sync
+   */
+  WhitelistSync(RFIDManager& rfid);
+
+  /**
+   * @brief Apply a whitelist_delta command
+   * @param doc Parsed command
+   * @return Ack to publish
+   */
+  WhitelistAck applyDelta(JsonDocument& doc);
+
+  /**
+   * @brief Apply one whitelist_snapshot chunk
+   * @param doc Parsed command
+   * @return Ack to publish (only after the last chunk or on error)
+   */
+  WhitelistAck applySnapshotChunk(JsonDocument& doc);
+
+  /**
+   * @brief Report the current version (whitelist_version command)
+   * @return Ack with status "current"
+   */
+  WhitelistAck reportVersion() const;
+
+  /**
+   * @brief Abandon a snapshot whose chunks stopped arriving
+   * @return Ack requesting a resync if a snapshot was abandoned
+   */
+  WhitelistAck update();
+
+  /**
+   * @brief Check if a chunked snapshot is in progress
+   * @return true if receiving a snapshot
+   */
+  bool isSnapshotActive() const;
+
+private:
+  RFIDManager& _rfid;                        ///< Whitelist being synced
+  bool _snapshotActive;                      ///< Snapshot transaction open
+  uint32_t _snapshotVersion;                 ///< Version being received
+  int _nextChunk;                            ///< Expected chunk number
+  int _totalChunks;                          ///< Chunks in the snapshot
+  unsigned long _lastChunkTime;              ///< When the last chunk arrived
+  bool _snapshotFailed;                      ///< A card could not be stored
+
+  /**
+   * @brief Build an ack for the current whitelist state
+   * @param status Status string literal
+   * @return Ack
+   */
+  WhitelistAck makeAck(const char* status) const;
+
+  /**
+   * @brief Drop a partially received snapshot and restore the stored list
+   */
+  void abortSnapshot();
+
+  /**
+   * @brief Remove cards not seen in the snapshot and commit it
+   * @return true if every card was stored
+   */
+  bool finishSnapshot();
+};
+
+#endif // WHITELISTSYNC_H
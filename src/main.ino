@@ -1,7 +1,15 @@
 /**
  * @file main.ino
  * @brief Main orchestration file for IoT Parking Barrier System
- * @details Coordinates all modules: RFID, gates, slots, network, MQTT, display
+ * @details Coordinates all modules: RFID, gates, slots, network, MQTT, display.
+ *          Work is split across three FreeRTOS tasks:
+ *          - gateTask (APP core, high priority): RFID, IR, servos, slots for
+ *            every lane in LANES
+ *          - networkTask (PRO core): WiFi, MQTT, status publishing
+ *          - displayTask (PRO core, low priority): LCD compositing and I2C writes
+ *          Tasks exchange data only through TaskPipeline queues.
+ *          With BENCHMARK_MODE_ENABLED the "benchmark" command replays
+ *          synthetic traffic through the same gate path (BenchmarkRunner).
  * @author Enhanced Modular Version - December 2025
  */
 
@@ -9,43 +17,101 @@
 #include "Config.h"
 #include "TimeSync/TimeSync.h"
 #include "LCDDisplay/LCDDisplay.h"
+#include "DisplayCompositor/DisplayCompositor.h"
 #include "RFIDManager/RFIDManager.h"
 #include "SlotManager/SlotManager.h"
 #include "NetworkManager/NetworkManager.h"
 #include "MQTTHandler/MQTTHandler.h"
 #include "GateController/GateController.h"
+#include "ReaderScheduler/ReaderScheduler.h"
+#include "TaskPipeline/TaskPipeline.h"
+#include "WhitelistSync/WhitelistSync.h"
+#include "EventOutbox/EventOutbox.h"
+#include "JsonArena/JsonArena.h"
+#include "LatencyTracer/LatencyTracer.h"
+#include "HealthMonitor/HealthMonitor.h"
+#include "BenchmarkRunner/BenchmarkRunner.h"
+#include "DenyCache/DenyCache.h"
+#include "CommandRegistry/CommandRegistry.h"
 
 // ==================== GLOBAL MODULE INSTANCES ====================
 
 TimeSync timeSync;
 LCDDisplay lcd;
+DisplayCompositor compositor;    // Owned by the display task
 RFIDManager rfidManager;
-SlotManager slotManager;
+SlotManager slotManager(timeSync);
 NetworkManager networkManager;
 MQTTHandler mqttHandler;
+TaskPipeline pipeline;
+WhitelistSync whitelistSync(rfidManager);
+EventOutbox outbox;              // Owned by the network task
+HealthMonitor health;            // Gate task times iterations, network task samples
+CommandRegistry commandRegistry; // Built in setup(), read-only afterwards
 
-// Gate controllers
-GateController entranceGate("ENTRANCE", IR_IN_PIN, SERVO_IN_PIN);
-GateController exitGate("EXIT", IR_OUT_PIN, SERVO_OUT_PIN);
+// Parses commands in the gate task without heap allocation
+alignas(8) uint8_t commandArenaBuffer[JSON_RX_ARENA_SIZE];
+JsonArena commandArena(commandArenaBuffer, sizeof(commandArenaBuffer));
+
+// Lanes: gate controller and RFID reader N belong to lanes[N]
+const LaneConfig lanes[] = LANES;
+static_assert(sizeof(lanes) / sizeof(lanes[0]) == LANE_COUNT,
+              "LANES must have LANE_COUNT rows");
+GateController gates[LANE_COUNT];   // Configured from lanes[] in setup()
+ReaderScheduler readerScheduler;    // Shares the SPI bus between the readers
+#if DENY_CACHE_ENABLED
+DenyCache denyCache;                // Folds repeated refusals (gate task)
+#endif
+
+#if BENCHMARK_MODE_ENABLED
+// Synthetic traffic; owned by the gate task like the modules it drives
+BenchmarkRunner benchmark(rfidManager, slotManager, gates, lanes, LANE_COUNT);
+bool benchmarkAutoStarted = false;    // BENCHMARK_AUTOSTART_S run requested (network task)
+#endif
 
 // ==================== GLOBAL STATE ====================
 
-bool emergencyMode = false;
+// Written by the gate task, read by the network task for status messages
+volatile bool emergencyMode = false;
 bool scanModeActive = false;
-unsigned long scanModeStartTime = 0;
-String scanModeGate = "entrance";
-unsigned long lastStatusUpdate = 0;
-String lastScannedCardEntrance = "";
-String lastScannedCardExit = "";
+uint64_t scanModeStartTime = 0;
+uint8_t scanModeLane = 0;
+uint64_t lastStatusUpdate = 0;
+bool statusRequested = false;         // get_status received (network task)
+bool eventWindowOpen = false;         // Outbox events waiting to be coalesced
+uint64_t eventWindowStart = 0;        // When the oldest of them arrived
+uint32_t bootReadyMs = 0;             // When the gates started accepting cards
+bool timeSyncStarted = false;         // SNTP started (network task)
+CardUid lastScannedCard[LANE_COUNT] = {};  // Per lane, until its vehicle leaves
+
+TaskHandle_t gateTaskHandle = nullptr;
+TaskHandle_t networkTaskHandle = nullptr;
+TaskHandle_t displayTaskHandle = nullptr;
 
 // ==================== FORWARD DECLARATIONS ====================
 
-void handleEntranceGateEvent(const GateEventData& eventData);
-void handleExitGateEvent(const GateEventData& eventData);
+void handleGateEvent(const GateEventData& eventData);
+void handleEntranceGateEvent(const GateEventData& eventData, const LaneConfig& lane);
+void handleExitGateEvent(const GateEventData& eventData, const LaneConfig& lane);
+int findLane(JsonDocument& doc, const char* defaultGate);
 void handleMQTTCommand(const char* command, JsonDocument& doc);
+void queueMQTTCommand(const char* command, JsonDocument& doc);
 void processScanMode();
+void queueWhitelistAck(const WhitelistAck& ack);
+void queueDenial(PublishType type, const GateEventData& eventData);
+void queueDeniedSummaries();
+void drainOutbox();
 void updateDisplay();
 void sendPeriodicStatusUpdate();
+void onNetworkLink(bool linkUp);
+const char* handleBenchmarkCommand(JsonDocument& doc);
+void finishBenchmark();
+void gateTask(void* param);
+void networkTask(void* param);
+void displayTask(void* param);
+
+extern const CommandSpec commandTable[];   // MQTT commands, see handleMQTTCommand()
+extern const uint8_t commandTableSize;
 
 // ==================== SETUP FUNCTION ====================
 
@@ -56,203 +122,629 @@ void setup() {
   Serial.println("IoT Parking System - Modular Version");
   Serial.println("========================================");
   
+  // Create inter-task queues before anything can post to them
+  pipeline.begin();
+  
   // Initialize LCD display
   lcd.begin();
   lcd.showMessage(MSG_SYSTEM_INIT, "Please wait");
+#if !FAST_BOOT_ENABLED
   delay(1000);
+#endif
   
   // Initialize slot manager
   slotManager.begin();
+  static const SlotZone slotZones[] = SLOT_ZONES;
+  slotManager.configureZones(slotZones, sizeof(slotZones) / sizeof(slotZones[0]));
   
-  // Initialize RFID manager
+  // Initialize RFID manager; reader N is lane N
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    rfidManager.addReader(lanes[lane].rfidSsPin, lanes[lane].rfidRstPin);
+  }
   rfidManager.begin();
   
-  // Initialize gate controllers
-  entranceGate.begin();
-  exitGate.begin();
+  // Restore events that were not delivered before the last reset
+  outbox.begin();
   
-  // Set gate event callbacks
-  entranceGate.setEventCallback(handleEntranceGateEvent);
-  exitGate.setEventCallback(handleExitGateEvent);
+  // Initialize gate controllers; events carry the lane
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    gates[lane].configure(lane, lanes[lane]);
+    gates[lane].begin();
+    gates[lane].setEventCallback(handleGateEvent);
+  }
+  readerScheduler.begin(LANE_COUNT);
   
-  // Connect to WiFi
+  // Connect to WiFi. MQTT follows link changes, so it reconnects as soon as
+  // the network task sees a new IP; NTP starts on the first link-up.
+  networkManager.addLinkListener(MQTTHandler::onNetworkLink);
+  networkManager.addLinkListener(onNetworkLink);
+  networkManager.begin();
+#if !FAST_BOOT_ENABLED
   lcd.showMessage(MSG_WIFI_CONNECT, WIFI_SSID);
-  if (networkManager.begin()) {
-    lcd.showMessage(MSG_WIFI_CONNECTED, networkManager.getIPAddress());
+  if (networkManager.waitForConnection(WIFI_CONNECT_TIMEOUT)) {
+    lcd.showMessage(MSG_WIFI_CONNECTED, networkManager.getIPAddress().c_str());
     delay(2000);
   } else {
     lcd.showMessage(MSG_WIFI_FAILED, "Check config");
     delay(3000);
   }
+#endif
   
-  // Sync time with NTP
-  timeSync.begin();
+  // Connect to MQTT broker. Commands are forwarded to the gate task, so the
+  // callback is set even if the first attempt fails and update() reconnects.
+  commandRegistry.begin(commandTable, commandTableSize);
+  mqttHandler.setCommandCallback(queueMQTTCommand);
+  mqttHandler.setClock(&timeSync);
+  mqttHandler.begin();
   
-  // Connect to MQTT broker
-  if (mqttHandler.begin()) {
-    mqttHandler.setCommandCallback(handleMQTTCommand);
-  }
+  // Tell the backend which whitelist version survived the reboot so it
+  // can send only the changes since then
+  queueWhitelistAck(whitelistSync.reportVersion());
   
   // Display ready status
   updateDisplay();
   
+  // Start worker tasks. The gate path gets a core of its own; networking and
+  // the LCD share the PRO core with the WiFi stack.
+  xTaskCreatePinnedToCore(gateTask, "gate", GATE_TASK_STACK_SIZE, nullptr,
+                          GATE_TASK_PRIORITY, &gateTaskHandle, GATE_TASK_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK_SIZE, nullptr,
+                          NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE);
+  xTaskCreatePinnedToCore(displayTask, "display", DISPLAY_TASK_STACK_SIZE, nullptr,
+                          DISPLAY_TASK_PRIORITY, &displayTaskHandle, DISPLAY_TASK_CORE);
+  health.addTask("gate", gateTaskHandle);
+  health.addTask("network", networkTaskHandle);
+  health.addTask("display", displayTaskHandle);
+  
+  // Gates run on the stored whitelist from here; networking catches up
+  bootReadyMs = (uint32_t)TimeSync::monotonicMillis();
+  
   Serial.println("========================================");
   Serial.println("✓ System Ready!");
   Serial.printf("✓ Authorized Cards: %d\n", rfidManager.getCardCount());
   Serial.printf("✓ Available Slots: %d/%d\n", 
                 slotManager.getAvailableSlots(), 
                 slotManager.getTotalSlots());
+  Serial.printf("✓ Gates ready %lu ms after boot\n", (unsigned long)bootReadyMs);
   Serial.println("========================================\n");
 }
 
 // ==================== MAIN LOOP ====================
 
 void loop() {
-  // Update network connection
-  networkManager.update();
+  // All work happens in the tasks started by setup()
+  vTaskDelete(nullptr);
+}
+
+// ==================== GATE TASK ====================
+
+void gateTask(void* param) {
+  TickType_t lastWake = xTaskGetTickCount();
+  CommandMessage command;
+  
+  for (;;) {
+    health.beginIteration();
+    
+    // Execute MQTT commands forwarded by the network task
+    while (pipeline.receiveCommand(command)) {
+      commandArena.reset();
+      JsonDocument doc(&commandArena);
+      DeserializationError error = deserializeJson(doc, command.payload, command.length);
+      
+      if (!error) {
+        const char* name = doc["command"];
+        if (name != nullptr) {
+          handleMQTTCommand(name, doc);
+        }
+      }
+    }
+    
+    // Give up on a whitelist snapshot whose chunks stopped arriving
+    queueWhitelistAck(whitelistSync.update());
+    
+    // Once NTP syncs, store the entry times of cars that came in before
+    slotManager.update();
+    
+#if BENCHMARK_MODE_ENABLED
+    // Synthetic cars move before the gate logic reads sensors and readers
+    if (benchmark.update()) {
+      finishBenchmark();
+    }
+#endif
+    
+#if DENY_CACHE_ENABLED
+    // Report cards whose refusal window closed with repeats in it
+    queueDeniedSummaries();
+#endif
+    
+    // Process scan mode if active
+    if (scanModeActive) {
+      processScanMode();
+    } else {
+      // Normal operation: Read RFID cards and handle gate logic
+      processLanes();
+    }
+    
+    // Update gate state machines
+    for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+      gates[lane].update();
+    }
+    
+    health.endIteration();
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(GATE_TASK_PERIOD_MS));
+  }
+}
+
+// ==================== NETWORK TASK ====================
+
+void networkTask(void* param) {
+  PublishMessage msg;
   
-  // Update MQTT client
-  mqttHandler.update();
+  for (;;) {
+    // Update network connection
+    networkManager.update();
+    
+    // Update MQTT client
+    mqttHandler.update();
+    
+#if BENCHMARK_MODE_ENABLED && BENCHMARK_AUTOSTART_S > 0
+    // Self-test builds run once, as soon as the results can be delivered
+    if (!benchmarkAutoStarted && mqttHandler.isConnected()) {
+      char command[64];
+      int length = snprintf(command, sizeof(command),
+                            "{\"command\":\"benchmark\",\"action\":\"start\",\"duration\":%d}",
+                            BENCHMARK_AUTOSTART_S);
+      benchmarkAutoStarted = pipeline.postCommand(command, length);
+    }
+#endif
+    
+    // Publish everything the gate task queued; the first receive doubles as
+    // this task's idle wait
+    TickType_t wait = pdMS_TO_TICKS(NETWORK_TASK_PERIOD_MS);
+    while (pipeline.receivePublish(msg, wait)) {
+      publishQueuedMessage(msg);
+      wait = 0;
+    }
+    
+    // Deliver entry/exit events, or keep them in flash while offline
+    drainOutbox();
+    
+    // Send periodic status updates
+    sendPeriodicStatusUpdate();
+  }
+}
+
+void publishQueuedMessage(const PublishMessage& msg) {
+  switch (msg.type) {
+    case PUBLISH_ENTRY:
+    case PUBLISH_EXIT:
+      // Billing-relevant: always goes through the outbox
+      outbox.push(msg);
+      break;
+      
+    case PUBLISH_SCAN:
+      mqttHandler.publishScanEvent(msg.cardUID, msg.gate,
+                                   timeSync.correctTimestamp(msg.timestamp));
+      break;
+      
+    case PUBLISH_STATUS:
+      // Coalesced: several requests in one cycle produce one snapshot
+      statusRequested = true;
+      break;
+      
+    case PUBLISH_WHITELIST_ACK:
+      mqttHandler.publishWhitelistAck(msg.version, msg.status, msg.cardCount);
+      break;
+      
+    case PUBLISH_DENIED_SUMMARY:
+      // Telemetry: the first refusal of the window went through the outbox
+      mqttHandler.publishDeniedSummary(msg.cardUID, msg.gate, msg.lane, msg.repeats,
+                                       msg.duration,
+                                       timeSync.correctTimestamp(msg.timestamp));
+      break;
+      
+    case PUBLISH_COMMAND_ACK:
+      mqttHandler.publishCommandAck(msg.commandId, msg.command, msg.status);
+      break;
+      
+    case PUBLISH_COMMAND_RESULT:
+      mqttHandler.publishCommandResult(msg.commandId, msg.command, msg.status,
+                                       timeSync.correctTimestamp(msg.timestamp));
+      break;
+      
+    case PUBLISH_METRICS:
+      mqttHandler.publishMetrics();
+      break;
+      
+    case PUBLISH_BENCHMARK:
+#if BENCHMARK_MODE_ENABLED
+      {
+        BenchmarkResults results;
+        benchmark.getResults(results);
+        mqttHandler.publishBenchmark(results);
+      }
+#endif
+      break;
+  }
+}
+
+void onNetworkLink(bool linkUp) {
+  if (!linkUp) {
+    return;
+  }
   
-  // Process scan mode if active
-  if (scanModeActive) {
-    processScanMode();
+  // SNTP needs the network stack, so it starts with the first link; events
+  // stamped before the first sync are corrected when they are published
+  if (!timeSyncStarted) {
+    timeSyncStarted = timeSync.begin();
   } else {
-    // Normal operation: Read RFID cards and handle gate logic
-    processEntranceGate();
-    processExitGate();
+    timeSync.resync();
+  }
+}
+
+void drainOutbox() {
+  if (!mqttHandler.isConnected()) {
+    outbox.spill();
+    return;
   }
   
-  // Update gate state machines
-  entranceGate.update();
-  exitGate.update();
+  if (outbox.getStats().pending == 0) {
+    eventWindowOpen = false;
+    outbox.sync();
+    return;
+  }
+  
+  // Hold events briefly so a burst leaves as one message
+  if (!eventWindowOpen) {
+    eventWindowOpen = true;
+    eventWindowStart = TimeSync::monotonicMillis();
+  }
+  if (outbox.getStats().pending < EVENT_BATCH_MAX &&
+      TimeSync::monotonicMillis() - eventWindowStart < EVENT_BATCH_WINDOW) {
+    return;
+  }
+  
+  // A bounded number of messages per cycle keeps the MQTT keep-alive and
+  // new events flowing while a backlog replays; stop at the first failure
+  OutboxRecord batch[EVENT_BATCH_MAX];
+  uint32_t bootId = outbox.getStats().bootId;
+  for (int i = 0; i < OUTBOX_DRAIN_BATCH; i++) {
+    size_t count = 0;
+    while (count < EVENT_BATCH_MAX && outbox.peekAt(count, batch[count])) {
+      // Uptime stamps of earlier boots cannot be mapped to the wall clock
+      if (batch[count].bootId == bootId) {
+        batch[count].timestamp = timeSync.correctTimestamp(batch[count].timestamp);
+      }
+      count++;
+    }
+    
+    size_t sent = mqttHandler.publishEventBatch(batch, count);
+    if (sent == 0) {
+      break;
+    }
+    for (size_t j = 0; j < sent; j++) {
+#if BENCHMARK_MODE_ENABLED
+      benchmark.onEventPublished(batch[j]);
+#endif
+      outbox.pop();
+    }
+  }
   
-  // Send periodic status updates
-  sendPeriodicStatusUpdate();
+  if (outbox.getStats().pending == 0) {
+    eventWindowOpen = false;
+  }
+  outbox.sync();
 }
 
-// ==================== ENTRANCE GATE PROCESSING ====================
+// ==================== DISPLAY TASK ====================
 
-void processEntranceGate() {
-  // Read RFID card at entrance
-  String cardUID = rfidManager.readCard(RFIDManager::GATE_ENTRANCE);
+void displayTask(void* param) {
+  DisplayMessage msg;
   
-  // Check if new card detected (avoid duplicate scans)
-  if (!cardUID.isEmpty() && !cardUID.equals(lastScannedCardEntrance)) {
-    lastScannedCardEntrance = cardUID;
-    
-    // Check authorization
-    int accessLevel;
-    bool authorized = rfidManager.isAuthorized(cardUID, accessLevel);
+  for (;;) {
+    // Sleep until a message arrives or a timed one expires, take everything
+    // queued so far, then send only the cells that changed
+    TickType_t wait = compositor.getWaitTicks();
+    while (pipeline.receiveDisplay(msg, wait)) {
+      compositor.apply(msg);
+      wait = 0;
+    }
+    compositor.render(lcd);
+    lcd.flush();
+  }
+}
+
+// ==================== PIPELINE HELPERS ====================
+
+void showGateStatus(const char* gate, const char* status, uint8_t row) {
+  char text[LCD_COLS + 1];
+  snprintf(text, sizeof(text), "%s: %s", gate, status);
+  pipeline.postDisplayLine(row, text, DISPLAY_PRIO_GATE);
+}
+
+// Shown over the gate status for DISPLAY_MESSAGE_DURATION
+void showGateDenied(const char* gate, const char* status, uint8_t row) {
+  char text[LCD_COLS + 1];
+  snprintf(text, sizeof(text), "%s: %s", gate, status);
+  pipeline.postDisplayLine(row, text, DISPLAY_PRIO_DENIED, DISPLAY_MESSAGE_DURATION);
+}
+
+void clearGateStatus(uint8_t row) {
+  pipeline.postDisplayClear(1 << row, DISPLAY_PRIO_GATE);
+}
+
+void showGateSlot(const char* gate, int slotNumber, uint8_t row) {
+  char status[LCD_COLS + 1];
+  snprintf(status, sizeof(status), "Open S%d", slotNumber);
+  showGateStatus(gate, status, row);
+}
+
+void showMessage(const char* line1, const char* line2, DisplayPriority priority,
+                 uint32_t durationMs) {
+  pipeline.postDisplayMessage(line1, line2, priority, durationMs);
+}
+
+void clearMessage(DisplayPriority priority) {
+  pipeline.postDisplayClear(0x03, priority);
+}
+
+void queueEvent(PublishType type, const CardUid& cardUID, int slotNumber,
+                const char* status, unsigned long duration) {
+  PublishMessage msg = {};
+  msg.type = type;
+  msg.cardUID = cardUID;
+  msg.status = status;
+  msg.slotNumber = slotNumber;
+  msg.availableSlots = slotManager.getAvailableSlots();
+  msg.duration = duration;
+  msg.timestamp = timeSync.getTimestamp();
+  
+#if BENCHMARK_MODE_ENABLED
+  benchmark.onEventQueued(type, cardUID);
+#endif
+  pipeline.postPublish(msg);
+}
+
+// Refusals: the first one of a card at a lane is an ordinary entry/exit
+// event, repeats within DENY_CACHE_TTL_MS are folded into one summary
+void queueDenial(PublishType type, const GateEventData& eventData) {
+#if DENY_CACHE_ENABLED
+  if (!denyCache.recordDenial(eventData.lane, eventData.cardUID,
+                              rfidManager.getRevision(), TimeSync::monotonicMillis())) {
+    return;
+  }
+#endif
+  queueEvent(type, eventData.cardUID, 0, "denied_unauthorized", 0);
+}
+
+#if DENY_CACHE_ENABLED
+void queueDeniedSummaries() {
+  DenySummary summary;
+  while (denyCache.popSummary(TimeSync::monotonicMillis(), rfidManager.getRevision(),
+                              summary)) {
+    PublishMessage msg = {};
+    msg.type = PUBLISH_DENIED_SUMMARY;
+    msg.cardUID = summary.uid;
+    msg.gate = (lanes[summary.lane].direction == LANE_EXIT) ? "exit" : "entrance";
+    msg.lane = summary.lane;
+    msg.repeats = summary.repeats;
+    msg.duration = (unsigned long)((summary.lastMs - summary.firstMs) / 1000);
+    msg.timestamp = timeSync.getTimestamp();
     
-    // Check if parking is full
-    bool parkingFull = (slotManager.getAvailableSlots() == 0);
+    pipeline.postPublish(msg);
+  }
+}
+#endif
+
+void queueWhitelistAck(const WhitelistAck& ack) {
+  if (!ack.send) {
+    return;
+  }
+  
+  PublishMessage msg = {};
+  msg.type = PUBLISH_WHITELIST_ACK;
+  msg.status = ack.status;
+  msg.version = ack.version;
+  msg.cardCount = ack.cardCount;
+  msg.timestamp = timeSync.getTimestamp();
+  
+  pipeline.postPublish(msg);
+}
+
+void queueMQTTCommand(const char* command, JsonDocument& doc) {
+  // Runs in the network task's MQTT callback: hand the command to the gate
+  // task, which owns every module the commands operate on
+  const CommandSpec* spec = commandRegistry.find(command);
+  const char* status = "accepted";
+  
+  if (spec == nullptr) {
+    DEBUG_PRINTF("✗ Unknown command: %s\n", command);
+    status = "unknown_command";
+  } else {
+    char payload[MQTT_BUFFER_SIZE];
+    size_t length = serializeJson(doc, payload, sizeof(payload));
     
-    // Allocate slot if authorized and space available
-    int slotNumber = -1;
-    if (authorized && !parkingFull) {
-      slotNumber = slotManager.allocateSlot(cardUID, timeSync.getTimestamp());
+    if (!pipeline.postCommand(payload, length)) {
+      DEBUG_PRINTF("✗ Command queue full, dropped: %s\n", command);
+      status = "queue_full";
     }
-    
-    // Send to gate controller
-    entranceGate.handleCardScanned(cardUID, authorized, slotNumber, parkingFull);
   }
   
-  // Clear last scanned card when vehicle leaves
-  if (!entranceGate.isVehicleDetected() && !lastScannedCardEntrance.isEmpty()) {
-    lastScannedCardEntrance = "";
+  // Commands with an id are acknowledged right away and get a result once
+  // the gate task ran them. The ack is queued rather than published here:
+  // the callback is still reading from the client's buffer.
+  uint32_t commandId = doc["id"] | 0u;
+  if (commandId != 0) {
+    PublishMessage msg = {};
+    msg.type = PUBLISH_COMMAND_ACK;
+    msg.command = (spec != nullptr) ? spec->name : nullptr;
+    msg.commandId = commandId;
+    msg.status = status;
+    pipeline.postPublish(msg);
   }
 }
 
-// ==================== EXIT GATE PROCESSING ====================
+// ==================== LANE PROCESSING ====================
+
+// Readers share the SPI bus and an empty poll holds it until the reader
+// times out, so each iteration polls at most RFID_POLLS_PER_ITERATION of
+// them, lanes waiting for a card first (see ReaderScheduler)
+void processLanes() {
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    bool waiting = (gates[lane].getState() == STATE_WAITING_CARD);
+    readerScheduler.setWaiting(lane, waiting);
+#if RFID_POLL_ONLY_WHEN_WAITING
+    // Only talk to the reader while a vehicle is waiting for a card
+    rfidManager.setPollingEnabled(lane, waiting);
+#endif
+  }
+  
+  uint8_t polled[LANE_COUNT];
+  uint8_t count = readerScheduler.schedule(polled, RFID_POLLS_PER_ITERATION,
+                                           !RFID_POLL_ONLY_WHEN_WAITING);
+  for (uint8_t i = 0; i < count; i++) {
+    processLaneCard(polled[i]);
+  }
+  
+  // Clear last scanned card when vehicle leaves
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    if (!gates[lane].isVehicleDetected() && !lastScannedCard[lane].isEmpty()) {
+      lastScannedCard[lane].clear();
+    }
+  }
+}
 
-void processExitGate() {
-  // Read RFID card at exit
-  String cardUID = rfidManager.readCard(RFIDManager::GATE_EXIT);
+void processLaneCard(uint8_t lane) {
+  GateController& gate = gates[lane];
+  
+  // Read RFID card at this lane
+  CardUid cardUID;
+  uint64_t traceStart = LatencyTracer::now();
+  bool cardRead = rfidManager.readCard(lane, cardUID);
   
   // Check if new card detected (avoid duplicate scans)
-  if (!cardUID.isEmpty() && !cardUID.equals(lastScannedCardExit)) {
-    lastScannedCardExit = cardUID;
-    
-    // Check authorization
-    int accessLevel;
-    bool authorized = rfidManager.isAuthorized(cardUID, accessLevel);
+  if (!cardRead || cardUID == lastScannedCard[lane]) {
+    return;
+  }
+  lastScannedCard[lane] = cardUID;
+  
+  // Check authorization; a card refused here moments ago is refused again
+  // without a lookup
+  int accessLevel = 0;
+  bool authorized;
+#if DENY_CACHE_ENABLED
+  if (denyCache.isDenied(lane, cardUID, rfidManager.getRevision(),
+                         TimeSync::monotonicMillis())) {
+    authorized = false;
+  } else
+#endif
+  {
+    authorized = rfidManager.isAuthorized(cardUID, accessLevel);
+  }
+  
+  int slotNumber = -1;
+  bool parkingFull = false;
+  if (authorized && lanes[lane].direction == LANE_ENTRY) {
+    // Allocate a slot in a zone open to the card's access level; "full"
+    // means full for this card, even if other zones have room
+    slotNumber = slotManager.allocateSlot(cardUID, accessLevel);
+    parkingFull = (slotNumber == -1);
     
-    // Find and release slot
-    int slotNumber = -1;
-    if (authorized) {
-      slotNumber = slotManager.findSlotByCard(cardUID);
-      
-      // If slot found, it will be released in the event handler
-      // If not found, still allow exit (manual override or system restart)
-      if (slotNumber == -1) {
-        slotNumber = 0;  // Indicate no slot record
-      }
+  } else if (authorized) {
+    // Find the slot; it is released in the event handler. If not found,
+    // still allow exit (manual override or system restart)
+    slotNumber = slotManager.findSlotByCard(cardUID);
+    if (slotNumber == -1) {
+      slotNumber = 0;  // Indicate no slot record
     }
-    
-    // Send to gate controller
-    exitGate.handleCardScanned(cardUID, authorized, slotNumber, false);
   }
   
-  // Clear last scanned card when vehicle leaves
-  if (!exitGate.isVehicleDetected() && !lastScannedCardExit.isEmpty()) {
-    lastScannedCardExit = "";
+  // Send to gate controller
+  gate.handleCardScanned(cardUID, authorized, slotNumber, parkingFull);
+  if (gate.getState() == STATE_BARRIER_OPEN) {
+    LatencyTracer::recordSince(TRACE_CARD_TO_OPEN, traceStart);
+  }
+}
+
+// Lane a command addresses: "lane" (index into LANES) if given, otherwise
+// the first lane in the direction of "gate" ("entrance" or "exit")
+int findLane(JsonDocument& doc, const char* defaultGate) {
+  if (doc["lane"].is<int>()) {
+    int lane = doc["lane"];
+    return (lane >= 0 && lane < LANE_COUNT) ? lane : -1;
+  }
+  
+  const char* gate = doc["gate"] | defaultGate;
+  LaneDirection direction;
+  if (strcmp(gate, "entrance") == 0) {
+    direction = LANE_ENTRY;
+  } else if (strcmp(gate, "exit") == 0) {
+    direction = LANE_EXIT;
+  } else {
+    return -1;
+  }
+  
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    if (lanes[lane].direction == direction) {
+      return lane;
+    }
+  }
+  return -1;
+}
+
+// Entry lanes share LCD row 0, exit lanes row 1
+uint8_t laneDisplayRow(uint8_t lane) {
+  return (lanes[lane].direction == LANE_ENTRY) ? 0 : 1;
+}
+
+// ==================== GATE EVENT DISPATCH ====================
+
+void handleGateEvent(const GateEventData& eventData) {
+  const LaneConfig& lane = lanes[eventData.lane];
+  if (lane.direction == LANE_ENTRY) {
+    handleEntranceGateEvent(eventData, lane);
+  } else {
+    handleExitGateEvent(eventData, lane);
   }
 }
 
 // ==================== ENTRANCE GATE EVENT HANDLER ====================
 
-void handleEntranceGateEvent(const GateEventData& eventData) {
+void handleEntranceGateEvent(const GateEventData& eventData, const LaneConfig& lane) {
   switch (eventData.event) {
     case EVENT_VEHICLE_DETECTED:
-      lcd.displayGateStatus("IN", MSG_SCAN_CARD, 0);
+      showGateStatus(lane.label, MSG_SCAN_CARD, 0);
       break;
       
     case EVENT_VEHICLE_LEFT:
-      lcd.displayGateStatus("IN", "Ready", 0);
+      clearGateStatus(0);
       break;
       
     case EVENT_CARD_SCANNED:
       // Access granted
-      lcd.displayGateStatus("IN", "Open S" + String(eventData.slotNumber), 0);
+      showGateSlot(lane.label, eventData.slotNumber, 0);
       
-      // Publish MQTT event
-      mqttHandler.publishEntry(
-        eventData.cardUID,
-        eventData.slotNumber,
-        "success",
-        slotManager.getAvailableSlots(),
-        timeSync.getTimestamp()
-      );
+      // Queue MQTT event
+      queueEvent(PUBLISH_ENTRY, eventData.cardUID, eventData.slotNumber, "success", 0);
       break;
       
     case EVENT_CARD_DENIED:
-      lcd.displayGateStatus("IN", "Denied", 0);
+      showGateDenied(lane.label, "Denied", 0);
       
-      // Publish MQTT event
-      mqttHandler.publishEntry(
-        eventData.cardUID,
-        0,
-        "denied_unauthorized",
-        slotManager.getAvailableSlots(),
-        timeSync.getTimestamp()
-      );
+      // Queue MQTT event (repeats folded by the deny cache)
+      queueDenial(PUBLISH_ENTRY, eventData);
       break;
       
     case EVENT_PARKING_FULL:
-      lcd.displayGateStatus("IN", "Full", 0);
+      showGateDenied(lane.label, "Full", 0);
       
-      // Publish MQTT event
-      mqttHandler.publishEntry(
-        eventData.cardUID,
-        0,
-        "denied_full",
-        slotManager.getAvailableSlots(),
-        timeSync.getTimestamp()
-      );
+      // Queue MQTT event
+      queueEvent(PUBLISH_ENTRY, eventData.cardUID, 0, "denied_full", 0);
       break;
       
     case EVENT_VEHICLE_PASSED:
+    case EVENT_GATE_CLOSED:
+      clearGateStatus(0);
       updateDisplay();
       break;
       
@@ -263,14 +755,14 @@ void handleEntranceGateEvent(const GateEventData& eventData) {
 
 // ==================== EXIT GATE EVENT HANDLER ====================
 
-void handleExitGateEvent(const GateEventData& eventData) {
+void handleExitGateEvent(const GateEventData& eventData, const LaneConfig& lane) {
   switch (eventData.event) {
     case EVENT_VEHICLE_DETECTED:
-      lcd.displayGateStatus("OUT", MSG_SCAN_CARD, 1);
+      showGateStatus(lane.label, MSG_SCAN_CARD, 1);
       break;
       
     case EVENT_VEHICLE_LEFT:
-      lcd.displayGateStatus("OUT", "Ready", 1);
+      clearGateStatus(1);
       break;
       
     case EVENT_CARD_SCANNED:
@@ -281,38 +773,27 @@ void handleExitGateEvent(const GateEventData& eventData) {
         
         if (slotNumber > 0) {
           duration = slotManager.releaseSlot(slotNumber);
-          lcd.displayGateStatus("OUT", "Open S" + String(slotNumber), 1);
+          showGateSlot(lane.label, slotNumber, 1);
         } else {
-          lcd.displayGateStatus("OUT", "Open", 1);
+          showGateStatus(lane.label, "Open", 1);
         }
         
-        // Publish MQTT event
-        mqttHandler.publishExit(
-          eventData.cardUID,
-          slotNumber,
-          (slotNumber > 0) ? "success" : "success_no_slot",
-          duration,
-          slotManager.getAvailableSlots(),
-          timeSync.getTimestamp()
-        );
+        // Queue MQTT event
+        queueEvent(PUBLISH_EXIT, eventData.cardUID, slotNumber,
+                   (slotNumber > 0) ? "success" : "success_no_slot", duration);
       }
       break;
       
     case EVENT_CARD_DENIED:
-      lcd.displayGateStatus("OUT", "Denied", 1);
+      showGateDenied(lane.label, "Denied", 1);
       
-      // Publish MQTT event
-      mqttHandler.publishExit(
-        eventData.cardUID,
-        0,
-        "denied_unauthorized",
-        0,
-        slotManager.getAvailableSlots(),
-        timeSync.getTimestamp()
-      );
+      // Queue MQTT event (repeats folded by the deny cache)
+      queueDenial(PUBLISH_EXIT, eventData);
       break;
       
     case EVENT_VEHICLE_PASSED:
+    case EVENT_GATE_CLOSED:
+      clearGateStatus(1);
       updateDisplay();
       break;
       
@@ -321,117 +802,276 @@ void handleExitGateEvent(const GateEventData& eventData) {
   }
 }
 
-// ==================== MQTT COMMAND HANDLER ====================
+// ==================== MQTT COMMAND HANDLERS ====================
 
-void handleMQTTCommand(const char* command, JsonDocument& doc) {
-  DEBUG_PRINTF("Processing MQTT command: %s\n", command);
+// Each handler runs in the gate task and returns the result status that
+// is published for commands carrying an "id"
+
+const char* handleOpenBarrierCommand(JsonDocument& doc) {
+  int lane = findLane(doc, "");
+  if (lane < 0) {
+    return "no_lane";
+  }
   
-  if (strcmp(command, "open_barrier") == 0) {
-    const char* gate = doc["gate"];
-    
-    if (strcmp(gate, "entrance") == 0) {
-      entranceGate.openGate(5000);
-      lcd.displayGateStatus("IN", "Manual Open", 0);
-      delay(5000);
-      entranceGate.closeGate();
-      updateDisplay();
-      
-    } else if (strcmp(gate, "exit") == 0) {
-      exitGate.openGate(5000);
-      lcd.displayGateStatus("OUT", "Manual Open", 1);
-      delay(5000);
-      exitGate.closeGate();
-      updateDisplay();
+  // The gate closes itself (EVENT_GATE_CLOSED) once the hold expires
+  gates[lane].openGate(MANUAL_OPEN_DURATION);
+  showGateStatus(lanes[lane].label, "Manual Open", laneDisplayRow(lane));
+  return "ok";
+}
+
+const char* handleEmergencyCommand(JsonDocument& doc) {
+  bool enable = doc["enable"];
+  emergencyMode = enable;
+  
+  if (emergencyMode) {
+    DEBUG_PRINTLN("🚨 EMERGENCY MODE ACTIVATED");
+    for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+      gates[lane].openGate();
     }
-    
-  } else if (strcmp(command, "emergency") == 0) {
-    bool enable = doc["enable"];
-    emergencyMode = enable;
-    
-    if (emergencyMode) {
-      DEBUG_PRINTLN("🚨 EMERGENCY MODE ACTIVATED");
-      entranceGate.openGate();
-      exitGate.openGate();
-      lcd.showMessage(MSG_EMERGENCY_MODE, "All gates open");
-    } else {
-      DEBUG_PRINTLN("✓ Emergency mode deactivated");
-      entranceGate.closeGate();
-      exitGate.closeGate();
-      updateDisplay();
+    showMessage(MSG_EMERGENCY_MODE, "All gates open", DISPLAY_PRIO_EMERGENCY, 0);
+  } else {
+    DEBUG_PRINTLN("✓ Emergency mode deactivated");
+    for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+      gates[lane].reset();
     }
+    clearMessage(DISPLAY_PRIO_GATE);
+    clearMessage(DISPLAY_PRIO_EMERGENCY);
+    updateDisplay();
+  }
+  return "ok";
+}
+
+const char* handleUpdateWhitelistCommand(JsonDocument& doc) {
+  // A reload would drop the chunks of a snapshot applied so far
+  if (whitelistSync.isSnapshotActive()) {
+    return "busy";
+  }
+  
+  // Reload RFID cards from storage
+  DEBUG_PRINTLN("Whitelist update requested");
+  rfidManager.loadFromStorage();
+  return "ok";
+}
+
+const char* handleSyncWhitelistCommand(JsonDocument& doc) {
+  // Legacy full-list sync (superseded by whitelist_delta/whitelist_snapshot).
+  // Not while a snapshot holds the list open in its own transaction.
+  if (whitelistSync.isSnapshotActive()) {
+    return "busy";
+  }
+  
+  DEBUG_PRINTLN("🔄 Syncing whitelist from backend...");
+  
+  // Rebuild the list in one transaction; unchanged records are not rewritten
+  rfidManager.beginTransaction();
+  rfidManager.clearAllCards();
+  
+  // Parse cards array from JSON
+  JsonArray cardsArray = doc["cards"].as<JsonArray>();
+  int successCount = 0;
+  int failCount = 0;
+  
+  for (JsonObject cardObj : cardsArray) {
+    const char* uid = cardObj["card_uid"];
+    const char* ownerName = cardObj["owner_name"] | "Unknown";
+    int accessLevel = cardObj["access_level"] | 0;
+    bool isActive = cardObj["is_active"] | true;
     
-  } else if (strcmp(command, "update_whitelist") == 0) {
-    // Reload RFID cards from EEPROM
-    DEBUG_PRINTLN("Whitelist update requested");
-    rfidManager.loadFromEEPROM();
-    
-  } else if (strcmp(command, "sync_whitelist") == 0) {
-    // Synchronize whitelist from backend
-    DEBUG_PRINTLN("🔄 Syncing whitelist from backend...");
-    
-    // Clear existing cards
-    rfidManager.clearAllCards();
-    
-    // Parse cards array from JSON
-    JsonArray cardsArray = doc["cards"].as<JsonArray>();
-    int successCount = 0;
-    int failCount = 0;
-    
-    for (JsonObject cardObj : cardsArray) {
-      const char* uid = cardObj["card_uid"];
-      const char* ownerName = cardObj["owner_name"] | "Unknown";
-      int accessLevel = cardObj["access_level"] | 0;
-      bool isActive = cardObj["is_active"] | true;
-      
-      // Only add active cards
-      if (isActive && uid != nullptr) {
-        if (rfidManager.addCard(uid, ownerName, accessLevel)) {
-          successCount++;
-        } else {
-          failCount++;
-        }
+    // Only add active cards
+    CardUid cardUID;
+    if (isActive && cardUID.fromHex(uid)) {
+      if (rfidManager.addCard(cardUID, ownerName, accessLevel)) {
+        successCount++;
+      } else {
+        failCount++;
       }
     }
+  }
+  
+  // Unversioned: the next delta will find a gap and request a snapshot
+  rfidManager.setWhitelistVersion(0);
+  rfidManager.commitTransaction();
+  
+  DEBUG_PRINTF("✓ Whitelist sync complete: %d added, %d failed\n", successCount, failCount);
+  char summary[LCD_COLS + 1];
+  snprintf(summary, sizeof(summary), "%d cards added", successCount);
+  showMessage("Whitelist Synced", summary, DISPLAY_PRIO_NOTICE, DISPLAY_MESSAGE_DURATION);
+  return (failCount == 0) ? "ok" : "incomplete";
+}
+
+// The whitelist ack still goes out; the command result repeats its status
+const char* whitelistResult(const WhitelistAck& ack) {
+  queueWhitelistAck(ack);
+  return ack.send ? ack.status : "ok";
+}
+
+const char* handleWhitelistDeltaCommand(JsonDocument& doc) {
+  return whitelistResult(whitelistSync.applyDelta(doc));
+}
+
+const char* handleWhitelistSnapshotCommand(JsonDocument& doc) {
+  return whitelistResult(whitelistSync.applySnapshotChunk(doc));
+}
+
+const char* handleWhitelistVersionCommand(JsonDocument& doc) {
+  return whitelistResult(whitelistSync.reportVersion());
+}
+
+const char* handleGetStatusCommand(JsonDocument& doc) {
+  // Status is assembled by the network task
+  PublishMessage msg = {};
+  msg.type = PUBLISH_STATUS;
+  pipeline.postPublish(msg);
+  return "ok";
+}
+
+const char* handleGetMetricsCommand(JsonDocument& doc) {
+  // Latency percentiles, also assembled by the network task
+  PublishMessage msg = {};
+  msg.type = PUBLISH_METRICS;
+  pipeline.postPublish(msg);
+  return "ok";
+}
+
+const char* handleScanModeCommand(JsonDocument& doc) {
+  // Card scan mode for enrollment
+  bool enable = doc["enable"].as<bool>();
+  int lane = findLane(doc, "entrance");
+  
+  DEBUG_PRINT("📋 Scan mode command received - enable: ");
+  DEBUG_PRINT(enable);
+  DEBUG_PRINT(", lane: ");
+  DEBUG_PRINTLN(lane);
+  
+  if (enable && lane < 0) {
+    DEBUG_PRINTLN("✗ Scan mode: no such lane");
+    return "no_lane";
+  }
+  
+  if (enable) {
+    scanModeActive = true;
+    scanModeStartTime = TimeSync::monotonicMillis();
+    scanModeLane = lane;
     
-    DEBUG_PRINTF("✓ Whitelist sync complete: %d added, %d failed\n", successCount, failCount);
-    lcd.showMessage("Whitelist Synced", String(successCount) + " cards added");
-    delay(2000);
-    updateDisplay();
-    
-  } else if (strcmp(command, "get_status") == 0) {
-    sendStatusUpdate();
-    
-  } else if (strcmp(command, "scan_mode") == 0) {
-    // Card scan mode for enrollment
-    bool enable = doc["enable"].as<bool>();
-    const char* gate = doc["gate"] | "entrance";
-    
-    DEBUG_PRINT("📋 Scan mode command received - enable: ");
-    DEBUG_PRINT(enable);
-    DEBUG_PRINT(", gate: ");
-    DEBUG_PRINTLN(gate);
+    DEBUG_PRINTLN("🔍 Scan mode ACTIVATED - waiting for card...");
+    showMessage("SCAN MODE", "Tap card now...", DISPLAY_PRIO_NOTICE, 0);
+  } else {
+    scanModeActive = false;
+    DEBUG_PRINTLN("✓ Scan mode deactivated");
+    clearMessage(DISPLAY_PRIO_NOTICE);
+  }
+  return "ok";
+}
+
+const char* handleResetSlotsCommand(JsonDocument& doc) {
+  // Clear all slots (for testing)
+  slotManager.clearAllSlots();
+  DEBUG_PRINTLN("All slots cleared");
+  updateDisplay();
+  return "ok";
+}
+
+// Indexed by commandRegistry in setup(). A running benchmark holds the
+// whitelist in an open transaction and simulates the sensors, so every
+// command without COMMAND_KEEPS_BENCHMARK ends it first.
+const CommandSpec commandTable[] = {
+  {"open_barrier",       handleOpenBarrierCommand,       0},
+  {"emergency",          handleEmergencyCommand,         0},
+  {"update_whitelist",   handleUpdateWhitelistCommand,   0},
+  {"sync_whitelist",     handleSyncWhitelistCommand,     0},
+  {"whitelist_delta",    handleWhitelistDeltaCommand,    0},
+  {"whitelist_snapshot", handleWhitelistSnapshotCommand, 0},
+  {"whitelist_version",  handleWhitelistVersionCommand,  0},
+  {"get_status",         handleGetStatusCommand,         COMMAND_KEEPS_BENCHMARK},
+  {"get_metrics",        handleGetMetricsCommand,        COMMAND_KEEPS_BENCHMARK},
+  {"scan_mode",          handleScanModeCommand,          0},
+  {"reset_slots",        handleResetSlotsCommand,        0},
+#if BENCHMARK_MODE_ENABLED
+  {"benchmark",          handleBenchmarkCommand,         COMMAND_KEEPS_BENCHMARK},
+#endif
+};
+const uint8_t commandTableSize = sizeof(commandTable) / sizeof(commandTable[0]);
+static_assert(sizeof(commandTable) / sizeof(commandTable[0]) <= COMMAND_MAX,
+              "commandTable has more than COMMAND_MAX rows");
+
+// Runs in the gate task; see queueMQTTCommand()
+void handleMQTTCommand(const char* command, JsonDocument& doc) {
+  DEBUG_PRINTF("Processing MQTT command: %s\n", command);
+  
+  // Unknown commands were already refused by queueMQTTCommand()
+  const CommandSpec* spec = commandRegistry.find(command);
+  if (spec == nullptr) {
+    return;
+  }
+  
+#if BENCHMARK_MODE_ENABLED
+  if (benchmark.isRunning() && !(spec->flags & COMMAND_KEEPS_BENCHMARK)) {
+    benchmark.stop();
+    finishBenchmark();
+  }
+#endif
+  
+  const char* result = spec->handler(doc);
+  
+  uint32_t commandId = doc["id"] | 0u;
+  if (commandId != 0) {
+    PublishMessage msg = {};
+    msg.type = PUBLISH_COMMAND_RESULT;
+    msg.command = spec->name;
+    msg.commandId = commandId;
+    msg.status = result;
+    msg.timestamp = timeSync.getTimestamp();
+    pipeline.postPublish(msg);
+  }
+}
+
+// ==================== BENCHMARK MODE ====================
+
+#if BENCHMARK_MODE_ENABLED
+// Runs in the gate task. Every action answers on MQTT_TOPIC_BENCHMARK:
+// "start" with status "running" (or why not), "stop" with the results so
+// far, "status" with the current or last run.
+const char* handleBenchmarkCommand(JsonDocument& doc) {
+  const char* action = doc["action"] | "start";
+  
+  if (strcmp(action, "start") == 0) {
+    unsigned long duration = doc["duration"] | BENCHMARK_DEFAULT_DURATION_S;
+    if (duration == 0 || duration > BENCHMARK_MAX_DURATION_S) {
+      duration = BENCHMARK_MAX_DURATION_S;
+    }
     
-    if (enable) {
-      scanModeActive = true;
-      scanModeStartTime = millis();
-      scanModeGate = String(gate);
-      
-      DEBUG_PRINTLN("🔍 Scan mode ACTIVATED - waiting for card...");
-      lcd.showMessage("SCAN MODE", "Tap card now...");
-      
-    } else {
-      scanModeActive = false;
-      DEBUG_PRINTLN("✓ Scan mode deactivated");
-      updateDisplay();
+    if (emergencyMode) {
+      benchmark.reject("emergency");
+    } else if (scanModeActive || whitelistSync.isSnapshotActive()) {
+      benchmark.reject("busy");
+    } else if (benchmark.start(duration * 1000)) {
+      showMessage("BENCHMARK", "Synthetic cars", DISPLAY_PRIO_NOTICE, 0);
     }
     
-  } else if (strcmp(command, "reset_slots") == 0) {
-    // Clear all slots (for testing)
-    slotManager.clearAllSlots();
-    DEBUG_PRINTLN("All slots cleared");
-    updateDisplay();
+  } else if (strcmp(action, "stop") == 0) {
+    if (benchmark.isRunning()) {
+      benchmark.stop();
+      finishBenchmark();
+      return "ok";
+    }
   }
+  
+  PublishMessage msg = {};
+  msg.type = PUBLISH_BENCHMARK;
+  pipeline.postPublish(msg);
+  return "ok";
+}
+
+void finishBenchmark() {
+  clearMessage(DISPLAY_PRIO_NOTICE);
+  updateDisplay();
+  
+  // Assembled by the network task, after the run's last events
+  PublishMessage msg = {};
+  msg.type = PUBLISH_BENCHMARK;
+  pipeline.postPublish(msg);
 }
+#endif
 
 // ==================== DISPLAY UPDATE ====================
 
@@ -439,18 +1079,24 @@ void updateDisplay() {
   int availableSlots = slotManager.getAvailableSlots();
   int totalSlots = slotManager.getTotalSlots();
   
-  lcd.displayGateStatus("IN", "Ready", 0);
-  lcd.displaySlotStatus(availableSlots, totalSlots, 1);
+  char slots[LCD_COLS + 1];
+  snprintf(slots, sizeof(slots), "Slots: %d/%d", availableSlots, totalSlots);
+  showMessage("IN: Ready", slots, DISPLAY_PRIO_IDLE, 0);
 }
 
 // ==================== STATUS UPDATE ====================
 
+// Runs in the network task
 void sendPeriodicStatusUpdate() {
-  unsigned long currentTime = millis();
+  uint64_t currentTime = TimeSync::monotonicMillis();
   
-  if (currentTime - lastStatusUpdate >= STATUS_UPDATE_INTERVAL) {
+  if (statusRequested) {
+    statusRequested = false;
+    lastStatusUpdate = currentTime;
+    sendStatusUpdate(true);
+  } else if (currentTime - lastStatusUpdate >= STATUS_UPDATE_INTERVAL) {
     lastStatusUpdate = currentTime;
-    sendStatusUpdate();
+    sendStatusUpdate(false);
   }
 }
 
@@ -458,49 +1104,73 @@ void sendPeriodicStatusUpdate() {
 
 void processScanMode() {
   // Auto-timeout after 30 seconds
-  if (millis() - scanModeStartTime > 30000) {
+  if (TimeSync::monotonicMillis() - scanModeStartTime > 30000) {
     scanModeActive = false;
     DEBUG_PRINTLN("⏱ Scan mode timeout");
-    updateDisplay();
+    clearMessage(DISPLAY_PRIO_NOTICE);
     return;
   }
   
-  // Determine which gate to read from
-  RFIDManager::GateType gate = (scanModeGate == "exit") ? 
-                                 RFIDManager::GATE_EXIT : 
-                                 RFIDManager::GATE_ENTRANCE;
+  // Enrollment taps happen without a vehicle at the gate
+  rfidManager.setPollingEnabled(scanModeLane, true);
   
   // Read card without authorization check
-  String cardUID = rfidManager.readCard(gate);
+  CardUid cardUID;
   
-  if (!cardUID.isEmpty()) {
+  if (rfidManager.readCard(scanModeLane, cardUID)) {
+    char uidHex[CARD_UID_HEX_SIZE];
+    cardUID.toHex(uidHex, sizeof(uidHex));
+    
     DEBUG_PRINT("📋 Card scanned in scan mode: ");
-    DEBUG_PRINTLN(cardUID);
+    DEBUG_PRINTLN(uidHex);
     
-    // Publish scan event
-    mqttHandler.publishScanEvent(cardUID, scanModeGate, timeSync.getTimestamp());
+    // Queue scan event
+    PublishMessage msg = {};
+    msg.type = PUBLISH_SCAN;
+    msg.cardUID = cardUID;
+    msg.gate = (lanes[scanModeLane].direction == LANE_EXIT) ? "exit" : "entrance";
+    msg.timestamp = timeSync.getTimestamp();
+    pipeline.postPublish(msg);
     
-    // Show feedback on LCD
-    lcd.showMessage("Card Scanned!", cardUID);
-    delay(2000);
+    // Show feedback on LCD; it replaces the scan prompt and expires on its own
+    showMessage("Card Scanned!", uidHex, DISPLAY_PRIO_NOTICE, DISPLAY_MESSAGE_DURATION);
     
     // Deactivate scan mode
     scanModeActive = false;
-    updateDisplay();
   }
 }
 
-void sendStatusUpdate() {
+// Runs in the network task. Slot and card counts are plain ints owned by the
+// gate task; a torn read is impossible on the ESP32 and a stale one harmless.
+// Unless full is set, MQTTHandler only sends what changed since last time.
+void sendStatusUpdate(bool full) {
   if (!mqttHandler.isConnected()) {
     return;
   }
   
+  // Time to first opening is whichever gate opened first
+  unsigned long firstOpen = 0;
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    unsigned long laneOpen = gates[lane].getFirstOpenTime();
+    if (laneOpen != 0 && (firstOpen == 0 || laneOpen < firstOpen)) {
+      firstOpen = laneOpen;
+    }
+  }
+  mqttHandler.setBootTiming(bootReadyMs, (uint32_t)firstOpen);
+  
+  HealthStats healthStats;
+  health.sample(healthStats);
+  healthStats.wifiReconnects = networkManager.getReconnectCount();
+  
   mqttHandler.publishStatus(
     slotManager.getTotalSlots(),
     slotManager.getAvailableSlots(),
     rfidManager.getCardCount(),
     emergencyMode,
     networkManager.getRSSI(),
-    timeSync.getUptime()
+    timeSync.getUptime(),
+    outbox.getStats(),
+    healthStats,
+    full
   );
 }
@@ -0,0 +1,151 @@
+/**
+ * @file Bench.h
+ * @brief Timing loop shared by the native benchmark suites
+ * @details Each benchmark grows its batch until one batch takes at least
+ *          BENCH_MIN_BATCH_MS of host time, then times BENCH_BATCHES
+ *          batches and reports the median per call. Results are printed as
+ *          one line per benchmark:
+ *
+ *              BENCH <name> <ns per op> ns/op
+ *
+ *          so two runs can be compared line by line (see
+ *          test/compare_bench.py). Always on the host clock, even while a
+ *          suite runs the modules on the virtual one.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include "CardUid/CardUid.h"
+
+#ifndef BENCH_MIN_BATCH_MS
+#define BENCH_MIN_BATCH_MS 20   // Shortest timed batch (ms of host time)
+#endif
+
+#ifndef BENCH_BATCHES
+#define BENCH_BATCHES 7         // Timed batches per benchmark; the median is reported
+#endif
+
+namespace bench {
+
+inline volatile uint32_t sink;   ///< Benchmarks fold results in here so the work is kept
+
+/**
+ * @brief Host monotonic time
+ * @return Nanoseconds from an arbitrary start
+ */
+inline int64_t hostNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Run op(i) for i = 0 .. iterations-1
+ * @return Elapsed host nanoseconds
+ */
+template <typename Op>
+int64_t timeBatch(Op& op, uint32_t iterations) {
+  int64_t start = hostNanos();
+  for (uint32_t i = 0; i < iterations; i++) {
+    op(i);
+  }
+  return hostNanos() - start;
+}
+
+/**
+ * @brief Time an operation and print its result line
+ * @param name Benchmark name (no spaces), e.g. "whitelist_lookup_hit/50"
+ * @param op Callable taking the iteration number (uint32_t)
+ * @return Median nanoseconds per call
+ */
+template <typename Op>
+double run(const char* name, Op op) {
+  // Size the batch, which also warms caches and the branch predictor
+  uint32_t iterations = 1;
+  while (timeBatch(op, iterations) < (int64_t)BENCH_MIN_BATCH_MS * 1000000 &&
+         iterations < (1u << 30)) {
+    iterations *= 2;
+  }
+
+  double samples[BENCH_BATCHES];
+  for (int b = 0; b < BENCH_BATCHES; b++) {
+    samples[b] = (double)timeBatch(op, iterations) / iterations;
+  }
+  std::sort(samples, samples + BENCH_BATCHES);
+  double median = samples[BENCH_BATCHES / 2];
+
+  printf("BENCH %-36s %12.1f ns/op  (%u ops x %d)\n", name, median,
+         (unsigned)iterations, BENCH_BATCHES);
+  fflush(stdout);
+  return median;
+}
+
+/**
+ * @brief Print a result line for a value measured by the caller
+ * @param name Metric name (no spaces)
+ * @param value Value
+ * @param unit Unit label
+ */
+inline void report(const char* name, double value, const char* unit) {
+  printf("BENCH %-36s %12.1f %s\n", name, value, unit);
+  fflush(stdout);
+}
+
+/**
+ * @brief Deterministic pseudo-random numbers (xorshift32) for workloads
+ */
+class Random {
+public:
+  explicit Random(uint32_t seed) : _state(seed != 0 ? seed : 1) {}
+
+  uint32_t next() {
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return _state;
+  }
+
+  /**
+   * @brief Uniform integer in [0, bound)
+   */
+  uint32_t below(uint32_t bound) { return bound > 0 ? next() % bound : 0; }
+
+  /**
+   * @brief Exponentially distributed value with the given mean
+   */
+  double exponential(double mean) {
+    // 1 - u is in (0, 1], so the log is finite
+    double u = (double)(next() >> 8) / (double)(1u << 24);
+    return -mean * log(1.0 - u);
+  }
+
+private:
+  uint32_t _state;
+};
+
+/**
+ * @brief Build the n-th card of a workload
+ * @details 4-byte UIDs with the bits of n spread out, like real cards;
+ *          different n always give different UIDs.
+ * @param n Card number
+ * @return Card UID
+ */
+inline CardUid makeCard(uint32_t n) {
+  // Odd multiplier: a bijection on 32 bits
+  uint32_t mixed = n * 2654435761u + 0x9E3779B9u;
+  uint8_t bytes[4] = {
+    (uint8_t)(mixed >> 24), (uint8_t)(mixed >> 16), (uint8_t)(mixed >> 8), (uint8_t)mixed
+  };
+  CardUid uid;
+  uid.fromBytes(bytes, sizeof(bytes));
+  return uid;
+}
+
+} // namespace bench
+
+#endif // BENCH_H
@@ -0,0 +1,67 @@
+"""Compare two benchmark runs of the native test suites.
+
+Reads the ``BENCH <name> <value> <unit>`` lines printed by test/common/Bench.h
+from a baseline and a candidate log (the output of ``pio test -e native -v``)
+and prints, per benchmark, both values and the change. Lines that are not
+benchmark results are ignored, so whole test logs can be passed in.
+
+    pio test -e native -v > bench_baseline.txt
+    # ... make the change ...
+    pio test -e native -v > bench_output.txt
+    python test/compare_bench.py bench_baseline.txt bench_output.txt
+
+Exits with status 1 if any ns/op benchmark got slower than --threshold
+percent, so the comparison can gate a change.
+"""
+
+import argparse
+import re
+import sys
+from typing import Dict, Tuple
+
+BENCH_LINE = re.compile(r"BENCH\s+(\S+)\s+([-+0-9.eE]+)\s+(\S+)")
+
+
+def load(path: str) -> Dict[str, Tuple[float, str]]:
+    """Map benchmark name -> (value, unit); a repeated name keeps the last."""
+    results = {}
+    with open(path, encoding="utf-8", errors="replace") as log:
+        for line in log:
+            match = BENCH_LINE.search(line)
+            if match:
+                results[match.group(1)] = (float(match.group(2)), match.group(3))
+    return results
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline", help="log of the reference run")
+    parser.add_argument("candidate", help="log of the run to check")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="slowdown in percent that counts as a regression (default 10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    candidate = load(args.candidate)
+    regressions = 0
+
+    print(f"{'benchmark':<40} {'baseline':>12} {'candidate':>12} {'change':>8}")
+    for name in sorted(baseline.keys() | candidate.keys()):
+        if name not in baseline or name not in candidate:
+            side = "candidate" if name in candidate else "baseline"
+            print(f"{name:<40} only in {side}")
+            continue
+
+        (old, unit), (new, _) = baseline[name], candidate[name]
+        change = (new - old) / old * 100.0 if old else 0.0
+        flag = ""
+        if unit == "ns/op" and change > args.threshold:
+            flag = "  slower"
+            regressions += 1
+        print(f"{name:<40} {old:>12.1f} {new:>12.1f} {change:>+7.1f}%{flag}  {unit}")
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
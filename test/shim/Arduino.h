@@ -0,0 +1,248 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the ESP32 Arduino core (env:native only)
+ * @details Covers the part of the core the gate modules use. GPIO levels
+ *          live in a table the tests drive through shim::setPin(), which
+ *          also runs an attached edge ISR. millis()/micros() follow
+ *          esp_timer_get_time(), so a simulation on the virtual clock moves
+ *          every module's sense of time. Serial output is discarded.
+ */
+
+#ifndef NATIVE_SHIM_ARDUINO_H
+#define NATIVE_SHIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <time.h>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#define SHIM_PIN_COUNT 40   // ESP32 GPIO numbers 0-39
+
+// ==================== STRING ====================
+
+/**
+ * @class String
+ * @brief Arduino String backed by std::string
+ */
+class String {
+public:
+  String() {}
+  String(const char* text) : _s(text != nullptr ? text : "") {}
+  String(const std::string& text) : _s(text) {}
+  String(char c) : _s(1, c) {}
+  String(int value, int base = DEC) { format(base == HEX ? "%x" : "%d", value); }
+  String(unsigned int value, int base = DEC) { format(base == HEX ? "%x" : "%u", value); }
+  String(long value, int base = DEC) { format(base == HEX ? "%lx" : "%ld", value); }
+  String(unsigned long value, int base = DEC) { format(base == HEX ? "%lx" : "%lu", value); }
+  String(unsigned char value, int base = DEC) { format(base == HEX ? "%x" : "%u", value); }
+  String(double value, unsigned int decimals = 2) { format("%.*f", (int)decimals, value); }
+
+  const char* c_str() const { return _s.c_str(); }
+  unsigned int length() const { return (unsigned int)_s.size(); }
+  bool isEmpty() const { return _s.empty(); }
+  bool equals(const String& other) const { return _s == other._s; }
+  bool equalsIgnoreCase(const String& other) const { return strcasecmp(c_str(), other.c_str()) == 0; }
+  bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+  int indexOf(char c) const { size_t p = _s.find(c); return p == std::string::npos ? -1 : (int)p; }
+  String substring(unsigned int from) const { return String(_s.substr(from)); }
+  String substring(unsigned int from, unsigned int to) const { return String(_s.substr(from, to - from)); }
+  long toInt() const { return atol(c_str()); }
+  void toUpperCase() { for (size_t i = 0; i < _s.size(); i++) _s[i] = (char)toupper(_s[i]); }
+  void toLowerCase() { for (size_t i = 0; i < _s.size(); i++) _s[i] = (char)tolower(_s[i]); }
+  void toCharArray(char* buffer, unsigned int size) const {
+    if (size == 0) return;
+    strncpy(buffer, c_str(), size - 1);
+    buffer[size - 1] = '\0';
+  }
+  bool reserve(unsigned int size) { _s.reserve(size); return true; }
+  void trim() {
+    size_t first = _s.find_first_not_of(" \t\r\n");
+    size_t last = _s.find_last_not_of(" \t\r\n");
+    _s = (first == std::string::npos) ? std::string() : _s.substr(first, last - first + 1);
+  }
+
+  char operator[](unsigned int i) const { return _s[i]; }
+  bool operator==(const String& other) const { return _s == other._s; }
+  bool operator==(const char* other) const { return _s == (other != nullptr ? other : ""); }
+  bool operator!=(const String& other) const { return _s != other._s; }
+  String& operator+=(const String& other) { _s += other._s; return *this; }
+  String& operator+=(const char* other) { _s += other; return *this; }
+  String& operator+=(char c) { _s += c; return *this; }
+
+  friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+
+private:
+  std::string _s;
+
+  void format(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buffer[40];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    _s = buffer;
+  }
+};
+
+// ==================== PRINT / SERIAL ====================
+
+/**
+ * @class Print
+ * @brief Output sink; the shim swallows everything written to it
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) { return 1; }
+  virtual size_t write(const uint8_t*, size_t size) { return size; }
+
+  size_t print(const String&) { return 0; }
+  size_t print(const char*) { return 0; }
+  size_t print(char) { return 0; }
+  size_t print(int, int = DEC) { return 0; }
+  size_t print(unsigned int, int = DEC) { return 0; }
+  size_t print(long, int = DEC) { return 0; }
+  size_t print(unsigned long, int = DEC) { return 0; }
+  size_t print(long long, int = DEC) { return 0; }
+  size_t print(unsigned long long, int = DEC) { return 0; }
+  size_t print(double, int = 2) { return 0; }
+  size_t println() { return 0; }
+  template <typename T> size_t println(const T& value) { return print(value); }
+  template <typename T> size_t println(const T& value, int) { return print(value); }
+  size_t printf(const char*, ...) __attribute__((format(printf, 2, 3))) { return 0; }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+};
+
+inline HardwareSerial Serial;
+
+// ==================== IP ADDRESS ====================
+
+class IPAddress {
+public:
+  IPAddress() : _address(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : _address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+  IPAddress(uint32_t address) : _address(address) {}
+  operator uint32_t() const { return _address; }
+  uint8_t operator[](int i) const { return (uint8_t)(_address >> (8 * i)); }
+  String toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buffer);
+  }
+
+private:
+  uint32_t _address;
+};
+
+// ==================== GPIO / TIME / RANDOM ====================
+
+namespace shim {
+
+inline uint8_t pinLevels[SHIM_PIN_COUNT];              ///< Level read by digitalRead()
+inline void (*pinIsrs[SHIM_PIN_COUNT])(void*);         ///< attachInterruptArg() handlers
+inline void* pinIsrArgs[SHIM_PIN_COUNT];               ///< Handler arguments
+inline uint32_t randomState = 0x2545F491;              ///< xorshift32 state
+
+/**
+ * @brief Drive an input pin; runs the attached ISR when the level changes
+ */
+inline void setPin(uint8_t pin, uint8_t level) {
+  if (pin >= SHIM_PIN_COUNT || pinLevels[pin] == level) {
+    return;
+  }
+  pinLevels[pin] = level;
+  if (pinIsrs[pin] != nullptr) {
+    pinIsrs[pin](pinIsrArgs[pin]);
+  }
+}
+
+/**
+ * @brief Deterministic pseudo-random source for random()/esp_random()
+ */
+inline uint32_t nextRandom() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+} // namespace shim
+
+inline unsigned long millis() { return (unsigned long)(esp_timer_get_time() / 1000); }
+inline unsigned long micros() { return (unsigned long)esp_timer_get_time(); }
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+inline void yield() {}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  // Pull-ups idle high, like the IR sensors' open-collector outputs
+  if (pin < SHIM_PIN_COUNT && mode == INPUT_PULLUP) {
+    shim::pinLevels[pin] = HIGH;
+  }
+}
+inline int digitalRead(uint8_t pin) { return pin < SHIM_PIN_COUNT ? shim::pinLevels[pin] : LOW; }
+inline void digitalWrite(uint8_t pin, uint8_t level) { if (pin < SHIM_PIN_COUNT) shim::pinLevels[pin] = level; }
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int) {
+  if (pin < SHIM_PIN_COUNT) {
+    shim::pinIsrs[pin] = isr;
+    shim::pinIsrArgs[pin] = arg;
+  }
+}
+inline void detachInterrupt(uint8_t pin) { if (pin < SHIM_PIN_COUNT) shim::pinIsrs[pin] = nullptr; }
+
+inline long random(long max) { return max > 0 ? (long)(shim::nextRandom() % (uint32_t)max) : 0; }
+inline long random(long min, long max) { return max > min ? min + random(max - min) : min; }
+inline void randomSeed(unsigned long seed) { shim::randomState = seed != 0 ? (uint32_t)seed : 1; }
+inline uint32_t esp_random() { return shim::nextRandom(); }
+
+template <class T> const T& min(const T& a, const T& b) { return b < a ? b : a; }
+template <class T> const T& max(const T& a, const T& b) { return a < b ? b : a; }
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Time zone setup; SNTP itself is in esp_sntp.h
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}
+
+#endif // NATIVE_SHIM_ARDUINO_H
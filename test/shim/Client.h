@@ -0,0 +1,23 @@
+/**
+ * @file Client.h
+ * @brief Host stand-in for the Arduino network client interface
+ */
+
+#ifndef NATIVE_SHIM_CLIENT_H
+#define NATIVE_SHIM_CLIENT_H
+
+#include <Arduino.h>
+
+class Client : public Stream {
+public:
+  virtual int connect(IPAddress, uint16_t) { return 1; }
+  virtual int connect(const char*, uint16_t) { return 1; }
+  virtual int read(uint8_t*, size_t) { return 0; }
+  using Stream::read;
+  virtual void flush() {}
+  virtual uint8_t connected() { return 1; }
+  virtual void stop() {}
+  virtual operator bool() { return connected(); }
+};
+
+#endif // NATIVE_SHIM_CLIENT_H
@@ -0,0 +1,52 @@
+/**
+ * @file EEPROM.h
+ * @brief Host stand-in for the emulated EEPROM, kept in memory
+ * @details Starts erased (0xFF like blank flash), so the legacy whitelist
+ *          import finds no image and leaves NVS alone unless a test puts
+ *          one there. shim::eepromReset() erases it again.
+ */
+
+#ifndef NATIVE_SHIM_EEPROM_H
+#define NATIVE_SHIM_EEPROM_H
+
+#include <Arduino.h>
+#include <vector>
+
+namespace shim {
+
+inline std::vector<uint8_t> eepromBytes(4096, 0xFF);   ///< Emulated EEPROM contents
+
+/**
+ * @brief Erase the emulated EEPROM
+ */
+inline void eepromReset() {
+  std::fill(eepromBytes.begin(), eepromBytes.end(), 0xFF);
+}
+
+} // namespace shim
+
+class EEPROMClass {
+public:
+  bool begin(size_t size) {
+    if (shim::eepromBytes.size() < size) {
+      shim::eepromBytes.resize(size, 0xFF);
+    }
+    return true;
+  }
+  void end() {}
+  uint8_t read(int address) { return shim::eepromBytes[address]; }
+  void write(int address, uint8_t value) { shim::eepromBytes[address] = value; }
+  bool commit() { return true; }
+  template <typename T> T& get(int address, T& value) {
+    memcpy((void*)&value, &shim::eepromBytes[address], sizeof(T));
+    return value;
+  }
+  template <typename T> const T& put(int address, const T& value) {
+    memcpy(&shim::eepromBytes[address], (const void*)&value, sizeof(T));
+    return value;
+  }
+};
+
+inline EEPROMClass EEPROM;
+
+#endif // NATIVE_SHIM_EEPROM_H
@@ -0,0 +1,34 @@
+/**
+ * @file ESP32Servo.h
+ * @brief Host stand-in for the ESP32Servo library
+ * @details Remembers the commanded angle so tests can check the barrier.
+ */
+
+#ifndef NATIVE_SHIM_ESP32SERVO_H
+#define NATIVE_SHIM_ESP32SERVO_H
+
+#include <Arduino.h>
+
+class Servo {
+public:
+  Servo() : _pin(-1), _angle(0), _writes(0) {}
+
+  void setPeriodHertz(int) {}
+  int attach(int pin, int, int) { _pin = pin; return 0; }
+  void detach() { _pin = -1; }
+  bool attached() const { return _pin >= 0; }
+  void write(int angle) { _angle = angle; _writes++; }
+  int read() const { return _angle; }
+
+  /**
+   * @brief Get the number of write() calls (shim only)
+   */
+  unsigned long getWriteCount() const { return _writes; }
+
+private:
+  int _pin;                 ///< Attached pin, -1 if detached
+  int _angle;               ///< Last commanded angle
+  unsigned long _writes;    ///< write() calls
+};
+
+#endif // NATIVE_SHIM_ESP32SERVO_H
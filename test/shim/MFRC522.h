@@ -0,0 +1,79 @@
+/**
+ * @file MFRC522.h
+ * @brief Host stand-in for the MFRC522 reader library
+ * @details A test puts a card in the field with presentCard(); the next
+ *          PICC_IsNewCardPresent()/PICC_ReadCardSerial() pair reads it once,
+ *          like a card held still after a successful read and HaltA.
+ */
+
+#ifndef NATIVE_SHIM_MFRC522_H
+#define NATIVE_SHIM_MFRC522_H
+
+#include <Arduino.h>
+
+class MFRC522 {
+public:
+  enum StatusCode : byte {
+    STATUS_OK,
+    STATUS_ERROR,
+    STATUS_TIMEOUT
+  };
+
+  typedef struct {
+    byte size;          ///< UID length (4, 7 or 10)
+    byte uidByte[10];   ///< UID bytes
+    byte sak;           ///< Select acknowledge
+  } Uid;
+
+  Uid uid;              ///< UID of the last card read
+
+  MFRC522() : _pending(false), _antennaOn(true), _reads(0) { memset(&uid, 0, sizeof(uid)); }
+  MFRC522(byte, byte) : MFRC522() {}
+
+  void PCD_Init() { _antennaOn = true; }
+  void PCD_Init(byte, byte) { PCD_Init(); }
+  void PCD_AntennaOn() { _antennaOn = true; }
+  void PCD_AntennaOff() { _antennaOn = false; }
+  bool PICC_IsNewCardPresent() { return _pending && _antennaOn; }
+  bool PICC_ReadCardSerial() {
+    if (!_pending || !_antennaOn) {
+      return false;
+    }
+    uid = _field;
+    _pending = false;
+    _reads++;
+    return true;
+  }
+  StatusCode PICC_HaltA() { return STATUS_OK; }
+  void PCD_StopCrypto1() {}
+
+  /**
+   * @brief Hold a card in front of the reader (shim only)
+   * @param bytes UID bytes
+   * @param size UID length (at most 10)
+   */
+  void presentCard(const byte* bytes, byte size) {
+    memset(&_field, 0, sizeof(_field));
+    _field.size = size > sizeof(_field.uidByte) ? sizeof(_field.uidByte) : size;
+    memcpy(_field.uidByte, bytes, _field.size);
+    _pending = true;
+  }
+
+  /**
+   * @brief Take the card away before it was read (shim only)
+   */
+  void removeCard() { _pending = false; }
+
+  /**
+   * @brief Get the number of successful reads (shim only)
+   */
+  unsigned long getReadCount() const { return _reads; }
+
+private:
+  Uid _field;             ///< Card in the field
+  bool _pending;          ///< _field not read yet
+  bool _antennaOn;        ///< RF field enabled
+  unsigned long _reads;   ///< Successful ReadCardSerial() calls
+};
+
+#endif // NATIVE_SHIM_MFRC522_H
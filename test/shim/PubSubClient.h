@@ -0,0 +1,144 @@
+/**
+ * @file PubSubClient.h
+ * @brief Host stand-in for the PubSubClient MQTT library
+ * @details An in-process broker: connect() succeeds while
+ *          shim::brokerOnline is set, publish() keeps the last message and
+ *          a count per client, and deliver() feeds a message to the
+ *          registered callback the way loop() would. The most recently
+ *          constructed client is shim::mqttClient, so tests can reach the
+ *          one inside MQTTHandler.
+ */
+
+#ifndef NATIVE_SHIM_PUBSUBCLIENT_H
+#define NATIVE_SHIM_PUBSUBCLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <string>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+class PubSubClient;
+
+namespace shim {
+
+inline bool brokerOnline = true;               ///< connect() succeeds
+inline PubSubClient* mqttClient = nullptr;     ///< Last constructed client
+
+} // namespace shim
+
+class PubSubClient {
+public:
+  typedef void (*Callback)(char* topic, uint8_t* payload, unsigned int length);
+
+  PubSubClient() { init(); }
+  explicit PubSubClient(Client&) { init(); }
+
+  PubSubClient& setServer(const char*, uint16_t) { return *this; }
+  PubSubClient& setServer(IPAddress, uint16_t) { return *this; }
+  PubSubClient& setCallback(Callback callback) { _callback = callback; return *this; }
+  PubSubClient& setClient(Client&) { return *this; }
+  PubSubClient& setKeepAlive(uint16_t) { return *this; }
+  PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+  bool setBufferSize(uint16_t size) { _bufferSize = size; return true; }
+  uint16_t getBufferSize() const { return _bufferSize; }
+
+  bool connect(const char* id) { return connect(id, nullptr, nullptr); }
+  bool connect(const char*, const char*, const char*) {
+    _connected = shim::brokerOnline;
+    _state = _connected ? MQTT_CONNECTED : MQTT_CONNECT_FAILED;
+    return _connected;
+  }
+  void disconnect() {
+    _connected = false;
+    _state = MQTT_DISCONNECTED;
+  }
+  bool connected() {
+    if (_connected && !shim::brokerOnline) {
+      _connected = false;
+      _state = MQTT_CONNECTION_LOST;
+    }
+    return _connected;
+  }
+  int state() const { return _state; }
+  bool loop() { return connected(); }
+
+  bool subscribe(const char*) { return _connected; }
+  bool subscribe(const char*, uint8_t) { return _connected; }
+
+  bool publish(const char* topic, const char* payload) {
+    return publish(topic, (const uint8_t*)payload, (unsigned int)strlen(payload));
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length) {
+    // Header plus topic must fit the buffer, as in the real client
+    if (!connected() || length + strlen(topic) + 7 > _bufferSize) {
+      return false;
+    }
+    if (_keepMessages) {
+      _lastTopic.assign(topic);
+      _lastPayload.assign((const char*)payload, length);
+    }
+    _published++;
+    _publishedBytes += length;
+    return true;
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool) {
+    return publish(topic, payload, length);
+  }
+
+  /**
+   * @brief Hand a message to the callback, as loop() does (shim only)
+   * @param topic Topic the message arrived on
+   * @param payload Payload bytes (copied; the callback gets a mutable buffer)
+   * @param length Payload length
+   */
+  void deliver(const char* topic, const char* payload, unsigned int length) {
+    if (_callback == nullptr) {
+      return;
+    }
+    _rxTopic.assign(topic);
+    _rxPayload.assign(payload, length);
+    _callback(&_rxTopic[0], (uint8_t*)&_rxPayload[0], length);
+  }
+
+  /**
+   * @brief Keep a copy of every published message (shim only, default on)
+   * @details Benchmarks turn this off so copying does not skew the timing.
+   */
+  void setKeepMessages(bool keep) { _keepMessages = keep; }
+
+  const std::string& getLastTopic() const { return _lastTopic; }
+  const std::string& getLastPayload() const { return _lastPayload; }
+  unsigned long getPublishedCount() const { return _published; }
+  unsigned long getPublishedBytes() const { return _publishedBytes; }
+
+private:
+  Callback _callback;
+  uint16_t _bufferSize;
+  bool _connected;
+  int _state;
+  bool _keepMessages;
+  std::string _lastTopic;
+  std::string _lastPayload;
+  std::string _rxTopic;
+  std::string _rxPayload;
+  unsigned long _published;
+  unsigned long _publishedBytes;
+
+  void init() {
+    _callback = nullptr;
+    _bufferSize = 256;
+    _connected = false;
+    _state = MQTT_DISCONNECTED;
+    _keepMessages = true;
+    _published = 0;
+    _publishedBytes = 0;
+    shim::mqttClient = this;
+  }
+};
+
+#endif // NATIVE_SHIM_PUBSUBCLIENT_H
@@ -0,0 +1,20 @@
+/**
+ * @file SPI.h
+ * @brief Host stand-in for the Arduino SPI bus
+ */
+
+#ifndef NATIVE_SHIM_SPI_H
+#define NATIVE_SHIM_SPI_H
+
+#include <Arduino.h>
+
+class SPIClass {
+public:
+  void begin() {}
+  void begin(int8_t, int8_t, int8_t, int8_t) {}
+  void end() {}
+};
+
+inline SPIClass SPI;
+
+#endif // NATIVE_SHIM_SPI_H
@@ -0,0 +1,29 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Host stand-in for the ESP-IDF heap statistics
+ * @details Reports a fixed, healthy heap so HealthMonitor has numbers to
+ *          publish; the host allocator is not instrumented.
+ */
+
+#ifndef NATIVE_SHIM_ESP_HEAP_CAPS_H
+#define NATIVE_SHIM_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+#define SHIM_HEAP_FREE 200000   // Free heap reported by the shim (bytes)
+
+inline void* heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void* heap_caps_calloc(size_t count, size_t size, uint32_t) { return calloc(count, size); }
+inline void heap_caps_free(void* ptr) { free(ptr); }
+inline size_t heap_caps_get_free_size(uint32_t) { return SHIM_HEAP_FREE; }
+inline size_t heap_caps_get_largest_free_block(uint32_t) { return SHIM_HEAP_FREE / 2; }
+inline size_t heap_caps_get_minimum_free_size(uint32_t) { return SHIM_HEAP_FREE; }
+
+#endif // NATIVE_SHIM_ESP_HEAP_CAPS_H
@@ -0,0 +1,33 @@
+/**
+ * @file esp_sntp.h
+ * @brief Host stand-in for the ESP-IDF SNTP client
+ * @details Never contacts a server. The registered notification callback is
+ *          kept in shim::sntpCallback so a test can deliver a sync itself.
+ */
+
+#ifndef NATIVE_SHIM_ESP_SNTP_H
+#define NATIVE_SHIM_ESP_SNTP_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+typedef enum {
+  SNTP_SYNC_MODE_IMMED,
+  SNTP_SYNC_MODE_SMOOTH
+} sntp_sync_mode_t;
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+namespace shim {
+
+inline sntp_sync_time_cb_t sntpCallback = nullptr;   ///< TimeSync's notification handler
+
+} // namespace shim
+
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) { shim::sntpCallback = callback; }
+inline void sntp_set_sync_mode(sntp_sync_mode_t) {}
+inline void sntp_set_sync_interval(uint32_t) {}
+inline int sntp_enabled() { return shim::sntpCallback != nullptr; }
+inline bool sntp_restart() { return shim::sntpCallback != nullptr; }
+
+#endif // NATIVE_SHIM_ESP_SNTP_H
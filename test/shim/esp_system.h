@@ -0,0 +1,38 @@
+/**
+ * @file esp_system.h
+ * @brief Host stand-in for ESP-IDF error codes and reset reasons
+ */
+
+#ifndef NATIVE_SHIM_ESP_SYSTEM_H
+#define NATIVE_SHIM_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+
+typedef enum {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO
+} esp_reset_reason_t;
+
+inline esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
+
+#endif // NATIVE_SHIM_ESP_SYSTEM_H
@@ -0,0 +1,55 @@
+/**
+ * @file esp_timer.h
+ * @brief Host stand-in for the ESP-IDF high-resolution timer
+ * @details Reads the host's steady clock by default. A simulation switches
+ *          to the virtual clock and moves it explicitly, so hours of gate
+ *          traffic replay in milliseconds and every run is reproducible.
+ */
+
+#ifndef NATIVE_SHIM_ESP_TIMER_H
+#define NATIVE_SHIM_ESP_TIMER_H
+
+#include <stdint.h>
+#include <chrono>
+
+namespace shim {
+
+inline bool virtualClock = false;    ///< esp_timer_get_time() returns virtualTimeUs
+inline int64_t virtualTimeUs = 0;    ///< Virtual microseconds since boot
+
+/**
+ * @brief Switch to the virtual clock
+ * @param startUs Virtual time to start from (microseconds since boot)
+ */
+inline void useVirtualClock(int64_t startUs) {
+  virtualClock = true;
+  virtualTimeUs = startUs;
+}
+
+/**
+ * @brief Return to the host clock
+ */
+inline void useHostClock() {
+  virtualClock = false;
+}
+
+/**
+ * @brief Move the virtual clock forward
+ * @param us Microseconds to advance
+ */
+inline void advanceTime(int64_t us) {
+  virtualTimeUs += us;
+}
+
+} // namespace shim
+
+inline int64_t esp_timer_get_time() {
+  if (shim::virtualClock) {
+    return shim::virtualTimeUs;
+  }
+  static const std::chrono::steady_clock::time_point boot = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now() - boot).count();
+}
+
+#endif // NATIVE_SHIM_ESP_TIMER_H
@@ -0,0 +1,77 @@
+/**
+ * @file esp_tls.h
+ * @brief Host stand-in for ESP-IDF's esp_tls (handshakes complete at once)
+ * @details An asynchronous connect succeeds on its first step while
+ *          shim::tlsOnline is set. Writes are swallowed, reads find nothing
+ *          waiting. The session offered by the last connect is kept in
+ *          shim::tlsOfferedSession, so a test can check resumption.
+ */
+
+#ifndef NATIVE_SHIM_ESP_TLS_H
+#define NATIVE_SHIM_ESP_TLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// The firmware's IDF configuration options this stand-in mirrors
+#define CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS 1
+#define CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY 1
+
+#define ESP_TLS_ERR_SSL_WANT_READ -0x6900
+#define ESP_TLS_ERR_SSL_WANT_WRITE -0x6880
+
+typedef struct esp_tls_client_session {
+  int id;                                  ///< Handshake that produced it
+} esp_tls_client_session_t;
+
+typedef struct esp_tls {
+  int handshake;                           ///< Number of this handshake
+} esp_tls_t;
+
+typedef struct esp_tls_cfg {
+  bool non_block;
+  int timeout_ms;
+  const char* common_name;
+  const unsigned char* cacert_buf;
+  unsigned int cacert_bytes;
+  int (*crt_bundle_attach)(void* conf);
+  esp_tls_client_session_t* client_session;
+} esp_tls_cfg_t;
+
+namespace shim {
+
+inline bool tlsOnline = true;                          ///< Connects succeed
+inline int tlsHandshakes = 0;                          ///< Completed handshakes
+inline int tlsOfferedSession = 0;                      ///< Session id offered last (0 = none)
+
+} // namespace shim
+
+inline esp_tls_t* esp_tls_init() { return new esp_tls_t(); }
+
+inline int esp_tls_conn_new_async(const char*, int, int, const esp_tls_cfg_t* cfg, esp_tls_t* tls) {
+  if (!shim::tlsOnline) {
+    return -1;
+  }
+  shim::tlsOfferedSession = cfg->client_session != nullptr ? cfg->client_session->id : 0;
+  tls->handshake = ++shim::tlsHandshakes;
+  return 1;
+}
+
+inline int esp_tls_conn_destroy(esp_tls_t* tls) {
+  delete tls;
+  return 0;
+}
+
+inline ssize_t esp_tls_conn_write(esp_tls_t*, const void*, size_t length) { return (ssize_t)length; }
+inline ssize_t esp_tls_conn_read(esp_tls_t*, void*, size_t) { return ESP_TLS_ERR_SSL_WANT_READ; }
+
+inline esp_tls_client_session_t* esp_tls_get_client_session(esp_tls_t* tls) {
+  esp_tls_client_session_t* session = new esp_tls_client_session_t();
+  session->id = tls->handshake;
+  return session;
+}
+
+inline void esp_tls_free_client_session(esp_tls_client_session_t* session) { delete session; }
+
+#endif // NATIVE_SHIM_ESP_TLS_H
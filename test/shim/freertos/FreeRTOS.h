@@ -0,0 +1,37 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS kernel types (single-threaded)
+ * @details Native tests run every "task" on one host thread, so critical
+ *          sections are no-ops.
+ */
+
+#ifndef NATIVE_SHIM_FREERTOS_H
+#define NATIVE_SHIM_FREERTOS_H
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+typedef struct {
+  uint32_t owner;   ///< Unused on the host
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+inline void portENTER_CRITICAL(portMUX_TYPE*) {}
+inline void portEXIT_CRITICAL(portMUX_TYPE*) {}
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE*) {}
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE*) {}
+
+#endif // NATIVE_SHIM_FREERTOS_H
@@ -0,0 +1,81 @@
+/**
+ * @file queue.h
+ * @brief Host stand-in for FreeRTOS queues
+ * @details Fixed-size item copies in a std::deque. Calls never block: a
+ *          receive on an empty queue fails at once whatever the timeout,
+ *          which is what a single-threaded test wants.
+ */
+
+#ifndef NATIVE_SHIM_FREERTOS_QUEUE_H
+#define NATIVE_SHIM_FREERTOS_QUEUE_H
+
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "FreeRTOS.h"
+
+struct QueueDefinition {
+  UBaseType_t length;                        ///< Capacity in items
+  UBaseType_t itemSize;                      ///< Bytes per item
+  std::deque<std::vector<uint8_t>> items;    ///< Queued copies, front = next out
+};
+
+typedef QueueDefinition* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  QueueHandle_t queue = new QueueDefinition();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+inline void vQueueDelete(QueueHandle_t queue) {
+  delete queue;
+}
+
+inline BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t) {
+  if (queue->items.size() >= queue->length) {
+    return pdFALSE;
+  }
+  const uint8_t* bytes = (const uint8_t*)item;
+  queue->items.push_back(std::vector<uint8_t>(bytes, bytes + queue->itemSize));
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+  return xQueueSendToBack(queue, item, ticks);
+}
+
+inline BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) {
+  if (woken != nullptr) {
+    *woken = pdFALSE;
+  }
+  return xQueueSendToBack(queue, item, 0);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t) {
+  if (queue->items.empty()) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+inline BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t) {
+  if (queue->items.empty()) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  return (UBaseType_t)queue->items.size();
+}
+
+inline UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  return queue->length - (UBaseType_t)queue->items.size();
+}
+
+#endif // NATIVE_SHIM_FREERTOS_QUEUE_H
@@ -0,0 +1,17 @@
+/**
+ * @file semphr.h
+ * @brief Host stand-in for FreeRTOS semaphores (always available)
+ */
+
+#ifndef NATIVE_SHIM_FREERTOS_SEMPHR_H
+#define NATIVE_SHIM_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { static int mutex; return &mutex; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+#endif // NATIVE_SHIM_FREERTOS_SEMPHR_H
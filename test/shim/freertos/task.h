@@ -0,0 +1,22 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for the FreeRTOS task API
+ * @details Tasks cannot be created; tests call the task bodies' steps
+ *          directly. The tick count follows esp_timer_get_time().
+ */
+
+#ifndef NATIVE_SHIM_FREERTOS_TASK_H
+#define NATIVE_SHIM_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+#include "../esp_timer.h"
+
+typedef void* TaskHandle_t;
+
+inline TickType_t xTaskGetTickCount() { return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS); }
+inline void vTaskDelay(TickType_t) {}
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline BaseType_t xPortGetCoreID() { return 0; }
+
+#endif // NATIVE_SHIM_FREERTOS_TASK_H
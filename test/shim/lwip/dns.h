@@ -0,0 +1,33 @@
+/**
+ * @file dns.h
+ * @brief Host stand-in for the lwIP resolver (every name is 10.0.0.1)
+ */
+
+#ifndef NATIVE_SHIM_LWIP_DNS_H
+#define NATIVE_SHIM_LWIP_DNS_H
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+
+typedef struct {
+  uint32_t addr;
+} ip4_addr_t;
+
+typedef struct {
+  ip4_addr_t ip4;
+} ip_addr_t;
+
+#define IP_IS_V4(address) true
+#define ip_2_ip4(address) (&(address)->ip4)
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* address, void* arg);
+
+inline err_t dns_gethostbyname(const char*, ip_addr_t* address, dns_found_callback, void*) {
+  address->ip4.addr = 0x0100000A;   // 10.0.0.1, network byte order
+  return ERR_OK;
+}
+
+#endif // NATIVE_SHIM_LWIP_DNS_H
@@ -0,0 +1,18 @@
+/**
+ * @file tcpip.h
+ * @brief Host stand-in for the lwIP task (callbacks run at once)
+ */
+
+#ifndef NATIVE_SHIM_LWIP_TCPIP_H
+#define NATIVE_SHIM_LWIP_TCPIP_H
+
+#include "dns.h"
+
+typedef void (*tcpip_callback_fn)(void* context);
+
+inline err_t tcpip_callback(tcpip_callback_fn function, void* context) {
+  function(context);
+  return ERR_OK;
+}
+
+#endif // NATIVE_SHIM_LWIP_TCPIP_H
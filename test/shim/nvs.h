@@ -0,0 +1,194 @@
+/**
+ * @file nvs.h
+ * @brief Host stand-in for ESP-IDF NVS, kept in memory
+ * @details Each namespace is a map of keys to blobs or u32 values; all
+ *          partitions share one key space. Commits are counted, not
+ *          timed: flash write latency is not modeled. shim::nvsReset()
+ *          wipes everything between tests. shim::nvsWriteBudget cuts the
+ *          power: once it runs out, sets and erases fail without effect.
+ */
+
+#ifndef NATIVE_SHIM_NVS_H
+#define NATIVE_SHIM_NVS_H
+
+#include <stddef.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "esp_system.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+  NVS_READONLY,
+  NVS_READWRITE
+} nvs_open_mode_t;
+
+namespace shim {
+
+/**
+ * @struct NvsNamespace
+ * @brief Contents of one NVS namespace
+ */
+struct NvsNamespace {
+  std::string name;                                      ///< Namespace name
+  std::map<std::string, std::vector<uint8_t>> blobs;     ///< nvs_set_blob() values
+  std::map<std::string, uint32_t> words;                 ///< nvs_set_u32() values
+};
+
+inline std::vector<NvsNamespace> nvsNamespaces;   ///< Handle n refers to entry n - 1
+inline unsigned long nvsWrites = 0;               ///< Set/erase calls since the last reset
+inline unsigned long nvsCommits = 0;              ///< nvs_commit() calls since the last reset
+inline long nvsWriteBudget = -1;                  ///< Sets/erases still allowed (-1 = unlimited)
+
+/**
+ * @brief Erase every namespace and the counters
+ */
+inline void nvsReset() {
+  for (size_t i = 0; i < nvsNamespaces.size(); i++) {
+    nvsNamespaces[i].blobs.clear();
+    nvsNamespaces[i].words.clear();
+  }
+  nvsWrites = 0;
+  nvsCommits = 0;
+  nvsWriteBudget = -1;
+}
+
+/**
+ * @brief Take one write from the budget
+ * @return false once the power is "cut"
+ */
+inline bool nvsSpendWrite() {
+  if (nvsWriteBudget == 0) {
+    return false;
+  }
+  if (nvsWriteBudget > 0) {
+    nvsWriteBudget--;
+  }
+  return true;
+}
+
+inline NvsNamespace* nvsLookup(nvs_handle_t handle) {
+  return (handle >= 1 && handle <= nvsNamespaces.size()) ? &nvsNamespaces[handle - 1] : nullptr;
+}
+
+} // namespace shim
+
+inline esp_err_t nvs_open(const char* name, nvs_open_mode_t, nvs_handle_t* handle) {
+  // Reopening a namespace returns the same contents, as on flash
+  for (size_t i = 0; i < shim::nvsNamespaces.size(); i++) {
+    if (shim::nvsNamespaces[i].name == name) {
+      *handle = (nvs_handle_t)(i + 1);
+      return ESP_OK;
+    }
+  }
+  shim::nvsNamespaces.push_back(shim::NvsNamespace());
+  shim::nvsNamespaces.back().name = name;
+  *handle = (nvs_handle_t)shim::nvsNamespaces.size();
+  return ESP_OK;
+}
+
+inline esp_err_t nvs_open_from_partition(const char*, const char* name, nvs_open_mode_t mode,
+                                         nvs_handle_t* handle) {
+  return nvs_open(name, mode, handle);
+}
+
+inline void nvs_close(nvs_handle_t) {}
+
+inline esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+  shim::NvsNamespace* ns = shim::nvsLookup(handle);
+  if (ns == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!shim::nvsSpendWrite()) {
+    return ESP_FAIL;
+  }
+  const uint8_t* bytes = (const uint8_t*)value;
+  ns->blobs[key] = std::vector<uint8_t>(bytes, bytes + length);
+  shim::nvsWrites++;
+  return ESP_OK;
+}
+
+inline esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* value, size_t* length) {
+  shim::NvsNamespace* ns = shim::nvsLookup(handle);
+  if (ns == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::map<std::string, std::vector<uint8_t>>::const_iterator it = ns->blobs.find(key);
+  if (it == ns->blobs.end()) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  if (value == nullptr) {
+    *length = it->second.size();
+    return ESP_OK;
+  }
+  if (*length < it->second.size()) {
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  }
+  memcpy(value, it->second.data(), it->second.size());
+  *length = it->second.size();
+  return ESP_OK;
+}
+
+inline esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+  shim::NvsNamespace* ns = shim::nvsLookup(handle);
+  if (ns == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!shim::nvsSpendWrite()) {
+    return ESP_FAIL;
+  }
+  ns->words[key] = value;
+  shim::nvsWrites++;
+  return ESP_OK;
+}
+
+inline esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* value) {
+  shim::NvsNamespace* ns = shim::nvsLookup(handle);
+  if (ns == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::map<std::string, uint32_t>::const_iterator it = ns->words.find(key);
+  if (it == ns->words.end()) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  *value = it->second;
+  return ESP_OK;
+}
+
+inline esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+  shim::NvsNamespace* ns = shim::nvsLookup(handle);
+  if (ns == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!shim::nvsSpendWrite()) {
+    return ESP_FAIL;
+  }
+  if (ns->blobs.erase(key) == 0 && ns->words.erase(key) == 0) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  shim::nvsWrites++;
+  return ESP_OK;
+}
+
+inline esp_err_t nvs_erase_all(nvs_handle_t handle) {
+  shim::NvsNamespace* ns = shim::nvsLookup(handle);
+  if (ns == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!shim::nvsSpendWrite()) {
+    return ESP_FAIL;
+  }
+  ns->blobs.clear();
+  ns->words.clear();
+  shim::nvsWrites++;
+  return ESP_OK;
+}
+
+inline esp_err_t nvs_commit(nvs_handle_t) {
+  shim::nvsCommits++;
+  return ESP_OK;
+}
+
+#endif // NATIVE_SHIM_NVS_H
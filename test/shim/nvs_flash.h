@@ -0,0 +1,16 @@
+/**
+ * @file nvs_flash.h
+ * @brief Host stand-in for NVS partition initialization
+ */
+
+#ifndef NATIVE_SHIM_NVS_FLASH_H
+#define NATIVE_SHIM_NVS_FLASH_H
+
+#include "nvs.h"
+
+inline esp_err_t nvs_flash_init() { return ESP_OK; }
+inline esp_err_t nvs_flash_erase() { shim::nvsReset(); return ESP_OK; }
+inline esp_err_t nvs_flash_init_partition(const char*) { return ESP_OK; }
+inline esp_err_t nvs_flash_erase_partition(const char*) { shim::nvsReset(); return ESP_OK; }
+
+#endif // NATIVE_SHIM_NVS_FLASH_H
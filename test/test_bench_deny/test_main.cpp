@@ -0,0 +1,151 @@
+/**
+ * @file test_main.cpp
+ * @brief Repeated refusals folded by the deny cache
+ * @details Replays an unknown card tapped again and again at a lane and
+ *          checks that only the first refusal of each DENY_CACHE_TTL_MS
+ *          window is published, that the repeats come back as one summary
+ *          per window, and that a whitelist change ends the window. Also
+ *          reports how many messages the storm costs with and without the
+ *          cache, and the cost of a cache hit.
+ */
+
+#include <unity.h>
+#include "Bench.h"
+#include "DenyCache/DenyCache.h"
+
+#define STORM_TAP_INTERVAL_MS 3000   // A refused driver backing up and tapping again
+#define STORM_DURATION_MS 600000     // Ten minutes of it
+
+static DenyCache cache;
+
+void setUp() {
+  cache.clear();
+}
+
+void tearDown() {}
+
+static CardUid makeCard(uint8_t n) {
+  const uint8_t bytes[4] = {0xDE, 0xAD, 0x00, n};
+  CardUid uid;
+  uid.fromBytes(bytes, sizeof(bytes));
+  return uid;
+}
+
+void test_storm_folded() {
+  CardUid card = makeCard(1);
+  uint32_t taps = 0;
+  uint32_t published = 0;
+  uint32_t summaries = 0;
+  uint32_t repeats = 0;
+  DenySummary summary;
+
+  for (uint64_t now = 0; now < STORM_DURATION_MS; now += STORM_TAP_INTERVAL_MS) {
+    while (cache.popSummary(now, 0, summary)) {
+      TEST_ASSERT_TRUE(summary.uid == card);
+      TEST_ASSERT_EQUAL(2, summary.lane);
+      summaries++;
+      repeats += summary.repeats;
+    }
+
+    // A hit is refused without asking the whitelist
+    bool cached = cache.isDenied(2, card, 0, now);
+    if (cache.recordDenial(2, card, 0, now)) {
+      TEST_ASSERT_FALSE(cached);
+      published++;
+    } else {
+      TEST_ASSERT_TRUE(cached);
+    }
+    taps++;
+  }
+  while (cache.popSummary(UINT64_MAX / 2, 0, summary)) {
+    summaries++;
+    repeats += summary.repeats;
+  }
+
+  uint32_t windows = STORM_DURATION_MS / DENY_CACHE_TTL_MS;
+  TEST_ASSERT_EQUAL(windows, published);
+  TEST_ASSERT_EQUAL(windows, summaries);
+  TEST_ASSERT_EQUAL(taps, published + repeats);
+  TEST_ASSERT_EQUAL(repeats, cache.getFoldedCount());
+
+  bench::report("deny_storm_messages/uncached", taps, "messages");
+  bench::report("deny_storm_messages/cached", published + summaries, "messages");
+}
+
+void test_lanes_independent() {
+  CardUid card = makeCard(1);
+  TEST_ASSERT_TRUE(cache.recordDenial(0, card, 0, 0));
+  TEST_ASSERT_TRUE(cache.recordDenial(1, card, 0, 10));
+  TEST_ASSERT_FALSE(cache.recordDenial(0, card, 0, 20));
+  TEST_ASSERT_FALSE(cache.isDenied(0, makeCard(2), 0, 20));
+
+  // Only the lane with a repeat has something to report
+  DenySummary summary;
+  TEST_ASSERT_TRUE(cache.popSummary(DENY_CACHE_TTL_MS + 10, 0, summary));
+  TEST_ASSERT_EQUAL(0, summary.lane);
+  TEST_ASSERT_EQUAL(1, summary.repeats);
+  TEST_ASSERT_FALSE(cache.popSummary(DENY_CACHE_TTL_MS + 10, 0, summary));
+}
+
+void test_whitelist_change_ends_window() {
+  CardUid card = makeCard(1);
+  TEST_ASSERT_TRUE(cache.recordDenial(0, card, 7, 0));
+  TEST_ASSERT_FALSE(cache.recordDenial(0, card, 7, 100));
+
+  // The card was just added: no cached refusal, and the repeat is reported
+  TEST_ASSERT_FALSE(cache.isDenied(0, card, 8, 200));
+  DenySummary summary;
+  TEST_ASSERT_TRUE(cache.popSummary(200, 8, summary));
+  TEST_ASSERT_EQUAL(1, summary.repeats);
+  TEST_ASSERT_FALSE(cache.popSummary(200, 8, summary));
+}
+
+void test_full_cache_keeps_repeats() {
+  // Every entry has repeats: a new card is published without being cached
+  for (uint8_t n = 0; n < DENY_CACHE_SIZE; n++) {
+    TEST_ASSERT_TRUE(cache.recordDenial(0, makeCard(n), 0, n));
+    TEST_ASSERT_FALSE(cache.recordDenial(0, makeCard(n), 0, n + 100));
+  }
+  CardUid extra = makeCard(DENY_CACHE_SIZE);
+  TEST_ASSERT_TRUE(cache.recordDenial(0, extra, 0, 200));
+  TEST_ASSERT_TRUE(cache.recordDenial(0, extra, 0, 300));
+  TEST_ASSERT_FALSE(cache.isDenied(0, extra, 0, 300));
+
+  // One entry without repeats: it makes room
+  cache.clear();
+  for (uint8_t n = 0; n < DENY_CACHE_SIZE; n++) {
+    TEST_ASSERT_TRUE(cache.recordDenial(0, makeCard(n), 0, n));
+    if (n != 3) {
+      TEST_ASSERT_FALSE(cache.recordDenial(0, makeCard(n), 0, n + 100));
+    }
+  }
+  TEST_ASSERT_TRUE(cache.recordDenial(0, extra, 0, 200));
+  TEST_ASSERT_TRUE(cache.isDenied(0, extra, 0, 300));
+  TEST_ASSERT_FALSE(cache.isDenied(0, makeCard(3), 0, 300));
+}
+
+void test_bench_hit() {
+  for (uint8_t n = 0; n < DENY_CACHE_SIZE; n++) {
+    cache.recordDenial(n % 2, makeCard(n), 0, 0);
+  }
+  CardUid last = makeCard(DENY_CACHE_SIZE - 1);
+  uint8_t lane = (DENY_CACHE_SIZE - 1) % 2;
+
+  uint32_t hits = 0;
+  char name[48];
+  snprintf(name, sizeof(name), "deny_hit/%d", DENY_CACHE_SIZE);
+  bench::run(name, [&](uint32_t i) {
+    hits += cache.isDenied(lane, last, 0, i % DENY_CACHE_TTL_MS);
+  });
+  bench::sink = hits;
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_storm_folded);
+  RUN_TEST(test_lanes_independent);
+  RUN_TEST(test_whitelist_change_ends_window);
+  RUN_TEST(test_full_cache_keeps_repeats);
+  RUN_TEST(test_bench_hit);
+  return UNITY_END();
+}
@@ -0,0 +1,196 @@
+/**
+ * @file test_main.cpp
+ * @brief Entry/exit event encode and decode benchmarks
+ * @details Encoding runs MQTTHandler's own publish path (document in the
+ *          fixed arena, serialization, PubSubClient::publish) against the
+ *          PubSubClient shim. Decoding parses the produced events the way
+ *          the gate task parses commands: into an arena-backed document.
+ *          The wire format follows MQTT_EVENT_ENCODING. Command lookup
+ *          compares CommandRegistry with the strcmp chain it replaced.
+ */
+
+#include <unity.h>
+#include <string>
+#include "Bench.h"
+#include "MQTTHandler/MQTTHandler.h"
+#include "CommandRegistry/CommandRegistry.h"
+
+#define BENCH_TIMESTAMP 1760000000UL   // Wall-clock seconds stamped on events
+
+static MQTTHandler mqtt;   // Static: holds two JSON arenas and the TX buffer
+alignas(8) static uint8_t decodeBuffer[JSON_RX_ARENA_SIZE];
+static JsonArena decodeArena(decodeBuffer, sizeof(decodeBuffer));
+static std::string entryPayload;   // One encoded entry event
+static std::string exitPayload;    // One encoded exit event
+static unsigned long commandsSeen = 0;
+
+static void onCommand(const char*, JsonDocument&) {
+  commandsSeen++;
+}
+
+static DeserializationError decode(JsonDocument& doc, const std::string& payload) {
+#if MQTT_EVENT_ENCODING == EVENT_ENCODING_MSGPACK
+  return deserializeMsgPack(doc, payload.data(), payload.size());
+#else
+  return deserializeJson(doc, payload.data(), payload.size());
+#endif
+}
+
+static const char* onTableCommand(JsonDocument&) {
+  return "ok";
+}
+
+// Same names and order as the firmware's commandTable
+static const CommandSpec commandTable[] = {
+  {"open_barrier",       onTableCommand, 0},
+  {"emergency",          onTableCommand, 0},
+  {"update_whitelist",   onTableCommand, 0},
+  {"sync_whitelist",     onTableCommand, 0},
+  {"whitelist_delta",    onTableCommand, 0},
+  {"whitelist_snapshot", onTableCommand, 0},
+  {"whitelist_version",  onTableCommand, 0},
+  {"get_status",         onTableCommand, COMMAND_KEEPS_BENCHMARK},
+  {"get_metrics",        onTableCommand, COMMAND_KEEPS_BENCHMARK},
+  {"scan_mode",          onTableCommand, 0},
+  {"reset_slots",        onTableCommand, 0},
+  {"benchmark",          onTableCommand, COMMAND_KEEPS_BENCHMARK},
+};
+static const uint8_t commandCount = sizeof(commandTable) / sizeof(commandTable[0]);
+
+void setUp() {
+  shim::mqttClient->setKeepMessages(true);
+}
+
+void tearDown() {}
+
+void test_events_round_trip() {
+  CardUid card = bench::makeCard(7);
+  TEST_ASSERT_TRUE(mqtt.publishEntry(card, 3, "success", 6, BENCH_TIMESTAMP, 0x1234, 1));
+  entryPayload = shim::mqttClient->getLastPayload();
+  TEST_ASSERT_TRUE(mqtt.publishExit(card, 3, "success", 5400, 7, BENCH_TIMESTAMP, 0x1234, 2));
+  exitPayload = shim::mqttClient->getLastPayload();
+
+  decodeArena.reset();
+  JsonDocument doc(&decodeArena);
+  TEST_ASSERT_TRUE(decode(doc, exitPayload) == DeserializationError::Ok);
+#if MQTT_EVENT_ENCODING == EVENT_ENCODING_MSGPACK
+  TEST_ASSERT_EQUAL(3, doc["s"].as<int>());
+  TEST_ASSERT_EQUAL(5400, doc["d"].as<long>());
+#else
+  TEST_ASSERT_EQUAL(3, doc["slot_id"].as<int>());
+  TEST_ASSERT_EQUAL(5400, doc["duration"].as<long>());
+#endif
+}
+
+void test_bench_encode() {
+  shim::mqttClient->setKeepMessages(false);
+  CardUid card = bench::makeCard(7);
+  unsigned long published = 0;
+
+  bench::run("event_encode_entry", [&](uint32_t i) {
+    published += mqtt.publishEntry(card, 3, "success", 6, BENCH_TIMESTAMP, 0x1234, i + 1);
+  });
+  bench::run("event_encode_exit", [&](uint32_t i) {
+    published += mqtt.publishExit(card, 3, "success", 5400, 7, BENCH_TIMESTAMP, 0x1234, i + 1);
+  });
+
+  // A full coalescing window drained from the outbox
+  OutboxRecord records[EVENT_BATCH_MAX];
+  memset(records, 0, sizeof(records));
+  for (int i = 0; i < EVENT_BATCH_MAX; i++) {
+    records[i].bootId = 0x1234;
+    records[i].sequence = i + 1;
+    records[i].type = (i & 1) ? PUBLISH_EXIT : PUBLISH_ENTRY;
+    records[i].cardUID = bench::makeCard(i);
+    strncpy(records[i].status, "success", sizeof(records[i].status) - 1);
+    records[i].slotNumber = i + 1;
+    records[i].availableSlots = TOTAL_SLOTS - i;
+    records[i].duration = (i & 1) ? 3600 : 0;
+    records[i].timestamp = BENCH_TIMESTAMP + i;
+  }
+  char name[48];
+  snprintf(name, sizeof(name), "event_batch_encode/%d", EVENT_BATCH_MAX);
+  size_t sent = 0;
+  bench::run(name, [&](uint32_t) {
+    sent = mqtt.publishEventBatch(records, EVENT_BATCH_MAX);
+  });
+  TEST_ASSERT_GREATER_THAN(1, sent);
+  bench::sink = published;
+}
+
+void test_bench_decode() {
+  uint32_t fields = 0;
+  bench::run("event_decode_entry", [&](uint32_t) {
+    decodeArena.reset();
+    JsonDocument doc(&decodeArena);
+    decode(doc, entryPayload);
+    fields += doc.size();
+  });
+  bench::run("event_decode_exit", [&](uint32_t) {
+    decodeArena.reset();
+    JsonDocument doc(&decodeArena);
+    decode(doc, exitPayload);
+    fields += doc.size();
+  });
+  TEST_ASSERT_GREATER_THAN(0, fields);
+
+  // Command path: PubSubClient callback -> parse -> command callback
+  static const char command[] = "{\"command\":\"get_status\"}";
+  commandsSeen = 0;
+  bench::run("command_decode", [&](uint32_t) {
+    shim::mqttClient->deliver(MQTT_TOPIC_COMMANDS, command, sizeof(command) - 1);
+  });
+  TEST_ASSERT_GREATER_THAN(0, commandsSeen);
+  bench::sink = fields;
+}
+
+void test_command_lookup() {
+  CommandRegistry registry;
+  TEST_ASSERT_TRUE(registry.begin(commandTable, commandCount));
+  TEST_ASSERT_EQUAL(commandCount, registry.getCount());
+  for (uint8_t i = 0; i < commandCount; i++) {
+    TEST_ASSERT_TRUE(registry.find(commandTable[i].name) == &commandTable[i]);
+  }
+  TEST_ASSERT_TRUE(registry.find("get_statu") == nullptr);
+  TEST_ASSERT_TRUE(registry.find("") == nullptr);
+
+  static const CommandSpec twice[] = {
+    {"get_status", onTableCommand, 0},
+    {"get_status", onTableCommand, 0},
+  };
+  CommandRegistry duplicate;
+  TEST_ASSERT_FALSE(duplicate.begin(twice, 2));
+  TEST_ASSERT_EQUAL(1, duplicate.getCount());
+
+  // Every known command in turn, then one unknown
+  uint32_t found = 0;
+  bench::run("command_lookup", [&](uint32_t i) {
+    uint32_t row = i % (commandCount + 1);
+    const char* name = (row < commandCount) ? commandTable[row].name : "not_a_command";
+    found += (registry.find(name) != nullptr);
+  });
+  bench::run("command_lookup_strcmp", [&](uint32_t i) {
+    uint32_t row = i % (commandCount + 1);
+    const char* name = (row < commandCount) ? commandTable[row].name : "not_a_command";
+    for (uint8_t c = 0; c < commandCount; c++) {
+      if (strcmp(name, commandTable[c].name) == 0) {
+        found++;
+        break;
+      }
+    }
+  });
+  TEST_ASSERT_GREATER_THAN(0, found);
+  bench::sink = found;
+}
+
+int main(int argc, char** argv) {
+  mqtt.setCommandCallback(onCommand);
+  mqtt.begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_events_round_trip);
+  RUN_TEST(test_bench_encode);
+  RUN_TEST(test_bench_decode);
+  RUN_TEST(test_command_lookup);
+  return UNITY_END();
+}
@@ -0,0 +1,144 @@
+/**
+ * @file test_main.cpp
+ * @brief Reader poll scheduling from 1 to MAX_LANES lanes
+ * @details Checks the bound the gate task relies on: with a budget of
+ *          RFID_POLLS_PER_ITERATION polls, a lane waiting for a card is
+ *          polled at least every ceil(lanes / budget) iterations, however
+ *          the other lanes come and go, and idle lanes get no polls. Also
+ *          reports the scheduling cost per gate-task iteration.
+ */
+
+#include <unity.h>
+#include "Bench.h"
+#include "ReaderScheduler/ReaderScheduler.h"
+
+#define LANE_SIM_ITERATIONS 20000   // Gate-task iterations per lane count
+#define LANE_TOGGLE_PERCENT 5       // Chance per lane and iteration of a car arriving/leaving
+
+static ReaderScheduler scheduler;
+
+void setUp() {}
+
+void tearDown() {}
+
+/**
+ * @brief Run the scheduler with lanes changing state at random
+ * @param worstGap Output, longest gap between polls of a lane while it was waiting
+ */
+static void simulateLanes(uint8_t lanes, uint8_t budget, bool allWaiting,
+                          uint32_t& worstGap) {
+  bench::Random random(lanes);
+  bool waiting[MAX_LANES] = {};
+  uint32_t sincePoll[MAX_LANES] = {};
+  worstGap = 0;
+
+  scheduler.begin(lanes);
+  for (uint8_t lane = 0; lane < lanes; lane++) {
+    waiting[lane] = allWaiting;
+    scheduler.setWaiting(lane, allWaiting);
+  }
+
+  for (uint32_t i = 0; i < LANE_SIM_ITERATIONS; i++) {
+    if (!allWaiting) {
+      for (uint8_t lane = 0; lane < lanes; lane++) {
+        if (random.below(100) < LANE_TOGGLE_PERCENT) {
+          waiting[lane] = !waiting[lane];
+          sincePoll[lane] = 0;
+          scheduler.setWaiting(lane, waiting[lane]);
+        }
+      }
+    }
+
+    uint8_t polled[MAX_LANES];
+    uint8_t count = scheduler.schedule(polled, budget, false);
+    TEST_ASSERT_LESS_OR_EQUAL(budget, count);
+
+    bool hit[MAX_LANES] = {};
+    for (uint8_t p = 0; p < count; p++) {
+      TEST_ASSERT_TRUE(waiting[polled[p]]);
+      TEST_ASSERT_FALSE(hit[polled[p]]);
+      hit[polled[p]] = true;
+    }
+
+    for (uint8_t lane = 0; lane < lanes; lane++) {
+      if (!waiting[lane]) {
+        continue;
+      }
+      sincePoll[lane]++;
+      if (hit[lane]) {
+        worstGap = std::max(worstGap, sincePoll[lane]);
+        sincePoll[lane] = 0;
+      }
+    }
+  }
+
+  // Lanes still waiting at the end count as if polled next
+  for (uint8_t lane = 0; lane < lanes; lane++) {
+    if (waiting[lane]) {
+      worstGap = std::max(worstGap, sincePoll[lane] + 1);
+    }
+  }
+}
+
+void test_poll_gap_bounded() {
+  char name[48];
+  for (uint8_t lanes = 1; lanes <= MAX_LANES; lanes++) {
+    uint32_t bound = ReaderScheduler::pollInterval(lanes, RFID_POLLS_PER_ITERATION);
+
+    // Every lane busy: the worst case, which the bound must be tight for
+    uint32_t fullGap;
+    simulateLanes(lanes, RFID_POLLS_PER_ITERATION, true, fullGap);
+    TEST_ASSERT_EQUAL(bound, fullGap);
+    TEST_ASSERT_EQUAL(bound, scheduler.getMaxPollGap());
+
+    uint32_t mixedGap;
+    simulateLanes(lanes, RFID_POLLS_PER_ITERATION, false, mixedGap);
+    TEST_ASSERT_LESS_OR_EQUAL(bound, mixedGap);
+    TEST_ASSERT_LESS_OR_EQUAL(bound, scheduler.getMaxPollGap());
+
+    snprintf(name, sizeof(name), "lane_poll_gap_worst/%u", (unsigned)lanes);
+    bench::report(name, fullGap, "iterations");
+  }
+}
+
+void test_idle_lanes_share_leftover() {
+  scheduler.begin(MAX_LANES);
+  scheduler.setWaiting(3, true);
+
+  // One waiting lane first, the rest of the budget round-robin over idle ones
+  bool seen[MAX_LANES] = {};
+  for (int i = 0; i < MAX_LANES; i++) {
+    uint8_t polled[MAX_LANES];
+    uint8_t count = scheduler.schedule(polled, 2, true);
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(3, polled[0]);
+    seen[polled[1]] = true;
+  }
+  for (uint8_t lane = 0; lane < MAX_LANES; lane++) {
+    TEST_ASSERT_EQUAL(lane != 3, seen[lane]);
+  }
+}
+
+void test_bench_schedule() {
+  scheduler.begin(MAX_LANES);
+  for (uint8_t lane = 0; lane < MAX_LANES; lane += 2) {
+    scheduler.setWaiting(lane, true);
+  }
+
+  uint32_t total = 0;
+  char name[48];
+  snprintf(name, sizeof(name), "lane_schedule/%d", MAX_LANES);
+  bench::run(name, [&](uint32_t) {
+    uint8_t polled[MAX_LANES];
+    total += scheduler.schedule(polled, RFID_POLLS_PER_ITERATION, false);
+  });
+  bench::sink = total;
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_poll_gap_bounded);
+  RUN_TEST(test_idle_lanes_share_leftover);
+  RUN_TEST(test_bench_schedule);
+  return UNITY_END();
+}
@@ -0,0 +1,158 @@
+/**
+ * @file test_main.cpp
+ * @brief Slot allocation benchmarks at 10 and 1000 bays
+ * @details The garage is kept 90% full, so allocation has to skip occupied
+ *          bays. allocate/release includes the NVS record writes, which
+ *          here go to the in-memory NVS shim rather than flash. The last
+ *          tests park a car before the first NTP sync and reboot, and
+ *          check that resyncs slew timestamps instead of stepping them.
+ */
+
+#include <unity.h>
+#include "Bench.h"
+#include "SlotManager/SlotManager.h"
+
+#define RESIDENT_PERCENT 90   // Occupancy kept during the benchmarks
+#define SYNC_WALL_CLOCK 1760000000L   // Server time of the simulated NTP sync
+
+static TimeSync timeSync;
+static SlotManagerT<10> smallGarage(timeSync);
+static SlotManagerT<1000> largeGarage(timeSync);
+
+void setUp() {}
+
+void tearDown() {}
+
+template <int N>
+static int fillGarage(SlotManagerT<N>& slots) {
+  // Both garages use the same NVS namespace; start each from empty
+  shim::nvsReset();
+  slots.begin();
+
+  int resident = N * RESIDENT_PERCENT / 100;
+  for (int i = 0; i < resident; i++) {
+    slots.allocateSlot(bench::makeCard(i));
+  }
+  return resident;
+}
+
+template <int N>
+static void benchGarage(SlotManagerT<N>& slots) {
+  int resident = fillGarage(slots);
+  TEST_ASSERT_EQUAL(N - resident, slots.getAvailableSlots());
+
+  char name[48];
+  uint32_t total = 0;
+
+  // One car in, one car out
+  snprintf(name, sizeof(name), "slot_allocate_release/%d", N);
+  bench::run(name, [&](uint32_t i) {
+    int slot = slots.allocateSlot(bench::makeCard(N + (i & 1)));
+    total += slot;
+    slots.releaseSlot(slot);
+  });
+  TEST_ASSERT_EQUAL(N - resident, slots.getAvailableSlots());
+
+  // Exit gate: which slot does this card hold?
+  snprintf(name, sizeof(name), "slot_find_by_card/%d", N);
+  bench::run(name, [&](uint32_t i) {
+    total += slots.findSlotByCard(bench::makeCard(i % resident));
+  });
+
+  // Entrance when full: the allocation that has to fail
+  for (int i = resident; i < N; i++) {
+    slots.allocateSlot(bench::makeCard(i));
+  }
+  TEST_ASSERT_EQUAL(0, slots.getAvailableSlots());
+  snprintf(name, sizeof(name), "slot_allocate_full/%d", N);
+  bench::run(name, [&](uint32_t) {
+    total += slots.allocateSlot(bench::makeCard(N));
+  });
+
+  bench::sink = total;
+}
+
+void test_bench_slots_10() {
+  benchGarage(smallGarage);
+}
+
+void test_bench_slots_1000() {
+  benchGarage(largeGarage);
+}
+
+// Entry time in the stored record of a slot (0 = unknown or no record)
+static uint32_t storedEntryTime(int slotNumber) {
+  char key[16];
+  snprintf(key, sizeof(key), "r%d", slotNumber - 1);
+  for (size_t i = 0; i < shim::nvsNamespaces.size(); i++) {
+    if (shim::nvsNamespaces[i].name == SLOT_NVS_NAMESPACE &&
+        shim::nvsNamespaces[i].blobs.count(key)) {
+      SlotRecord record;
+      memcpy(&record, shim::nvsNamespaces[i].blobs[key].data(), sizeof(record));
+      return record.entryTime;
+    }
+  }
+  return 0;
+}
+
+void test_entry_before_sync() {
+  // FAST_BOOT: the gates run before NTP answers
+  shim::nvsReset();
+  static SlotManagerT<10> garage(timeSync);
+  garage.begin();
+  int slot = garage.allocateSlot(bench::makeCard(1));
+  garage.update();
+  TEST_ASSERT_EQUAL(0, storedEntryTime(slot));
+
+  timeSync.begin();
+  struct timeval tv = {SYNC_WALL_CLOCK, 0};
+  shim::sntpCallback(&tv);
+  garage.update();
+  uint32_t entryTime = storedEntryTime(slot);
+  TEST_ASSERT_GREATER_THAN(SYNC_WALL_CLOCK - 60, entryTime);
+  TEST_ASSERT_LESS_OR_EQUAL(SYNC_WALL_CLOCK, entryTime);
+
+  // After a reboot the car is still parked with a known entry time
+  static SlotManagerT<10> rebooted(timeSync);
+  rebooted.begin();
+  TEST_ASSERT_TRUE(rebooted.isSlotOccupied(slot));
+  TEST_ASSERT_EQUAL(entryTime, storedEntryTime(slot));
+}
+
+// Deliver a server time of wall + ms
+static void deliverSync(long wall, long ms) {
+  struct timeval tv = {wall + ms / 1000, (ms % 1000) * 1000};
+  shim::sntpCallback(&tv);
+}
+
+void test_resync_slews() {
+  // A clock of its own, synced once on a virtual timeline
+  shim::useVirtualClock(1000000);
+  static TimeSync clock;
+  clock.begin();
+  deliverSync(SYNC_WALL_CLOCK, 0);
+
+  // One second later the server is 900 ms ahead: timestamps do not jump
+  shim::advanceTime(1000000);
+  deliverSync(SYNC_WALL_CLOCK, 1900);
+  shim::advanceTime(200000);
+  TEST_ASSERT_EQUAL(SYNC_WALL_CLOCK + 1, clock.getTimestamp());
+
+  // ... but catch up at NTP_SLEW_MAX_PPM (900 ms in 1800 s)
+  shim::advanceTime(1800000000LL);
+  TEST_ASSERT_EQUAL(SYNC_WALL_CLOCK + 1802, clock.getTimestamp());
+
+  // Corrections above NTP_STEP_THRESHOLD_MS are stepped
+  deliverSync(SYNC_WALL_CLOCK, 1802200 + 3000);
+  TEST_ASSERT_EQUAL(SYNC_WALL_CLOCK + 1805, clock.getTimestamp());
+  shim::useHostClock();
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_slots_10);
+  RUN_TEST(test_bench_slots_1000);
+  RUN_TEST(test_entry_before_sync);
+  RUN_TEST(test_resync_slews);
+  return UNITY_END();
+}
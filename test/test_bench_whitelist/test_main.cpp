@@ -0,0 +1,284 @@
+/**
+ * @file test_main.cpp
+ * @brief Whitelist lookup benchmarks
+ * @details Fills RFIDManager to MAX_RFID_CARDS and times isAuthorized() for
+ *          cards on and off the list, and reports the RAM the list takes
+ *          (owner names stay in flash). [env:native] builds the firmware's
+ *          50-card whitelist; [env:native_whitelist_1k] and
+ *          [env:native_whitelist_10k] rebuild it with 1000 and 10000.
+ *          The last tests cut the power in the middle of a flush, check
+ *          what the next boot loads, sweep out the cards a snapshot did
+ *          not mention, and import an EEPROM image written by earlier
+ *          firmware.
+ */
+
+#include <unity.h>
+#include "Bench.h"
+#include "RFIDManager/RFIDManager.h"
+
+#define LOOKUP_SET_SIZE 1024   // Precomputed lookup keys (power of two)
+
+static RFIDManager rfid;                  // Static: 10k cards do not fit a stack
+static CardUid hits[LOOKUP_SET_SIZE];     // Cards on the whitelist, random order
+static CardUid misses[LOOKUP_SET_SIZE];   // Cards never added
+
+void setUp() {}
+
+void tearDown() {}
+
+static void fillWhitelist() {
+  shim::nvsReset();
+  rfid.begin();
+  rfid.clearAllCards();
+
+  // One commit for the whole list, every card with a name of its own, as
+  // the legacy sync_whitelist command does. Far more distinct names than
+  // WHITELIST_PENDING_NAMES, so most go through staging records.
+  rfid.beginTransaction();
+  for (int i = 0; i < MAX_RFID_CARDS; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "Bench %d", i);
+    rfid.addCard(bench::makeCard(i), name, ACCESS_REGULAR);
+  }
+  rfid.commitTransaction();
+
+  bench::Random random(42);
+  for (int i = 0; i < LOOKUP_SET_SIZE; i++) {
+    hits[i] = bench::makeCard(random.below(MAX_RFID_CARDS));
+    misses[i] = bench::makeCard(MAX_RFID_CARDS + random.next() % 1000000);
+  }
+}
+
+// Whether the whitelist namespace holds record key "r<index>"
+static bool hasRecord(int index) {
+  char key[16];
+  snprintf(key, sizeof(key), "r%d", index);
+  for (size_t i = 0; i < shim::nvsNamespaces.size(); i++) {
+    if (shim::nvsNamespaces[i].name == WHITELIST_NVS_NAMESPACE) {
+      return shim::nvsNamespaces[i].blobs.count(key) != 0;
+    }
+  }
+  return false;
+}
+
+void test_whitelist_filled() {
+  TEST_ASSERT_EQUAL(MAX_RFID_CARDS, rfid.getCardCount());
+  TEST_ASSERT_TRUE(rfid.isAuthorized(bench::makeCard(0)));
+  TEST_ASSERT_TRUE(rfid.isAuthorized(bench::makeCard(MAX_RFID_CARDS - 1)));
+  TEST_ASSERT_FALSE(rfid.isAuthorized(bench::makeCard(MAX_RFID_CARDS)));
+
+  // The commit released every staging record
+  TEST_ASSERT_TRUE(hasRecord(MAX_RFID_CARDS - 1));
+  TEST_ASSERT_FALSE(hasRecord(MAX_RFID_CARDS));
+}
+
+void test_names_from_flash() {
+  RFIDCard card;
+  char expected[16];
+  for (int i = 0; i < MAX_RFID_CARDS; i += 1 + MAX_RFID_CARDS / 16) {
+    snprintf(expected, sizeof(expected), "Bench %d", i);
+    TEST_ASSERT_TRUE(rfid.getCardInfo(bench::makeCard(i), card));
+    TEST_ASSERT_EQUAL_STRING(expected, card.ownerName);
+  }
+
+  // Inside a transaction names wait in RAM, then in staging records:
+  // twice as many distinct names as pending slots, read back before the
+  // commit, and gone again after an abort
+  const int renamed = 2 * WHITELIST_PENDING_NAMES;
+  rfid.beginTransaction();
+  for (int i = 0; i < renamed; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "Pending %d", i);
+    TEST_ASSERT_TRUE(rfid.updateCard(bench::makeCard(i % MAX_RFID_CARDS), name));
+  }
+  snprintf(expected, sizeof(expected), "Pending %d", (renamed - 1) % MAX_RFID_CARDS);
+  TEST_ASSERT_TRUE(rfid.getCardInfo(bench::makeCard((renamed - 1) % MAX_RFID_CARDS), card));
+  TEST_ASSERT_EQUAL_STRING(expected, card.ownerName);
+  TEST_ASSERT_TRUE(hasRecord(MAX_RFID_CARDS));
+  rfid.abortTransaction();
+  TEST_ASSERT_FALSE(hasRecord(MAX_RFID_CARDS));
+
+  TEST_ASSERT_TRUE(rfid.getCardInfo(bench::makeCard(1), card));
+  TEST_ASSERT_EQUAL_STRING("Bench 1", card.ownerName);
+
+  char name[48];
+  snprintf(name, sizeof(name), "whitelist_ram/%d", MAX_RFID_CARDS);
+  bench::report(name, sizeof(RFIDManager) + PoolMemory::getInternalBytes() +
+                PoolMemory::getPsramBytes(), "bytes");
+}
+
+void test_bench_lookup_hit() {
+  char name[48];
+  snprintf(name, sizeof(name), "whitelist_lookup_hit/%d", MAX_RFID_CARDS);
+  uint32_t found = 0;
+  bench::run(name, [&](uint32_t i) {
+    int level;
+    found += rfid.isAuthorized(hits[i & (LOOKUP_SET_SIZE - 1)], level);
+  });
+  bench::sink = found;
+  TEST_ASSERT_GREATER_THAN(0, found);
+}
+
+void test_bench_lookup_miss() {
+  char name[48];
+  snprintf(name, sizeof(name), "whitelist_lookup_miss/%d", MAX_RFID_CARDS);
+  uint32_t found = 0;
+  bench::run(name, [&](uint32_t i) {
+    int level;
+    found += rfid.isAuthorized(misses[i & (LOOKUP_SET_SIZE - 1)], level);
+  });
+  TEST_ASSERT_EQUAL(0, found);
+}
+
+void test_bench_card_info() {
+  // Copies the whole record, unlike isAuthorized()
+  char name[48];
+  snprintf(name, sizeof(name), "whitelist_card_info/%d", MAX_RFID_CARDS);
+  uint32_t levels = 0;
+  bench::run(name, [&](uint32_t i) {
+    RFIDCard card;
+    if (rfid.getCardInfo(hits[i & (LOOKUP_SET_SIZE - 1)], card)) {
+      levels += card.accessLevel + 1;
+    }
+  });
+  bench::sink = levels;
+  TEST_ASSERT_GREATER_THAN(0, levels);
+}
+
+#define SHRINK_CARDS 6   // Small list for the power-cut tests
+
+// A stored list of SHRINK_CARDS cards, committed
+static void storeSmallList() {
+  shim::nvsReset();
+  rfid.clearAllCards();
+  rfid.beginTransaction();
+  for (int i = 0; i < SHRINK_CARDS; i++) {
+    rfid.addCard(bench::makeCard(i), "Shrink", ACCESS_REGULAR);
+  }
+  rfid.commitTransaction();
+}
+
+void test_interrupted_shrink() {
+  // Removing cards 0 and 2 moves cards 5 and 4 into their records. Cut the
+  // power after every possible number of writes: the next boot must load
+  // a list that still holds every card that was kept.
+  for (int cut = 0; cut <= 8; cut++) {
+    storeSmallList();
+    shim::nvsWriteBudget = cut;
+    rfid.beginTransaction();
+    rfid.removeCard(bench::makeCard(0));
+    rfid.removeCard(bench::makeCard(2));
+    rfid.commitTransaction();
+    shim::nvsWriteBudget = -1;
+
+    TEST_ASSERT_TRUE(rfid.loadFromStorage());
+    TEST_ASSERT_GREATER_OR_EQUAL(SHRINK_CARDS - 2, rfid.getCardCount());
+    for (int i = 1; i < SHRINK_CARDS; i++) {
+      if (i != 2) {
+        TEST_ASSERT_TRUE(rfid.isAuthorized(bench::makeCard(i)));
+      }
+    }
+  }
+
+  // Uninterrupted, the list ends up exactly as edited
+  storeSmallList();
+  TEST_ASSERT_TRUE(rfid.removeCard(bench::makeCard(0)));
+  TEST_ASSERT_TRUE(rfid.removeCard(bench::makeCard(2)));
+  TEST_ASSERT_TRUE(rfid.loadFromStorage());
+  TEST_ASSERT_EQUAL(SHRINK_CARDS - 2, rfid.getCardCount());
+  TEST_ASSERT_FALSE(rfid.isAuthorized(bench::makeCard(0)));
+  TEST_ASSERT_FALSE(rfid.isAuthorized(bench::makeCard(2)));
+}
+
+void test_gap_keeps_prefix() {
+  storeSmallList();
+  for (size_t i = 0; i < shim::nvsNamespaces.size(); i++) {
+    if (shim::nvsNamespaces[i].words.count("count")) {
+      shim::nvsNamespaces[i].blobs.erase("r3");
+    }
+  }
+
+  // Cards before the gap survive instead of the list falling back to defaults
+  TEST_ASSERT_TRUE(rfid.loadFromStorage());
+  TEST_ASSERT_EQUAL(3, rfid.getCardCount());
+  TEST_ASSERT_TRUE(rfid.isAuthorized(bench::makeCard(2)));
+
+  // The next save drops the stale records behind the gap
+  TEST_ASSERT_TRUE(rfid.addCard(bench::makeCard(SHRINK_CARDS), "Shrink", ACCESS_REGULAR));
+  TEST_ASSERT_TRUE(rfid.loadFromStorage());
+  TEST_ASSERT_EQUAL(4, rfid.getCardCount());
+  TEST_ASSERT_FALSE(rfid.isAuthorized(bench::makeCard(4)));
+}
+
+void test_sweep_unmarked() {
+  // A snapshot naming cards 1, 3 and 4 (and one not on the list)
+  storeSmallList();
+  rfid.clearMarks();
+  TEST_ASSERT_TRUE(rfid.markCard(bench::makeCard(1)));
+  TEST_ASSERT_TRUE(rfid.markCard(bench::makeCard(3)));
+  TEST_ASSERT_TRUE(rfid.markCard(bench::makeCard(4)));
+  TEST_ASSERT_FALSE(rfid.markCard(bench::makeCard(SHRINK_CARDS)));
+  TEST_ASSERT_EQUAL(SHRINK_CARDS - 3, rfid.removeUnmarked());
+
+  // Kept cards are still found after the moves, and the stored list matches
+  TEST_ASSERT_TRUE(rfid.loadFromStorage());
+  TEST_ASSERT_EQUAL(3, rfid.getCardCount());
+  for (int i = 0; i < SHRINK_CARDS; i++) {
+    TEST_ASSERT_EQUAL(i == 1 || i == 3 || i == 4, rfid.isAuthorized(bench::makeCard(i)));
+  }
+}
+
+void test_migrate_eeprom() {
+  // Image of the firmware before NVS storage: hex string UIDs
+  EEPROMData image;
+  memset(&image, 0, sizeof(image));
+  image.magic = EEPROM_MAGIC;
+  image.numCards = 3;
+  strcpy(image.cards[0].uid, "0A1B2C3D");
+  image.cards[0].isActive = true;
+  image.cards[0].accessLevel = ACCESS_ADMIN;
+  strcpy(image.cards[0].ownerName, "Legacy Admin");
+  strcpy(image.cards[1].uid, "not hex");
+  strcpy(image.cards[2].uid, "04A3B2C1D0E1F2");
+  image.cards[2].isActive = false;
+  strcpy(image.cards[2].ownerName, "Legacy Seven");
+  EEPROM.put(0, image);
+
+  // First boot on NVS storage
+  shim::nvsReset();
+  rfid.begin();
+  shim::eepromReset();
+
+  TEST_ASSERT_EQUAL(2, rfid.getCardCount());
+  CardUid uid;
+  TEST_ASSERT_TRUE(uid.fromHex("0A1B2C3D"));
+  int level = -1;
+  TEST_ASSERT_TRUE(rfid.isAuthorized(uid, level));
+  TEST_ASSERT_EQUAL(ACCESS_ADMIN, level);
+
+  RFIDCard card;
+  TEST_ASSERT_TRUE(uid.fromHex("04A3B2C1D0E1F2"));
+  TEST_ASSERT_FALSE(rfid.isAuthorized(uid));
+  TEST_ASSERT_TRUE(rfid.getCardInfo(uid, card));
+  TEST_ASSERT_EQUAL_STRING("Legacy Seven", card.ownerName);
+
+  // Stored in NVS: the next boot loads it without the image
+  TEST_ASSERT_TRUE(rfid.loadFromStorage());
+  TEST_ASSERT_EQUAL(2, rfid.getCardCount());
+}
+
+int main(int argc, char** argv) {
+  fillWhitelist();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_whitelist_filled);
+  RUN_TEST(test_names_from_flash);
+  RUN_TEST(test_bench_lookup_hit);
+  RUN_TEST(test_bench_lookup_miss);
+  RUN_TEST(test_bench_card_info);
+  RUN_TEST(test_interrupted_shrink);
+  RUN_TEST(test_gap_keeps_prefix);
+  RUN_TEST(test_sweep_unmarked);
+  RUN_TEST(test_migrate_eeprom);
+  return UNITY_END();
+}
@@ -0,0 +1,422 @@
+/**
+ * @file test_main.cpp
+ * @brief Rush-hour traffic simulation driving both gates
+ * @details Replays SIM_DURATION_MIN minutes of traffic on the virtual clock
+ *          through the real GateController, RFIDManager and SlotManager,
+ *          wired the way the gate task wires them in main.ino. Cars arrive
+ *          at the entrance at a rate that ramps up to a peak and back down,
+ *          pull up to the barrier, hold their card to the reader, drive
+ *          through and park for a random time before queueing at the exit.
+ *          Some arrive with cards that are not on the whitelist; when the
+ *          garage is full, cars are turned away.
+ *
+ *          The run checks that every car at a reader got an answer, that
+ *          both gates end idle, and that the free slot count matches the
+ *          cars inside. It reports host CPU time per gate-task iteration
+ *          and the virtual wait from arrival to an open barrier.
+ */
+
+#include <unity.h>
+#include <deque>
+#include <vector>
+#include "Bench.h"
+#include "GateController/GateController.h"
+#include "RFIDManager/RFIDManager.h"
+#include "ReaderScheduler/ReaderScheduler.h"
+#include "SlotManager/SlotManager.h"
+
+#define SIM_DURATION_MIN 180          // Simulated traffic (minutes)
+#define SIM_DRAIN_MIN 30              // Exits only, after the arrivals stop (minutes)
+#define SIM_SETTLE_MAX_MIN 10         // Limit for the lanes to empty after that (minutes)
+#define SIM_PEAK_ARRIVALS_PER_HOUR 90 // Entrance arrival rate at the peak
+#define SIM_BASE_ARRIVALS_PER_HOUR 20 // Arrival rate at the start and end
+#define SIM_MEAN_STAY_MIN 40          // Mean parking time (minutes, exponential)
+#define SIM_UNKNOWN_CARD_PERCENT 5    // Arrivals whose card is not on the whitelist
+#define SIM_PULL_UP_MS 1500           // Barrier down to the next car at the sensor
+#define SIM_CARD_DELAY_MS 2000        // Car at the sensor to card at the reader
+#define SIM_DRIVE_THROUGH_MS 3000     // Barrier up to the car clearing the sensor
+#define SIM_BACK_OUT_MS 4000          // Refused car clearing the sensor
+
+#define SIM_UNKNOWN_CARD_BASE 1000000 // Card numbers from here on are never added
+
+/**
+ * @struct SimCar
+ * @brief One car's trip through the garage
+ */
+struct SimCar {
+  uint32_t card;          ///< bench::makeCard() number
+  uint64_t arrivedAt;     ///< Virtual ms the car joined the lane queue
+  uint64_t leaveAt;       ///< Virtual ms it wants to leave (parked cars)
+  int slot;               ///< Assigned slot (parked cars)
+};
+
+enum SimPhase {
+  PHASE_EMPTY,            ///< No car at the barrier
+  PHASE_PULLING_UP,       ///< Next car rolling up to the sensor
+  PHASE_AT_SENSOR,        ///< Sensor covered, card not shown yet
+  PHASE_AT_READER,        ///< Card shown, waiting for the barrier
+  PHASE_DRIVING_THROUGH,  ///< Barrier up, car passing
+  PHASE_BACKING_OUT,      ///< Refused, waiting for the hold to end before reversing
+  PHASE_CLEARING          ///< Reversing off the sensor
+};
+
+/**
+ * @struct SimLane
+ * @brief Cars queued at one gate and the one at its barrier
+ */
+struct SimLane {
+  GateController* gate;            ///< Gate under test
+  uint8_t reader;                  ///< Reader of this lane (lane number)
+  uint8_t irPin;                   ///< Sensor pin the cars cover
+  std::deque<SimCar> queue;        ///< Waiting cars, front one is next
+  SimCar car;                      ///< Car at the barrier
+  SimPhase phase;                  ///< What that car is doing
+  uint64_t phaseUntil;             ///< Virtual ms the current phase ends
+  CardUid lastScanned;             ///< Duplicate-read filter, as in main.ino
+  size_t maxQueue;                 ///< Longest queue seen
+};
+
+static TimeSync timeSync;
+static RFIDManager rfid;
+static SlotManager slots(timeSync);
+static GateController entranceGate("ENTRANCE", IR_IN_PIN, SERVO_IN_PIN);
+static GateController exitGate("EXIT", IR_OUT_PIN, SERVO_OUT_PIN, 1);
+static ReaderScheduler readerScheduler;
+
+static SimLane entrance;
+static SimLane exitLane;
+static std::vector<SimCar> parked;      // Cars inside, in arrival order
+static std::vector<bool> cardBusy;      // Known card is inside or queued
+static std::vector<double> waitsMs;     // Arrival to open barrier, entrances
+
+static unsigned long entries = 0;
+static unsigned long exits = 0;
+static unsigned long deniedUnknown = 0;
+static unsigned long turnedAway = 0;
+static unsigned long scanTimeouts = 0;
+static int lastEntrySlot = -1;
+
+static uint64_t now() {
+  return TimeSync::monotonicMillis();
+}
+
+static void onEntranceEvent(const GateEventData& event) {
+  switch (event.event) {
+    case EVENT_CARD_SCANNED: lastEntrySlot = event.slotNumber; break;
+    case EVENT_CARD_DENIED:  deniedUnknown++; break;
+    case EVENT_PARKING_FULL: turnedAway++; break;
+    case EVENT_TIMEOUT:      scanTimeouts++; break;
+    default: break;
+  }
+}
+
+static void onExitEvent(const GateEventData& event) {
+  switch (event.event) {
+    case EVENT_CARD_SCANNED:
+      if (event.slotNumber > 0) {
+        slots.releaseSlot(event.slotNumber);
+      }
+      break;
+    case EVENT_TIMEOUT:
+      scanTimeouts++;
+      break;
+    default:
+      break;
+  }
+}
+
+static void initLane(SimLane& lane, GateController* gate, uint8_t reader,
+                     uint8_t irPin) {
+  lane.gate = gate;
+  lane.reader = reader;
+  lane.irPin = irPin;
+  lane.phase = PHASE_EMPTY;
+  lane.phaseUntil = 0;
+  lane.lastScanned.clear();
+  lane.maxQueue = 0;
+}
+
+/**
+ * @brief Read and act on the card at one lane (processLaneCard)
+ */
+static void processLane(SimLane& lane, bool isEntrance) {
+  CardUid uid;
+  if (rfid.readCard(lane.reader, uid) && uid != lane.lastScanned) {
+    lane.lastScanned = uid;
+
+    int accessLevel;
+    bool authorized = rfid.isAuthorized(uid, accessLevel);
+    int slotNumber = -1;
+    bool parkingFull = false;
+
+    if (isEntrance) {
+      if (authorized) {
+        slotNumber = slots.allocateSlot(uid, accessLevel);
+        parkingFull = (slotNumber == -1);
+      }
+    } else if (authorized) {
+      slotNumber = slots.findSlotByCard(uid);
+      if (slotNumber == -1) {
+        slotNumber = 0;
+      }
+    }
+    lane.gate->handleCardScanned(uid, authorized, slotNumber, parkingFull);
+  }
+}
+
+/**
+ * @brief One gate-task pass over both lanes (processLanes)
+ */
+static void processLanes() {
+  SimLane* lanes[2] = { &entrance, &exitLane };
+  for (uint8_t i = 0; i < 2; i++) {
+    bool waiting = (lanes[i]->gate->getState() == STATE_WAITING_CARD);
+    readerScheduler.setWaiting(lanes[i]->reader, waiting);
+    rfid.setPollingEnabled(lanes[i]->reader, waiting);
+  }
+
+  uint8_t polled[2];
+  uint8_t count = readerScheduler.schedule(polled, RFID_POLLS_PER_ITERATION, false);
+  for (uint8_t i = 0; i < count; i++) {
+    processLane(*lanes[polled[i]], polled[i] == entrance.reader);
+  }
+
+  for (uint8_t i = 0; i < 2; i++) {
+    if (!lanes[i]->gate->isVehicleDetected() && !lanes[i]->lastScanned.isEmpty()) {
+      lanes[i]->lastScanned.clear();
+    }
+  }
+}
+
+/**
+ * @brief Move the car at the barrier along; returns true when it has gone
+ */
+static bool driveLane(SimLane& lane, bool isEntrance, bench::Random& random) {
+  uint64_t t = now();
+  GateState state = lane.gate->getState();
+
+  switch (lane.phase) {
+    case PHASE_EMPTY:
+      // Drivers wait for the barrier to come down before pulling up
+      if (!lane.queue.empty() && state == STATE_IDLE && !lane.gate->isVehicleDetected()) {
+        lane.car = lane.queue.front();
+        lane.queue.pop_front();
+        lane.phase = PHASE_PULLING_UP;
+        lane.phaseUntil = t + SIM_PULL_UP_MS;
+      }
+      break;
+
+    case PHASE_PULLING_UP:
+      if (t >= lane.phaseUntil) {
+        shim::setPin(lane.irPin, LOW);
+        lane.phase = PHASE_AT_SENSOR;
+        lane.phaseUntil = t + SIM_CARD_DELAY_MS;
+      }
+      break;
+
+    case PHASE_AT_SENSOR:
+      if (t >= lane.phaseUntil) {
+        CardUid uid = bench::makeCard(lane.car.card);
+        rfid.getReader(lane.reader)->presentCard(uid.bytes, uid.length);
+        lane.phase = PHASE_AT_READER;
+      }
+      break;
+
+    case PHASE_AT_READER:
+      if (state == STATE_BARRIER_OPEN) {
+        if (isEntrance) {
+          waitsMs.push_back((double)(t - lane.car.arrivedAt));
+        }
+        lane.phase = PHASE_DRIVING_THROUGH;
+        lane.phaseUntil = t + SIM_DRIVE_THROUGH_MS;
+      } else if (state == STATE_MESSAGE_HOLD) {
+        lane.phase = PHASE_BACKING_OUT;
+      } else if (state == STATE_IDLE) {
+        // Scan timeout: the gate gave up on this car
+        rfid.getReader(lane.reader)->removeCard();
+        lane.phase = PHASE_CLEARING;
+        lane.phaseUntil = t + SIM_BACK_OUT_MS;
+      }
+      break;
+
+    case PHASE_DRIVING_THROUGH:
+      if (t >= lane.phaseUntil) {
+        shim::setPin(lane.irPin, HIGH);
+        if (isEntrance) {
+          entries++;
+          lane.car.slot = lastEntrySlot;
+          lane.car.leaveAt = t + (uint64_t)random.exponential(SIM_MEAN_STAY_MIN * 60000.0);
+          parked.push_back(lane.car);
+        } else {
+          exits++;
+          cardBusy[lane.car.card] = false;
+        }
+        lane.phase = PHASE_EMPTY;
+        return true;
+      }
+      break;
+
+    case PHASE_BACKING_OUT:
+      if (state == STATE_IDLE) {
+        lane.phase = PHASE_CLEARING;
+        lane.phaseUntil = t + SIM_BACK_OUT_MS;
+      }
+      break;
+
+    case PHASE_CLEARING:
+      if (t >= lane.phaseUntil) {
+        shim::setPin(lane.irPin, HIGH);
+        if (lane.car.card < cardBusy.size()) {
+          cardBusy[lane.car.card] = false;
+        }
+        lane.phase = PHASE_EMPTY;
+        return true;
+      }
+      break;
+  }
+  return false;
+}
+
+/**
+ * @brief Entrance arrivals per hour at a point of the run (triangular peak)
+ */
+static double arrivalRate(uint64_t elapsedMs) {
+  double progress = (double)elapsedMs / (SIM_DURATION_MIN * 60000.0);
+  double peak = 1.0 - fabs(2.0 * progress - 1.0);
+  return SIM_BASE_ARRIVALS_PER_HOUR +
+         (SIM_PEAK_ARRIVALS_PER_HOUR - SIM_BASE_ARRIVALS_PER_HOUR) * peak;
+}
+
+static uint32_t pickArrivalCard(bench::Random& random) {
+  if (random.below(100) < SIM_UNKNOWN_CARD_PERCENT) {
+    return SIM_UNKNOWN_CARD_BASE + random.below(SIM_UNKNOWN_CARD_BASE);
+  }
+  // A known card whose car is not already inside or queued
+  for (int attempt = 0; attempt < MAX_RFID_CARDS; attempt++) {
+    uint32_t card = random.below(MAX_RFID_CARDS);
+    if (!cardBusy[card]) {
+      cardBusy[card] = true;
+      return card;
+    }
+  }
+  return SIM_UNKNOWN_CARD_BASE + random.below(SIM_UNKNOWN_CARD_BASE);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_rush_hour() {
+  bench::Random random(2024);
+  uint64_t start = now();
+  uint64_t trafficEnd = start + (uint64_t)SIM_DURATION_MIN * 60000;
+  uint64_t drainEnd = trafficEnd + (uint64_t)SIM_DRAIN_MIN * 60000;
+  uint64_t settleEnd = drainEnd + (uint64_t)SIM_SETTLE_MAX_MIN * 60000;
+  uint64_t nextArrival = start + (uint64_t)random.exponential(3600000.0 / arrivalRate(0));
+  unsigned long iterations = 0;
+
+  int64_t hostStart = bench::hostNanos();
+  for (;;) {
+    shim::advanceTime((int64_t)GATE_TASK_PERIOD_MS * 1000);
+    uint64_t t = now();
+
+    // Thinned Poisson arrivals: rate follows the rush-hour curve
+    while (t < trafficEnd && t >= nextArrival) {
+      SimCar car = {};
+      car.card = pickArrivalCard(random);
+      car.arrivedAt = nextArrival;
+      entrance.queue.push_back(car);
+      nextArrival += (uint64_t)random.exponential(3600000.0 / arrivalRate(nextArrival - start));
+    }
+
+    // Parked cars whose stay is over queue at the exit; the rest stay overnight
+    for (size_t i = 0; i < parked.size();) {
+      if (parked[i].leaveAt <= t && t < drainEnd) {
+        exitLane.queue.push_back(parked[i]);
+        parked.erase(parked.begin() + i);
+      } else {
+        i++;
+      }
+    }
+
+    driveLane(entrance, true, random);
+    driveLane(exitLane, false, random);
+    entrance.maxQueue = std::max(entrance.maxQueue, entrance.queue.size());
+    exitLane.maxQueue = std::max(exitLane.maxQueue, exitLane.queue.size());
+
+    // The gate task's loop body
+    processLanes();
+    entranceGate.update();
+    exitGate.update();
+    iterations++;
+
+    bool lanesIdle = entrance.phase == PHASE_EMPTY && entrance.queue.empty() &&
+                     exitLane.phase == PHASE_EMPTY && exitLane.queue.empty() &&
+                     entranceGate.getState() == STATE_IDLE && exitGate.getState() == STATE_IDLE;
+    if ((t >= drainEnd && lanesIdle) || t >= settleEnd) {
+      break;
+    }
+  }
+  int64_t hostNs = bench::hostNanos() - hostStart;
+
+  std::sort(waitsMs.begin(), waitsMs.end());
+  double waitP50 = waitsMs.empty() ? 0 : waitsMs[waitsMs.size() / 2];
+  double waitP99 = waitsMs.empty() ? 0 : waitsMs[waitsMs.size() * 99 / 100];
+
+  bench::report("sim_gate_iteration", (double)hostNs / iterations, "ns/op");
+  bench::report("sim_entries", entries, "cars");
+  bench::report("sim_exits", exits, "cars");
+  bench::report("sim_denied_unknown", deniedUnknown, "cars");
+  bench::report("sim_turned_away_full", turnedAway, "cars");
+  bench::report("sim_entrance_wait_p50", waitP50 / 1000.0, "s");
+  bench::report("sim_entrance_wait_p99", waitP99 / 1000.0, "s");
+  bench::report("sim_entrance_queue_max", entrance.maxQueue, "cars");
+  bench::report("sim_exit_queue_max", exitLane.maxQueue, "cars");
+
+  // Every car at a reader got an answer and nobody is left mid-barrier
+  TEST_ASSERT_EQUAL(0, scanTimeouts);
+  TEST_ASSERT_GREATER_THAN(0, entries);
+  TEST_ASSERT_GREATER_THAN(0, exits);
+  TEST_ASSERT_GREATER_THAN(0, deniedUnknown);
+  TEST_ASSERT_EQUAL(STATE_IDLE, entranceGate.getState());
+  TEST_ASSERT_EQUAL(STATE_IDLE, exitGate.getState());
+  TEST_ASSERT_EQUAL(0, entrance.queue.size());
+  TEST_ASSERT_EQUAL(0, exitLane.queue.size());
+
+  // Slot bookkeeping matches the cars still inside
+  TEST_ASSERT_EQUAL(entries - exits, parked.size());
+  TEST_ASSERT_EQUAL(TOTAL_SLOTS - (int)parked.size(), slots.getAvailableSlots());
+  for (size_t i = 0; i < parked.size(); i++) {
+    TEST_ASSERT_EQUAL(parked[i].slot, slots.findSlotByCard(bench::makeCard(parked[i].card)));
+  }
+}
+
+int main(int argc, char** argv) {
+  // Start well past boot so "since boot" deadlines never go negative
+  shim::useVirtualClock(3600LL * 1000000);
+  shim::nvsReset();
+
+  rfid.addReader(RFID_IN_SS, RFID_IN_RST);
+  rfid.addReader(RFID_OUT_SS, RFID_OUT_RST);
+  rfid.begin();
+  rfid.clearAllCards();
+  rfid.beginTransaction();
+  for (int i = 0; i < MAX_RFID_CARDS; i++) {
+    rfid.addCard(bench::makeCard(i), "Sim", ACCESS_REGULAR);
+  }
+  rfid.commitTransaction();
+  cardBusy.assign(MAX_RFID_CARDS, false);
+
+  slots.begin();
+  entranceGate.begin();
+  exitGate.begin();
+  entranceGate.setEventCallback(onEntranceEvent);
+  exitGate.setEventCallback(onExitEvent);
+  readerScheduler.begin(2);
+  initLane(entrance, &entranceGate, 0, IR_IN_PIN);
+  initLane(exitLane, &exitGate, 1, IR_OUT_PIN);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_rush_hour);
+  return UNITY_END();
+}